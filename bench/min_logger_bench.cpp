@@ -0,0 +1,343 @@
+/*
+ * Microbenchmarks for the logging macros, the built-in serializers and LockFreeRingBuffer.
+ *
+ * Results are printed as JSON so they can be compared between releases:
+ *   min_logger_bench [--quick] [--max_writers=N] [--output=results.json]
+ *
+ * min_logger_write() is replaced with a sink that only counts bytes, so the macro results are the
+ * cost of the level check and serialization without a transport.
+ */
+
+#include <min_logger/min_logger.h>
+#include <min_logger/platform_implementations/lock_free_ring_buffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef MIN_LOGGER_VERSION
+    #define MIN_LOGGER_VERSION "unknown"
+#endif
+
+// Timed runs of each benchmark. The fastest is reported to filter out scheduling noise.
+static constexpr int REPEATS = 5;
+static constexpr uint32_t RING_BUFFER_SIZE = 1 << 20;
+
+static uint64_t sink_bytes = 0;
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) { sink_bytes += len_bytes; }
+
+static uint64_t NowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static const char* CYCLE_COUNTER_NAME = "rdtsc";
+static uint64_t ReadCycles() { return __builtin_ia32_rdtsc(); }
+#elif defined(__aarch64__)
+static const char* CYCLE_COUNTER_NAME = "cntvct_el0";
+static uint64_t ReadCycles() {
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+}
+#else
+static const char* CYCLE_COUNTER_NAME = nullptr;
+static uint64_t ReadCycles() { return 0; }
+#endif
+
+struct CallResult {
+    std::string name;
+    std::string format;
+    size_t payload_bytes;
+    double ns_per_call;
+    double cycles_per_call;
+    double bytes_per_call;
+};
+
+struct RingBufferResult {
+    unsigned writers;
+    uint64_t messages;
+    double messages_per_second;
+    double megabytes_per_second;
+    uint64_t full_retries;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_max_ns;
+};
+
+// Runs func iterations times per repeat, after a warm up.
+template <typename Func>
+static CallResult TimeCalls(const char* name, const char* format, size_t payload_bytes,
+                            uint64_t iterations, Func func) {
+    for (uint64_t i = 0; i < iterations / 10; i++) {
+        func();
+    }
+    min_logger_flush_block();
+
+    CallResult result = {name, format, payload_bytes, 0, 0, 0};
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        uint64_t start_bytes = sink_bytes;
+        uint64_t start_ns = NowNanoseconds();
+        uint64_t start_cycles = ReadCycles();
+        for (uint64_t i = 0; i < iterations; i++) {
+            func();
+        }
+        uint64_t cycles = ReadCycles() - start_cycles;
+        uint64_t ns = NowNanoseconds() - start_ns;
+        min_logger_flush_block();
+
+        double ns_per_call = double(ns) / iterations;
+        if (repeat == 0 || ns_per_call < result.ns_per_call) {
+            result.ns_per_call = ns_per_call;
+            result.cycles_per_call = double(cycles) / iterations;
+            result.bytes_per_call = double(sink_bytes - start_bytes) / iterations;
+        }
+    }
+    return result;
+}
+
+template <size_t N>
+struct Payload {
+    uint8_t data[N];
+};
+
+// The macro's type check can't be used with a dependent type, so each size gets a function.
+#define BENCH_RECORD_VALUE_FUNC(N)                                                      \
+    static void RecordValue##N(const Payload<N>& value) {                               \
+        MIN_LOGGER_RECORD_VALUE(MIN_LOGGER_INFO, "bench_value_" #N, Payload<N>, value); \
+    }
+BENCH_RECORD_VALUE_FUNC(4)
+BENCH_RECORD_VALUE_FUNC(16)
+BENCH_RECORD_VALUE_FUNC(64)
+BENCH_RECORD_VALUE_FUNC(240)
+
+static void RecordArray(const uint8_t* values, size_t num_values) {
+    MIN_LOGGER_RECORD_VALUE_ARRAY(MIN_LOGGER_INFO, "bench_array", uint8_t, values, num_values);
+}
+
+template <size_t N>
+static void AddRecordValueResult(std::vector<CallResult>* results, const char* format,
+                                 uint64_t iterations, void (*record)(const Payload<N>&)) {
+    Payload<N> value;
+    memset(&value, 0x5A, sizeof(value));
+    results->push_back(TimeCalls("record_value", format, N, iterations,
+                                 [&value, record]() { record(value); }));
+}
+
+static std::vector<CallResult> RunMacroBenchmarks(uint64_t iterations) {
+    static const struct {
+        const char* name;
+        MinLoggerSerializeCallBack format;
+    } FORMATS[] = {
+        {"BINARY", MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT},
+        {"MICRO", MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT},
+        {"MICRO_THREAD", MIN_LOGGER_MICRO_THREAD_BINARY_SERIALIZED_FORMAT},
+#if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+        {"BLOCK", MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT},
+#endif
+    };
+    static const size_t ARRAY_SIZES[] = {1, 16, 64, 240};
+
+    std::vector<CallResult> results;
+    uint8_t array[240];
+    memset(array, 0x5A, sizeof(array));
+
+    for (const auto& format : FORMATS) {
+        min_logger_set_serialize_format(format.format);
+        min_logger_set_level(MIN_LOGGER_INFO);
+
+        results.push_back(TimeCalls("log", format.name, 0, iterations, []() {
+            MIN_LOGGER_LOG(MIN_LOGGER_INFO, "bench log");
+        }));
+        AddRecordValueResult<4>(&results, format.name, iterations, RecordValue4);
+        AddRecordValueResult<16>(&results, format.name, iterations, RecordValue16);
+        AddRecordValueResult<64>(&results, format.name, iterations, RecordValue64);
+        AddRecordValueResult<240>(&results, format.name, iterations, RecordValue240);
+        for (size_t size : ARRAY_SIZES) {
+            results.push_back(TimeCalls("record_value_array", format.name, size, iterations,
+                                        [&array, size]() { RecordArray(array, size); }));
+        }
+
+        // Compiled in, but filtered out by the runtime level.
+        min_logger_set_level(MIN_LOGGER_DEBUG);
+        results.push_back(TimeCalls("log_filtered", format.name, 0, iterations, []() {
+            MIN_LOGGER_LOG(MIN_LOGGER_INFO, "bench filtered log");
+        }));
+    }
+    return results;
+}
+
+struct RingBufferMsg {
+    uint64_t write_ns;
+    uint32_t writer;
+    uint32_t sequence;
+    uint8_t padding[16];
+};
+
+// Writers send timestamped messages while a reader drains the buffer. TryWrite() is used so the
+// reader sees every message, and is retried when the buffer is full.
+static RingBufferResult RunRingBuffer(unsigned num_writers, uint64_t messages_per_writer) {
+    std::vector<uint8_t> buffer(RING_BUFFER_SIZE);
+    LockFreeRingBuffer ring_buffer(buffer.data(), RING_BUFFER_SIZE);
+    LockFreeRingBufferReader reader(&ring_buffer);
+
+    const uint64_t total_messages = messages_per_writer * num_writers;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(total_messages);
+    std::atomic<uint64_t> full_retries{0};
+
+    uint64_t start_ns = NowNanoseconds();
+    std::vector<std::thread> writers;
+    for (unsigned writer = 0; writer < num_writers; writer++) {
+        writers.emplace_back([&ring_buffer, &full_retries, writer, messages_per_writer]() {
+            RingBufferMsg msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.writer = writer;
+            uint64_t retries = 0;
+            for (uint64_t i = 0; i < messages_per_writer; i++) {
+                msg.sequence = static_cast<uint32_t>(i);
+                msg.write_ns = NowNanoseconds();
+                while (!ring_buffer.TryWrite(&msg, sizeof(msg))) {
+                    retries++;
+                    std::this_thread::yield();
+                    msg.write_ns = NowNanoseconds();
+                }
+            }
+            full_retries += retries;
+        });
+    }
+
+    // Writes are all the same size, so reads stay aligned to the start of a message.
+    RingBufferMsg msgs[256];
+    while (latencies.size() < total_messages) {
+        size_t size_read = 0;
+        if (!reader.Read(msgs, &size_read, sizeof(msgs))) {
+            fprintf(stderr, "Ring buffer overflowed while reading\n");
+            exit(1);
+        }
+        if (size_read == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t read_ns = NowNanoseconds();
+        for (size_t i = 0; i < size_read / sizeof(RingBufferMsg); i++) {
+            latencies.push_back(read_ns - msgs[i].write_ns);
+        }
+    }
+    uint64_t elapsed_ns = NowNanoseconds() - start_ns;
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    RingBufferResult result;
+    result.writers = num_writers;
+    result.messages = total_messages;
+    result.messages_per_second = total_messages * 1e9 / elapsed_ns;
+    result.megabytes_per_second = total_messages * sizeof(RingBufferMsg) * 1e3 / elapsed_ns;
+    result.full_retries = full_retries;
+    result.latency_p50_ns = latencies[latencies.size() / 2];
+    result.latency_p99_ns = latencies[latencies.size() * 99 / 100];
+    result.latency_max_ns = latencies.back();
+    return result;
+}
+
+static void WriteJson(FILE* out, uint64_t iterations, const std::vector<CallResult>& calls,
+                      const std::vector<RingBufferResult>& ring_buffers,
+                      uint64_t ring_buffer_messages) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": \"%s\",\n", MIN_LOGGER_VERSION);
+    if (CYCLE_COUNTER_NAME != nullptr) {
+        fprintf(out, "  \"cycle_counter\": \"%s\",\n", CYCLE_COUNTER_NAME);
+    } else {
+        fprintf(out, "  \"cycle_counter\": null,\n");
+    }
+    fprintf(out, "  \"iterations\": %llu,\n", (unsigned long long)iterations);
+    fprintf(out, "  \"calls\": [\n");
+    for (size_t i = 0; i < calls.size(); i++) {
+        const CallResult& call = calls[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"format\": \"%s\", \"payload_bytes\": %zu, "
+                "\"ns_per_call\": %.2f, \"cycles_per_call\": ",
+                call.name.c_str(), call.format.c_str(), call.payload_bytes, call.ns_per_call);
+        if (CYCLE_COUNTER_NAME != nullptr) {
+            fprintf(out, "%.2f", call.cycles_per_call);
+        } else {
+            fprintf(out, "null");
+        }
+        fprintf(out, ", \"bytes_per_call\": %.2f}%s\n", call.bytes_per_call,
+                (i + 1 < calls.size()) ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+    fprintf(out, "  \"ring_buffer\": {\n");
+    fprintf(out, "    \"buffer_bytes\": %u,\n", RING_BUFFER_SIZE);
+    fprintf(out, "    \"message_bytes\": %zu,\n", sizeof(RingBufferMsg));
+    fprintf(out, "    \"messages_per_writer\": %llu,\n",
+            (unsigned long long)ring_buffer_messages);
+    fprintf(out, "    \"runs\": [\n");
+    for (size_t i = 0; i < ring_buffers.size(); i++) {
+        const RingBufferResult& run = ring_buffers[i];
+        fprintf(out,
+                "      {\"writers\": %u, \"messages_per_second\": %.0f, "
+                "\"megabytes_per_second\": %.2f, \"full_retries\": %llu, "
+                "\"reader_latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu}}%s\n",
+                run.writers, run.messages_per_second, run.megabytes_per_second,
+                (unsigned long long)run.full_retries, (unsigned long long)run.latency_p50_ns,
+                (unsigned long long)run.latency_p99_ns, (unsigned long long)run.latency_max_ns,
+                (i + 1 < ring_buffers.size()) ? "," : "");
+    }
+    fprintf(out, "    ]\n");
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv) {
+    uint64_t iterations = 1000000;
+    uint64_t ring_buffer_messages = 200000;
+    unsigned max_writers = std::max(std::thread::hardware_concurrency(), 1u);
+    const char* output_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            iterations /= 100;
+            ring_buffer_messages /= 100;
+        } else if (strncmp(argv[i], "--max_writers=", 14) == 0) {
+            max_writers = std::max(atoi(argv[i] + 14), 1);
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            output_path = argv[i] + 9;
+        } else {
+            fprintf(stderr, "Usage: %s [--quick] [--max_writers=N] [--output=results.json]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<CallResult> calls = RunMacroBenchmarks(iterations);
+    std::vector<RingBufferResult> ring_buffers;
+    for (unsigned writers = 1; writers <= max_writers; writers++) {
+        ring_buffers.push_back(RunRingBuffer(writers, ring_buffer_messages));
+    }
+
+    FILE* out = stdout;
+    if (output_path != nullptr) {
+        out = fopen(output_path, "w");
+        if (out == nullptr) {
+            fprintf(stderr, "Couldn't open %s\n", output_path);
+            return 1;
+        }
+    }
+    WriteJson(out, iterations, calls, ring_buffers, ring_buffer_messages);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
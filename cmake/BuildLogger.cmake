@@ -4,10 +4,14 @@ function(build_min_logger src_dir dependant_target)
         set(EXTRA_ARGS "--type_defs=${ARGV2}")
     endif()
     set(GEN_META ${CMAKE_CURRENT_BINARY_DIR}/${dependant_target}_min_logger.json)
+    # The builder leaves the JSON alone when it's unchanged, so the stamp records when it last ran.
+    set(GEN_META_STAMP ${GEN_META}.stamp)
     get_target_property(TARGET_SOURCES ${dependant_target} SOURCES)
     add_custom_command(
-        OUTPUT ${GEN_META}
-        COMMAND uv --project ${CMAKE_SOURCE_DIR}/python run min-logger-builder ${src_dir} --root_paths ${CMAKE_SOURCE_DIR} --json_output ${GEN_META} ${EXTRA_ARGS}
+        OUTPUT ${GEN_META_STAMP}
+        BYPRODUCTS ${GEN_META}
+        COMMAND uv --project ${CMAKE_SOURCE_DIR}/python run min-logger-builder ${src_dir} --root_paths ${CMAKE_SOURCE_DIR} --json_output ${GEN_META} --cache ${GEN_META}.cache ${EXTRA_ARGS}
+        COMMAND ${CMAKE_COMMAND} -E touch ${GEN_META_STAMP}
         WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
         DEPENDS ${TARGET_SOURCES} ${type_defs_file}
     )
@@ -16,7 +20,7 @@ function(build_min_logger src_dir dependant_target)
     # This is needed so the meta data is actually generated.
     add_custom_target(
         ${dependant_target}_min_logger_meta
-        DEPENDS ${GEN_META}
+        DEPENDS ${GEN_META_STAMP}
     )
     add_dependencies(${dependant_target} ${dependant_target}_min_logger_meta)
 endfunction()
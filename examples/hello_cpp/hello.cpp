@@ -5,4 +5,18 @@ int main() {
     // Example parsed log message:
     // 15328834.560464 INFO  examples/hello_cpp/hello.cpp:7 hello_cpp] hello world binary
     MIN_LOGGER_LOG(MIN_LOGGER_INFO, "hello world binary");
+
+    for (int32_t i = 0; i < 10; i++) {
+        // Only every 5th call is sent. Parsed as:
+        // 15328834.560470 INFO  examples/hello_cpp/hello.cpp:12 hello_cpp] sampled: 5 [1 in 5]
+        MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_N(MIN_LOGGER_INFO, 5, "SAMPLED", int32_t, i,
+                                                "sampled: ${SAMPLED}");
+    }
+
+    for (int32_t i = 0; i < 10; i++) {
+        // Only sent when the value changes, so this prints "mode: 0", "mode: 1" and "mode: 2".
+        const int32_t mode = i / 4;
+        MIN_LOGGER_RECORD_AND_LOG_VALUE_ON_CHANGE(MIN_LOGGER_INFO, "MODE", int32_t, mode,
+                                                  "mode: ${MODE}");
+    }
 }
@@ -19,7 +19,16 @@ void task(string msg) {
         MIN_LOGGER_RECORD_AND_LOG_VALUE(MIN_LOGGER_INFO, "LOOP_COUNT", uint64_t, i,
                                         "task: ${LOOP_COUNT}");
         MIN_LOGGER_EXIT(MIN_LOGGER_DEBUG, "TASK_LOOP");
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        {
+            // Sends a single message with the duration when the scope exits.
+            MIN_LOGGER_SCOPE(MIN_LOGGER_DEBUG, "TASK_SLEEP");
+            auto start = std::chrono::steady_clock::now();
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            // Only the count, min, max, mean and std of the sleep times are sent.
+            double sleep_time =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            MIN_LOGGER_RECORD_STAT(MIN_LOGGER_INFO, "SLEEP_TIME", double, sleep_time);
+        }
     }
 }
 
@@ -40,4 +49,7 @@ int main(const int argc, const char** argv) {
     // execution.
     t1.join();
     t2.join();
+
+    // There's no buffered drain to flush the stats periodically, so send them before exiting.
+    min_logger_flush_stats();
 }
@@ -5,8 +5,12 @@ Build min-logger metadata from source files with MIN_LOGGER macros.
 
 from binascii import crc32
 from collections import defaultdict
+from concurrent.futures import ProcessPoolExecutor
 from enum import Enum, StrEnum, auto
+from hashlib import sha256
+import json
 import logging
+import os
 from pathlib import Path
 import re
 from typing import NamedTuple, Optional
@@ -28,6 +32,29 @@ class ProfilerType(StrEnum):
 
     ENTER = auto()
     EXIT = auto()
+    # A single record sent when a scope exits, with its duration as a uint32_t payload.
+    SCOPE = auto()
+    # Periodic summary of the values a call site recorded: {u32 count, f64 min, max, sum, sum_sq}.
+    STAT = auto()
+    # STAT followed by {f64 histogram_min, histogram_max, u32 buckets[8]}.
+    STAT_HISTOGRAM = auto()
+
+
+class SampleType(StrEnum):
+    """How a call site's messages are sampled"""
+
+    @staticmethod
+    def _generate_next_value_(name, start, count, last_values) -> str:
+        return name
+
+    # Every sample_value'th call is sent.
+    EVERY_N = auto()
+    # At most one call every sample_value milliseconds is sent.
+    EVERY_MS = auto()
+    # Calls are sent at up to sample_value per second, after a burst of sample_burst.
+    RATE_LIMITED = auto()
+    # Only calls where the value changed, or that follow a keyframe request, are sent.
+    ON_CHANGE = auto()
 
 
 class MetricEntryData(NamedTuple):
@@ -43,6 +70,9 @@ class MetricEntryData(NamedTuple):
     msg: Optional[str] = None
     name: Optional[str] = None
     profiler_type: Optional[ProfilerType] = None
+    sample_type: Optional[SampleType] = None
+    sample_value: Optional[float] = None
+    sample_burst: Optional[int] = None
 
 
 def json_dump_helper(obj):
@@ -57,8 +87,22 @@ def json_dump_helper(obj):
 SEVERITY_LEVELS = {"DEBUG": 10, "INFO": 20, "WARN": 30, "ERROR": 40, "CRITICAL": 50}
 
 THREAD_NAME_MSG_ID = 0xFFFFFF00
-
-RESERVED_IDS = {THREAD_NAME_MSG_ID}
+DROPPED_MSG_ID = 0xFFFFFF01
+TIME_CALIBRATION_MSG_ID = 0xFFFFFF02
+TIME_SYNC_MSG_ID = 0xFFFFFF03
+MICRO_SYNC_MSG_ID = 0xFFFFFF04
+CONTINUATION_MSG_ID = 0xFFFFFF05
+THREAD_REGISTRY_MSG_ID = 0xFFFFFF06
+
+RESERVED_IDS = {
+    THREAD_NAME_MSG_ID,
+    DROPPED_MSG_ID,
+    TIME_CALIBRATION_MSG_ID,
+    TIME_SYNC_MSG_ID,
+    MICRO_SYNC_MSG_ID,
+    CONTINUATION_MSG_ID,
+    THREAD_REGISTRY_MSG_ID,
+}
 
 
 def _parse_severity(level_str: str) -> Optional[int]:
@@ -72,6 +116,18 @@ def _parse_severity(level_str: str) -> Optional[int]:
         return None
 
 
+def _parse_number(value: str) -> Optional[float]:
+    # Allow C literal suffixes like 100u or 0.5f.
+    try:
+        return int(value.rstrip("uUlL"), 0)
+    except ValueError:
+        pass
+    try:
+        return float(value.rstrip("fFlL"))
+    except ValueError:
+        return None
+
+
 def _get_string_literal(value: str) -> Optional[str]:
     if len(value) < 2 or value[0] != '"' or value[-1] != '"':
         return None
@@ -98,17 +154,46 @@ _METRIC_RE = re.compile(r"^\s*MIN_LOGGER_[A-Z_]+\((.+?)\);", flags=re.DOTALL | r
 
 # MIN_LOGGER_LOG(MIN_LOGGER_INFO, "task{T_NAME}: {LOOP_COUNT}");
 # MIN_LOGGER_LOG_ID(0xDEADBEEF, MIN_LOS(_ID)?\((.GGER_INFO, "hello world trunc explicit ID");
-_LOG_METRIC_RE = re.compile(r"MIN_LOGGER_LOG(_ID)?\((.+?)\);", flags=re.DOTALL)
+# MIN_LOGGER_LOG_ISR_ID(0xDEADBEEF, MIN_LOGGER_INFO, "from an interrupt");
+_LOG_METRIC_RE = re.compile(
+    r"MIN_LOGGER_LOG(?:_(EVERY_N|EVERY_MS|RATE_LIMITED))?(?:_ISR)?(_ID)?\((.+?)\);",
+    flags=re.DOTALL,
+)
 # define MIN_LOGGER_RECORD_VALUE_ID(id, level, name, type, value)
 # define MIN_LOGGER_RECORD_AND_LOG_VALUE_ID(id, level, name, type, value, msg)
 # define MIN_LOGGER_RECORD_VALUE_ARRAY_ID(id, level, name, type, values, num_values)
 # define MIN_LOGGER_RECORD_AND_LOG_VALUE_ARRAY_ID(id, level, name, type, values, num_values, msg)
+# The sampled versions take their sampling arguments after the level:
+# define MIN_LOGGER_RECORD_VALUE_EVERY_N_ID(id, level, n, name, type, value)
+# define MIN_LOGGER_LOG_RATE_LIMITED(level, rate_hz, burst, msg)
+# define MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(id, level, name, type, value)
+# define MIN_LOGGER_RECORD_VALUE_ISR_ID(id, level, name, type, value)
 _RECORD_VALUE_METRIC_RE = re.compile(
-    r"MIN_LOGGER_RECORD(_AND_LOG)?_VALUE(_ARRAY)?(_ID)?\((.+?)\);", flags=re.DOTALL
+    r"MIN_LOGGER_RECORD(_AND_LOG)?_VALUE(_ARRAY)?"
+    r"(?:_(EVERY_N|EVERY_MS|RATE_LIMITED|ON_CHANGE))?(?:_ISR)?(_ID)?\((.+?)\);",
+    flags=re.DOTALL,
 )
+# Arguments each type of sampling adds after the level.
+_SAMPLE_ARGS = {
+    SampleType.EVERY_N: ["sample_value"],
+    SampleType.EVERY_MS: ["sample_value"],
+    SampleType.RATE_LIMITED: ["sample_value", "sample_burst"],
+    SampleType.ON_CHANGE: [],
+}
 # MIN_LOGGER_ENTER(MIN_LOGGER_DEBUG, "TASK_LOOP");
 # MIN_LOGGER_EXIT(MIN_LOGGER_DEBUG, "TASK_LOOP");
 _ENTER_METRIC_RE = re.compile(r"MIN_LOGGER_(ENTER|EXIT)(_ID)?\((.+?)\);", flags=re.DOTALL)
+# MIN_LOGGER_SCOPE(MIN_LOGGER_DEBUG, "TASK_LOOP");
+# MIN_LOGGER_SCOPE_END_ID(0xDEADBEEF, MIN_LOGGER_DEBUG, "TASK_LOOP");
+# MIN_LOGGER_SCOPE_BEGIN_ID doesn't send a message, so it's skipped.
+_SCOPE_METRIC_RE = re.compile(r"MIN_LOGGER_SCOPE(_END)?(_ID)?\((.+?)\);", flags=re.DOTALL)
+# MIN_LOGGER_RECORD_STAT(MIN_LOGGER_INFO, "loop_time", uint32_t, loop_time);
+# MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID(0xDEADBEEF, MIN_LOGGER_INFO, "loop_time", uint32_t, t, 0, 9);
+_STAT_METRIC_RE = re.compile(
+    r"MIN_LOGGER_RECORD_STAT(_HISTOGRAM)?(_ID)?\((.+?)\);", flags=re.DOTALL
+)
+# MIN_LOGGER_FILE_TAGS("network", "wifi");
+_FILE_TAGS_RE = re.compile(r"^\s*MIN_LOGGER_FILE_TAGS\((.*?)\);", flags=re.DOTALL | re.MULTILINE)
 
 
 def get_file_matches(src_paths: list[Path], extensions: list[str], recursive: bool) -> list[Path]:
@@ -135,168 +220,365 @@ def get_file_matches(src_paths: list[Path], extensions: list[str], recursive: bo
     return matches
 
 
-def get_metric_entries(files: list[Path], root_paths: list[Path]) -> dict[int, MetricEntryData]:
+def get_file_tags(content: str, file: Path) -> list[str]:
+    """Get the tags set with MIN_LOGGER_FILE_TAGS in a source file.
+
+    Args:
+        content: Contents of the source file.
+        file: Path of the source file for error messages.
+    """
+    tags: list[str] = []
+    for m in _FILE_TAGS_RE.finditer(content):
+        for arg in _parse_args(m.group(1)):
+            tag = _get_string_literal(arg)
+            if tag is None:
+                raise ValueError(f'Tag "{arg}" in {file} not string literal.')
+            if tag not in tags:
+                tags.append(tag)
+    return tags
+
+
+def get_file_entries(content: str, file: Path) -> list[MetricEntryData]:
+    """Parse metric macros from one source file.
+
+    IDs are only checked against RESERVED_IDS. Duplicates are checked by get_metric_entries().
+
+    Args:
+        content: Contents of the source file.
+        file: Path of the source file in the output, with the root path stripped.
+    """
+    entries: list[MetricEntryData] = []
+    file_tags = get_file_tags(content, file)
+
+    current_line = 1
+    last_pos = 0
+    for m in _METRIC_RE.finditer(content):
+        # The match can start with blank lines before the macro.
+        start = m.start() + len(m.group(0)) - len(m.group(0).lstrip())
+        current_line += content.count("\n", last_pos, start)
+        last_pos = start
+        line_num = current_line
+        location_str = f"{file}:{line_num}"
+        lines = m.group(0)
+
+        profiler_type: Optional[ProfilerType] = None
+        sample_type: Optional[SampleType] = None
+        parsed_args: list[str] = []
+        has_id = False
+        is_array = False
+
+        raw_strings = {
+            "severity": "",
+            "msg": None,
+            "name": None,
+            "msg_id": None,
+            "value_type": None,
+            "sample_value": None,
+            "sample_burst": None,
+        }
+
+        param_positions: dict[str, int] = {}
+
+        name = None
+        msg = None
+
+        m = _LOG_METRIC_RE.search(lines)
+        if m is not None:
+            sample_type = SampleType(m.group(1)) if m.group(1) else None
+            has_id = bool(m.group(2))
+            parsed_args = _parse_args(m.group(3))
+            param_positions["severity"] = 0
+            param_positions["msg"] = 1
+
+        m = _RECORD_VALUE_METRIC_RE.search(lines)
+        if m is not None:
+            has_msg = bool(m.group(1))
+            is_array = bool(m.group(2))
+            sample_type = SampleType(m.group(3)) if m.group(3) else None
+            has_id = bool(m.group(4))
+            parsed_args = _parse_args(m.group(5))
+            param_positions["severity"] = 0
+            param_positions["name"] = 1
+            param_positions["value_type"] = 2
+            param_positions["value"] = 3
+            if is_array:
+                param_positions["num_values"] = len(param_positions)
+            if has_msg:
+                param_positions["msg"] = len(param_positions)
+
+        m = _ENTER_METRIC_RE.search(lines)
+        if m is not None:
+            if m.group(1) == "ENTER":
+                profiler_type = ProfilerType.ENTER
+            else:
+                profiler_type = ProfilerType.EXIT
+            has_id = bool(m.group(2))
+            parsed_args = _parse_args(m.group(3))
+            param_positions["severity"] = 0
+            param_positions["name"] = 1
+
+        m = _SCOPE_METRIC_RE.search(lines)
+        if m is not None:
+            profiler_type = ProfilerType.SCOPE
+            has_id = bool(m.group(2))
+            parsed_args = _parse_args(m.group(3))
+            param_positions["severity"] = 0
+            param_positions["name"] = 1
+
+        m = _STAT_METRIC_RE.search(lines)
+        if m is not None:
+            if m.group(1):
+                profiler_type = ProfilerType.STAT_HISTOGRAM
+            else:
+                profiler_type = ProfilerType.STAT
+            has_id = bool(m.group(2))
+            parsed_args = _parse_args(m.group(3))
+            param_positions["severity"] = 0
+            param_positions["name"] = 1
+            param_positions["value_type"] = 2
+            param_positions["value"] = 3
+            if m.group(1):
+                param_positions["histogram_min"] = 4
+                param_positions["histogram_max"] = 5
+
+        if len(param_positions) > 0:
+            error_msg = f'Could not parse "{lines.strip()}" at {location_str}.'
+
+            if sample_type is not None:
+                sample_args = _SAMPLE_ARGS[sample_type]
+                for key in param_positions:
+                    if param_positions[key] > 0:
+                        param_positions[key] += len(sample_args)
+                for i, key in enumerate(sample_args):
+                    param_positions[key] = i + 1
+
+            if has_id:
+                for key in param_positions:
+                    param_positions[key] += 1
+                param_positions["msg_id"] = 0
+
+            if len(param_positions) != len(parsed_args):
+                raise ValueError(
+                    f"{error_msg} Expected {len(param_positions)} args, parsed {len(parsed_args)}."
+                )
+
+            for param, idx in param_positions.items():
+                raw_strings[param] = parsed_args[idx]
+
+            severity = _parse_severity(raw_strings["severity"])
+            if severity is None:
+                raise ValueError(
+                    f'{error_msg} Could not parse severiy level "{raw_strings["severity"]}".'
+                )
+
+            if raw_strings["msg"] is not None:
+                msg = _get_string_literal(raw_strings["msg"])
+                if msg is None:
+                    raise ValueError(
+                        f'{error_msg} Log message "{raw_strings["msg"]}" not string literal.'
+                    )
+
+            if raw_strings["name"] is not None:
+                name = _get_string_literal(raw_strings["name"])
+                if name is None:
+                    raise ValueError(
+                        f'{error_msg} Metric name "{raw_strings["name"]}" not string literal.'
+                    )
+
+            sample_value = None
+            sample_burst = None
+            if sample_type is not None and _SAMPLE_ARGS[sample_type]:
+                sample_value = _parse_number(raw_strings["sample_value"])
+                if sample_value is None or sample_value <= 0:
+                    raise ValueError(
+                        f'{error_msg} Sampling "{raw_strings["sample_value"]}" not positive number literal.'
+                    )
+            if sample_type == SampleType.RATE_LIMITED:
+                burst = _parse_number(raw_strings["sample_burst"])
+                if not isinstance(burst, int) or burst < 1:
+                    raise ValueError(
+                        f'{error_msg} Burst "{raw_strings["sample_burst"]}" not positive integer literal.'
+                    )
+                sample_burst = int(burst)
+
+            if profiler_type == ProfilerType.STAT_HISTOGRAM:
+                histogram_min = _parse_number(raw_strings["histogram_min"])
+                histogram_max = _parse_number(raw_strings["histogram_max"])
+                if histogram_min is None or histogram_max is None or histogram_min >= histogram_max:
+                    raise ValueError(
+                        f"{error_msg} Histogram range must be increasing number literals."
+                    )
+
+            value_type = raw_strings["value_type"]
+            if profiler_type in {ProfilerType.STAT, ProfilerType.STAT_HISTOGRAM}:
+                # The payload is the summary, not a value of the recorded type.
+                value_type = None
+
+            metric_id = 0
+            if raw_strings["msg_id"] is not None:
+                try:
+                    metric_id = int(raw_strings["msg_id"], 0)
+                except ValueError:
+                    raise ValueError(
+                        f'{error_msg} Could not parse ID "{raw_strings["msg_id"]}" as integer.'
+                    )
+            else:
+                metric_id = crc32(location_str.encode())
+
+            if metric_id in RESERVED_IDS:
+                raise ValueError(f'Can\'t use reserved ID "{metric_id}" in {location_str}.')
+
+            entries.append(
+                MetricEntryData(
+                    id=metric_id,
+                    value_type=value_type,
+                    is_array=is_array,
+                    profiler_type=profiler_type,
+                    source_file=file,
+                    source_line=line_num,
+                    level=severity,
+                    tags=list(file_tags),
+                    msg=msg,
+                    name=name,
+                    sample_type=sample_type,
+                    sample_value=sample_value,
+                    sample_burst=sample_burst,
+                )
+            )
+
+    return entries
+
+
+# Files are only scanned in worker processes when at least this many changed, since starting the
+# processes takes longer than scanning a few files.
+MIN_PARALLEL_FILES = 64
+
+
+def _builder_hash() -> str:
+    # Cached entries are only reused by the version of the builder that made them.
+    with open(__file__, "rb") as fd:
+        return sha256(fd.read()).hexdigest()
+
+
+def _entry_from_json(data: dict) -> MetricEntryData:
+    entry = MetricEntryData(**data)
+    return entry._replace(
+        source_file=Path(entry.source_file),
+        profiler_type=None if entry.profiler_type is None else ProfilerType(entry.profiler_type),
+        sample_type=None if entry.sample_type is None else SampleType(entry.sample_type),
+    )
+
+
+def _load_cache(cache_file: Path) -> dict[str, dict]:
+    try:
+        with open(cache_file) as fd:
+            cache = json.load(fd)
+    except (OSError, ValueError):
+        return {}
+    if not isinstance(cache, dict) or cache.get("builder") != _builder_hash():
+        return {}
+    return cache.get("files", {})
+
+
+def _save_cache(cache_file: Path, files: dict[str, dict]):
+    # Written to a temporary file first, so an interrupted build doesn't leave a partial cache.
+    tmp_file = Path(f"{cache_file}.tmp")
+    with open(tmp_file, "w") as fd:
+        json.dump({"builder": _builder_hash(), "files": files}, fd, default=json_dump_helper)
+    os.replace(tmp_file, cache_file)
+
+
+def _scan_files(
+    contents: list[str], files: list[Path], jobs: Optional[int]
+) -> list[list[MetricEntryData]]:
+    if jobs is None:
+        jobs = os.cpu_count() or 1
+    if jobs > 1 and len(files) >= MIN_PARALLEL_FILES:
+        chunksize = max(1, len(files) // (jobs * 4))
+        with ProcessPoolExecutor(jobs) as executor:
+            return list(executor.map(get_file_entries, contents, files, chunksize=chunksize))
+    return [get_file_entries(content, file) for content, file in zip(contents, files)]
+
+
+def get_metric_entries(
+    files: list[Path],
+    root_paths: list[Path],
+    cache_file: Optional[Path] = None,
+    jobs: Optional[int] = 1,
+) -> dict[int, MetricEntryData]:
     """Parse metric macros from source files.
 
     Args:
         files: Source files to scan for MIN_LOGGER macros.
+        root_paths: Root paths to strip from source file paths in the output.
+        cache_file: JSON file to keep each file's entries in, keyed by the SHA-256 of its contents.
+            Only files that changed since the last call are scanned again. Created if it doesn't
+            exist.
+        jobs: Number of processes to scan the changed files with. None uses every CPU.
     """
-    metrics: dict[int, MetricEntryData] = {}
-    name_table: dict[str, list[MetricEntryData]] = defaultdict(list)
+    cache = {} if cache_file is None else _load_cache(cache_file)
+    new_cache: dict[str, dict] = {}
+    file_entries: list[Optional[list[MetricEntryData]]] = []
+    scan_indices: list[int] = []
+    scan_contents: list[str] = []
+    scan_files: list[Path] = []
 
     for file in files:
         with open(file) as fd:
             content = fd.read()
-            for root in root_paths:
-                try:
-                    file = file.relative_to(root)
-                except ValueError:
-                    pass
-
-            current_line = 1
-            last_pos = 0
-            for m in _METRIC_RE.finditer(content):
-                current_line += content.count("\n", last_pos, m.start())
-                last_pos = m.start()
-                line_num = current_line
-                location_str = f"{file}:{line_num}"
-                lines = m.group(0)
-
-                profiler_type: Optional[ProfilerType] = None
-                parsed_args: list[str] = []
-                has_id = False
-                is_array = False
-
-                raw_strings = {
-                    "severity": "",
-                    "msg": None,
-                    "name": None,
-                    "msg_id": None,
-                    "value_type": None,
-                }
-
-                param_positions: dict[str, int] = {}
-
-                name = None
-                msg = None
-
-                m = _LOG_METRIC_RE.search(lines)
-                if m is not None:
-                    has_id = bool(m.group(1))
-                    parsed_args = _parse_args(m.group(2))
-                    param_positions["severity"] = 0
-                    param_positions["msg"] = 1
-
-                m = _RECORD_VALUE_METRIC_RE.search(lines)
-                if m is not None:
-                    has_msg = bool(m.group(1))
-                    is_array = bool(m.group(2))
-                    has_id = bool(m.group(3))
-                    parsed_args = _parse_args(m.group(4))
-                    param_positions["severity"] = 0
-                    param_positions["name"] = 1
-                    param_positions["value_type"] = 2
-                    param_positions["value"] = 3
-                    if is_array:
-                        param_positions["num_values"] = len(param_positions)
-                    if has_msg:
-                        param_positions["msg"] = len(param_positions)
-
-                m = _ENTER_METRIC_RE.search(lines)
-                if m is not None:
-                    if m.group(1) == "ENTER":
-                        profiler_type = ProfilerType.ENTER
-                    else:
-                        profiler_type = ProfilerType.EXIT
-                    has_id = bool(m.group(2))
-                    parsed_args = _parse_args(m.group(3))
-                    param_positions["severity"] = 0
-                    param_positions["name"] = 1
-
-                if len(param_positions) > 0:
-                    error_msg = f'Could not parse "{lines.strip()}" at {location_str}.'
-
-                    if has_id:
-                        for key in param_positions:
-                            param_positions[key] += 1
-                        param_positions["msg_id"] = 0
-
-                    if len(param_positions) != len(parsed_args):
-                        raise ValueError(
-                            f"{error_msg} Expected {len(param_positions)} args, parsed {len(parsed_args)}."
-                        )
-
-                    for param, idx in param_positions.items():
-                        raw_strings[param] = parsed_args[idx]
-
-                    severity = _parse_severity(raw_strings["severity"])
-                    if severity is None:
-                        raise ValueError(
-                            f'{error_msg} Could not parse severiy level "{raw_strings["severity"]}".'
-                        )
-
-                    if raw_strings["msg"] is not None:
-                        msg = _get_string_literal(raw_strings["msg"])
-                        if msg is None:
-                            raise ValueError(
-                                f'{error_msg} Log message "{raw_strings["msg"]}" not string literal.'
-                            )
-
-                    if raw_strings["name"] is not None:
-                        name = _get_string_literal(raw_strings["name"])
-                        if name is None:
-                            raise ValueError(
-                                f'{error_msg} Metric name "{raw_strings["name"]}" not string literal.'
-                            )
-
-                        if (
-                            profiler_type not in {ProfilerType.ENTER, ProfilerType.EXIT}
-                            and name in name_table
-                        ):
-                            others = name_table[name]
-                            other_location_str = f"{others[0].source_file}:{others[0].source_line}"
-                            _logger.warning(
-                                'Duplicate metric name "%s" in %s and %s.',
-                                name,
-                                other_location_str,
-                                location_str,
-                            )
-
-                    metric_id = 0
-                    if raw_strings["msg_id"] is not None:
-                        try:
-                            metric_id = int(raw_strings["msg_id"], 0)
-                        except ValueError:
-                            raise ValueError(
-                                f'{error_msg} Could not parse ID "{raw_strings["msg_id"]}" as integer.'
-                            )
-                    else:
-                        metric_id = crc32(location_str.encode())
-
-                    if metric_id in RESERVED_IDS:
-                        raise ValueError(f'Can\'t use reserved ID "{metric_id}" in {location_str}.')
-
-                    if metric_id in metrics:
-                        other = metrics[metric_id]
-                        other_location_str = f"{other.source_file}:{other.source_line}"
-                        raise ValueError(
-                            f'Duplicate ID "{metric_id}" in {other_location_str} and {location_str}.'
-                        )
-
-                    metrics[metric_id] = MetricEntryData(
-                        id=metric_id,
-                        value_type=raw_strings["value_type"],
-                        is_array=is_array,
-                        profiler_type=profiler_type,
-                        source_file=file,
-                        source_line=line_num,
-                        level=severity,
-                        tags=[],
-                        msg=msg,
-                        name=name,
+        for root in root_paths:
+            try:
+                file = file.relative_to(root)
+            except ValueError:
+                pass
+        digest = sha256(content.encode()).hexdigest()
+        cached = cache.get(str(file))
+        if cached is not None and cached["sha256"] == digest:
+            file_entries.append([_entry_from_json(e) for e in cached["entries"]])
+            new_cache[str(file)] = cached
+        else:
+            scan_indices.append(len(file_entries))
+            scan_contents.append(content)
+            scan_files.append(file)
+            file_entries.append(None)
+            new_cache[str(file)] = {"sha256": digest}
+
+    scanned = _scan_files(scan_contents, scan_files, jobs)
+    for i, file, entries in zip(scan_indices, scan_files, scanned):
+        file_entries[i] = entries
+        new_cache[str(file)]["entries"] = [e._asdict() for e in entries]
+
+    metrics: dict[int, MetricEntryData] = {}
+    name_table: dict[str, list[MetricEntryData]] = defaultdict(list)
+    for entries in file_entries:
+        assert entries is not None
+        for entry in entries:
+            location_str = f"{entry.source_file}:{entry.source_line}"
+            if entry.id in metrics:
+                other = metrics[entry.id]
+                other_location_str = f"{other.source_file}:{other.source_line}"
+                raise ValueError(
+                    f'Duplicate ID "{entry.id}" in {other_location_str} and {location_str}.'
+                )
+            if entry.name is not None:
+                if (
+                    entry.profiler_type
+                    not in {ProfilerType.ENTER, ProfilerType.EXIT, ProfilerType.SCOPE}
+                    and entry.name in name_table
+                ):
+                    others = name_table[entry.name]
+                    other_location_str = f"{others[0].source_file}:{others[0].source_line}"
+                    _logger.warning(
+                        'Duplicate metric name "%s" in %s and %s.',
+                        entry.name,
+                        other_location_str,
+                        location_str,
                     )
+                name_table[entry.name].append(entry)
+            metrics[entry.id] = entry
 
-                    if name is not None:
-                        name_table[name].append(metrics[metric_id])
+    # Rewritten when a file changed, or was added or removed.
+    if cache_file is not None and (scan_files or new_cache.keys() != cache.keys()):
+        _save_cache(cache_file, new_cache)
 
     return metrics
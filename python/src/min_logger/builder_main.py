@@ -11,7 +11,12 @@ from typing import Optional
 from jsonargparse import auto_cli
 from jsonargparse.typing import Path_fc, Path_fr, path_type
 
-from min_logger.builder import get_file_matches, get_metric_entries, json_dump_helper
+from min_logger.builder import (
+    get_file_matches,
+    get_metric_entries,
+    json_dump_helper,
+    ProfilerType,
+)
 from min_logger.parser import _c_type_to_python_data, SUBSTITUTE_PATTERN
 
 Path_dr = path_type("dw", docstring="path to a directory that exists and is writeable")
@@ -27,6 +32,8 @@ def command(
     extensions: list[str] = ["h", "hh", "hpp", "c", "cpp", "cc", "cxx"],
     recursive: bool = True,
     type_defs: Path_fr = None,  # pyright: ignore[reportInvalidTypeForm]
+    cache: Optional[Path_fc] = None,  # pyright: ignore[reportInvalidTypeForm]
+    jobs: Optional[int] = None,
 ):  # pylint: disable=dangerous-default-value
     """Generate min-logger metadata data files from source files with MIN_LOGGER macros.
 
@@ -37,6 +44,8 @@ def command(
         extensions: The extensions for source files with MIN_LOGGER macros.
         recursive: Search src_paths recursively.
         type_defs: A JSON map of C types to their python serialization
+        cache: File to cache each source file's entries in, so only changed files are scanned again.
+        jobs: Number of processes to scan changed files with. Defaults to the number of CPUs.
     """
 
     if json_output is None:
@@ -56,10 +65,18 @@ def command(
             type_defs_data = json.load(fd)
 
     candidate_files = get_file_matches(src_paths, extensions, recursive)
-    entries = get_metric_entries(candidate_files, root_paths)
+    entries = get_metric_entries(
+        candidate_files, root_paths, None if cache is None else Path(cache), jobs
+    )
 
     value_names = set(
-        e.name for e in entries.values() if e.name is not None and e.value_type is not None
+        e.name
+        for e in entries.values()
+        if e.name is not None
+        and (
+            e.value_type is not None
+            or e.profiler_type in {ProfilerType.STAT, ProfilerType.STAT_HISTOGRAM}
+        )
     )
     for entry in entries.values():
         if entry.value_type is not None:
@@ -77,8 +94,16 @@ def command(
 
     description = {"entries": [e._asdict() for e in entries.values()], "type_defs": type_defs_data}
 
+    # Leave the file alone if it's unchanged, so build steps that depend on it don't rerun.
+    output = json.dumps(description, default=json_dump_helper)
+    try:
+        with open(json_output, "r") as fd:
+            if fd.read() == output:
+                return
+    except OSError:
+        pass
     with open(json_output, "w") as fd:
-        json.dump(description, fd, default=json_dump_helper)
+        fd.write(output)
 
 
 def main():
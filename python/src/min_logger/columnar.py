@@ -0,0 +1,148 @@
+"""
+Write parsed metric values to columnar Parquet or Arrow IPC files.
+
+Needs pyarrow, which is an optional dependency: `uv sync --project python --extra arrow`
+"""
+
+from pathlib import Path
+from typing import Any
+
+# struct format characters to the pyarrow type factories.
+ARROW_TYPES = {
+    "b": "int8",
+    "B": "uint8",
+    "h": "int16",
+    "H": "uint16",
+    "i": "int32",
+    "I": "uint32",
+    "l": "int32",
+    "L": "uint32",
+    "q": "int64",
+    "Q": "uint64",
+    "P": "uint64",
+    "f": "float32",
+    "d": "float64",
+    "?": "bool_",
+    "s": "string",
+    "p": "string",
+    "c": "binary",
+}
+
+FORMATS = {"PARQUET": ".parquet", "ARROW": ".arrow"}
+
+
+def _import_pyarrow():
+    try:
+        import pyarrow
+        import pyarrow.ipc
+        import pyarrow.parquet
+    except ImportError as e:
+        raise ImportError(
+            "pyarrow is needed for columnar output: uv sync --project python --extra arrow"
+        ) from e
+    return pyarrow
+
+
+class _MetricColumns:
+    def __init__(self, pa, path: Path, out_format: str, fields: list[tuple[str, str]], indexed):
+        self.path = path
+        self.out_format = out_format
+        self.indexed = indexed
+        self.field_count = len(fields)
+        self.string_columns = [fmt in "sp" for _, fmt in fields]
+        self.types = [getattr(pa, ARROW_TYPES[fmt])() for _, fmt in fields]
+        implicit = [pa.field("timestamp", pa.float64())]
+        if indexed:
+            implicit.append(pa.field("index", pa.uint32()))
+        self.schema = pa.schema(
+            implicit + [pa.field(name, t) for (name, _), t in zip(fields, self.types)]
+        )
+        self.timestamps: list[float] = []
+        self.indices: list[int] = []
+        self.columns: list[list[Any]] = [[] for _ in fields]
+        self.writer = None
+
+    def append(self, timestamp: float, values: tuple):
+        if not self.indexed:
+            self.timestamps.append(timestamp)
+            for column, value in zip(self.columns, values):
+                column.append(value)
+            return
+
+        # An array's values are its elements' fields back to back.
+        count = len(values) // self.field_count if self.field_count else 0
+        self.timestamps.extend([timestamp] * count)
+        self.indices.extend(range(count))
+        for i, column in enumerate(self.columns):
+            column.extend(values[i :: self.field_count])
+
+    def flush(self, pa):
+        if not self.timestamps:
+            return
+        arrays = [pa.array(self.timestamps, pa.float64())]
+        if self.indexed:
+            arrays.append(pa.array(self.indices, pa.uint32()))
+        for column, is_string, column_type in zip(self.columns, self.string_columns, self.types):
+            if is_string:
+                column = [v.rstrip(b"\x00").decode("utf-8", "replace") for v in column]
+            arrays.append(pa.array(column, column_type))
+        table = pa.Table.from_arrays(arrays, schema=self.schema)
+
+        if self.writer is None:
+            if self.out_format == "PARQUET":
+                self.writer = pa.parquet.ParquetWriter(self.path, self.schema)
+            else:
+                self.writer = pa.ipc.new_file(self.path, self.schema)
+        self.writer.write_table(table)
+
+        self.timestamps = []
+        self.indices = []
+        self.columns = [[] for _ in self.columns]
+
+    def close(self, pa):
+        self.flush(pa)
+        if self.writer is not None:
+            self.writer.close()
+
+
+class ColumnarWriter:
+    """Buffers each metric's samples into typed columns, and writes them in batches.
+
+    Each metric gets a file with a timestamp column, an index column for arrays, and a column for
+    each of the value's fields, named like the CSV output.
+    """
+
+    # Rows buffered per metric before they're written.
+    BATCH_ROWS = 1 << 16
+
+    def __init__(self, out_dir: Path, out_format: str) -> None:
+        if out_format not in FORMATS:
+            raise ValueError(f"Unsupported columnar format: {out_format}")
+        self._pa = _import_pyarrow()
+        self.out_dir = Path(out_dir)
+        self.out_format = out_format
+        self.out_dir.mkdir(parents=True, exist_ok=True)
+        self._metrics: dict[str, _MetricColumns] = {}
+
+    def add_metric(self, key: str, file_name: str, fields: list[tuple[str, str]], indexed: bool):
+        """Set the columns for a metric.
+
+        Args:
+            key: Used to refer to the metric in append().
+            file_name: The file name without its extension.
+            fields: (column name, struct format character) for each of the value's fields.
+            indexed: If the values are arrays with a row per element.
+        """
+        path = self.out_dir / (file_name + FORMATS[self.out_format])
+        self._metrics[key] = _MetricColumns(self._pa, path, self.out_format, fields, indexed)
+
+    def append(self, key: str, timestamp: float, values: tuple):
+        """Add a sample of the values unpacked from a payload."""
+        metric = self._metrics[key]
+        metric.append(timestamp, values)
+        if len(metric.timestamps) >= self.BATCH_ROWS:
+            metric.flush(self._pa)
+
+    def close(self):
+        for metric in self._metrics.values():
+            metric.close(self._pa)
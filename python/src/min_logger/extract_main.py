@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+CLI interface for extracting the newest data from a min_logger_init_mmap() file.
+
+The file keeps the ring buffers after the process that wrote it has crashed. The output can be
+parsed with min-logger-parser.
+"""
+
+import logging
+import mmap
+import struct
+import sys
+from typing import Optional
+
+from jsonargparse import auto_cli
+from jsonargparse.typing import Path_fr, Path_fc
+
+_logger = logging.getLogger("min_logger.extract_main")
+
+MAGIC = b"MINLOGMM"
+VERSION = 1
+# Layout of MinLoggerMmapHeader in min_logger_buffered_posix.h.
+HEADER = struct.Struct("<8s4I5QI20s")
+
+
+def extract(data: bytes | mmap.mmap, max_bytes: Optional[int] = None) -> tuple[bytes, str]:
+    """Get the newest data in each of the file's shards.
+
+    Args:
+        data: Contents of the file.
+        max_bytes: Maximum number of bytes to extract, split evenly between the shards. Defaults to
+            everything in the buffers.
+
+    Returns:
+        The shards' data one after another, and the log format the header records.
+    """
+    if len(data) < HEADER.size:
+        raise ValueError("File too short for a min-logger mmap header")
+    (
+        magic,
+        version,
+        num_shards,
+        shard_size,
+        index_size,
+        ring_buffer_offset,
+        ring_buffer_stride,
+        _ring_buffer_size,
+        write_size_offset,
+        data_offset,
+        pid,
+        log_format,
+    ) = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError("Not a min-logger mmap file, or it wasn't finished being created")
+    if version != VERSION:
+        raise ValueError(f"Unsupported mmap file version {version}")
+    if len(data) < data_offset + num_shards * shard_size:
+        raise ValueError("File truncated")
+    _logger.info("Extracting %d shards of %d bytes written by PID %d.", num_shards, shard_size, pid)
+
+    shard_max = shard_size if max_bytes is None else min(shard_size, max_bytes // num_shards)
+    out = bytearray()
+    for i in range(num_shards):
+        counter = ring_buffer_offset + i * ring_buffer_stride + write_size_offset
+        total_write_size = int.from_bytes(data[counter : counter + index_size], "little")
+        # Before the buffer wraps, only the start is filled. A 32bit count that rolled over can
+        # look like that too, which only loses older data.
+        size = min(shard_max, total_write_size, shard_size)
+        if size == 0:
+            continue
+        shard = data_offset + i * shard_size
+        end = total_write_size % shard_size
+        start = (end - size) % shard_size
+        if start < end:
+            out += data[shard + start : shard + end]
+        else:
+            out += data[shard + start : shard + shard_size]
+            out += data[shard : shard + end]
+    return bytes(out), log_format.split(b"\0", 1)[0].decode()
+
+
+def command(
+    mmap_file: Path_fr,  # pyright: ignore[reportInvalidTypeForm]
+    output: Optional[Path_fc] = None,  # pyright: ignore[reportInvalidTypeForm]
+    max_mb: Optional[float] = None,
+):
+    """Extract the newest data from a min_logger_init_mmap() file, e.g. after a crash.
+
+    The oldest message in each shard is usually cut off, and the newest can be incomplete if it was
+    being written when the process died. The parsers skip them.
+
+    Args:
+        mmap_file: File passed to min_logger_init_mmap().
+        output: File to write the data to. Defaults to stdout.
+        max_mb: Only extract the newest max_mb megabytes, split evenly between the shards.
+    """
+    with open(mmap_file, "rb") as fd:
+        with mmap.mmap(fd.fileno(), 0, access=mmap.ACCESS_READ) as data:
+            max_bytes = None if max_mb is None else int(max_mb * 1024 * 1024)
+            out, log_format = extract(data, max_bytes)
+
+    if output is None:
+        sys.stdout.buffer.write(out)
+    else:
+        with open(output, "wb") as fd:
+            fd.write(out)
+    if log_format:
+        _logger.info("Extracted %d bytes. Parse with --log_format %s", len(out), log_format)
+    else:
+        _logger.info("Extracted %d bytes in a custom format.", len(out))
+
+
+def main():
+    """
+    Entry point for the application. Invokes the auto_cli function with the specified command.
+    """
+    logging.basicConfig(
+        level=logging.INFO,
+        format="%(levelname)s - %(name)s:%(lineno)d - %(message)s",
+        stream=sys.stderr,
+    )
+    auto_cli(command)
+
+
+if __name__ == "__main__":
+    main()
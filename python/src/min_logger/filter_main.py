@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+CLI interface for generating runtime ID filter sets from min-logger metadata.
+
+The output is passed to min_logger_filter_set_ids() to send the selected messages regardless of
+the runtime log level.
+"""
+
+from fnmatch import fnmatch
+import json
+import logging
+import sys
+
+from jsonargparse import auto_cli
+from jsonargparse.typing import Path_fr
+
+from min_logger.builder import MetricEntryData
+
+_logger = logging.getLogger("min_logger.filter_main")
+
+OUTPUT_FORMATS = ("C_ARRAY", "LIST")
+
+
+def select_entries(
+    entries: dict[int, MetricEntryData],
+    ids: list[int],
+    files: list[str],
+    tags: list[str],
+    names: list[str],
+) -> set[int]:
+    """Get the IDs of the entries matching any of the criteria.
+
+    Args:
+        entries: The metadata entries to select from.
+        ids: IDs to include.
+        files: Glob patterns to match against the entries' source files.
+        tags: Tags set with MIN_LOGGER_FILE_TAGS.
+        names: Glob patterns to match against the entries' value or section names.
+    """
+    selected = set(i for i in ids if i in entries)
+    for missing in set(ids) - selected:
+        _logger.warning("ID 0x%08X not found in meta data.", missing)
+
+    for entry in entries.values():
+        if any(fnmatch(str(entry.source_file), f) for f in files):
+            selected.add(entry.id)
+        elif any(t in entry.tags for t in tags):
+            selected.add(entry.id)
+        elif entry.name is not None and any(fnmatch(entry.name, n) for n in names):
+            selected.add(entry.id)
+    return selected
+
+
+def command(
+    meta_data: Path_fr,  # pyright: ignore[reportInvalidTypeForm]
+    ids: list[str] = [],
+    files: list[str] = [],
+    tags: list[str] = [],
+    names: list[str] = [],
+    output_format: str = "C_ARRAY",
+    filter_bits: int = 0,
+):  # pylint: disable=dangerous-default-value
+    """Print the IDs of log messages selected by ID, file, tag, or name.
+
+    Args:
+        meta_data: Meta data json file with log definitions.
+        ids: IDs to select. Can be decimal or hex with a 0x prefix.
+        files: Glob patterns for the source files to select, e.g. "src/net/*".
+        tags: Tags set with MIN_LOGGER_FILE_TAGS to select.
+        names: Glob patterns for the value or section names to select.
+        output_format: C_ARRAY for a C initializer to pass to min_logger_filter_set_ids(), or LIST
+            for one hex ID per line.
+        filter_bits: The MIN_LOGGER_FILTER_BITS the code was built with. If set, warns about
+            unselected messages that share a bit with the selection.
+    """
+
+    output_format = output_format.upper()
+    if output_format not in OUTPUT_FORMATS:
+        raise ValueError(f"Unsupported output format: {output_format}")
+    if filter_bits != 0 and (filter_bits < 32 or filter_bits & (filter_bits - 1)):
+        raise ValueError("--filter_bits must be a power of two, at least 32")
+
+    with open(meta_data, "r") as fd:
+        meta_data = json.load(fd)
+        entries = {e["id"]: MetricEntryData(**e) for e in meta_data["entries"]}
+
+    selected = select_entries(entries, [int(i, 0) for i in ids], files, tags, names)
+    if len(selected) == 0:
+        _logger.warning("No messages selected.")
+
+    if filter_bits > 0:
+        selected_bits = set(i & (filter_bits - 1) for i in selected)
+        shared = [
+            e
+            for e in entries.values()
+            if e.id not in selected and e.id & (filter_bits - 1) in selected_bits
+        ]
+        for entry in shared:
+            _logger.warning(
+                "0x%08X at %s:%d shares a filter bit with the selection and will also be sent.",
+                entry.id,
+                entry.source_file,
+                entry.source_line,
+            )
+
+    if output_format == "C_ARRAY":
+        values = ", ".join(f"0x{i:08X}" for i in sorted(selected))
+        print(f"const MinLoggerCRC ids[] = {{{values}}};")
+    else:
+        for i in sorted(selected):
+            print(f"0x{i:08X}")
+
+
+def main():
+    """
+    Entry point for the application. Invokes the auto_cli function with the specified command.
+    """
+    logging.basicConfig(
+        level=logging.INFO,
+        format="%(levelname)s - %(name)s:%(lineno)d - %(message)s",
+        stream=sys.stderr,
+    )
+    auto_cli(command)
+
+
+if __name__ == "__main__":
+    main()
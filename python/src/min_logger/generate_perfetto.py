@@ -1,11 +1,10 @@
 from pathlib import Path
 import uuid
 
-from perfetto.trace_builder.proto_builder import TraceProtoBuilder, TracePacket
-
 from perfetto.protos.perfetto.trace.perfetto_trace_pb2 import (
+    TracePacket,
     TrackEvent,
-    TrackDescriptor,
+    EventName,
     SourceLocation,
     LogMessage,
     LogMessageBody,
@@ -17,65 +16,131 @@ from perfetto.protos.perfetto.trace.perfetto_trace_pb2 import (
 # https://perfetto.dev/docs/getting-started/converting#python-example
 # https://perfetto.dev/docs/reference/synthetic-track-event
 
+# Tag of the repeated TracePacket field of the Trace message: field 1, length delimited.
+_TRACE_PACKET_TAG = b"\x0a"
+
+
+def _encode_varint(value: int) -> bytes:
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
 
 class PerfettoBuilder:
+    """Writes a Perfetto trace to a file as the events are added.
+
+    Event names, source locations and log messages are interned, so each one is only written the
+    first time it's used.
+    """
+
     _TRUSTED_PACKET_SEQUENCE_ID = 8009
     _PROCESS_NAME = "MinLoggerApp"
     _PROCESS_PID = 0
-
-    def __init__(self) -> None:
-        self.builder = TraceProtoBuilder()
-        self.threads: dict[int, TrackDescriptor] = {}
-        self.process_desc = None
-        # Could actually cache data to avoid duplicate strings. To do this I
-        # think it would need to be done upfront preprocessing all the messages
-        # to generate the full interned state that would be used for all
-        # subsequent packets:
-        # https://perfetto.dev/docs/reference/synthetic-track-event#interning-data-for-trace-size-optimization
-        self.internal_iids = 1
+    # The interned strings are dropped, and the trace's incremental state cleared, once there are
+    # this many. Keeps memory bounded for logs with many unique messages.
+    MAX_INTERNED = 1 << 16
+
+    def __init__(self, out_path: Path) -> None:
+        self._file = open(out_path, "wb")
+        # Thread ID -> (track UUID, thread name)
+        self.threads: dict[int, tuple[int, str]] = {}
+        # Counter name -> track UUID
+        self.counters: dict[str, int] = {}
+        self.process_uuid: int | None = None
         self.start_time = 0
 
+        self._event_names: dict[str, int] = {}
+        self._source_locations: dict[tuple[str, int], int] = {}
+        self._log_bodies: dict[str, int] = {}
+        self._next_iid = 1
+        self._state_cleared = False
+
     def _get_timestamp_ns(self, timestamp: float):
         if self.start_time is None:
             self.start_time = timestamp
 
         return int((timestamp - self.start_time) * 1e9)
 
-    def write_to_file(self, out_path: Path):
-        with open(out_path, "wb") as f:
-            f.write(self.builder.serialize())
+    def _write_packet(self, packet: TracePacket):
+        # A trace file is a Trace message, which is just the repeated packets.
+        data = packet.SerializeToString()
+        self._file.write(_TRACE_PACKET_TAG + _encode_varint(len(data)) + data)
+
+    def close(self):
+        self._file.close()
 
     def add_log(self, timestamp: float, msg: str, thread_id: int, priority, file: Path, line: int):
-        packet = self._add_slice_event(
+        packet = self._new_slice_event(
             timestamp, TrackEvent.TYPE_INSTANT, thread_id, "log", file, line
         )
-        body_id = self.internal_iids
-        self.internal_iids += 1
-
-        packet.interned_data.log_message_body.append(LogMessageBody(iid=body_id, body=msg))
+        body_iid = self._log_bodies.get(msg)
+        if body_iid is None:
+            body_iid = self._new_iid(self._log_bodies, msg)
+            packet.interned_data.log_message_body.append(LogMessageBody(iid=body_iid, body=msg))
 
         packet.track_event.log_message.prio = self._get_priority(priority)
         packet.track_event.log_message.source_location_iid = packet.track_event.source_location_iid
-        packet.track_event.log_message.body_iid = body_id
+        packet.track_event.log_message.body_iid = body_iid
+        self._write_packet(packet)
 
     def enter_slice(self, timestamp: float, name: str, thread_id: int, file: Path, line: int):
-        self._add_slice_event(timestamp, TrackEvent.TYPE_SLICE_BEGIN, thread_id, name, file, line)
+        self._write_packet(
+            self._new_slice_event(
+                timestamp, TrackEvent.TYPE_SLICE_BEGIN, thread_id, name, file, line
+            )
+        )
 
     def exit_slice(self, timestamp: float, name: str, thread_id: int, file: Path, line: int):
-        self._add_slice_event(timestamp, TrackEvent.TYPE_SLICE_END, thread_id, name, file, line)
-
-    def set_thread_name(self, timestamp: float, thread_id: int, thread_name: str):
-        thread_descr = self._get_or_create_thread_if_needed(timestamp, thread_id)
-        thread_descr.thread.thread_name = thread_name
+        self._write_packet(
+            self._new_slice_event(timestamp, TrackEvent.TYPE_SLICE_END, thread_id, name, file, line)
+        )
 
-    def _add_source_location(self, packet: TracePacket, file: Path, line: int):
-        source_id = self.internal_iids
-        self.internal_iids += 1
+    def add_slice(
+        self, start: float, end: float, name: str, thread_id: int, file: Path, line: int
+    ):
+        """Add a slice whose begin and end are both known, like the ones from MIN_LOGGER_SCOPE.
+
+        Nested scopes finish inner first, so these packets aren't in timestamp order. The trace
+        processor sorts the events, which keeps the nesting correct.
+        """
+        self.enter_slice(start, name, thread_id, file, line)
+        self.exit_slice(end, name, thread_id, file, line)
+
+    def add_counter(self, timestamp: float, name: str, value: float):
+        """Add a sample to the process level counter track for name, creating it if needed."""
+        track_uuid = self._get_or_create_counter_if_needed(timestamp, name)
+        packet = TracePacket()
+        packet.timestamp = self._get_timestamp_ns(timestamp)
+        packet.track_event.type = TrackEvent.TYPE_COUNTER
+        packet.track_event.track_uuid = track_uuid
+        packet.track_event.double_counter_value = value
+        packet.trusted_packet_sequence_id = self._TRUSTED_PACKET_SEQUENCE_ID
+        self._write_packet(packet)
 
-        packet.interned_data.source_locations.append(
-            SourceLocation(iid=source_id, file_name=str(file), line_number=line)
-        )
-        packet.track_event.source_location_iid = source_id
+    def set_thread_name(self, timestamp: float, thread_id: int, thread_name: str):
+        if thread_id in self.threads:
+            # Descriptors are already written, so send an updated one for the same track.
+            track_uuid, _ = self.threads[thread_id]
+            self._write_thread_descriptor(timestamp, thread_id, track_uuid, thread_name)
+        else:
+            self._get_or_create_thread_if_needed(timestamp, thread_id, thread_name)
+
+    def _new_iid(self, table: dict, key) -> int:
+        iid = self._next_iid
+        self._next_iid += 1
+        table[key] = iid
+        return iid
+
+    def _reset_interned_data_if_full(self):
+        interned = len(self._event_names) + len(self._source_locations) + len(self._log_bodies)
+        if interned >= self.MAX_INTERNED:
+            self._event_names.clear()
+            self._source_locations.clear()
+            self._log_bodies.clear()
+            self._state_cleared = False
 
     @staticmethod
     def _get_priority(priority: str):
@@ -88,36 +153,63 @@ class PerfettoBuilder:
         }
         return LEVELS.get(priority, LogMessage.PRIO_UNSPECIFIED)
 
-    def _get_or_create_thread_if_needed(self, timestamp: float, thread_id: int) -> TrackDescriptor:
+    def _write_thread_descriptor(
+        self, timestamp: float, thread_id: int, track_uuid: int, thread_name: str
+    ):
+        packet = TracePacket()
+        packet.timestamp = self._get_timestamp_ns(timestamp)
+        desc = packet.track_descriptor
+        desc.uuid = track_uuid
+        desc.thread.pid = self._PROCESS_PID
+        # Avoid thread id 0 since maps to swapper
+        desc.thread.tid = thread_id + 1
+        desc.thread.thread_name = thread_name
+        self.threads[thread_id] = (track_uuid, thread_name)
+        self._write_packet(packet)
+
+    def _get_or_create_thread_if_needed(
+        self, timestamp: float, thread_id: int, thread_name: str | None = None
+    ) -> int:
         if thread_id in self.threads:
-            return self.threads[thread_id]
+            return self.threads[thread_id][0]
         else:
-            proc_desc = self._get_or_create_process_if_needed(timestamp)
-            packet = self.builder.add_packet()
-            packet.timestamp = self._get_timestamp_ns(timestamp)
-            desc = packet.track_descriptor
-            desc.uuid = uuid.uuid4().int & ((1 << 63) - 1)
-            desc.thread.pid = proc_desc.process.pid
-            # Avoid thread id 0 since maps to swapper
-            desc.thread.tid = thread_id + 1
-            desc.thread.thread_name = f"thread_{thread_id}"
-            self.threads[thread_id] = desc
-            return desc
-
-    def _get_or_create_process_if_needed(self, timestamp: float) -> TrackDescriptor:
-        if self.process_desc is not None:
-            return self.process_desc
+            self._get_or_create_process_if_needed(timestamp)
+            track_uuid = uuid.uuid4().int & ((1 << 63) - 1)
+            if thread_name is None:
+                thread_name = f"thread_{thread_id}"
+            self._write_thread_descriptor(timestamp, thread_id, track_uuid, thread_name)
+            return track_uuid
+
+    def _get_or_create_counter_if_needed(self, timestamp: float, name: str) -> int:
+        if name in self.counters:
+            return self.counters[name]
+        process_uuid = self._get_or_create_process_if_needed(timestamp)
+        packet = TracePacket()
+        packet.timestamp = self._get_timestamp_ns(timestamp)
+        desc = packet.track_descriptor
+        desc.uuid = uuid.uuid4().int & ((1 << 63) - 1)
+        desc.name = name
+        desc.parent_uuid = process_uuid
+        desc.counter.SetInParent()
+        self.counters[name] = desc.uuid
+        self._write_packet(packet)
+        return desc.uuid
+
+    def _get_or_create_process_if_needed(self, timestamp: float) -> int:
+        if self.process_uuid is not None:
+            return self.process_uuid
         else:
-            packet = self.builder.add_packet()
+            packet = TracePacket()
             packet.timestamp = self._get_timestamp_ns(timestamp)
             desc = packet.track_descriptor
             desc.uuid = uuid.uuid4().int & ((1 << 63) - 1)
             desc.process.pid = self._PROCESS_PID
             desc.process.process_name = self._PROCESS_NAME
-            self.process_desc = desc
-            return desc
+            self.process_uuid = desc.uuid
+            self._write_packet(packet)
+            return self.process_uuid
 
-    def _add_slice_event(
+    def _new_slice_event(
         self,
         timestamp: float,
         event_type: TrackEvent.Type,
@@ -126,16 +218,35 @@ class PerfettoBuilder:
         file: Path,
         line: int,
     ) -> TracePacket:
-        thread_descr = self._get_or_create_thread_if_needed(timestamp, thread_id)
+        track_uuid = self._get_or_create_thread_if_needed(timestamp, thread_id)
+        self._reset_interned_data_if_full()
 
-        packet = self.builder.add_packet()
+        packet = TracePacket()
         packet.timestamp = self._get_timestamp_ns(timestamp)
         packet.track_event.type = event_type
-        packet.track_event.track_uuid = thread_descr.uuid
-        packet.track_event.name = name
+        packet.track_event.track_uuid = track_uuid
         packet.trusted_packet_sequence_id = self._TRUSTED_PACKET_SEQUENCE_ID
-        packet.sequence_flags = (
-            TracePacket.SEQ_NEEDS_INCREMENTAL_STATE | TracePacket.SEQ_INCREMENTAL_STATE_CLEARED
-        )
-        self._add_source_location(packet, file, line)
+        if self._state_cleared:
+            packet.sequence_flags = TracePacket.SEQ_NEEDS_INCREMENTAL_STATE
+        else:
+            # The interned data starts over from this packet.
+            packet.sequence_flags = (
+                TracePacket.SEQ_NEEDS_INCREMENTAL_STATE | TracePacket.SEQ_INCREMENTAL_STATE_CLEARED
+            )
+            self._state_cleared = True
+
+        name_iid = self._event_names.get(name)
+        if name_iid is None:
+            name_iid = self._new_iid(self._event_names, name)
+            packet.interned_data.event_names.append(EventName(iid=name_iid, name=name))
+        packet.track_event.name_iid = name_iid
+
+        location = (str(file), line)
+        source_iid = self._source_locations.get(location)
+        if source_iid is None:
+            source_iid = self._new_iid(self._source_locations, location)
+            packet.interned_data.source_locations.append(
+                SourceLocation(iid=source_iid, file_name=location[0], line_number=line)
+            )
+        packet.track_event.source_location_iid = source_iid
         return packet
@@ -0,0 +1,423 @@
+"""
+Parse large log files with multiple processes.
+
+The log is split into segments at message boundaries. A first pass over each segment collects the
+state that later messages depend on (values for message substitution, thread names, dropped
+totals, time calibrations and payloads split into continuations). Each segment is then decoded in
+a worker starting from the state left by the segments before it, and the outputs are merged in
+order. The result matches parsing the whole file in one process.
+"""
+
+from bisect import bisect_left
+from concurrent.futures import ProcessPoolExecutor
+import io
+import logging
+import mmap
+from pathlib import Path
+import sys
+from typing import Any, NamedTuple, Optional
+
+from min_logger.builder import (
+    CONTINUATION_MSG_ID,
+    DROPPED_MSG_ID,
+    THREAD_NAME_MSG_ID,
+    THREAD_REGISTRY_MSG_ID,
+    TIME_CALIBRATION_MSG_ID,
+)
+from min_logger.parser import (
+    CONTINUATION_PAYLOAD,
+    DROPPED_PAYLOAD,
+    SYNC_BYTES,
+    ContinuationJoiner,
+    MessageHandler,
+    _decode_binary,
+    _decode_micro,
+    _MicroState,
+    index_micro_binary,
+)
+
+_logger = logging.getLogger("min_logger.parallel_parser")
+
+PARALLEL_FORMATS = ("BINARY", "MICRO_BINARY")
+# Segments are smaller than a job's share of the file so that uneven segments balance out.
+SEGMENTS_PER_JOB = 4
+MIN_SEGMENT_SIZE = 1 << 20
+
+
+class _SegmentSummary(NamedTuple):
+    # Where the segment's last message ended. Must be the start of the next segment.
+    next_start: int
+    # Value name -> (metric ID, payload) of the last value recorded.
+    values: dict[str, tuple[int, bytes]]
+    thread_names: dict[int, bytes]
+    dropped: dict[int, bytes]
+    calibrations: list[tuple[int, bytes]]
+    # Continuation pieces on each thread before the first that starts a payload. They finish one
+    # from an earlier segment.
+    leading_continuations: dict[int, list[bytes]]
+    # Threads that started a payload in the segment, and the payloads unfinished at its end.
+    continuation_threads: set[int]
+    continuations: dict[int, tuple[int, int, bytes]]
+    resyncs: int
+
+
+class _SegmentState(NamedTuple):
+    """MessageHandler state carried into a segment from the ones before it."""
+
+    values: dict[str, tuple[int, bytes]]
+    thread_names: dict[int, bytes]
+    dropped: dict[int, bytes]
+    continuations: dict[int, tuple[int, int, bytes]]
+    calibration: Optional[tuple[int, int, int]]
+    counter_mask: int
+    ns_per_tick: Optional[float]
+
+
+class _SegmentOutput(NamedTuple):
+    text: str
+    csv_rows: list[tuple[str, float, Any, Optional[int]]]
+    columnar_rows: list[tuple[int, float, bytes]]
+    perfetto_calls: list[tuple[str, tuple]]
+    dropped_messages: int
+    dropped_bytes: int
+    unknown_ids: set[int]
+
+
+def _record_value(values: dict[str, tuple[int, bytes]], meta, metric_id: int, value: bytes):
+    metric = meta["entries"].get(metric_id)
+    if metric is not None and metric.name is not None and metric.value_type is not None:
+        values[metric.name] = (metric_id, bytes(value))
+
+
+def _copy_continuations(joiner: ContinuationJoiner) -> dict[int, tuple[int, int, bytes]]:
+    return {k: (msg_id, size, bytes(data)) for k, (msg_id, size, data) in joiner.pending.items()}
+
+
+class _SummaryHandler(MessageHandler):
+    """Only records the messages that affect the parsing of later ones."""
+
+    def __init__(self, meta) -> None:
+        super().__init__(meta, print_messages=False)
+        self.meta = meta
+        self.values: dict[str, tuple[int, bytes]] = {}
+        self.thread_name_msgs: dict[int, bytes] = {}
+        self.dropped_msgs: dict[int, bytes] = {}
+        self.calibrations: list[tuple[int, bytes]] = []
+        self.leading_continuations: dict[int, list[bytes]] = {}
+        self.continuation_threads: set[int] = set()
+
+    def process_raw_msg(self, raw_time: int, metric_id: int, thread_id: int, value: bytes):
+        if metric_id == TIME_CALIBRATION_MSG_ID:
+            self.calibrations.append((raw_time, bytes(value)))
+        elif metric_id == THREAD_NAME_MSG_ID:
+            self.thread_name_msgs[thread_id] = bytes(value)
+        elif metric_id == THREAD_REGISTRY_MSG_ID:
+            if len(value) > 0:
+                self.thread_name_msgs[value[0]] = bytes(value[1:])
+        elif metric_id == DROPPED_MSG_ID:
+            self.dropped_msgs[thread_id] = bytes(value)
+        elif metric_id == CONTINUATION_MSG_ID:
+            self._add_continuation(raw_time, thread_id, value)
+        else:
+            _record_value(self.values, self.meta, metric_id, value)
+
+    def _add_continuation(self, raw_time: int, thread_id: int, value: bytes):
+        if thread_id not in self.continuation_threads:
+            # Until a piece with offset 0, the thread's pieces are from a payload started earlier.
+            offset = None
+            if len(value) >= CONTINUATION_PAYLOAD.size:
+                offset = CONTINUATION_PAYLOAD.unpack_from(value)[1]
+            if offset:
+                self.leading_continuations.setdefault(thread_id, []).append(bytes(value))
+                return
+            self.continuation_threads.add(thread_id)
+        joined = self._continuations.add(thread_id, value)
+        if joined is not None:
+            self.process_raw_msg(raw_time, joined[0], thread_id, joined[1])
+
+    def process_raw_msgs(self, msgs: list[tuple[int, int, int, bytes]]):
+        for msg in msgs:
+            self.process_raw_msg(*msg)
+
+
+class _PerfettoRecorder:
+    """Records PerfettoBuilder calls to replay them in the main process."""
+
+    def __init__(self) -> None:
+        self.calls: list[tuple[str, tuple]] = []
+
+    def __getattr__(self, name: str):
+        def record(*args):
+            self.calls.append((name, args))
+
+        return record
+
+
+class _SegmentHandler(MessageHandler):
+    """Buffers a segment's output to be merged in the main process."""
+
+    def __init__(
+        self,
+        meta,
+        perfetto_path: Optional[Path],
+        csv_dir: Optional[Path],
+        parquet_dir: Optional[Path],
+        arrow_dir: Optional[Path],
+        state: _SegmentState,
+        default_ns_per_tick: float,
+    ) -> None:
+        super().__init__(meta)
+        self.out = io.StringIO()
+        # The trace file, CSV and columnar files are written by the main process.
+        if perfetto_path is not None:
+            self.perfetto_gen = _PerfettoRecorder()  # type: ignore
+        self.csv_dir = csv_dir
+        self.csv_rows: list[tuple[str, float, Any, Optional[int]]] = []
+        self.parquet_dir = parquet_dir
+        self.arrow_dir = arrow_dir
+        self.columnar_rows: list[tuple[int, float, bytes]] = []
+        # Rate to use before the second calibration, so messages don't wait for a later segment.
+        self._default_ns_per_tick = default_ns_per_tick
+
+        for name, (metric_id, value) in state.values.items():
+            self.last_values[name] = self._decode_value(
+                metric_id, self.log_metrics[metric_id], value
+            )
+        self.thread_names = {k: v.decode() for k, v in state.thread_names.items()}
+        self._continuations = ContinuationJoiner(state.continuations)
+        self._dropped_totals = {
+            k: DROPPED_PAYLOAD.unpack_from(v)
+            for k, v in state.dropped.items()
+            if len(v) >= DROPPED_PAYLOAD.size
+        }
+        self._calibration = state.calibration
+        self._counter_mask = state.counter_mask
+        self._ns_per_tick = state.ns_per_tick
+        self._set_default_ns_per_tick()
+
+    def _set_default_ns_per_tick(self):
+        if self._calibration is not None and self._ns_per_tick is None:
+            self._ns_per_tick = self._default_ns_per_tick
+
+    def _handle_calibration(self, raw_time: int, value: bytes):
+        super()._handle_calibration(raw_time, value)
+        self._set_default_ns_per_tick()
+
+    def _write_metric_csv(
+        self, metric_name: str, timestamp: float, value: Any, index: Optional[int] = None
+    ) -> None:
+        self.csv_rows.append((metric_name, timestamp, value, index))
+
+    def _add_columnar(self, metric_id: int, metric, timestamp: float, value):
+        self.columnar_rows.append((metric_id, timestamp, bytes(value)))
+
+
+def _decode_segment(
+    data, log_format: str, handler: MessageHandler, start: int, stop: int
+) -> tuple[int, int]:
+    """Decode the messages that start in [start, stop).
+
+    Returns:
+        The offset after the last message, and the number of micro format resyncs.
+    """
+    if log_format == "BINARY":
+        return _decode_binary(data, start, handler, stop), 0
+    state = _MicroState(handler)
+    next_start = _decode_micro(data, start, handler, state, stop)
+    return next_start, state.resyncs
+
+
+def _summarize_segment(data, log_format: str, meta, start: int, stop: int) -> _SegmentSummary:
+    handler = _SummaryHandler(meta)
+    next_start, resyncs = _decode_segment(data, log_format, handler, start, stop)
+    return _SegmentSummary(
+        next_start,
+        handler.values,
+        handler.thread_name_msgs,
+        handler.dropped_msgs,
+        handler.calibrations,
+        handler.leading_continuations,
+        handler.continuation_threads,
+        _copy_continuations(handler._continuations),
+        resyncs,
+    )
+
+
+def _plan_segments(data, log_format: str, jobs: int) -> list[int]:
+    """Get the start offsets of the segments to split the log into."""
+    count = min(jobs * SEGMENTS_PER_JOB, len(data) // MIN_SEGMENT_SIZE)
+    targets = [len(data) * i // count for i in range(1, count)] if count > 1 else []
+    starts = [0]
+    if log_format == "BINARY":
+        # These might be sync bytes in a payload. Segments that don't line up are merged later.
+        candidates = [data.find(SYNC_BYTES, target) for target in targets]
+    else:
+        # Sync markers reset the timestamp, so parsing can start at any of them.
+        markers = [offset for offset, _ in index_micro_binary(data)]
+        indices = [bisect_left(markers, target) for target in targets]
+        candidates = [markers[i] for i in indices if i < len(markers)]
+    for candidate in candidates:
+        if candidate > starts[-1]:
+            starts.append(candidate)
+    return starts
+
+
+# Set in each worker process by _init_worker()
+_worker: dict[str, Any] = {}
+
+
+def _init_worker(
+    log_path: Path, log_format: str, meta, perfetto_path, csv_dir, parquet_dir, arrow_dir
+):
+    with open(log_path, "rb") as fd:
+        _worker["data"] = mmap.mmap(fd.fileno(), 0, access=mmap.ACCESS_READ)
+    _worker["log_format"] = log_format
+    _worker["meta"] = meta
+    _worker["perfetto_path"] = perfetto_path
+    _worker["csv_dir"] = csv_dir
+    _worker["parquet_dir"] = parquet_dir
+    _worker["arrow_dir"] = arrow_dir
+
+
+def _summarize_worker(start: int, stop: int) -> _SegmentSummary:
+    return _summarize_segment(_worker["data"], _worker["log_format"], _worker["meta"], start, stop)
+
+
+def _render_worker(
+    start: int, stop: int, state: _SegmentState, default_ns_per_tick: float
+) -> _SegmentOutput:
+    handler = _SegmentHandler(
+        _worker["meta"],
+        _worker["perfetto_path"],
+        _worker["csv_dir"],
+        _worker["parquet_dir"],
+        _worker["arrow_dir"],
+        state,
+        default_ns_per_tick,
+    )
+    _decode_segment(_worker["data"], _worker["log_format"], handler, start, stop)
+    return _SegmentOutput(
+        handler.out.getvalue(),
+        handler.csv_rows,
+        handler.columnar_rows,
+        handler.perfetto_gen.calls if handler.perfetto_gen is not None else [],  # type: ignore
+        handler.dropped_messages,
+        handler.dropped_bytes,
+        handler.unknown_ids,
+    )
+
+
+def read_parallel(
+    log_path: Path,
+    log_format: str,
+    meta,
+    perfetto_path: Optional[Path] = None,
+    csv_dir: Optional[Path] = None,
+    jobs: int = 2,
+    parquet_dir: Optional[Path] = None,
+    arrow_dir: Optional[Path] = None,
+) -> bool:
+    """Parse a BINARY or MICRO_BINARY log file using jobs processes.
+
+    Returns:
+        False if the log couldn't be split and nothing was parsed.
+    """
+    with open(log_path, "rb") as fd:
+        try:
+            data = mmap.mmap(fd.fileno(), 0, access=mmap.ACCESS_READ)
+        except (OSError, ValueError):
+            return False
+
+    with data:
+        starts = _plan_segments(data, log_format, jobs)
+        if len(starts) < 2:
+            return False
+        stops = starts[1:] + [len(data)]
+
+        init_args = (log_path, log_format, meta, perfetto_path, csv_dir, parquet_dir, arrow_dir)
+        with ProcessPoolExecutor(jobs, initializer=_init_worker, initargs=init_args) as executor:
+            segments: list[tuple[int, int, _SegmentSummary]] = []
+            for start, stop, summary in zip(
+                starts, stops, executor.map(_summarize_worker, starts, stops)
+            ):
+                if segments and segments[-1][2].next_start != start:
+                    # The previous segment's last message overlaps this one, so this start wasn't
+                    # a message boundary.
+                    start = segments.pop()[0]
+                    summary = _summarize_segment(data, log_format, meta, start, stop)
+                segments.append((start, stop, summary))
+
+            # Replay the state changes in order to get each segment's starting state.
+            calibration_handler = MessageHandler(meta, print_messages=False)
+            default_ns_per_tick: Optional[float] = None
+            values: dict[str, tuple[int, bytes]] = {}
+            thread_names: dict[int, bytes] = {}
+            dropped: dict[int, bytes] = {}
+            continuations = ContinuationJoiner()
+            states = []
+            for _, _, summary in segments:
+                states.append(
+                    _SegmentState(
+                        dict(values),
+                        dict(thread_names),
+                        dict(dropped),
+                        _copy_continuations(continuations),
+                        calibration_handler._calibration,
+                        calibration_handler._counter_mask,
+                        calibration_handler._ns_per_tick,
+                    )
+                )
+                for thread_id, pieces in summary.leading_continuations.items():
+                    for piece in pieces:
+                        joined = continuations.add(thread_id, piece)
+                        if joined is not None:
+                            _record_value(values, meta, *joined)
+                for thread_id in summary.continuation_threads:
+                    continuations.pending.pop(thread_id, None)
+                continuations.pending.update(ContinuationJoiner(summary.continuations).pending)
+                values.update(summary.values)
+                thread_names.update(summary.thread_names)
+                dropped.update(summary.dropped)
+                for raw_time, value in summary.calibrations:
+                    calibration_handler._handle_calibration(raw_time, value)
+                    if default_ns_per_tick is None:
+                        default_ns_per_tick = calibration_handler._ns_per_tick
+            if calibration_handler._calibration is not None and default_ns_per_tick is None:
+                _logger.warning(
+                    "Log only has one time calibration, assuming 1 tick per nanosecond."
+                )
+            if default_ns_per_tick is None:
+                default_ns_per_tick = 1.0
+
+            handler = MessageHandler(
+                meta,
+                perfetto_path=perfetto_path,
+                csv_dir=csv_dir,
+                parquet_dir=parquet_dir,
+                arrow_dir=arrow_dir,
+            )
+            outputs = executor.map(
+                _render_worker,
+                [start for start, _, _ in segments],
+                [stop for _, stop, _ in segments],
+                states,
+                [default_ns_per_tick] * len(segments),
+            )
+            for output in outputs:
+                sys.stdout.write(output.text)
+                for row in output.csv_rows:
+                    handler._write_metric_csv(*row)
+                for metric_id, timestamp, value in output.columnar_rows:
+                    metric = handler.log_metrics[metric_id]
+                    handler._add_columnar(metric_id, metric, timestamp, value)
+                for name, args in output.perfetto_calls:
+                    getattr(handler.perfetto_gen, name)(*args)
+                handler.dropped_messages += output.dropped_messages
+                handler.dropped_bytes += output.dropped_bytes
+                handler.unknown_ids |= output.unknown_ids
+
+    resyncs = sum(summary.resyncs for _, _, summary in segments)
+    if resyncs > 0:
+        _logger.warning("Skipped corrupted data before %d sync markers", resyncs)
+    handler.finish()
+    return True
@@ -1,11 +1,29 @@
+import heapq
+import io
 import logging
+import math
+import mmap
 from pathlib import Path
 import re
 import struct
-from typing import Any, BinaryIO, Optional, List
+from typing import Any, BinaryIO, Callable, Optional, List, TextIO
 import csv
-
-from min_logger.builder import MetricEntryData, THREAD_NAME_MSG_ID, SEVERITY_LEVELS, ProfilerType
+import zlib
+
+from min_logger.builder import (
+    MetricEntryData,
+    THREAD_NAME_MSG_ID,
+    DROPPED_MSG_ID,
+    TIME_CALIBRATION_MSG_ID,
+    TIME_SYNC_MSG_ID,
+    MICRO_SYNC_MSG_ID,
+    CONTINUATION_MSG_ID,
+    THREAD_REGISTRY_MSG_ID,
+    SEVERITY_LEVELS,
+    ProfilerType,
+    SampleType,
+)
+from min_logger.columnar import ColumnarWriter
 from min_logger.generate_perfetto import PerfettoBuilder
 from min_logger.built_in_types import get_struct_format
 
@@ -14,14 +32,118 @@ _logger = logging.getLogger("min_logger.parser")
 
 SUBSTITUTE_PATTERN = re.compile(r"\$\{(.+?)\}")
 
-
-def _substitute_vars(text, values):
-
-    def replacer(match):
-        key = match.group(1)
-        return str(values.get(key, match.group(0)))
-
-    return re.sub(SUBSTITUTE_PATTERN, replacer, text)
+# Payload: {uint32_t dropped_messages, uint32_t dropped_bytes} totals since start
+DROPPED_PAYLOAD = struct.Struct("<II")
+# Payload: {uint64_t ticks, uint64_t nanoseconds, uint64_t counter_bits}
+TIME_CALIBRATION_PAYLOAD = struct.Struct("<QQQ")
+# Payload: {uint32_t duration} in the logger's timestamp units, sent by MIN_LOGGER_SCOPE
+SCOPE_PAYLOAD = struct.Struct("<I")
+# Payload: {uint32_t count, double min, double max, double sum, double sum_sq}, sent by
+# min_logger_flush_stats() for MIN_LOGGER_RECORD_STAT
+STAT_PAYLOAD = struct.Struct("<Idddd")
+# Payload: STAT_PAYLOAD, then {double histogram_min, double histogram_max, uint32_t buckets[8]}
+STAT_HISTOGRAM_PAYLOAD = struct.Struct("<Idddddd8I")
+# Payloads of the profiler types, which are sent without a value_type.
+PROFILER_PAYLOADS = {
+    ProfilerType.SCOPE: SCOPE_PAYLOAD,
+    ProfilerType.STAT: STAT_PAYLOAD,
+    ProfilerType.STAT_HISTOGRAM: STAT_HISTOGRAM_PAYLOAD,
+}
+# Payload: {uint32_t magic, uint64_t timestamp}
+MICRO_SYNC_PAYLOAD = struct.Struct("<IQ")
+MICRO_SYNC_MAGIC = 0x5AA5C33C
+# Payload: {uint32_t msg_id, uint32_t offset, uint32_t total_len}, followed by the piece of the
+# msg_id message's payload at offset
+CONTINUATION_PAYLOAD = struct.Struct("<III")
+
+# Metadata for the messages the library sends itself.
+RESERVED_ENTRIES = {
+    THREAD_NAME_MSG_ID: MetricEntryData(
+        id=THREAD_NAME_MSG_ID,
+        tags=[],
+        name=None,
+        msg=None,
+        level=0,
+        source_file=Path(),
+        source_line=0,
+        value_type="char",
+        is_array=True,
+        profiler_type=None,
+    ),
+    DROPPED_MSG_ID: MetricEntryData(
+        id=DROPPED_MSG_ID,
+        tags=[],
+        name=None,
+        msg=None,
+        level=0,
+        source_file=Path(),
+        source_line=0,
+        value_type="2I",
+        is_array=False,
+        profiler_type=None,
+    ),
+    TIME_CALIBRATION_MSG_ID: MetricEntryData(
+        id=TIME_CALIBRATION_MSG_ID,
+        tags=[],
+        name=None,
+        msg=None,
+        level=0,
+        source_file=Path(),
+        source_line=0,
+        value_type="3Q",
+        is_array=False,
+        profiler_type=None,
+    ),
+    TIME_SYNC_MSG_ID: MetricEntryData(
+        id=TIME_SYNC_MSG_ID,
+        tags=[],
+        name=None,
+        msg=None,
+        level=0,
+        source_file=Path(),
+        source_line=0,
+        value_type="Q",
+        is_array=False,
+        profiler_type=None,
+    ),
+    MICRO_SYNC_MSG_ID: MetricEntryData(
+        id=MICRO_SYNC_MSG_ID,
+        tags=[],
+        name=None,
+        msg=None,
+        level=0,
+        source_file=Path(),
+        source_line=0,
+        value_type="3I",
+        is_array=False,
+        profiler_type=None,
+    ),
+    CONTINUATION_MSG_ID: MetricEntryData(
+        id=CONTINUATION_MSG_ID,
+        tags=[],
+        name=None,
+        msg=None,
+        level=0,
+        source_file=Path(),
+        source_line=0,
+        value_type="char",
+        is_array=True,
+        profiler_type=None,
+    ),
+    # uint8 thread index, then that thread's name.
+    THREAD_REGISTRY_MSG_ID: MetricEntryData(
+        id=THREAD_REGISTRY_MSG_ID,
+        tags=[],
+        name=None,
+        msg=None,
+        level=0,
+        source_file=Path(),
+        source_line=0,
+        value_type="char",
+        is_array=True,
+        profiler_type=None,
+    ),
+}
 
 
 def _severity_string(severity):
@@ -39,6 +161,7 @@ def _severity_string(severity):
 
 FORMAT_CHARS = "bBhHiIlLqQfdspPc?x"
 TYPE_RE = re.compile(r"([0-9]*)([^0-9].*)")
+FORMAT_TOKEN_RE = re.compile(r"([0-9]*)([^0-9])")
 
 
 def _c_type_to_python_data(
@@ -124,6 +247,191 @@ def _c_type_to_python_data(
     return value, size
 
 
+def _compile_type(
+    c_type: str,
+    type_defs: dict[str, str | dict],
+    seen: Optional[List[str]] = None,
+) -> tuple[str, Callable[[tuple, int], tuple[Any, int]]]:
+    """Compile a c_type into a flat struct format and a function to build its value.
+
+    Produces the same values as _c_type_to_python_data, but does the type lookups once so each
+    message only needs a single unpack.
+
+    Returns:
+        The struct format for the whole type, and a function taking the unpacked values and the
+        index of the type's first value that returns the built value and the next index.
+    """
+    if seen is None:
+        seen = []
+    if c_type in seen:
+        chain = " -> ".join(seen + [c_type])
+        raise ValueError(f"Circular type reference detected: {chain}")
+
+    m = TYPE_RE.fullmatch(c_type)
+    if m is None:
+        raise ValueError(f"Invalid c_type format: {c_type}")
+
+    count_str = m.group(1)
+    count = 1 if len(count_str) == 0 else int(count_str)
+
+    single_type = m.group(2)
+
+    if single_type in FORMAT_CHARS:
+        format_str = c_type
+    elif single_type not in type_defs:
+        format_str = count_str + get_struct_format(single_type)
+    else:
+        type_def = type_defs[single_type]
+
+        if isinstance(type_def, dict):
+            seen.append(single_type)
+            fields = []
+            field_formats = []
+            for field_name, field_type in type_def.items():
+                field_format, field_build = _compile_type(field_type, type_defs, seen)
+                field_formats.append(field_format)
+                fields.append((field_name, field_build))
+            seen.pop()
+
+            def build_struct(values, i):
+                result = {}
+                for field_name, field_build in fields:
+                    field_value, i = field_build(values, i)
+                    if field_value is not None:
+                        result[field_name] = field_value
+                return result, i
+
+            if count == 1:
+                return "".join(field_formats), build_struct
+
+            def build_struct_array(values, i):
+                array_values = []
+                for _ in range(count):
+                    result, i = build_struct(values, i)
+                    array_values.append(result)
+                return array_values, i
+
+            return "".join(field_formats) * count, build_struct_array
+
+        return _compile_type(count_str + type_def, type_defs, seen)
+
+    value_count = len(struct.unpack("<" + format_str, bytes(struct.calcsize("<" + format_str))))
+
+    def build_leaf(values, i):
+        if single_type == "x":
+            return None, i
+        if value_count != 1:
+            return list(values[i : i + value_count]), i + value_count
+        value = values[i]
+        if isinstance(value, bytes):
+            try:
+                str_val = value.rstrip(b"\x00").decode("utf-8")
+                if str_val.isprintable():
+                    value = str_val
+            except UnicodeDecodeError:
+                pass
+        return value, i + 1
+
+    return format_str, build_leaf
+
+
+class _DecodePlan:
+    """A c_type compiled to a single struct unpack."""
+
+    def __init__(self, c_type: str, type_defs: dict[str, str | dict]) -> None:
+        format_str, self._build = _compile_type(c_type, type_defs)
+        self._struct = struct.Struct("<" + format_str)
+        self.size = self._struct.size
+        # The format character of each unpacked value
+        self.formats: list[str] = []
+        for count, char in FORMAT_TOKEN_RE.findall(format_str):
+            if char in "sp":
+                self.formats.append(char)
+            elif char != "x":
+                self.formats += [char] * (1 if len(count) == 0 else int(count))
+
+    def unpack(self, data: bytes) -> tuple:
+        return self._struct.unpack_from(data)
+
+    def decode(self, data: bytes) -> Any:
+        value, _ = self._build(self._struct.unpack_from(data), 0)
+        return value
+
+
+def _compile_template(text: str) -> list[str]:
+    """Split a message into alternating literal text and SUBSTITUTE_PATTERN value names."""
+    return SUBSTITUTE_PATTERN.split(text)
+
+
+def _sample_note(metric: MetricEntryData) -> str:
+    """Marks messages from sampled call sites, since only some of their calls are in the log."""
+    if metric.sample_type == SampleType.EVERY_N:
+        return f" [1 in {metric.sample_value:g}]"
+    elif metric.sample_type == SampleType.EVERY_MS:
+        return f" [every {metric.sample_value:g}ms]"
+    elif metric.sample_type == SampleType.RATE_LIMITED:
+        return f" [max {metric.sample_value:g}/s]"
+    # ON_CHANGE call sites only skip repeats of the value in last_values, so nothing is missing.
+    return ""
+
+
+def _render_template(parts: list[str], values: dict[str, Any]) -> str:
+    rendered = []
+    for i, part in enumerate(parts):
+        if i % 2 == 0:
+            rendered.append(part)
+        elif part in values:
+            rendered.append(str(values[part]))
+        else:
+            rendered.append("${" + part + "}")
+    return "".join(rendered)
+
+
+class ContinuationJoiner:
+    """Joins the pieces of payloads that were too long for one message.
+
+    The serializers send the pieces in order as CONTINUATION_MSG_ID messages from the thread that
+    logged the payload.
+    """
+
+    def __init__(self, pending: Optional[dict[int, tuple[int, int, bytes]]] = None) -> None:
+        # Thread ID -> (message ID, total length, the pieces so far)
+        self.pending: dict[int, tuple[int, int, bytearray]] = {}
+        for thread_id, (msg_id, total_len, data) in (pending or {}).items():
+            self.pending[thread_id] = (msg_id, total_len, bytearray(data))
+        # Thread ID -> (message ID, total length) of a payload missing a piece, whose other pieces
+        # are skipped.
+        self._skipping: dict[int, tuple[int, int]] = {}
+
+    def add(self, thread_id: int, value: bytes) -> Optional[tuple[int, bytes]]:
+        """Add a piece, returning the message ID and payload once all its pieces are added."""
+        if len(value) < CONTINUATION_PAYLOAD.size:
+            _logger.warning("Truncated continuation message")
+            return None
+        msg_id, offset, total_len = CONTINUATION_PAYLOAD.unpack_from(value)
+        piece = value[CONTINUATION_PAYLOAD.size :]
+
+        current = self.pending.pop(thread_id, None)
+        skipping = self._skipping.pop(thread_id, None)
+        if offset == 0:
+            if current is not None:
+                _logger.warning("Missing the end of a 0x%08X message, skipping it", current[0])
+            data = bytearray(piece)
+        elif current is None or current[:2] != (msg_id, total_len) or len(current[2]) != offset:
+            if skipping != (msg_id, total_len):
+                _logger.warning("Missing part of a 0x%08X message, skipping it", msg_id)
+            self._skipping[thread_id] = (msg_id, total_len)
+            return None
+        else:
+            data = current[2]
+            data += piece
+
+        if len(data) >= total_len:
+            return msg_id, bytes(data[:total_len])
+        self.pending[thread_id] = (msg_id, total_len, data)
+        return None
+
+
 class MessageHandler:
     def __init__(
         self,
@@ -131,10 +439,15 @@ class MessageHandler:
         print_messages=True,
         perfetto_path: Optional[Path] = None,
         csv_dir: Optional[Path] = None,
+        reorder_window: float = 0.0,
+        parquet_dir: Optional[Path] = None,
+        arrow_dir: Optional[Path] = None,
     ) -> None:
         self.log_metrics: dict[int, MetricEntryData] = meta["entries"]
         self.type_defs: dict[str, str | dict] = meta["type_defs"]
         self.print_messages = print_messages
+        # Text output goes to stdout unless this is set.
+        self.out: Optional[TextIO] = None
         self.perfetto_path = perfetto_path
         self.csv_dir = csv_dir
         if self.csv_dir is not None:
@@ -143,27 +456,75 @@ class MessageHandler:
         # Map metric_key -> {file: fobj, writer: DictWriter, fieldnames: list}
         self._csv_files: dict[str, dict] = {}
 
+        self.parquet_dir = parquet_dir
+        self.arrow_dir = arrow_dir
+        self._columnar_writers: list[ColumnarWriter] = []
+        if parquet_dir is not None:
+            self._columnar_writers.append(ColumnarWriter(parquet_dir, "PARQUET"))
+        if arrow_dir is not None:
+            self._columnar_writers.append(ColumnarWriter(arrow_dir, "ARROW"))
+        # Metric ID -> the name of its columns, and column name -> (fields, indexed)
+        self._columnar_keys: dict[int, str] = {}
+        self._columnar_layouts: dict[str, tuple[list[tuple[str, str]], bool]] = {}
+
         self.last_values: dict[str, str] = {}
         self.unknown_ids: set[int] = set()
         self.thread_names: dict[int, str] = {}
-        self.perfetto_gen = PerfettoBuilder()
+        # The trace is written as the messages are handled.
+        self.perfetto_gen = PerfettoBuilder(perfetto_path) if perfetto_path else None
         self.base_payload_sizes: dict[int, int] = {}
+        # Decode plans by c_type, and messages split into templates by metric ID, compiled the
+        # first time they're seen.
+        self._plans: dict[str, _DecodePlan] = {}
+        self._templates: dict[int, list[str]] = {}
+        # Last dropped totals reported by each thread that sends DROPPED_MSG_ID
+        self._dropped_totals: dict[int, tuple[int, int]] = {}
+        self.dropped_messages = 0
+        self.dropped_bytes = 0
+        self._continuations = ContinuationJoiner()
+
+        # Messages are held for reorder_window seconds so that streams that are only ordered per
+        # thread (e.g. sharded buffers) can be output in timestamp order.
+        self.reorder_window = reorder_window
+        self._reorder_heap: list[tuple[float, int, int, int, bytes]] = []
+        self._reorder_count = 0
+        self._newest_timestamp = 0.0
+
+        # With MIN_LOGGER_CYCLE_COUNTER_TIME timestamps are cycle counter ticks. They're converted
+        # relative to the last TIME_CALIBRATION_MSG_ID: (raw timestamp, ticks, nanoseconds).
+        self._calibration: Optional[tuple[int, int, int]] = None
+        self._counter_mask = 0xFFFFFFFFFFFFFFFF
+        self._ns_per_tick: Optional[float] = None
+        # Messages received before the second calibration, when the tick rate is still unknown.
+        self._pending_msgs: list[tuple[int, int, int, bytes]] = []
 
     def get_base_payload_size(self, metric_id: int) -> int:
         if metric_id in self.base_payload_sizes:
             return self.base_payload_sizes[metric_id]
 
-        if metric_id not in self.log_metrics:
+        if metric_id in RESERVED_ENTRIES:
+            metric = RESERVED_ENTRIES[metric_id]
+        elif metric_id in self.log_metrics:
+            metric = self.log_metrics[metric_id]
+        else:
             raise ValueError(f"Metric ID 0x{metric_id:08X} not found in metadata")
 
-        metric = self.log_metrics[metric_id]
+        if metric.profiler_type in PROFILER_PAYLOADS:
+            return PROFILER_PAYLOADS[metric.profiler_type].size
         if metric.value_type is None:
             return 0
 
-        _, size = _c_type_to_python_data(None, metric.value_type, self.type_defs)
+        size = self._get_plan(metric.value_type).size
         self.base_payload_sizes[metric_id] = size
         return size
 
+    def _get_plan(self, c_type: str) -> _DecodePlan:
+        plan = self._plans.get(c_type)
+        if plan is None:
+            plan = _DecodePlan(c_type, self.type_defs)
+            self._plans[c_type] = plan
+        return plan
+
     def _sanitize_filename(self, name: str) -> str:
         # Keep only safe characters
         return re.sub(r"[^A-Za-z0-9_.-]", "_", name)
@@ -233,7 +594,96 @@ class MessageHandler:
 
         entry["writer"].writerow(row)
 
+    def process_raw_msg(self, raw_time: int, metric_id: int, thread_id: int, value: bytes):
+        """Process a message with the timestamp in the units sent by the logger.
+
+        This is nanoseconds, unless the log has time calibration messages, in which case it's ticks
+        of the cycle counter.
+        """
+        if metric_id == TIME_CALIBRATION_MSG_ID:
+            self._handle_calibration(raw_time, value)
+        elif self._calibration is None:
+            self.process_msg(raw_time * 1e-9, metric_id, thread_id, value)
+        elif self._ns_per_tick is None:
+            self._pending_msgs.append((raw_time, metric_id, thread_id, value))
+        else:
+            self.process_msg(self._ticks_to_seconds(raw_time), metric_id, thread_id, value)
+
+    def process_raw_msgs(self, msgs: list[tuple[int, int, int, bytes]]):
+        """process_raw_msg() for a batch of (raw time, metric ID, thread ID, payload)."""
+        if self._calibration is not None or self.reorder_window > 0:
+            for msg in msgs:
+                self.process_raw_msg(*msg)
+            return
+
+        # Fast path for nanosecond timestamps that don't need reordering.
+        handle_msg = self._handle_msg
+        for i, (raw_time, metric_id, thread_id, value) in enumerate(msgs):
+            if metric_id == TIME_CALIBRATION_MSG_ID:
+                self.process_raw_msg(raw_time, metric_id, thread_id, value)
+                self.process_raw_msgs(msgs[i + 1 :])
+                return
+            handle_msg(raw_time * 1e-9, metric_id, thread_id, value)
+
+    def _ticks_to_seconds(self, raw_time: int) -> float:
+        assert self._calibration is not None and self._ns_per_tick is not None
+        calibration_raw, _, calibration_ns = self._calibration
+        # Signed difference, so 32bit counters can wrap.
+        delta = (raw_time - calibration_raw) & self._counter_mask
+        if delta > self._counter_mask // 2:
+            delta -= self._counter_mask + 1
+        return (calibration_ns + delta * self._ns_per_tick) * 1e-9
+
+    def _duration_to_seconds(self, duration: int) -> float:
+        if self._calibration is None:
+            return duration * 1e-9
+        return duration * (self._ns_per_tick or 1.0) * 1e-9
+
+    def _handle_calibration(self, raw_time: int, value: bytes):
+        if len(value) < TIME_CALIBRATION_PAYLOAD.size:
+            _logger.warning("Truncated time calibration message")
+            return
+        ticks, nanoseconds, counter_bits = TIME_CALIBRATION_PAYLOAD.unpack_from(value)
+        self._counter_mask = (1 << counter_bits) - 1
+
+        if self._calibration is not None:
+            _, last_ticks, last_ns = self._calibration
+            elapsed_ticks = (ticks - last_ticks) & self._counter_mask
+            if elapsed_ticks > 0 and nanoseconds > last_ns:
+                self._ns_per_tick = (nanoseconds - last_ns) / elapsed_ticks
+            self._flush_pending_msgs()
+
+        self._calibration = (raw_time, ticks, nanoseconds)
+
+    def _flush_pending_msgs(self):
+        if self._ns_per_tick is None:
+            return
+        for raw_time, metric_id, thread_id, value in self._pending_msgs:
+            self.process_msg(self._ticks_to_seconds(raw_time), metric_id, thread_id, value)
+        self._pending_msgs = []
+
     def process_msg(self, timestamp: float, metric_id: int, thread_id: int, value: bytes):
+        if self.reorder_window <= 0:
+            self._handle_msg(timestamp, metric_id, thread_id, value)
+            return
+
+        # The count breaks timestamp ties so messages stay in arrival order.
+        heapq.heappush(
+            self._reorder_heap, (timestamp, self._reorder_count, metric_id, thread_id, value)
+        )
+        self._reorder_count += 1
+        self._newest_timestamp = max(self._newest_timestamp, timestamp)
+        while self._reorder_heap[0][0] <= self._newest_timestamp - self.reorder_window:
+            msg_timestamp, _, msg_id, msg_thread_id, msg_value = heapq.heappop(self._reorder_heap)
+            self._handle_msg(msg_timestamp, msg_id, msg_thread_id, msg_value)
+
+    def _handle_msg(self, timestamp: float, metric_id: int, thread_id: int, value: bytes):
+
+        if metric_id == THREAD_REGISTRY_MSG_ID:
+            # A name sent on another thread's behalf.
+            if len(value) > 0:
+                self._handle_msg(timestamp, THREAD_NAME_MSG_ID, value[0], value[1:])
+            return
 
         if metric_id == THREAD_NAME_MSG_ID:
             thread_name = ""
@@ -244,11 +694,22 @@ class MessageHandler:
 
             self.thread_names[thread_id] = thread_name
 
-            if self.perfetto_path:
+            if self.perfetto_gen is not None:
                 self.perfetto_gen.set_thread_name(timestamp, thread_id, thread_name)
 
             return
 
+        if metric_id == DROPPED_MSG_ID:
+            self._handle_dropped(timestamp, thread_id, value)
+            return
+
+        if metric_id == CONTINUATION_MSG_ID:
+            # The joined message gets the timestamp of its last piece.
+            joined = self._continuations.add(thread_id, value)
+            if joined is not None:
+                self._handle_msg(timestamp, joined[0], thread_id, joined[1])
+            return
+
         if metric_id not in self.log_metrics:
             if metric_id not in self.unknown_ids:
                 _logger.warning("Metric with unknown ID: 0x%08X", metric_id)
@@ -258,19 +719,10 @@ class MessageHandler:
         metric = self.log_metrics[metric_id]
 
         if metric.name is not None and metric.value_type is not None:
-            if metric.is_array:
-                size = self.get_base_payload_size(metric_id)
-                if len(value) % size != 0:
-                    raise ValueError(
-                        f"Payload size {len(value)} is not a multiple of element size {size} for metric ID 0x{metric_id:08X}"
-                    )
-                else:
-                    array_count = len(value) // size
-                    full_type = f"{array_count}{metric.value_type}"
-            else:
-                full_type = metric.value_type
-            new_value, size = _c_type_to_python_data(value, full_type, self.type_defs)
+            new_value = self._decode_value(metric_id, metric, value)
             self.last_values[metric.name] = new_value
+            if self.parquet_dir is not None or self.arrow_dir is not None:
+                self._add_columnar(metric_id, metric, timestamp, value)
             # Write CSV if requested and metric has a name
             if self.csv_dir is not None:
                 if isinstance(new_value, list):
@@ -278,10 +730,9 @@ class MessageHandler:
                         self._write_metric_csv(metric.name, timestamp, elem, i)
                 else:
                     self._write_metric_csv(metric.name, timestamp, new_value)
-            if size < len(value):
-                raise ValueError(
-                    f"Parsed size {size} is smaller than payload size {len(value)} for metric ID 0x{metric_id:08X}"
-                )
+
+        if metric.profiler_type in {ProfilerType.STAT, ProfilerType.STAT_HISTOGRAM}:
+            self._handle_stat(timestamp, metric_id, metric, value)
 
         thread_name = (
             f"thread_id_{thread_id}"
@@ -290,38 +741,182 @@ class MessageHandler:
         )
 
         if metric.profiler_type == ProfilerType.ENTER and metric.name is not None:
-            if self.perfetto_path:
+            if self.perfetto_gen is not None:
                 self.perfetto_gen.enter_slice(
                     timestamp, metric.name, thread_id, metric.source_file, metric.source_line
                 )
         elif metric.profiler_type == ProfilerType.EXIT and metric.name is not None:
-            if self.perfetto_path:
+            if self.perfetto_gen is not None:
                 self.perfetto_gen.exit_slice(
                     timestamp, metric.name, thread_id, metric.source_file, metric.source_line
                 )
+        elif metric.profiler_type == ProfilerType.SCOPE and metric.name is not None:
+            if self.perfetto_gen is not None:
+                if len(value) < SCOPE_PAYLOAD.size:
+                    _logger.warning("Truncated scope message for metric ID 0x%08X", metric_id)
+                else:
+                    (duration,) = SCOPE_PAYLOAD.unpack_from(value)
+                    # The message is sent when the scope exits, so it marks the end of the slice.
+                    self.perfetto_gen.add_slice(
+                        timestamp - self._duration_to_seconds(duration),
+                        timestamp,
+                        metric.name,
+                        thread_id,
+                        metric.source_file,
+                        metric.source_line,
+                    )
 
         if metric.msg is not None:
-            msg = _substitute_vars(metric.msg, self.last_values)
+            template = self._templates.get(metric_id)
+            if template is None:
+                template = _compile_template(metric.msg + _sample_note(metric))
+                self._templates[metric_id] = template
+            msg = _render_template(template, self.last_values)
             severity_str = _severity_string(metric.level)
             print(
-                f"{timestamp:.6f} {severity_str:5} {metric.source_file}:{metric.source_line} {thread_name}] {msg}"
+                f"{timestamp:.6f} {severity_str:5} {metric.source_file}:{metric.source_line} {thread_name}] {msg}",
+                file=self.out,
             )
-            if self.perfetto_path:
+            if self.perfetto_gen is not None:
                 self.perfetto_gen.add_log(
                     timestamp, msg, thread_id, severity_str, metric.source_file, metric.source_line
                 )
 
+    def _full_type(self, metric_id: int, metric: MetricEntryData, value: bytes) -> str:
+        assert metric.value_type is not None
+        if metric.is_array:
+            size = self.get_base_payload_size(metric_id)
+            if len(value) % size != 0:
+                raise ValueError(
+                    f"Payload size {len(value)} is not a multiple of element size {size} for metric ID 0x{metric_id:08X}"
+                )
+            else:
+                array_count = len(value) // size
+                return f"{array_count}{metric.value_type}"
+        return metric.value_type
+
+    def _decode_value(self, metric_id: int, metric: MetricEntryData, value: bytes) -> Any:
+        plan = self._get_plan(self._full_type(metric_id, metric, value))
+        if plan.size < len(value):
+            raise ValueError(
+                f"Parsed size {plan.size} is smaller than payload size {len(value)} for metric ID 0x{metric_id:08X}"
+            )
+        return plan.decode(value)
+
+    def _add_columnar_metric(self, metric_id: int, metric: MetricEntryData) -> str:
+        assert metric.name is not None and metric.value_type is not None
+        element = self._get_plan(metric.value_type)
+        flattened: dict = {}
+        self._flatten_value(element.decode(bytes(element.size)), flattened)
+        if len(flattened) != len(element.formats):
+            raise ValueError(
+                f"Can't make columns for {metric.value_type} for metric ID 0x{metric_id:08X}"
+            )
+        fields = list(zip(flattened.keys(), element.formats))
+        # Arrays of chars are strings, so they're a value per sample instead of per element.
+        indexed = metric.is_array and element.formats not in (["s"], ["p"])
+
+        key = metric.name
+        if self._columnar_layouts.get(key, (fields, indexed)) != (fields, indexed):
+            # Another metric with the same name has different columns.
+            key = f"{metric.name}_0x{metric_id:08X}"
+        if key not in self._columnar_layouts:
+            self._columnar_layouts[key] = (fields, indexed)
+            for writer in self._columnar_writers:
+                writer.add_metric(key, self._sanitize_filename(key), fields, indexed)
+        self._columnar_keys[metric_id] = key
+        return key
+
+    def _add_columnar(self, metric_id: int, metric: MetricEntryData, timestamp: float, value):
+        key = self._columnar_keys.get(metric_id)
+        if key is None:
+            key = self._add_columnar_metric(metric_id, metric)
+        values = self._get_plan(self._full_type(metric_id, metric, value)).unpack(value)
+        for writer in self._columnar_writers:
+            writer.append(key, timestamp, values)
+
+    def _handle_stat(
+        self, timestamp: float, metric_id: int, metric: MetricEntryData, value: bytes
+    ):
+        payload = PROFILER_PAYLOADS[metric.profiler_type]
+        if len(value) < payload.size:
+            _logger.warning("Truncated stat message for metric ID 0x%08X", metric_id)
+            return
+        fields = payload.unpack_from(value)
+        count, min_value, max_value, total, total_sq = fields[:5]
+        if count == 0:
+            return
+        mean = total / count
+        summary: dict[str, Any] = {
+            "count": count,
+            "min": min_value,
+            "max": max_value,
+            "mean": mean,
+            # Rounding can make the variance slightly negative when the values are all equal.
+            "std": math.sqrt(max(total_sq / count - mean * mean, 0.0)),
+        }
+        if metric.profiler_type == ProfilerType.STAT_HISTOGRAM:
+            summary["histogram_min"] = fields[5]
+            summary["histogram_max"] = fields[6]
+            summary["buckets"] = list(fields[7:])
+
+        assert metric.name is not None
+        self.last_values[metric.name] = summary
+        self._write_metric_csv(metric.name, timestamp, summary)
+        if self.perfetto_gen is not None:
+            for key in ("mean", "min", "max"):
+                self.perfetto_gen.add_counter(timestamp, f"{metric.name}.{key}", summary[key])
+
+    def _handle_dropped(self, timestamp: float, thread_id: int, value: bytes):
+        if len(value) < DROPPED_PAYLOAD.size:
+            _logger.warning("Truncated dropped message report at %.6f", timestamp)
+            return
+        total_messages, total_bytes = DROPPED_PAYLOAD.unpack_from(value)
+        last_messages, last_bytes = self._dropped_totals.get(thread_id, (0, 0))
+        self._dropped_totals[thread_id] = (total_messages, total_bytes)
+        # Totals are cumulative so a lost report doesn't lose the count. They wrap at 32 bits.
+        new_messages = (total_messages - last_messages) & 0xFFFFFFFF
+        new_bytes = (total_bytes - last_bytes) & 0xFFFFFFFF
+        if new_messages == 0:
+            return
+        self.dropped_messages += new_messages
+        self.dropped_bytes += new_bytes
+
+        msg = f"Logger dropped {new_messages} messages ({new_bytes} bytes)"
+        if self.print_messages:
+            thread_name = self.thread_names.get(thread_id, f"thread_id_{thread_id}")
+            print(f"{timestamp:.6f} {'WARN':5} min_logger {thread_name}] {msg}", file=self.out)
+        if self.perfetto_gen is not None:
+            self.perfetto_gen.add_log(timestamp, msg, thread_id, "WARN", Path(), 0)
+
     def finish(self):
-        if self.perfetto_path:
-            self.perfetto_gen.write_to_file(self.perfetto_path)
+        if self._pending_msgs:
+            _logger.warning("Log only has one time calibration, assuming 1 tick per nanosecond.")
+            self._ns_per_tick = 1.0
+            self._flush_pending_msgs()
+
+        while self._reorder_heap:
+            timestamp, _, metric_id, thread_id, value = heapq.heappop(self._reorder_heap)
+            self._handle_msg(timestamp, metric_id, thread_id, value)
+
+        if self.perfetto_gen is not None:
+            self.perfetto_gen.close()
 
         # Close any open CSV files
         for entry in list(self._csv_files.values()):
             entry["file"].close()
 
+        for writer in self._columnar_writers:
+            writer.close()
+
         if len(self.unknown_ids) > 0:
             _logger.warning("Log contained unknown IDs: %s", str(self.unknown_ids))
 
+        if self.dropped_messages > 0:
+            _logger.warning(
+                "Logger dropped %d messages (%d bytes)", self.dropped_messages, self.dropped_bytes
+            )
+
 
 # struct BinaryMsgHeader {
 #     static constexpr uint16_t SYNC = 0xFAAF;
@@ -335,61 +930,165 @@ class MessageHandler:
 SYNC_BYTES = b"\xaf\xfa"
 # Skip sync
 MSG_HEADER = struct.Struct("<BBIQ")
-CHUNK_SIZE = 32
 HEADER_SIZE = MSG_HEADER.size + len(SYNC_BYTES)
+# Size of the reads for logs that can't be memory mapped, like stdin.
+STREAM_CHUNK_SIZE = 1 << 16
+# Number of messages passed to MessageHandler.process_raw_msgs() at a time.
+DECODE_BATCH_SIZE = 4096
 
 
-def read_binary(
-    fd: BinaryIO, meta, perfetto_path: Optional[Path] = None, csv_dir: Optional[Path] = None
-):
-    handler = MessageHandler(meta, perfetto_path=perfetto_path, csv_dir=csv_dir)
-    buffer = b""
+def _decode_binary(
+    data, offset: int, handler: MessageHandler, stop: Optional[int] = None
+) -> int:
+    """Decode the complete messages in data starting at offset.
+
+    Args:
+        stop: If set, stop at the first message that starts at or after this offset.
+
+    Returns:
+        The offset of the first byte that wasn't consumed.
+    """
+    end = len(data)
+    if stop is None:
+        stop = end
+    find = data.find
+    unpack_header = MSG_HEADER.unpack_from
+    batch: list[tuple[int, int, int, bytes]] = []
+    append = batch.append
     while True:
-        chunk = fd.read(CHUNK_SIZE)
-        if not chunk:
-            break
-        buffer += chunk
-        while True:
-            idx = buffer.find(SYNC_BYTES)
-            if idx == -1:
-                # Keep last byte in buffer in case sync is split across chunks
-                buffer = (
-                    buffer[-(len(SYNC_BYTES) - 1) :]
-                    if len(buffer) >= len(SYNC_BYTES) - 1
-                    else buffer
-                )
+        # Messages are normally back to back, so only search when the next one isn't.
+        if data[offset : offset + 2] != SYNC_BYTES:
+            offset = find(SYNC_BYTES, offset)
+            if offset == -1:
+                # Keep last byte in case sync is split across reads
+                offset = max(end - (len(SYNC_BYTES) - 1), 0)
                 break
-            buffer = buffer[idx:]
+        if offset >= stop or offset + HEADER_SIZE > end:
+            break
+        payload_len, thread_id, metric_id, timestamp = unpack_header(data, offset + 2)
+        msg_end = offset + HEADER_SIZE + payload_len
+        if msg_end > end:
+            break
+        append((timestamp, metric_id, thread_id, data[offset + HEADER_SIZE : msg_end]))
+        if len(batch) == DECODE_BATCH_SIZE:
+            handler.process_raw_msgs(batch)
+            batch.clear()
+        offset = msg_end
 
-            if len(buffer) < HEADER_SIZE:
-                # Not enough data for header, wait for next chunk
-                break
-            payload_len, thread_id, metric_id, timestamp = MSG_HEADER.unpack_from(
-                buffer, len(SYNC_BYTES)
-            )
-            timestamp *= 1e-9
-            if len(buffer) < HEADER_SIZE + payload_len:
-                # Not enough data for payload, wait for next chunk
+    handler.process_raw_msgs(batch)
+    return offset
+
+
+def read_binary(
+    fd: BinaryIO,
+    meta,
+    perfetto_path: Optional[Path] = None,
+    csv_dir: Optional[Path] = None,
+    reorder_window: float = 0.0,
+    parquet_dir: Optional[Path] = None,
+    arrow_dir: Optional[Path] = None,
+):
+    """Parse MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT logs.
+
+    Files are memory mapped and decoded in place. Other streams are read in large chunks.
+    """
+    handler = MessageHandler(
+        meta,
+        perfetto_path=perfetto_path,
+        csv_dir=csv_dir,
+        reorder_window=reorder_window,
+        parquet_dir=parquet_dir,
+        arrow_dir=arrow_dir,
+    )
+    try:
+        data = mmap.mmap(fd.fileno(), 0, access=mmap.ACCESS_READ)
+    except (OSError, ValueError, io.UnsupportedOperation):
+        # Pipes and empty files can't be mapped.
+        data = None
+
+    if data is not None:
+        with data:
+            _decode_binary(data, 0, handler)
+    else:
+        # read1() returns what's available, so live streams aren't held until a chunk fills.
+        read = getattr(fd, "read1", fd.read)
+        buffer = b""
+        while True:
+            chunk = read(STREAM_CHUNK_SIZE)
+            if not chunk:
                 break
-            msg_end = HEADER_SIZE + payload_len
-            payload = buffer[HEADER_SIZE:msg_end]
-            handler.process_msg(timestamp, metric_id, thread_id, payload)
-            buffer = buffer[msg_end:]
+            buffer += chunk
+            buffer = buffer[_decode_binary(buffer, 0, handler) :]
 
     handler.finish()
 
 
-def _timescale_to_dt(time_scale, time_value) -> float:
-    return time_value * (1e-9 * (1000**time_scale))
+def _timescale_to_dt(time_scale, time_value) -> int:
+    return time_value * (1000**time_scale)
 
 
-def read_micro_binary(
-    fd: BinaryIO, meta, perfetto_path: Optional[Path] = None, csv_dir: Optional[Path] = None
-):
-    handler = MessageHandler(meta, perfetto_path=perfetto_path, csv_dir=csv_dir)
-    truncated_ids = {v & 0xFFFF: v for v in handler.log_metrics.keys()}
-    truncated_ids[THREAD_NAME_MSG_ID & 0xFFFF] = THREAD_NAME_MSG_ID
-    timestamp = 0
+MICRO_HEADER_SIZE = 4
+# MicroMessageHeader::THREAD_ID_ESCAPE
+MICRO_THREAD_ID_ESCAPE = 0xF
+_MICRO_SYNC_ID_BYTES = (MICRO_SYNC_MSG_ID & 0xFFFF).to_bytes(2, "little")
+_MICRO_SYNC_MAGIC_BYTES = MICRO_SYNC_MAGIC.to_bytes(4, "little")
+
+
+def _find_micro_sync(data: bytes, start: int) -> int:
+    """Get the offset of the first complete sync marker at or after start, or -1."""
+    pos = data.find(_MICRO_SYNC_MAGIC_BYTES, start + MICRO_HEADER_SIZE)
+    while pos != -1:
+        offset = pos - MICRO_HEADER_SIZE
+        marker_complete = len(data) >= offset + MICRO_HEADER_SIZE + MICRO_SYNC_PAYLOAD.size
+        if marker_complete and data[offset : offset + 2] == _MICRO_SYNC_ID_BYTES:
+            return offset
+        pos = data.find(_MICRO_SYNC_MAGIC_BYTES, pos + 1)
+    return -1
+
+
+def index_micro_binary(data: bytes) -> list[tuple[int, int]]:
+    """Find the sync markers in a micro format log.
+
+    Each segment starting at a marker can be decoded independently, since the marker has the
+    absolute timestamp for the messages that follow it.
+
+    Returns:
+        (offset, raw timestamp) for each marker.
+    """
+    markers = []
+    offset = _find_micro_sync(data, 0)
+    while offset != -1:
+        _, timestamp = MICRO_SYNC_PAYLOAD.unpack_from(data, offset + MICRO_HEADER_SIZE)
+        markers.append((offset, timestamp))
+        offset = _find_micro_sync(data, offset + MICRO_HEADER_SIZE + MICRO_SYNC_PAYLOAD.size)
+    return markers
+
+
+class _MicroState:
+    """Decoding state carried between the chunks of a micro format log."""
+
+    def __init__(self, handler: MessageHandler) -> None:
+        self.truncated_ids = {v & 0xFFFF: v for v in handler.log_metrics.keys()}
+        for reserved_id in RESERVED_ENTRIES:
+            self.truncated_ids[reserved_id & 0xFFFF] = reserved_id
+        self.timestamp = 0
+        # MIN_LOGGER_MICRO_THREAD_BINARY_SERIALIZED_FORMAT sends a TIME_SYNC before a thread's
+        # first message, after which its deltas are relative to its own previous message.
+        self.thread_timestamps: dict[int, int] = {}
+        self.resyncs = 0
+
+
+def _decode_micro(
+    buffer, i: int, handler: MessageHandler, state: _MicroState, stop: Optional[int] = None
+) -> int:
+    """Decode the complete micro format messages in buffer starting at i.
+
+    Args:
+        stop: If set, stop at the first message that starts at or after this offset.
+
+    Returns:
+        The offset of the first byte that wasn't consumed.
+    """
     # Searches a binary file byte by byte for words that match the truncated_ids.
     # Then parses the remainder of the MicroMessage structure:
     #     struct MicroMessage {
@@ -398,8 +1097,101 @@ def read_micro_binary(
     #         uint8_t time_scale : 2;
     #         uint16_t time_value : 10;
     #     };
+    # A thread_id of MICRO_THREAD_ID_ESCAPE is followed by a byte with the whole thread ID.
+
+    # Sync markers (MICRO_SYNC_MSG_ID) reset the timestamp, and since messages can't overlap them,
+    # a match that would is from corrupted data. Parsing skips ahead to the marker instead.
+
+    MIN_MSG_SIZE = MICRO_HEADER_SIZE
+    truncated_ids = state.truncated_ids
+    thread_timestamps = state.thread_timestamps
+    if stop is None:
+        stop = len(buffer)
+    next_sync = _find_micro_sync(buffer, i)
+    while i <= len(buffer) - MIN_MSG_SIZE and i < stop:
+        if next_sync != -1 and next_sync < i:
+            next_sync = _find_micro_sync(buffer, i)
+        truncated_id = int.from_bytes(buffer[i : i + 2], "little")
+        if truncated_id not in truncated_ids:
+            i += 1
+            continue
+        bitfield = int.from_bytes(buffer[i + 2 : i + 4], "little")
+
+        thread_id = (bitfield >> 0) & 0xF
+        time_scale = (bitfield >> 4) & 0x3
+        time_value = (bitfield >> 6) & 0x3FF
+        header_size = MIN_MSG_SIZE
+        if thread_id == MICRO_THREAD_ID_ESCAPE:
+            header_size += 1
+            if len(buffer) < i + header_size:
+                break  # Wait for more data
+            thread_id = buffer[i + MIN_MSG_SIZE]
+        msg_size = header_size
+        full_id = truncated_ids[truncated_id]
+        if full_id in RESERVED_ENTRIES:
+            metric_entry = RESERVED_ENTRIES[full_id]
+        else:
+            metric_entry = handler.log_metrics[full_id]
+        payload = bytes()
+        if metric_entry.value_type is not None or metric_entry.profiler_type in PROFILER_PAYLOADS:
+            payload_offset = i + header_size
+            if metric_entry.is_array:
+                msg_size += 1  # Initial payload length byte
+                if len(buffer) < i + msg_size:
+                    break  # Wait for more data
+                payload_len = buffer[i + header_size]
+                payload_offset += 1
+            else:
+                payload_len = handler.get_base_payload_size(truncated_ids[truncated_id])
+
+            msg_size += payload_len
+
+            if len(buffer) < i + msg_size + 1:
+                break  # Wait for more data
+
+            payload = buffer[payload_offset : payload_offset + payload_len]
+
+        if i < next_sync < i + msg_size:
+            state.resyncs += 1
+            i = next_sync
+            continue
+
+        # Only count the delta once the whole message is available.
+        dt = _timescale_to_dt(time_scale, time_value)
+        if full_id == MICRO_SYNC_MSG_ID:
+            magic, sync_timestamp = MICRO_SYNC_PAYLOAD.unpack(payload)
+            if magic == MICRO_SYNC_MAGIC:
+                state.timestamp = sync_timestamp
+        elif full_id == TIME_SYNC_MSG_ID and len(payload) == 8:
+            thread_timestamps[thread_id] = int.from_bytes(payload, "little")
+        elif thread_id in thread_timestamps:
+            thread_timestamps[thread_id] += dt
+            handler.process_raw_msg(thread_timestamps[thread_id], full_id, thread_id, payload)
+        else:
+            state.timestamp += dt
+            handler.process_raw_msg(state.timestamp, full_id, thread_id, payload)
+        i += msg_size
+    return i
 
-    MIN_MSG_SIZE = 4
+
+def read_micro_binary(
+    fd: BinaryIO,
+    meta,
+    perfetto_path: Optional[Path] = None,
+    csv_dir: Optional[Path] = None,
+    reorder_window: float = 0.0,
+    parquet_dir: Optional[Path] = None,
+    arrow_dir: Optional[Path] = None,
+):
+    handler = MessageHandler(
+        meta,
+        perfetto_path=perfetto_path,
+        csv_dir=csv_dir,
+        reorder_window=reorder_window,
+        parquet_dir=parquet_dir,
+        arrow_dir=arrow_dir,
+    )
+    state = _MicroState(handler)
     BUFFER_SIZE = 4096
     buffer = b""
     while True:
@@ -407,61 +1199,122 @@ def read_micro_binary(
         if not chunk:
             break
         buffer += chunk
-        i = 0
-        while i <= len(buffer) - MIN_MSG_SIZE:
-            truncated_id = int.from_bytes(buffer[i : i + 2], "little")
-            if truncated_id not in truncated_ids:
-                i += 1
-                continue
-            bitfield = int.from_bytes(buffer[i + 2 : i + 4], "little")
-
-            thread_id = (bitfield >> 0) & 0xF
-            time_scale = (bitfield >> 4) & 0x3
-            time_value = (bitfield >> 6) & 0x3FF
-            # print(hex(truncated_id), thread_id, time_scale, time_value)
-            dt = _timescale_to_dt(time_scale, time_value)
-            timestamp += dt
-
-            msg_size = MIN_MSG_SIZE
-            full_id = truncated_ids[truncated_id]
-            if full_id == THREAD_NAME_MSG_ID:
-                metric_entry = MetricEntryData(
-                    id=full_id,
-                    tags=[],
-                    name=None,
-                    msg=None,
-                    level=0,
-                    source_file=Path(),
-                    source_line=0,
-                    value_type="char",
-                    is_array=True,
-                    profiler_type=None,
-                )
-            else:
-                metric_entry = handler.log_metrics[full_id]
-            payload = bytes()
-            if metric_entry.value_type is not None:
-                payload_offset = i + MIN_MSG_SIZE
-                if metric_entry.is_array:
-                    msg_size += 1  # Initial payload length byte
-                    if len(buffer) < i + msg_size:
-                        break  # Wait for more data
-                    payload_len = buffer[i + MIN_MSG_SIZE]
-                    payload_offset += 1
-                else:
-                    payload_len = handler.get_base_payload_size(truncated_ids[truncated_id])
+        # Keep any leftover bytes for next chunk
+        buffer = buffer[_decode_micro(buffer, 0, handler, state) :]
+    if state.resyncs > 0:
+        _logger.warning("Skipped corrupted data before %d sync markers", state.resyncs)
+    handler.finish()
 
-                msg_size += payload_len
 
-                if len(buffer) < i + msg_size + 1:
-                    break  # Wait for more data
+# struct BlockHeader {
+#     static constexpr uint16_t SYNC = 0xFBBF;
+#     uint16_t sync = SYNC;
+#     uint32_t crc = 0;
+#     uint16_t body_len = 0;
+#     uint8_t thread_id = 0;
+#     uint64_t base_timestamp = 0;
+# };
+
+BLOCK_SYNC_BYTES = b"\xbf\xfb"
+# Skip sync
+BLOCK_HEADER = struct.Struct("<IHBQ")
+BLOCK_HEADER_SIZE = BLOCK_HEADER.size + len(BLOCK_SYNC_BYTES)
+# Offset of the data covered by the CRC
+BLOCK_CRC_START = len(BLOCK_SYNC_BYTES) + 4
+BLOCK_ID_SLOTS = 32
 
-                payload = buffer[payload_offset : payload_offset + payload_len]
 
-            # You may want to reconstruct a timestamp from time_scale/time_value here
-            # For now, just pass 0 as timestamp and truncated_id as metric_id
-            handler.process_msg(timestamp, truncated_ids[truncated_id], thread_id, payload)
-            i += msg_size
-        # Keep any leftover bytes for next chunk
-        buffer = buffer[i:]
+def _read_varint(data: bytes, offset: int) -> tuple[int, int]:
+    """Read a LEB128 varint, returning the value and the offset after it."""
+    value = 0
+    shift = 0
+    while True:
+        if offset >= len(data):
+            raise ValueError("Truncated varint")
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, offset
+
+
+def _process_block(handler: MessageHandler, thread_id: int, base_timestamp: int, body: bytes):
+    id_slots = [0] * BLOCK_ID_SLOTS
+    timestamp = base_timestamp
+    offset = 0
+    while offset < len(body):
+        slot_ref, offset = _read_varint(body, offset)
+        if slot_ref == 0:
+            (metric_id,) = struct.unpack_from("<I", body, offset)
+            offset += 4
+            id_slots[metric_id % BLOCK_ID_SLOTS] = metric_id
+        else:
+            metric_id = id_slots[slot_ref - 1]
+        delta, offset = _read_varint(body, offset)
+        payload_len, offset = _read_varint(body, offset)
+        timestamp += delta
+        payload = body[offset : offset + payload_len]
+        offset += payload_len
+        handler.process_raw_msg(timestamp, metric_id, thread_id, payload)
+
+
+def read_block_binary(
+    fd: BinaryIO,
+    meta,
+    perfetto_path: Optional[Path] = None,
+    csv_dir: Optional[Path] = None,
+    reorder_window: float = 0.0,
+    parquet_dir: Optional[Path] = None,
+    arrow_dir: Optional[Path] = None,
+):
+    """Parse MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT logs.
+
+    Blocks that fail their CRC check are skipped.
+    """
+    handler = MessageHandler(
+        meta,
+        perfetto_path=perfetto_path,
+        csv_dir=csv_dir,
+        reorder_window=reorder_window,
+        parquet_dir=parquet_dir,
+        arrow_dir=arrow_dir,
+    )
+    buffer = b""
+    bad_blocks = 0
+    eof = False
+    while not eof:
+        chunk = fd.read(4096)
+        eof = not chunk
+        buffer += chunk
+        while True:
+            idx = buffer.find(BLOCK_SYNC_BYTES)
+            if idx == -1:
+                # Keep last byte in buffer in case sync is split across chunks
+                buffer = buffer[-(len(BLOCK_SYNC_BYTES) - 1) :]
+                break
+            buffer = buffer[idx:]
+
+            if len(buffer) < BLOCK_HEADER_SIZE:
+                break
+            crc, body_len, thread_id, base_timestamp = BLOCK_HEADER.unpack_from(
+                buffer, len(BLOCK_SYNC_BYTES)
+            )
+            block_end = BLOCK_HEADER_SIZE + body_len
+            if len(buffer) < block_end and not eof:
+                break
+            if len(buffer) < block_end or zlib.crc32(buffer[BLOCK_CRC_START:block_end]) != crc:
+                # Not a block, or a corrupted one. Search for the next sync.
+                bad_blocks += 1
+                buffer = buffer[1:]
+                continue
+            try:
+                body = buffer[BLOCK_HEADER_SIZE:block_end]
+                _process_block(handler, thread_id, base_timestamp, body)
+            except (ValueError, struct.error) as e:
+                _logger.warning("Invalid block: %s", e)
+            buffer = buffer[block_end:]
+
+    if bad_blocks > 0:
+        _logger.warning("Skipped %d sync words without a valid block", bad_blocks)
     handler.finish()
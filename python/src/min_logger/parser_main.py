@@ -16,7 +16,8 @@ from jsonargparse.typing import Path_fr, path_type, Path_fc
 from min_logger.builder import (
     MetricEntryData,
 )
-from min_logger.parser import read_binary, read_micro_binary
+from min_logger.parallel_parser import PARALLEL_FORMATS, read_parallel
+from min_logger.parser import read_binary, read_block_binary, read_micro_binary
 
 Path_dr = path_type("dw", docstring="path to a directory that exists and is writeable")
 
@@ -25,6 +26,7 @@ _logger = logging.getLogger("min_logger.parser_main")
 PARSERS = {
     "BINARY": read_binary,
     "MICRO_BINARY": read_micro_binary,
+    "BLOCK_BINARY": read_block_binary,
 }
 
 
@@ -34,6 +36,10 @@ def command(
     log_file: Optional[Path_fr] = None,  # pyright: ignore[reportInvalidTypeForm]
     perfetto_out: Optional[Path_fc] = None,  # pyright: ignore[reportInvalidTypeForm]
     csv_dir: Optional[Path_dr] = None,  # pyright: ignore[reportInvalidTypeForm]
+    reorder_window: float = 0.0,
+    jobs: int = 1,
+    parquet_dir: Optional[Path_dr] = None,  # pyright: ignore[reportInvalidTypeForm]
+    arrow_dir: Optional[Path_dr] = None,  # pyright: ignore[reportInvalidTypeForm]
 ):  # pylint: disable=dangerous-default-value
     """Parse logs and output log message and optional Perfetto trace or CSV files.
 
@@ -43,23 +49,62 @@ def command(
         log_file: The log file to parse. If not provided, stdin is used.
         perfetto_out: If provided, output a Perfetto trace file with the parsed logs.
         csv_dir: If provided, write parsed values to CSV files in this directory.
+        reorder_window: If greater than 0, hold messages for this many seconds and output them in
+            timestamp order. Needed for logs that are only ordered per thread, like those from
+            sharded buffers (MIN_LOGGER_BUFFER_SHARDS).
+        jobs: Number of processes to parse with. Only BINARY and MICRO_BINARY (with sync markers)
+            log files can be split. The output is the same as parsing with one process.
+        parquet_dir: If provided, write parsed values to a Parquet file per metric in this
+            directory. Needs the pyarrow extra.
+        arrow_dir: If provided, write parsed values to an Arrow IPC file per metric in this
+            directory. Needs the pyarrow extra.
     """
 
     if log_format is None:
         raise ValueError("--log_format is required")
     if log_format.upper() not in PARSERS:
         raise ValueError(f"Unsupported log format: {log_format}")
+    if jobs > 1:
+        if log_file is None:
+            raise ValueError("--jobs requires --log_file")
+        if reorder_window > 0:
+            raise ValueError("--jobs can't be combined with --reorder_window")
+        if log_format.upper() not in PARALLEL_FORMATS:
+            _logger.warning("%s logs can't be split, parsing with one process.", log_format)
+            jobs = 1
 
     with open(meta_data, "r") as fd:
         meta_data = json.load(fd)
         meta_data["entries"] = {e["id"]: MetricEntryData(**e) for e in meta_data["entries"]}
 
+    if jobs > 1:
+        if read_parallel(
+            log_file,  # type: ignore
+            log_format.upper(),
+            meta_data,
+            perfetto_out,
+            csv_dir,
+            jobs,
+            parquet_dir=parquet_dir,
+            arrow_dir=arrow_dir,
+        ):
+            return
+        _logger.warning("Log is too small to split, parsing with one process.")
+
     if log_file is None:
         log_fd = sys.stdin.buffer
     else:
         log_fd = open(log_file, "rb")
 
-    PARSERS[log_format.upper()](log_fd, meta_data, perfetto_out, csv_dir)  # type: ignore
+    PARSERS[log_format.upper()](
+        log_fd,
+        meta_data,
+        perfetto_out,  # type: ignore
+        csv_dir,
+        reorder_window,
+        parquet_dir=parquet_dir,
+        arrow_dir=arrow_dir,
+    )
 
 
 def main():
@@ -1,3 +1,4 @@
+import json
 import logging
 from pathlib import Path
 import tempfile
@@ -5,18 +6,19 @@ from binascii import crc32
 
 import pytest
 
-from min_logger.builder import get_metric_entries, MetricEntryData
+from min_logger import builder
+from min_logger.builder import get_metric_entries, MetricEntryData, ProfilerType, SampleType
 
 
 def test_successful_parsing(caplog):
     logging.basicConfig(level=logging.INFO)
     TEST_FILE = """
         MIN_LOGGER_ENTER(MIN_LOGGER_DEBUG, "TASK_LOOP");
-        MIN_LOGGER_RECORD_STRING(MIN_LOGGER_INFO, "T_NAME", msg.c_str());
-        MIN_LOGGER_RECORD_U64(MIN_LOGGER_INFO, "LOOP_COUNT", i);
+        MIN_LOGGER_RECORD_VALUE_ARRAY(MIN_LOGGER_INFO, "T_NAME", char, msg.c_str(), msg.size());
+        MIN_LOGGER_RECORD_VALUE(MIN_LOGGER_INFO, "LOOP_COUNT", uint64_t, i);
         MIN_LOGGER_LOG(MIN_LOGGER_INFO, "task${T_NAME}: ${LOOP_COUNT}");
         MIN_LOGGER_EXIT(MIN_LOGGER_DEBUG, "TASK_LOOP");
-        MIN_LOGGER_LOG_ID(MIN_LOGGER_INFO, "hello world trunc, explicit ID", 0xDEADBEEF);"""
+        MIN_LOGGER_LOG_ID(0xDEADBEEF, MIN_LOGGER_INFO, "hello world trunc, explicit ID");"""
 
     TEST_FILE_NAME = "test.c"
 
@@ -33,7 +35,7 @@ def test_successful_parsing(caplog):
             assert ID_LINE2 in entries
             assert entries[ID_LINE2] == MetricEntryData(
                 id=ID_LINE2,
-                type=MetricType.ENTER,
+                profiler_type=ProfilerType.ENTER,
                 source_file=Path("test.c"),
                 source_line=2,
                 level=10,
@@ -46,7 +48,8 @@ def test_successful_parsing(caplog):
             assert ID_LINE3 in entries
             assert entries[ID_LINE3] == MetricEntryData(
                 id=ID_LINE3,
-                type=MetricType.RECORD_STRING,
+                value_type="char",
+                is_array=True,
                 source_file=Path("test.c"),
                 source_line=3,
                 level=20,
@@ -59,7 +62,7 @@ def test_successful_parsing(caplog):
             assert ID_LINE4 in entries
             assert entries[ID_LINE4] == MetricEntryData(
                 id=ID_LINE4,
-                type=MetricType.RECORD_U64,
+                value_type="uint64_t",
                 source_file=Path("test.c"),
                 source_line=4,
                 level=20,
@@ -72,7 +75,6 @@ def test_successful_parsing(caplog):
             assert ID_LINE5 in entries
             assert entries[ID_LINE5] == MetricEntryData(
                 id=ID_LINE5,
-                type=MetricType.LOG,
                 source_file=Path("test.c"),
                 source_line=5,
                 level=20,
@@ -85,7 +87,7 @@ def test_successful_parsing(caplog):
             assert ID_LINE6 in entries
             assert entries[ID_LINE6] == MetricEntryData(
                 id=ID_LINE6,
-                type=MetricType.EXIT,
+                profiler_type=ProfilerType.EXIT,
                 source_file=Path("test.c"),
                 source_line=6,
                 level=10,
@@ -98,7 +100,6 @@ def test_successful_parsing(caplog):
             assert ID_LINE7 in entries
             assert entries[ID_LINE7] == MetricEntryData(
                 id=ID_LINE7,
-                type=MetricType.LOG,
                 source_file=Path("test.c"),
                 source_line=7,
                 level=20,
@@ -112,8 +113,8 @@ def test_successful_parsing(caplog):
 def test_duplicate_name_warning(caplog):
     logging.basicConfig(level=logging.INFO)
     TEST_FILE = """
-        MIN_LOGGER_RECORD_STRING(MIN_LOGGER_INFO, "FOO", msg.c_str());
-        MIN_LOGGER_RECORD_U64(MIN_LOGGER_INFO, "FOO", i);"""
+        MIN_LOGGER_RECORD_VALUE_ARRAY(MIN_LOGGER_INFO, "FOO", char, msg.c_str(), msg.size());
+        MIN_LOGGER_RECORD_VALUE(MIN_LOGGER_INFO, "FOO", uint64_t, i);"""
 
     TEST_FILE_NAME = "test.c"
 
@@ -132,7 +133,7 @@ def test_duplicate_id():
     logging.basicConfig(level=logging.INFO)
     ID_LINE3 = crc32(b"test.c:3")
     TEST_FILE = f"""
-        MIN_LOGGER_LOG_ID(MIN_LOGGER_INFO, "hello1", {ID_LINE3});
+        MIN_LOGGER_LOG_ID({ID_LINE3}, MIN_LOGGER_INFO, "hello1");
         MIN_LOGGER_LOG(MIN_LOGGER_INFO, "hello2");"""
 
     TEST_FILE_NAME = "test.c"
@@ -167,7 +168,7 @@ def test_string_literal():
 
 def test_malformed_id():
     logging.basicConfig(level=logging.INFO)
-    TEST_FILE = 'MIN_LOGGER_LOG_ID(MIN_LOGGER_INFO, "hello1", a123);'
+    TEST_FILE = 'MIN_LOGGER_LOG_ID(a123, MIN_LOGGER_INFO, "hello1");'
 
     TEST_FILE_NAME = "test.c"
 
@@ -180,3 +181,188 @@ def test_malformed_id():
         with pytest.raises(ValueError) as excinfo:
             get_metric_entries([test_file], [test_path])
         assert "Could not parse ID" in str(excinfo.value)
+
+
+def _write_sources(test_path: Path, count: int) -> list[Path]:
+    files = []
+    for i in range(count):
+        test_file = test_path / f"test{i}.c"
+        with open(test_file, "w") as fd:
+            fd.write(f'MIN_LOGGER_LOG(MIN_LOGGER_INFO, "hello{i}");\n')
+        files.append(test_file)
+    return files
+
+
+def test_cache_only_scans_changed_files(monkeypatch):
+    with tempfile.TemporaryDirectory() as temp_dir:
+        test_path = Path(temp_dir)
+        files = _write_sources(test_path, 3)
+        cache_file = test_path / "cache.json"
+
+        first = get_metric_entries(files, [test_path], cache_file=cache_file)
+        assert cache_file.exists()
+
+        scanned = []
+        get_file_entries = builder.get_file_entries
+
+        def record_scan(content, file):
+            scanned.append(file)
+            return get_file_entries(content, file)
+
+        monkeypatch.setattr(builder, "get_file_entries", record_scan)
+
+        assert get_metric_entries(files, [test_path], cache_file=cache_file) == first
+        assert scanned == []
+
+        with open(files[1], "w") as fd:
+            fd.write('\nMIN_LOGGER_LOG(MIN_LOGGER_WARN, "changed");\n')
+        entries = get_metric_entries(files, [test_path], cache_file=cache_file)
+        assert scanned == [Path("test1.c")]
+        assert entries == get_metric_entries(files, [test_path])
+        assert entries[crc32(b"test1.c:2")].msg == "changed"
+        assert entries[crc32(b"test0.c:1")] == first[crc32(b"test0.c:1")]
+
+
+def test_cache_from_other_builder_ignored():
+    with tempfile.TemporaryDirectory() as temp_dir:
+        test_path = Path(temp_dir)
+        files = _write_sources(test_path, 1)
+        cache_file = test_path / "cache.json"
+
+        # Stale entries with the right hash, that must not be used.
+        entries = get_metric_entries(files, [test_path], cache_file=cache_file)
+        with open(cache_file) as fd:
+            cache = json.load(fd)
+        cache["builder"] = "old"
+        cache["files"]["test0.c"]["entries"][0]["msg"] = "stale"
+        with open(cache_file, "w") as fd:
+            json.dump(cache, fd)
+
+        assert get_metric_entries(files, [test_path], cache_file=cache_file) == entries
+
+        with open(cache_file, "w") as fd:
+            fd.write("{not json")
+        assert get_metric_entries(files, [test_path], cache_file=cache_file) == entries
+
+
+def test_parallel_scan(monkeypatch):
+    with tempfile.TemporaryDirectory() as temp_dir:
+        test_path = Path(temp_dir)
+        files = _write_sources(test_path, 4)
+
+        serial = get_metric_entries(files, [test_path])
+        monkeypatch.setattr(builder, "MIN_PARALLEL_FILES", 2)
+        assert get_metric_entries(files, [test_path], jobs=2) == serial
+        assert len(serial) == 4
+
+        # Duplicates are still found across files scanned by different processes.
+        with open(files[3], "w") as fd:
+            fd.write(f'MIN_LOGGER_LOG_ID({crc32(b"test0.c:1")}, MIN_LOGGER_INFO, "hello");\n')
+        with pytest.raises(ValueError) as excinfo:
+            get_metric_entries(files, [test_path], jobs=2)
+        assert "Duplicate ID" in str(excinfo.value)
+
+
+def test_sampled_macros():
+    TEST_FILE = """
+        MIN_LOGGER_LOG_EVERY_N(MIN_LOGGER_INFO, 10, "every tenth");
+        MIN_LOGGER_RECORD_VALUE_EVERY_MS_ID(0x1234, MIN_LOGGER_DEBUG, 0.5f, "POS", float, pos);
+        MIN_LOGGER_LOG_RATE_LIMITED(MIN_LOGGER_WARN, 100u, 5, "limited");
+        MIN_LOGGER_RECORD_VALUE_ON_CHANGE(MIN_LOGGER_INFO, "STATE", uint8_t, state);"""
+
+    entries = builder.get_file_entries(TEST_FILE, Path("test.c"))
+    assert entries == [
+        MetricEntryData(
+            id=crc32(b"test.c:2"),
+            source_file=Path("test.c"),
+            source_line=2,
+            level=20,
+            tags=[],
+            msg="every tenth",
+            sample_type=SampleType.EVERY_N,
+            sample_value=10,
+        ),
+        MetricEntryData(
+            id=0x1234,
+            source_file=Path("test.c"),
+            source_line=3,
+            level=10,
+            tags=[],
+            value_type="float",
+            name="POS",
+            sample_type=SampleType.EVERY_MS,
+            sample_value=0.5,
+        ),
+        MetricEntryData(
+            id=crc32(b"test.c:4"),
+            source_file=Path("test.c"),
+            source_line=4,
+            level=30,
+            tags=[],
+            msg="limited",
+            sample_type=SampleType.RATE_LIMITED,
+            sample_value=100,
+            sample_burst=5,
+        ),
+        MetricEntryData(
+            id=crc32(b"test.c:5"),
+            source_file=Path("test.c"),
+            source_line=5,
+            level=20,
+            tags=[],
+            value_type="uint8_t",
+            name="STATE",
+            sample_type=SampleType.ON_CHANGE,
+        ),
+    ]
+
+
+def test_sampled_macro_bad_args():
+    with pytest.raises(ValueError) as excinfo:
+        builder.get_file_entries('MIN_LOGGER_LOG_EVERY_N(MIN_LOGGER_INFO, 0, "a");', Path("t.c"))
+    assert "not positive number literal" in str(excinfo.value)
+
+    with pytest.raises(ValueError) as excinfo:
+        builder.get_file_entries(
+            'MIN_LOGGER_LOG_RATE_LIMITED(MIN_LOGGER_INFO, 10, burst, "a");', Path("t.c")
+        )
+    assert "not positive integer literal" in str(excinfo.value)
+
+    with pytest.raises(ValueError) as excinfo:
+        builder.get_file_entries('MIN_LOGGER_LOG_EVERY_MS(MIN_LOGGER_INFO, "a");', Path("t.c"))
+    assert "Expected 3 args" in str(excinfo.value)
+
+
+def test_stat_macros():
+    TEST_FILE = """
+        MIN_LOGGER_RECORD_STAT(MIN_LOGGER_INFO, "loop_time", uint32_t, loop_time);
+        MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID(0x1234, MIN_LOGGER_DEBUG, "rssi", int8_t, r, -90, 0);"""
+
+    entries = builder.get_file_entries(TEST_FILE, Path("test.c"))
+    # The payloads are summaries, so there's no value type.
+    assert entries == [
+        MetricEntryData(
+            id=crc32(b"test.c:2"),
+            source_file=Path("test.c"),
+            source_line=2,
+            level=20,
+            tags=[],
+            name="loop_time",
+            profiler_type=ProfilerType.STAT,
+        ),
+        MetricEntryData(
+            id=0x1234,
+            source_file=Path("test.c"),
+            source_line=3,
+            level=10,
+            tags=[],
+            name="rssi",
+            profiler_type=ProfilerType.STAT_HISTOGRAM,
+        ),
+    ]
+
+    with pytest.raises(ValueError) as excinfo:
+        builder.get_file_entries(
+            'MIN_LOGGER_RECORD_STAT_HISTOGRAM(MIN_LOGGER_INFO, "t", float, t, 5, 5);', Path("t.c")
+        )
+    assert "Histogram range" in str(excinfo.value)
@@ -0,0 +1,119 @@
+from pathlib import Path
+import struct
+
+import pytest
+
+from min_logger import columnar
+from min_logger.builder import MetricEntryData
+from min_logger.parser import MessageHandler
+
+pa = pytest.importorskip("pyarrow")
+import pyarrow.ipc  # noqa: E402
+import pyarrow.parquet  # noqa: E402
+
+VALUES_ID = 0x300
+LABEL_ID = 0x301
+POINT_ID = 0x302
+PATH_ID = 0x303
+
+
+def _entry(metric_id: int, name: str, value_type: str, is_array: bool) -> MetricEntryData:
+    return MetricEntryData(
+        id=metric_id,
+        source_file=Path("test.c"),
+        source_line=metric_id,
+        level=20,
+        tags=[],
+        value_type=value_type,
+        is_array=is_array,
+        name=name,
+    )
+
+
+META = {
+    "entries": {
+        VALUES_ID: _entry(VALUES_ID, "values", "uint16_t", True),
+        LABEL_ID: _entry(LABEL_ID, "label", "char", True),
+        POINT_ID: _entry(POINT_ID, "point", "Point", False),
+        PATH_ID: _entry(PATH_ID, "path", "Point", True),
+    },
+    "type_defs": {"Point": {"x": "int16_t", "y": "float"}},
+}
+
+
+def _points(*points: tuple[int, float]) -> bytes:
+    return b"".join(struct.pack("<hf", x, y) for x, y in points)
+
+
+def _read(path: Path):
+    if path.suffix == ".parquet":
+        return pyarrow.parquet.read_table(path)
+    with pyarrow.ipc.open_file(path) as reader:
+        return reader.read_all()
+
+
+@pytest.mark.parametrize("out_format", ["PARQUET", "ARROW"])
+def test_columnar_round_trip(out_format, monkeypatch, tmp_path):
+    # Write the samples across several batches.
+    monkeypatch.setattr(columnar.ColumnarWriter, "BATCH_ROWS", 2)
+    out_dir = tmp_path / out_format.lower()
+    if out_format == "PARQUET":
+        handler = MessageHandler(META, parquet_dir=out_dir)
+    else:
+        handler = MessageHandler(META, arrow_dir=out_dir)
+
+    msgs = [
+        (1000, VALUES_ID, 1, struct.pack("<3H", 1, 2, 65535)),
+        (2000, LABEL_ID, 1, b"idle\x00\x00"),
+        (3000, VALUES_ID, 1, struct.pack("<1H", 7)),
+        (4000, LABEL_ID, 1, b"running"),
+        (5000, POINT_ID, 1, _points((-3, 1.5))),
+        (6000, PATH_ID, 1, _points((1, 0.25), (-2, -8.0))),
+        (7000, POINT_ID, 1, _points((32767, -0.5))),
+        (8000, PATH_ID, 1, _points((5, 2.0))),
+    ]
+    for msg in msgs:
+        handler.process_raw_msg(*msg)
+    handler.finish()
+
+    ext = columnar.FORMATS[out_format]
+    expected = {
+        "values": (
+            [("timestamp", pa.float64()), ("index", pa.uint32()), ("value", pa.uint16())],
+            {
+                "timestamp": [1e-6, 1e-6, 1e-6, 3e-6],
+                "index": [0, 1, 2, 0],
+                "value": [1, 2, 65535, 7],
+            },
+        ),
+        # Char arrays are a string per sample, without the null padding.
+        "label": (
+            [("timestamp", pa.float64()), ("value", pa.string())],
+            {"timestamp": [2e-6, 4e-6], "value": ["idle", "running"]},
+        ),
+        "point": (
+            [("timestamp", pa.float64()), ("x", pa.int16()), ("y", pa.float32())],
+            {"timestamp": [5e-6, 7e-6], "x": [-3, 32767], "y": [1.5, -0.5]},
+        ),
+        "path": (
+            [
+                ("timestamp", pa.float64()),
+                ("index", pa.uint32()),
+                ("x", pa.int16()),
+                ("y", pa.float32()),
+            ],
+            {
+                "timestamp": [6e-6, 6e-6, 8e-6],
+                "index": [0, 1, 0],
+                "x": [1, -2, 5],
+                "y": [0.25, -8.0, 2.0],
+            },
+        ),
+    }
+    assert sorted(p.name for p in out_dir.iterdir()) == sorted(name + ext for name in expected)
+    for name, (fields, values) in expected.items():
+        table = _read(out_dir / (name + ext))
+        assert [(field.name, field.type) for field in table.schema] == fields
+        columns = table.to_pydict()
+        assert columns.pop("timestamp") == pytest.approx(values.pop("timestamp"))
+        assert columns == values
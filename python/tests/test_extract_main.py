@@ -0,0 +1,62 @@
+import pytest
+
+from min_logger import extract_main
+
+NUM_SHARDS = 2
+SHARD_SIZE = 16
+INDEX_SIZE = 4
+RING_BUFFER_OFFSET = 128
+RING_BUFFER_STRIDE = 32
+WRITE_SIZE_OFFSET = 8
+DATA_OFFSET = 256
+# Everything shard 0 was sent, which wrapped its buffer.
+SHARD_0_STREAM = bytes(range(100, 140))
+SHARD_1_STREAM = b"hello"
+
+
+def _make_file(magic: bytes = extract_main.MAGIC) -> bytes:
+    data = bytearray(DATA_OFFSET + NUM_SHARDS * SHARD_SIZE)
+    extract_main.HEADER.pack_into(
+        data,
+        0,
+        magic,
+        extract_main.VERSION,
+        NUM_SHARDS,
+        SHARD_SIZE,
+        INDEX_SIZE,
+        RING_BUFFER_OFFSET,
+        RING_BUFFER_STRIDE,
+        RING_BUFFER_STRIDE,
+        WRITE_SIZE_OFFSET,
+        DATA_OFFSET,
+        1234,
+        b"BINARY",
+    )
+    for i, stream in enumerate([SHARD_0_STREAM, SHARD_1_STREAM]):
+        counter = RING_BUFFER_OFFSET + i * RING_BUFFER_STRIDE + WRITE_SIZE_OFFSET
+        data[counter : counter + INDEX_SIZE] = len(stream).to_bytes(INDEX_SIZE, "little")
+        shard = DATA_OFFSET + i * SHARD_SIZE
+        for offset, value in enumerate(stream):
+            data[shard + offset % SHARD_SIZE] = value
+    return bytes(data)
+
+
+def test_extract():
+    data = _make_file()
+    assert extract_main.extract(data) == (SHARD_0_STREAM[-SHARD_SIZE:] + SHARD_1_STREAM, "BINARY")
+    # Split evenly between the shards
+    assert extract_main.extract(data, 8) == (SHARD_0_STREAM[-4:] + SHARD_1_STREAM[-4:], "BINARY")
+
+    with pytest.raises(ValueError):
+        extract_main.extract(_make_file(b"MINLOGXX"))
+    with pytest.raises(ValueError):
+        extract_main.extract(data[:-1])
+
+
+def test_command(tmp_path):
+    mmap_path = tmp_path / "log.mmap"
+    mmap_path.write_bytes(_make_file())
+    out_path = tmp_path / "log.bin"
+
+    extract_main.command(mmap_path, out_path)
+    assert out_path.read_bytes() == SHARD_0_STREAM[-SHARD_SIZE:] + SHARD_1_STREAM
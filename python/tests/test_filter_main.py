@@ -0,0 +1,84 @@
+import json
+from pathlib import Path
+
+import pytest
+
+from min_logger import filter_main
+from min_logger.builder import MetricEntryData, json_dump_helper
+
+ENTRIES = [
+    MetricEntryData(
+        id=0x00000101,
+        source_file=Path("src/net/socket.c"),
+        source_line=10,
+        level=20,
+        tags=[],
+        msg="connected",
+    ),
+    MetricEntryData(
+        id=0x00000202,
+        source_file=Path("src/app/main.c"),
+        source_line=20,
+        level=20,
+        tags=["motor"],
+        msg="started",
+    ),
+    MetricEntryData(
+        id=0x00000303,
+        source_file=Path("src/app/main.c"),
+        source_line=30,
+        level=10,
+        tags=[],
+        value_type="float",
+        name="motor_speed",
+    ),
+    # Shares a filter bit with 0x00000101 when there are 256 bits.
+    MetricEntryData(
+        id=0x00001101,
+        source_file=Path("src/app/loop.c"),
+        source_line=40,
+        level=10,
+        tags=[],
+        name="loop",
+    ),
+]
+
+
+def _write_meta(tmp_path: Path) -> Path:
+    meta_path = tmp_path / "meta.json"
+    with open(meta_path, "w") as fd:
+        json.dump(
+            {"entries": [e._asdict() for e in ENTRIES], "type_defs": {}},
+            fd,
+            default=json_dump_helper,
+        )
+    return meta_path
+
+
+def test_select_entries():
+    entries = {e.id: e for e in ENTRIES}
+    assert filter_main.select_entries(entries, [0x202], [], [], []) == {0x202}
+    assert filter_main.select_entries(entries, [], ["src/net/*"], [], []) == {0x101}
+    assert filter_main.select_entries(entries, [], [], ["motor"], []) == {0x202}
+    assert filter_main.select_entries(entries, [], [], [], ["motor_*"]) == {0x303}
+    assert filter_main.select_entries(entries, [0x101], ["*/main.c"], [], ["loop"]) == {
+        0x101,
+        0x202,
+        0x303,
+        0x1101,
+    }
+
+
+def test_command_output(tmp_path, capsys, caplog):
+    meta_path = _write_meta(tmp_path)
+
+    filter_main.command(meta_path, ids=["0x303", "999"], tags=["motor"])
+    assert capsys.readouterr().out == "const MinLoggerCRC ids[] = {0x00000202, 0x00000303};\n"
+    assert "0x000003E7 not found in meta data" in caplog.text
+
+    filter_main.command(meta_path, files=["src/net/*"], output_format="list", filter_bits=256)
+    assert capsys.readouterr().out == "0x00000101\n"
+    assert "0x00001101 at src/app/loop.c:40 shares a filter bit" in caplog.text
+
+    with pytest.raises(ValueError):
+        filter_main.command(meta_path, filter_bits=48)
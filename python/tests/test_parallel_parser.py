@@ -0,0 +1,133 @@
+import json
+from pathlib import Path
+import struct
+import tempfile
+
+import pytest
+
+from min_logger import parallel_parser, parser_main
+from min_logger.builder import (
+    CONTINUATION_MSG_ID,
+    MICRO_SYNC_MSG_ID,
+    THREAD_NAME_MSG_ID,
+    MetricEntryData,
+    json_dump_helper,
+)
+from min_logger.parser import (
+    CONTINUATION_PAYLOAD,
+    MICRO_SYNC_MAGIC,
+    MICRO_SYNC_PAYLOAD,
+    MSG_HEADER,
+    SYNC_BYTES,
+)
+
+VALUES_ID = 0x10001
+COUNT_ID = 0x10002
+LOG_ID = 0x10003
+ENTRIES = [
+    MetricEntryData(
+        id=VALUES_ID,
+        source_file=Path("test.c"),
+        source_line=1,
+        level=20,
+        tags=[],
+        value_type="uint16_t",
+        is_array=True,
+        name="values",
+    ),
+    MetricEntryData(
+        id=COUNT_ID,
+        source_file=Path("test.c"),
+        source_line=2,
+        level=20,
+        tags=[],
+        value_type="uint32_t",
+        name="count",
+    ),
+    MetricEntryData(
+        id=LOG_ID,
+        source_file=Path("test.c"),
+        source_line=3,
+        level=20,
+        tags=[],
+        msg="count ${count} values ${values}",
+    ),
+]
+NUM_UNITS = 40
+
+
+def _binary_msg(timestamp: int, metric_id: int, payload: bytes) -> bytes:
+    return SYNC_BYTES + MSG_HEADER.pack(len(payload), 1, metric_id, timestamp) + payload
+
+
+def _micro_msg(metric_id: int, payload: bytes, is_array: bool, dt_us: int = 0) -> bytes:
+    # Thread 1, with the delta in microseconds (time_scale 1)
+    header = struct.pack("<HH", metric_id & 0xFFFF, 1 | (1 << 4) | (dt_us << 6))
+    if is_array:
+        header += bytes([len(payload)])
+    return header + payload
+
+
+def _make_log(log_format: str) -> bytes:
+    """A log where each payload split into continuations is finished after the next sync marker."""
+    data = b""
+    timestamp = 0
+    for i in range(NUM_UNITS):
+        values = struct.pack("<4H", i, i + 1, i + 2, i + 3)
+        msgs = []
+        if i == 0:
+            msgs.append((THREAD_NAME_MSG_ID, b"main", True))
+        if i > 0:
+            previous = struct.pack("<4H", i - 1, i, i + 1, i + 2)
+            piece = CONTINUATION_PAYLOAD.pack(VALUES_ID, 4, 8) + previous[4:]
+            msgs.append((CONTINUATION_MSG_ID, piece, True))
+        msgs.append((LOG_ID, b"", False))
+        msgs.append((COUNT_ID, struct.pack("<I", i), False))
+        piece = CONTINUATION_PAYLOAD.pack(VALUES_ID, 0, 8) + values[:4]
+        msgs.append((CONTINUATION_MSG_ID, piece, True))
+
+        if log_format == "MICRO_BINARY":
+            # The sync markers, where the log can be split, are between the continuation pieces.
+            timestamp = i * 1000000000
+            sync = MICRO_SYNC_PAYLOAD.pack(MICRO_SYNC_MAGIC, timestamp)
+            data += _micro_msg(MICRO_SYNC_MSG_ID, sync, False)
+            for metric_id, payload, is_array in msgs:
+                data += _micro_msg(metric_id, payload, is_array, 1)
+        else:
+            for metric_id, payload, _ in msgs:
+                timestamp += 1000
+                data += _binary_msg(timestamp, metric_id, payload)
+    return data
+
+
+@pytest.mark.parametrize("log_format", ["BINARY", "MICRO_BINARY"])
+def test_parallel_matches_serial(log_format, monkeypatch, capsys, caplog):
+    monkeypatch.setattr(parallel_parser, "MIN_SEGMENT_SIZE", 64)
+    data = _make_log(log_format)
+    assert len(parallel_parser._plan_segments(data, log_format, 3)) > 3
+
+    with tempfile.TemporaryDirectory() as temp_dir:
+        test_path = Path(temp_dir)
+        meta_path = test_path / "meta.json"
+        with open(meta_path, "w") as fd:
+            json.dump(
+                {"entries": [e._asdict() for e in ENTRIES], "type_defs": {}},
+                fd,
+                default=json_dump_helper,
+            )
+        log_path = test_path / "test.log"
+        with open(log_path, "wb") as fd:
+            fd.write(data)
+
+        parser_main.command(meta_path, log_format, log_path, jobs=1)
+        serial = capsys.readouterr().out
+        parser_main.command(meta_path, log_format, log_path, jobs=3)
+        parallel = capsys.readouterr().out
+
+    assert "too small to split" not in caplog.text
+    lines = serial.splitlines()
+    assert len(lines) == NUM_UNITS
+    # The thread name and the payload joined from pieces on both sides of the split carry over.
+    last = NUM_UNITS - 2
+    assert lines[-1].endswith(f"main] count {last} values {list(range(last, last + 4))}")
+    assert parallel == serial
@@ -0,0 +1,212 @@
+import io
+import logging
+from pathlib import Path
+import struct
+import zlib
+
+from min_logger import parser
+from min_logger.builder import CONTINUATION_MSG_ID, MetricEntryData
+from min_logger.parser import (
+    BLOCK_HEADER,
+    BLOCK_SYNC_BYTES,
+    BLOCK_CRC_START,
+    CONTINUATION_PAYLOAD,
+    MSG_HEADER,
+    SYNC_BYTES,
+    ContinuationJoiner,
+    MessageHandler,
+    read_binary,
+    read_block_binary,
+)
+
+VALUE_ID = 0x100
+# In the slot after VALUE_ID's
+LOG_ID = 0x121
+
+META = {
+    "entries": {
+        VALUE_ID: MetricEntryData(
+            id=VALUE_ID,
+            source_file=Path("test.c"),
+            source_line=1,
+            level=20,
+            tags=[],
+            value_type="uint32_t",
+            name="count",
+        ),
+        LOG_ID: MetricEntryData(
+            id=LOG_ID,
+            source_file=Path("test.c"),
+            source_line=2,
+            level=20,
+            tags=[],
+            msg="count ${count}",
+        ),
+    },
+    "type_defs": {},
+}
+
+
+def _varint(value: int) -> bytes:
+    data = bytearray()
+    while value >= 0x80:
+        data.append((value & 0x7F) | 0x80)
+        value >>= 7
+    data.append(value)
+    return bytes(data)
+
+
+def _block(thread_id: int, base_timestamp: int, msgs: list[tuple[int, int, bytes]]) -> bytes:
+    """Serialize (metric ID, timestamp delta, payload) messages like BlockBuffer."""
+    slots = [0] * 32
+    body = b""
+    for metric_id, delta, payload in msgs:
+        slot = metric_id % 32
+        if slots[slot] == metric_id:
+            body += _varint(slot + 1)
+        else:
+            body += _varint(0) + struct.pack("<I", metric_id)
+            slots[slot] = metric_id
+        body += _varint(delta) + _varint(len(payload)) + payload
+    block = bytearray(BLOCK_SYNC_BYTES + BLOCK_HEADER.pack(0, len(body), thread_id, base_timestamp))
+    block += body
+    struct.pack_into("<I", block, len(BLOCK_SYNC_BYTES), zlib.crc32(block[BLOCK_CRC_START:]))
+    return bytes(block)
+
+
+def _counts_block(thread_id: int, base_timestamp: int, counts: list[int]) -> bytes:
+    msgs = []
+    for count in counts:
+        msgs.append((VALUE_ID, 1000, struct.pack("<I", count)))
+        msgs.append((LOG_ID, 0, b""))
+    return _block(thread_id, base_timestamp, msgs)
+
+
+def test_block_binary(capsys):
+    # The second pair of messages reference their IDs by slot.
+    data = _counts_block(3, 2_000_000_000, [5, 6])
+    assert data.count(struct.pack("<I", VALUE_ID)) == 1
+
+    read_block_binary(io.BytesIO(data), META)
+    assert capsys.readouterr().out.splitlines() == [
+        "2.000001 INFO  test.c:2 thread_id_3] count 5",
+        "2.000002 INFO  test.c:2 thread_id_3] count 6",
+    ]
+
+
+def test_block_binary_bad_crc(capsys, caplog):
+    bad_block = bytearray(_counts_block(1, 1_000_000_000, [2]))
+    bad_block[-5] ^= 0xFF
+    data = (
+        _counts_block(1, 0, [1])
+        + bytes(bad_block)
+        + _counts_block(1, 2_000_000_000, [3])
+        # Truncated by the end of the log
+        + _counts_block(1, 3_000_000_000, [4])[:-1]
+    )
+
+    with caplog.at_level(logging.WARNING):
+        read_block_binary(io.BytesIO(data), META)
+    assert capsys.readouterr().out.splitlines() == [
+        "0.000001 INFO  test.c:2 thread_id_1] count 1",
+        "2.000001 INFO  test.c:2 thread_id_1] count 3",
+    ]
+    assert "without a valid block" in caplog.text
+
+
+def _piece(msg_id: int, offset: int, payload: bytes, size: int) -> bytes:
+    return CONTINUATION_PAYLOAD.pack(msg_id, offset, len(payload)) + payload[offset : offset + size]
+
+
+def test_continuation_joiner(caplog):
+    payload = bytes(range(10))
+    joiner = ContinuationJoiner()
+    assert joiner.add(1, _piece(VALUE_ID, 0, payload, 4)) is None
+    # Other threads' payloads are joined separately.
+    assert joiner.add(2, _piece(LOG_ID, 0, b"abc", 3)) == (LOG_ID, b"abc")
+    assert joiner.add(1, _piece(VALUE_ID, 4, payload, 4)) is None
+    assert joiner.add(1, _piece(VALUE_ID, 8, payload, 4)) == (VALUE_ID, payload)
+
+    with caplog.at_level(logging.WARNING):
+        assert joiner.add(1, _piece(VALUE_ID, 0, payload, 4)) is None
+        assert joiner.add(1, _piece(VALUE_ID, 8, payload, 4)) is None
+    assert "Missing part of a 0x00000100 message" in caplog.text
+
+    # The next payload starts over.
+    assert joiner.add(1, _piece(VALUE_ID, 0, payload, 6)) is None
+    assert joiner.add(1, _piece(VALUE_ID, 6, payload, 4)) == (VALUE_ID, payload)
+
+
+def test_continuation_message(capsys):
+    handler = MessageHandler(META)
+    handler.process_raw_msg(1000, CONTINUATION_MSG_ID, 1, _piece(VALUE_ID, 0, b"\x07\0\0\0", 2))
+    handler.process_raw_msg(2000, CONTINUATION_MSG_ID, 1, _piece(VALUE_ID, 2, b"\x07\0\0\0", 2))
+    handler.process_raw_msg(3000, LOG_ID, 1, b"")
+    handler.finish()
+    assert capsys.readouterr().out.splitlines() == ["0.000003 INFO  test.c:2 thread_id_1] count 7"]
+
+
+def _binary_log(count: int) -> bytes:
+    data = b""
+    for i in range(count):
+        payload = struct.pack("<I", i)
+        data += SYNC_BYTES + MSG_HEADER.pack(len(payload), 1, VALUE_ID, i * 1000) + payload
+        data += SYNC_BYTES + MSG_HEADER.pack(0, 1, LOG_ID, i * 1000 + 1000)
+    return data
+
+
+def test_binary_mmap_matches_stream(monkeypatch, capsys, tmp_path):
+    # Small batches and reads, so messages are split between them.
+    monkeypatch.setattr(parser, "DECODE_BATCH_SIZE", 3)
+    monkeypatch.setattr(parser, "STREAM_CHUNK_SIZE", 7)
+    # The last message is cut off.
+    data = _binary_log(10)[:-1]
+    log_path = tmp_path / "test.log"
+    with open(log_path, "wb") as fd:
+        fd.write(data)
+
+    with open(log_path, "rb") as fd:
+        read_binary(fd, META)
+    mapped = capsys.readouterr().out
+    # BytesIO can't be memory mapped.
+    read_binary(io.BytesIO(data), META)
+    streamed = capsys.readouterr().out
+
+    assert mapped == streamed
+    assert mapped.splitlines() == [
+        f"0.{i + 1:06} INFO  test.c:2 thread_id_1] count {i}" for i in range(9)
+    ]
+
+
+def test_decode_plan_matches_type_lookup():
+    type_defs = {
+        "Point": {"x": "int16_t", "pad": "2x", "y": "float"},
+        "Shape": {"name": "6char", "corners": "2Point", "id": "ID"},
+        "ID": "uint32_t",
+    }
+    for c_type in ["uint32_t", "3uint16_t", "2I", "5char", "Point", "2Point", "Shape"]:
+        plan = parser._DecodePlan(c_type, type_defs)
+        # Small bytes, so the floats aren't NaN.
+        data = bytes(range(1, plan.size + 1))
+        expected, size = parser._c_type_to_python_data(data, c_type, type_defs)
+        assert plan.size == size
+        assert plan.decode(data) == expected
+
+
+def test_decode_plan_reused(monkeypatch, capsys):
+    compiled = []
+
+    class CountingPlan(parser._DecodePlan):
+        def __init__(self, c_type, type_defs) -> None:
+            compiled.append(c_type)
+            super().__init__(c_type, type_defs)
+
+    monkeypatch.setattr(parser, "_DecodePlan", CountingPlan)
+    handler = MessageHandler(META)
+    for i in range(5):
+        handler.process_raw_msg(i * 1000, VALUE_ID, 1, struct.pack("<I", i))
+        handler.process_raw_msg(i * 1000, LOG_ID, 1, b"")
+    handler.finish()
+
+    assert compiled == ["uint32_t"]
+    assert capsys.readouterr().out.splitlines()[-1].endswith("count 4")
@@ -0,0 +1,131 @@
+from pathlib import Path
+import struct
+
+from perfetto.protos.perfetto.trace.perfetto_trace_pb2 import Trace, TrackEvent
+
+from min_logger.builder import THREAD_NAME_MSG_ID, MetricEntryData, ProfilerType
+from min_logger.parser import SCOPE_PAYLOAD, STAT_PAYLOAD, MessageHandler
+
+ENTER_ID = 0x200
+EXIT_ID = 0x201
+SCOPE_ID = 0x202
+STAT_ID = 0x203
+LOG_ID = 0x204
+
+
+def _entry(metric_id: int, line: int, **kwargs) -> MetricEntryData:
+    return MetricEntryData(
+        id=metric_id, source_file=Path("test.c"), source_line=line, level=20, tags=[], **kwargs
+    )
+
+
+META = {
+    "entries": {
+        ENTER_ID: _entry(ENTER_ID, 1, name="loop", profiler_type=ProfilerType.ENTER),
+        EXIT_ID: _entry(EXIT_ID, 2, name="loop", profiler_type=ProfilerType.EXIT),
+        SCOPE_ID: _entry(SCOPE_ID, 3, name="work", profiler_type=ProfilerType.SCOPE),
+        STAT_ID: _entry(STAT_ID, 4, name="load", profiler_type=ProfilerType.STAT),
+        LOG_ID: _entry(LOG_ID, 5, msg="done"),
+    },
+    "type_defs": {},
+}
+
+
+def _stat(values: list[float]) -> bytes:
+    return STAT_PAYLOAD.pack(
+        len(values), min(values), max(values), sum(values), sum(v * v for v in values)
+    )
+
+
+def _write_trace(trace_path: Path):
+    handler = MessageHandler(META, perfetto_path=trace_path)
+    msgs = [
+        (1000, THREAD_NAME_MSG_ID, 1, b"main"),
+        (2000, ENTER_ID, 1, b""),
+        (3000, ENTER_ID, 2, b""),
+        # A 2us scope inside the loop
+        (6000, SCOPE_ID, 1, SCOPE_PAYLOAD.pack(2000)),
+        (7000, EXIT_ID, 1, b""),
+        (8000, STAT_ID, 1, _stat([1.0, 2.0, 6.0])),
+        (9000, THREAD_NAME_MSG_ID, 1, b"renamed"),
+        (10000, STAT_ID, 2, _stat([4.0])),
+        (11000, EXIT_ID, 2, b""),
+        (12000, LOG_ID, 2, b""),
+    ]
+    for msg in msgs:
+        handler.process_raw_msg(*msg)
+    handler.finish()
+
+
+def _close(timestamp: int, expected: int) -> bool:
+    # Timestamps pass through floating point seconds.
+    return abs(timestamp - expected) <= 1
+
+
+def test_perfetto_packets(tmp_path, capsys):
+    trace_path = tmp_path / "trace.pftrace"
+    _write_trace(trace_path)
+    trace = Trace.FromString(trace_path.read_bytes())
+
+    processes = []
+    threads: dict[int, list[tuple[int, str]]] = {}
+    counter_tracks: dict[int, str] = {}
+    event_names: dict[int, str] = {}
+    # Track UUID -> [(type, name, timestamp)]
+    slices: dict[int, list[tuple[int, str, int]]] = {}
+    counters: dict[str, list[tuple[int, float]]] = {}
+    for packet in trace.packet:
+        if packet.HasField("track_descriptor"):
+            desc = packet.track_descriptor
+            if desc.HasField("process"):
+                processes.append(desc.uuid)
+            elif desc.HasField("thread"):
+                threads.setdefault(desc.thread.tid, []).append((desc.uuid, desc.thread.thread_name))
+            else:
+                assert desc.HasField("counter")
+                assert desc.uuid not in counter_tracks
+                counter_tracks[desc.uuid] = desc.name
+            continue
+
+        for name in packet.interned_data.event_names:
+            assert name.iid not in event_names
+            event_names[name.iid] = name.name
+        event = packet.track_event
+        if event.type == TrackEvent.TYPE_COUNTER:
+            name = counter_tracks[event.track_uuid]
+            counters.setdefault(name, []).append((packet.timestamp, event.double_counter_value))
+        elif event.type in {TrackEvent.TYPE_SLICE_BEGIN, TrackEvent.TYPE_SLICE_END}:
+            slices.setdefault(event.track_uuid, []).append(
+                (event.type, event_names[event.name_iid], packet.timestamp)
+            )
+
+    assert len(processes) == 1
+    # Thread IDs are offset by one in the trace. A rename reuses the thread's track.
+    main_uuid = threads[2][0][0]
+    assert threads[2] == [(main_uuid, "main"), (main_uuid, "renamed")]
+    assert [name for _, name in threads[3]] == ["thread_2"]
+    other_uuid = threads[3][0][0]
+
+    assert sorted(counter_tracks.values()) == ["load.max", "load.mean", "load.min"]
+    for name, expected in [("mean", [3.0, 4.0]), ("min", [1.0, 4.0]), ("max", [6.0, 4.0])]:
+        samples = counters[f"load.{name}"]
+        assert [value for _, value in samples] == expected
+        assert _close(samples[0][0], 8000) and _close(samples[1][0], 10000)
+
+    begin, end = TrackEvent.TYPE_SLICE_BEGIN, TrackEvent.TYPE_SLICE_END
+    expected_slices = {
+        main_uuid: [
+            (begin, "loop", 2000),
+            (begin, "work", 4000),
+            (end, "work", 6000),
+            (end, "loop", 7000),
+        ],
+        other_uuid: [(begin, "loop", 3000), (end, "loop", 11000)],
+    }
+    assert slices.keys() == expected_slices.keys()
+    for track_uuid, expected in expected_slices.items():
+        actual = slices[track_uuid]
+        assert [event[:2] for event in actual] == [event[:2] for event in expected]
+        assert all(_close(a[2], e[2]) for a, e in zip(actual, expected))
+
+    assert capsys.readouterr().out.endswith("thread_id_2] done\n")
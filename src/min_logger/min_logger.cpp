@@ -1,192 +1,410 @@
 #include "min_logger.h"
 
 #if MIN_LOGGER_ENABLED
-    #include <algorithm>
     #include <atomic>
     #include <cmath>
+    #include <cstddef>
     #include <cstdio>
     #include <cstring>
 
-#if defined(ESP32) || defined(ESP_PLATFORM)
-    #include <esp_attr.h>
-    #define MIN_LOGGER_FUNC_ATTR IRAM_ATTR
-#else
-    #define MIN_LOGGER_FUNC_ATTR
-#endif
+    #include "min_logger_serializers.h"
+
+using namespace min_logger_serializers;
 
 static constexpr uint32_t THREAD_NAME_MSG_ID = 0XFFFFFF00;
+static constexpr uint32_t DROPPED_MSG_ID = 0XFFFFFF01;
+static constexpr uint32_t TIME_CALIBRATION_MSG_ID = 0XFFFFFF02;
+// Name of another thread, with a ThreadRegistryEntry's thread index and name as the payload.
+static constexpr uint32_t THREAD_REGISTRY_MSG_ID = 0XFFFFFF06;
 static constexpr size_t PTHREAD_NAME_LEN = 16;
 
+std::atomic<int> min_logger_serializers::runtime_level = {MIN_LOGGER_DEFAULT_LEVEL};
+std::atomic<uint64_t> min_logger_serializers::micro_last_timestamp_ns = {0};
+std::atomic<uint64_t> min_logger_serializers::micro_last_sync_ns = {0};
+thread_local uint64_t min_logger_serializers::micro_thread_timestamp_ns = 0;
+
+    #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+thread_local BlockBuffer min_logger_serializers::block_buffer;
+
+void MIN_LOGGER_FUNC_ATTR BlockBuffer::Flush() {
+    if (body_len == 0) {
+        return;
+    }
+    BlockHeader header;
+    header.body_len = body_len;
+    header.thread_id = min_logger_get_thread_idx();
+    header.base_timestamp = base_timestamp;
+    write_block_header(data, header);
+
+    size_t total_len = sizeof(header) + body_len;
+    body_len = 0;
+    MinLoggerWriteReservation reservation;
+    if (min_logger_write_reserve(total_len, &reservation)) {
+        if (reservation.part1_size + reservation.part2_size > 0) {
+            reservation_copy(reservation, 0, data, total_len);
+            min_logger_write_commit(&reservation);
+        }
+        return;
+    }
+    min_logger_write(data, total_len);
+}
+    #endif
+
+void MIN_LOGGER_FUNC_ATTR min_logger_serializers::write_escaped_micro_message(
+    const MicroEscapedHeader& header, bool add_len_prefix, const MinLoggerIoVec* parts,
+    size_t num_parts, size_t payload_len) {
+    write_message_parts<MicroEscapedHeader, MAX_MSG_SIZE>(header, add_len_prefix, parts, num_parts,
+                                                          payload_len);
+}
+
+// Call sites that have recorded a stat, pushed on first use and never removed.
+static MinLoggerStatSite* stat_sites = nullptr;
+
+void MIN_LOGGER_FUNC_ATTR min_logger_serializers::register_stat_site(MinLoggerStatSite* site) {
+    uint32_t expected = 0;
+    if (!__atomic_compare_exchange_n(&site->registered, &expected, 1, false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    site->next = __atomic_load_n(&stat_sites, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&stat_sites, &site->next, site, true, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED)) {
+    }
+}
+
+    #if MIN_LOGGER_CYCLE_COUNTER_TIME
+std::atomic<uint64_t> min_logger_serializers::last_calibration_ticks = {0};
+std::atomic<bool> min_logger_serializers::calibration_sent = {false};
+    #endif
+
 static std::atomic<int> thread_count = {0};
 
+// Incremented by min_logger_resend_thread_names() to have the ISR names sent again.
 static std::atomic<unsigned> name_broadcast_count = {0};
+// Set by the first min_logger_write_thread_names(). Threads that register after it send their
+// name with their first message.
+static std::atomic<bool> thread_names_requested = {false};
 
 thread_local int local_thread_idx = -1;
-thread_local unsigned local_name_broadcast_count = 0;
 
-void min_logger_write_thread_names() { name_broadcast_count++; }
+// A thread's name, looked up when it registers in get_thread_idx().
+struct ThreadRegistryEntry {
+    char name[PTHREAD_NAME_LEN];
+    size_t name_len;
+    // Set once name is filled in.
+    std::atomic<bool> ready;
+};
+static ThreadRegistryEntry thread_registry[MIN_LOGGER_THREAD_REGISTRY_SIZE];
+
+// Number of cores that get their own thread ID for the _ISR macros.
+static constexpr unsigned MAX_ISR_CORES = 16;
+// name_broadcast_count when each core last sent its ISR name.
+static std::atomic<unsigned> isr_name_broadcast_counts[MAX_ISR_CORES];
+
+static void MIN_LOGGER_FUNC_ATTR write_thread_name(size_t thread_idx, const char* name,
+                                                    size_t name_len) {
+    uint8_t payload[1 + PTHREAD_NAME_LEN];
+    payload[0] = static_cast<uint8_t>(thread_idx);
+    memcpy(payload + 1, name, name_len);
+    (min_logger_get_serialize_format())(THREAD_REGISTRY_MSG_ID, payload, 1 + name_len, false);
+}
 
-// Converts elapsed time in nanoseconds to (scale, value) pair
-// Scale: 0=ns, 1=us, 2=ms, 3=s
-// Value: 0-999
-static std::pair<unsigned, unsigned> MIN_LOGGER_FUNC_ATTR convertNanoseconds(uint64_t ns) {
-    unsigned scale = 0;
-    uint64_t value = ns;
+void min_logger_write_thread_names() {
+    thread_names_requested.store(true);
+    min_logger_resend_thread_names();
+}
 
-    // Scale up until value fits in 0-999 range
-    if (value >= 1000) {
-        value /= 1000;
-        scale = 1;  // microseconds
+void min_logger_resend_thread_names() {
+    if (!thread_names_requested.load()) {
+        return;
+    }
+    name_broadcast_count++;
+    size_t num_threads = thread_count.load();
+    if (num_threads > MIN_LOGGER_THREAD_REGISTRY_SIZE) {
+        num_threads = MIN_LOGGER_THREAD_REGISTRY_SIZE;
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        // Threads still filling in their entry send their own name once they're done.
+        const ThreadRegistryEntry& entry = thread_registry[i];
+        if (entry.ready.load()) {
+            write_thread_name(i, entry.name, entry.name_len);
+        }
+    }
+}
 
-        if (value >= 1000) {
-            value /= 1000;
-            scale = 2;  // milliseconds
+void min_logger_write_dropped_count(uint32_t dropped_messages, uint32_t dropped_bytes) {
+    const uint32_t payload[2] = {dropped_messages, dropped_bytes};
+    (min_logger_get_serialize_format())(DROPPED_MSG_ID, payload, sizeof(payload), true);
+}
 
-            if (value >= 1000) {
-                value /= 1000;
-                scale = 3;  // seconds
+void MIN_LOGGER_FUNC_ATTR min_logger_write_time_calibration() {
+    #if MIN_LOGGER_CYCLE_COUNTER_TIME
+    // Payload: {ticks, nanoseconds, counter bits}
+    const uint64_t ticks = read_cycle_counter();
+    const uint64_t payload[3] = {ticks, min_logger_get_time_nanoseconds(), CYCLE_COUNTER_BITS};
+    last_calibration_ticks.store(ticks, std::memory_order_relaxed);
+    calibration_sent.store(true, std::memory_order_relaxed);
+    (min_logger_get_serialize_format())(TIME_CALIBRATION_MSG_ID, payload, sizeof(payload), true);
+    #endif
+}
 
-                // Cap at 999 seconds
-                if (value > 999) {
-                    value = 999;
-                }
-            }
-        }
+// Fills in the registry entry for a thread's index. Names past the registry are left unset.
+static void MIN_LOGGER_FUNC_ATTR register_thread(size_t thread_idx) {
+    if (thread_idx >= MIN_LOGGER_THREAD_REGISTRY_SIZE) {
+        return;
     }
-
-    return {scale, static_cast<unsigned>(value)};
+    ThreadRegistryEntry& entry = thread_registry[thread_idx];
+    const size_t name_len = min_logger_get_thread_name(entry.name, PTHREAD_NAME_LEN);
+    entry.name_len = (name_len < PTHREAD_NAME_LEN) ? name_len : PTHREAD_NAME_LEN;
+    entry.ready.store(true);
 }
 
 static size_t MIN_LOGGER_FUNC_ATTR get_thread_idx() {
     if (local_thread_idx == -1) {
         local_thread_idx = thread_count++;
+        register_thread(local_thread_idx);
     }
     return local_thread_idx;
 }
 
 extern "C" {
 
+size_t MIN_LOGGER_FUNC_ATTR min_logger_get_thread_idx() { return get_thread_idx(); }
+
 void MIN_LOGGER_FUNC_ATTR send_thread_name_if_needed() {
-    // Handles overflow implicitly
-    if (local_name_broadcast_count != name_broadcast_count) {
-        local_name_broadcast_count = name_broadcast_count;
-        char name_buffer[PTHREAD_NAME_LEN] = {0};
-        size_t name_len = min_logger_get_thread_name(name_buffer, PTHREAD_NAME_LEN);
-        (min_logger_get_serialize_format())(THREAD_NAME_MSG_ID, name_buffer, name_len, false);
-    }
-}
-
-    #pragma pack(1)  // Set packing alignment to 1 byte
-struct BinaryMsgHeader {
-    static constexpr uint16_t SYNC = 0xFAAF;
-    uint16_t sync = SYNC;
-    uint8_t payload_len = 0;
-    uint8_t thread_id = 0;
-    MinLoggerCRC msg_id = 0;
-    uint64_t timestamp = 0;
-};
-    #pragma pack()  // Revert to default packing alignment
+    if (local_thread_idx != -1) {
+        return;
+    }
+    const size_t thread_idx = get_thread_idx();
+    // Checked after the registry entry is ready, so either this or a concurrent
+    // min_logger_write_thread_names() sends the name.
+    if (!thread_names_requested.load()) {
+        return;
+    }
+    if (thread_idx < MIN_LOGGER_THREAD_REGISTRY_SIZE) {
+        const ThreadRegistryEntry& entry = thread_registry[thread_idx];
+        write_thread_name(thread_idx, entry.name, entry.name_len);
+    } else {
+        char name[PTHREAD_NAME_LEN] = {0};
+        size_t name_len = min_logger_get_thread_name(name, PTHREAD_NAME_LEN);
+        name_len = (name_len < PTHREAD_NAME_LEN) ? name_len : PTHREAD_NAME_LEN;
+        write_thread_name(thread_idx, name, name_len);
+    }
+}
 
 void MIN_LOGGER_FUNC_ATTR min_logger_default_binary_serializer(MinLoggerCRC msg_id, const void* payload,
                                           size_t payload_len, bool is_fixed_size) {
-    send_thread_name_if_needed();
-
-    static constexpr size_t _MAX_MSG_SIZE = 256;
-    static constexpr size_t _MAX_PAYLOAD_SIZE = _MAX_MSG_SIZE - sizeof(BinaryMsgHeader);
-    payload_len = (payload_len > _MAX_PAYLOAD_SIZE) ? _MAX_PAYLOAD_SIZE : payload_len;
-
-    uint8_t msg_buffer[_MAX_MSG_SIZE];
-    BinaryMsgHeader* header_ptr = reinterpret_cast<BinaryMsgHeader*>(msg_buffer);
-    header_ptr->sync = BinaryMsgHeader::SYNC;
-    header_ptr->msg_id = msg_id;
-    header_ptr->payload_len = payload_len;
-    header_ptr->timestamp = min_logger_get_time_nanoseconds();
-    header_ptr->thread_id = get_thread_idx();
-    memcpy(msg_buffer + sizeof(BinaryMsgHeader), payload, payload_len);
-    min_logger_write(msg_buffer, sizeof(BinaryMsgHeader) + payload_len);
+    BINARY::Serialize(msg_id, payload, payload_len, is_fixed_size);
 }
 const MinLoggerSerializeCallBack MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT =
     min_logger_default_binary_serializer;
 
-    #pragma pack(1)  // Set packing alignment to 1 byte
-struct MicroMessageHeader {
-    uint16_t truncated_id;
-    uint8_t thread_id : 4;     // 4 bits
-    uint8_t time_scale : 2;    // 2 bits
-    uint16_t time_value : 10;  // 10 bits
+void MIN_LOGGER_FUNC_ATTR min_logger_micro_binary_serializer(MinLoggerCRC msg_id, const void* payload,
+                                        size_t payload_len, bool is_fixed_size) {
+    MICRO::Serialize(msg_id, payload, payload_len, is_fixed_size);
+}
+const MinLoggerSerializeCallBack MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT =
+    min_logger_micro_binary_serializer;
+
+void MIN_LOGGER_FUNC_ATTR min_logger_micro_thread_binary_serializer(MinLoggerCRC msg_id,
+                                                                    const void* payload,
+                                                                    size_t payload_len,
+                                                                    bool is_fixed_size) {
+    MICRO_THREAD::Serialize(msg_id, payload, payload_len, is_fixed_size);
+}
+const MinLoggerSerializeCallBack MIN_LOGGER_MICRO_THREAD_BINARY_SERIALIZED_FORMAT =
+    min_logger_micro_thread_binary_serializer;
+
+    #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+void MIN_LOGGER_FUNC_ATTR min_logger_block_binary_serializer(MinLoggerCRC msg_id,
+                                                             const void* payload,
+                                                             size_t payload_len,
+                                                             bool is_fixed_size) {
+    BLOCK::Serialize(msg_id, payload, payload_len, is_fixed_size);
+}
+const MinLoggerSerializeCallBack MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT =
+    min_logger_block_binary_serializer;
 
-    MicroMessageHeader() : truncated_id(0), thread_id(0), time_scale(0), time_value(0) {}
+void min_logger_flush_block() { block_buffer.Flush(); }
+    #endif
 
-    MicroMessageHeader(MinLoggerCRC id, uint8_t thread, uint8_t scale, uint16_t value)
-        : truncated_id(static_cast<uint16_t>(id)),
-          thread_id(thread & 0xF),
-          time_scale(scale & 0x3),
-          time_value(value & 0x3FF) {}
-};
-    #pragma pack()
+uint64_t MIN_LOGGER_FUNC_ATTR min_logger_get_timestamp() { return get_timestamp(); }
 
-void MIN_LOGGER_FUNC_ATTR min_logger_micro_binary_serializer(MinLoggerCRC msg_id, const void* payload,
-                                        size_t payload_len, bool is_fixed_size) {
-    send_thread_name_if_needed();
-    static std::atomic<uint64_t> last_timestamp_ns = {0};
-
-    uint64_t current_timestamp_ns = min_logger_get_time_nanoseconds();
-    uint64_t local_last_timestamp_ns = last_timestamp_ns.exchange(current_timestamp_ns);
-    uint64_t elapsed_ns = 0;
-    // Handle initial case, and race condition between computing current time and doing exchange.
-    // There still an issue here where the messages can end up being sent in a different order then
-    // their deltas were computed. The overall time progress will still be correct, but individual
-    // message deltas may be off. This could be fixed with a mutex, but that would add significant
-    // overhead to this low-level function and copmlicate portability. Since this should be rare in
-    // practice, we accept the potential inaccuracy for the sake of performance.
-    if (local_last_timestamp_ns != 0 && current_timestamp_ns > local_last_timestamp_ns) {
-        elapsed_ns = current_timestamp_ns - local_last_timestamp_ns;
-    }
-
-    auto delta = convertNanoseconds(elapsed_ns);
-
-    static constexpr size_t _MAX_MSG_SIZE = 256;
-    static constexpr size_t _MAX_PAYLOAD_SIZE = _MAX_MSG_SIZE - sizeof(BinaryMsgHeader);
-    payload_len = (payload_len > _MAX_PAYLOAD_SIZE) ? _MAX_PAYLOAD_SIZE : payload_len;
-    size_t total_size = payload_len + sizeof(MicroMessageHeader);
-
-    uint8_t msg_buffer[_MAX_MSG_SIZE];
-    MicroMessageHeader* header_ptr = reinterpret_cast<MicroMessageHeader*>(msg_buffer);
-    *header_ptr = MicroMessageHeader(msg_id, get_thread_idx(), delta.first, delta.second);
-
-    if (payload_len > 0) {
-        uint8_t* payload_ptr = msg_buffer + sizeof(MicroMessageHeader);
-        if (!is_fixed_size) {
-            *payload_ptr = payload_len;
-            payload_ptr++;
-            total_size++;
+uint32_t MIN_LOGGER_FUNC_ATTR min_logger_get_scope_duration(uint64_t start) {
+    return get_scope_duration(start);
+}
+
+bool MIN_LOGGER_FUNC_ATTR min_logger_sample_every_ns(uint64_t* next_ns, uint64_t period_ns) {
+    return sample_every_ns(next_ns, period_ns);
+}
+
+bool MIN_LOGGER_FUNC_ATTR min_logger_rate_limit(uint64_t* tat_ns, uint64_t interval_ns,
+                                                uint32_t burst) {
+    return rate_limit(tat_ns, interval_ns, burst);
+}
+
+void MIN_LOGGER_FUNC_ATTR min_logger_record_stat(MinLoggerStatSite* site, double value) {
+    record_stat(site, value);
+}
+
+void MIN_LOGGER_FUNC_ATTR min_logger_flush_stats() {
+    for (MinLoggerStatSite* site = __atomic_load_n(&stat_sites, __ATOMIC_ACQUIRE); site != nullptr;
+         site = site->next) {
+        StatHistogramPayload payload;
+        StatPayload& stat = payload.stat;
+        for (auto& slot : site->slots) {
+            // A slot that's being recorded to is picked up by the next flush.
+            if (__atomic_exchange_n(&slot.busy, 1, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            if (slot.count > 0) {
+                if (stat.count == 0 || slot.min < stat.min) {
+                    stat.min = slot.min;
+                }
+                if (stat.count == 0 || slot.max > stat.max) {
+                    stat.max = slot.max;
+                }
+                stat.count += slot.count;
+                stat.sum += slot.sum;
+                stat.sum_sq += slot.sum_sq;
+                for (size_t i = 0; i < MIN_LOGGER_STAT_BUCKETS; i++) {
+                    payload.buckets[i] += slot.buckets[i];
+                }
+                slot.count = 0;
+                slot.sum = 0;
+                slot.sum_sq = 0;
+                memset(slot.buckets, 0, sizeof(slot.buckets));
+            }
+            __atomic_store_n(&slot.busy, 0, __ATOMIC_RELEASE);
+        }
+        if (stat.count == 0) {
+            continue;
+        }
+        if (site->has_histogram) {
+            payload.histogram_min = site->histogram_min;
+            payload.histogram_max = site->histogram_max;
+            (min_logger_get_serialize_format())(site->id, &payload, sizeof(payload), true);
+        } else {
+            (min_logger_get_serialize_format())(site->id, &stat, sizeof(stat), true);
         }
-        memcpy(payload_ptr, payload, payload_len);
     }
+}
 
-    min_logger_write(msg_buffer, total_size);
+// Writes a message from an interrupt in the format the serialization callback is set to.
+static void MIN_LOGGER_FUNC_ATTR isr_write(uint8_t thread_id, MinLoggerCRC msg_id,
+                                           const void* payload, size_t payload_len,
+                                           bool is_fixed_size) {
+    payload_len = (payload_len > MAX_ISR_PAYLOAD_SIZE) ? MAX_ISR_PAYLOAD_SIZE : payload_len;
+    // Compares against the functions directly, since the exported pointers are constants that
+    // can be placed in flash.
+    MinLoggerSerializeCallBack format = min_logger_get_serialize_format();
+    if (format == min_logger_default_binary_serializer || format == BINARY::Serialize) {
+        ISR::WriteBinary(thread_id, msg_id, payload, payload_len);
+    } else if (format == min_logger_micro_binary_serializer || format == MICRO::Serialize ||
+               format == min_logger_micro_thread_binary_serializer ||
+               format == MICRO_THREAD::Serialize) {
+        ISR::WriteMicro(thread_id, msg_id, payload, payload_len, is_fixed_size);
+    #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+    } else if (format == min_logger_block_binary_serializer || format == BLOCK::Serialize) {
+        ISR::WriteBlock(thread_id, msg_id, payload, payload_len);
+    #endif
+    } else {
+        format(msg_id, payload, payload_len, is_fixed_size);
+    }
 }
-const MinLoggerSerializeCallBack MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT =
-    min_logger_micro_binary_serializer;
 
-MinLoggerSerializeCallBack* min_logger_serialize_format() {
+void MIN_LOGGER_FUNC_ATTR min_logger_isr_serialize(MinLoggerCRC msg_id, const void* payload,
+                                                   size_t payload_len) {
+    const unsigned core = min_logger_get_core_id() % MAX_ISR_CORES;
+    const uint8_t thread_id = MIN_LOGGER_ISR_THREAD_ID(core);
+    // Handles overflow implicitly
+    const unsigned broadcast_count = name_broadcast_count.load(std::memory_order_relaxed);
+    if (isr_name_broadcast_counts[core].exchange(broadcast_count, std::memory_order_relaxed) !=
+        broadcast_count) {
+        // "isr_core<core>", built without a string literal that could be placed in flash.
+        char name[10] = {'i', 's', 'r', '_', 'c', 'o', 'r', 'e'};
+        size_t name_len = 8;
+        if (core >= 10) {
+            name[name_len++] = char('0' + core / 10);
+        }
+        name[name_len++] = char('0' + core % 10);
+        isr_write(thread_id, THREAD_NAME_MSG_ID, name, name_len, false);
+    }
+    isr_write(thread_id, msg_id, payload, payload_len, true);
+}
+
+MinLoggerSerializeCallBack* MIN_LOGGER_FUNC_ATTR min_logger_serialize_format() {
+    #ifdef MIN_LOGGER_STATIC_FORMAT
+    // Keep messages sent through the callback consistent with the macros.
+    static MinLoggerSerializeCallBack serialize_format = MIN_LOGGER_STATIC_FORMAT::Serialize;
+    #else
     static MinLoggerSerializeCallBack serialize_format =
         MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT;
+    #endif
     return &serialize_format;
 }
 void min_logger_set_serialize_format(MinLoggerSerializeCallBack serialize_format) {
     *min_logger_serialize_format() = serialize_format;
 }
-MinLoggerSerializeCallBack min_logger_get_serialize_format() {
+MinLoggerSerializeCallBack MIN_LOGGER_FUNC_ATTR min_logger_get_serialize_format() {
     return *min_logger_serialize_format();
 }
+const char* min_logger_get_serialize_format_name() {
+    MinLoggerSerializeCallBack format = min_logger_get_serialize_format();
+    if (format == min_logger_default_binary_serializer || format == BINARY::Serialize) {
+        return "BINARY";
+    } else if (format == min_logger_micro_binary_serializer || format == MICRO::Serialize ||
+               format == min_logger_micro_thread_binary_serializer ||
+               format == MICRO_THREAD::Serialize) {
+        return "MICRO_BINARY";
+    #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+    } else if (format == min_logger_block_binary_serializer || format == BLOCK::Serialize) {
+        return "BLOCK_BINARY";
+    #endif
+    }
+    return nullptr;
+}
 
-int* min_logger_level() {
-    static int level = MIN_LOGGER_DEFAULT_LEVEL;
-    return &level;
+    #if MIN_LOGGER_FILTER_BITS > 0
+static_assert(MIN_LOGGER_FILTER_BITS >= 32 &&
+                  (MIN_LOGGER_FILTER_BITS & (MIN_LOGGER_FILTER_BITS - 1)) == 0,
+              "MIN_LOGGER_FILTER_BITS must be a power of two, at least 32");
+uint32_t min_logger_filter[MIN_LOGGER_FILTER_BITS / 32] = {0};
+    #endif
+
+void min_logger_filter_set_ids(const MinLoggerCRC* ids, size_t num_ids, bool enabled) {
+    #if MIN_LOGGER_FILTER_BITS > 0
+    for (size_t i = 0; i < num_ids; i++) {
+        uint32_t* word = &min_logger_filter[PRIVATE_MIN_LOGGER_FILTER_WORD(ids[i])];
+        uint32_t mask = uint32_t(1) << (ids[i] % 32);
+        if (enabled) {
+            __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_and(word, ~mask, __ATOMIC_RELAXED);
+        }
+    }
+    #endif
+}
+
+void min_logger_filter_clear() {
+    #if MIN_LOGGER_FILTER_BITS > 0
+    for (auto& word : min_logger_filter) {
+        __atomic_store_n(&word, 0, __ATOMIC_RELAXED);
+    }
+    #endif
 }
-void min_logger_set_level(int level) { *min_logger_level() = level; }
-int min_logger_get_level() { return *min_logger_level(); }
+
+uint32_t min_logger_keyframe_epoch = 1;
+
+void min_logger_request_keyframe() {
+    // Skip 0 when wrapping, so call sites that haven't sent yet always see a new epoch.
+    if (__atomic_add_fetch(&min_logger_keyframe_epoch, 1, __ATOMIC_RELAXED) == 0) {
+        __atomic_add_fetch(&min_logger_keyframe_epoch, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void min_logger_set_level(int level) { runtime_level.store(level, std::memory_order_relaxed); }
+int MIN_LOGGER_FUNC_ATTR min_logger_get_level() { return get_level(); }
 
 }  // extern "C"
 
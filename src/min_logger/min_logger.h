@@ -13,7 +13,7 @@
  * - Platform-agnostic with customizable serialization format
  *
  * The two built in serialization formats report timestamps and thread names.
- * See min_logger.cpp for their details.
+ * See min_logger_serializers.h for their details.
  *
  * Basic Usage (C++):
  *   MIN_LOGGER_LOG(MIN_LOGGER_INFO, "Application started");
@@ -60,6 +60,120 @@
     #define MIN_LOGGER_DEFAULT_LEVEL MIN_LOGGER_WARN
 #endif
 
+/// Set to 1 to have the built-in serializers timestamp messages with the CPU cycle counter (rdtsc
+/// on x86, cntvct_el0 on aarch64, CCOUNT on Xtensa) instead of min_logger_get_time_nanoseconds().
+/// Reading the counter is much cheaper than the system clock. Calibration messages pairing the
+/// counter with min_logger_get_time_nanoseconds() are sent with the first message and then every
+/// MIN_LOGGER_TIME_CALIBRATION_TICKS, and the parser uses them to convert the timestamps back to
+/// nanoseconds. The counter must run at a constant rate and be shared by all threads (e.g. an
+/// invariant TSC). CCOUNT is per core, so on multi-core ESP32s tasks must be pinned to one core.
+#ifndef MIN_LOGGER_CYCLE_COUNTER_TIME
+    #define MIN_LOGGER_CYCLE_COUNTER_TIME 0
+#endif
+
+/// Cycle counter ticks between calibration messages. Must be less than 2^31 for 32bit counters.
+#ifndef MIN_LOGGER_TIME_CALIBRATION_TICKS
+    #define MIN_LOGGER_TIME_CALIBRATION_TICKS (1ull << 28)
+#endif
+
+/// Nanoseconds (or cycle counter ticks) between the sync markers
+/// MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT sends. Markers have the absolute timestamp and a
+/// magic number, so the parser can find them to recover after lost data, or to split the log. 0
+/// disables them.
+#ifndef MIN_LOGGER_MICRO_SYNC_INTERVAL
+    #define MIN_LOGGER_MICRO_SYNC_INTERVAL 100000000ull
+#endif
+
+/// Set to 0 to leave out MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT. Defaults to 0 on the ESP32,
+/// where thread local storage is placed on every task's stack, so the block each thread holds would
+/// take stack from every task whether the format is used or not. Must be defined the same way for
+/// the library and the code using it.
+#ifndef MIN_LOGGER_ENABLE_BLOCK_FORMAT
+    #if defined(ESP32) || defined(ESP_PLATFORM)
+        #define MIN_LOGGER_ENABLE_BLOCK_FORMAT 0
+    #else
+        #define MIN_LOGGER_ENABLE_BLOCK_FORMAT 1
+    #endif
+#endif
+
+/// Size in bytes of the per-thread blocks sent by MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT,
+/// including the header. Must fit in the transport's buffer. With MIN_LOGGER_ENABLE_BLOCK_FORMAT,
+/// every thread has MIN_LOGGER_BLOCK_SIZE + 152 bytes of thread local storage for its block.
+#ifndef MIN_LOGGER_BLOCK_SIZE
+    #define MIN_LOGGER_BLOCK_SIZE 512
+#endif
+
+/// A thread's block is sent before adding a message this many nanoseconds (or cycle counter ticks)
+/// after the block's first message.
+#ifndef MIN_LOGGER_BLOCK_MAX_AGE
+    #define MIN_LOGGER_BLOCK_MAX_AGE 100000000ull
+#endif
+
+/// Number of bits in the runtime ID filter (0 or a power of two, at least 32). Messages with their
+/// ID added with min_logger_filter_set_ids() are sent even if the runtime level would filter them
+/// out, so one module can be made more verbose without changing the global level. 0 removes the
+/// filter. Must be defined the same way for the library and the code using it, which the CMake
+/// build does from its MIN_LOGGER_FILTER_BITS cache variable.
+#ifndef MIN_LOGGER_FILTER_BITS
+    #define MIN_LOGGER_FILTER_BITS 0
+#endif
+
+/// Number of slots each MIN_LOGGER_RECORD_STAT call site accumulates into. Threads start at the
+/// slot for their min_logger_get_thread_idx(), so up to this many threads can update a call site
+/// without contending. Must be defined the same way for the library and the code using it, which
+/// the CMake build does from its MIN_LOGGER_STAT_SLOTS cache variable.
+#ifndef MIN_LOGGER_STAT_SLOTS
+    #define MIN_LOGGER_STAT_SLOTS 4
+#endif
+
+/// Milliseconds between the min_logger_flush_stats() calls the buffered platforms make from their
+/// drain tasks. 0 leaves flushing to the application.
+#ifndef MIN_LOGGER_STAT_FLUSH_INTERVAL_MS
+    #define MIN_LOGGER_STAT_FLUSH_INTERVAL_MS 1000
+#endif
+
+/// Milliseconds between the min_logger_request_keyframe() calls the buffered platforms make from
+/// their drain tasks, so receivers that join late see every _ON_CHANGE value within this time. 0
+/// leaves keyframes to the application.
+#ifndef MIN_LOGGER_KEYFRAME_INTERVAL_MS
+    #define MIN_LOGGER_KEYFRAME_INTERVAL_MS 1000
+#endif
+
+/// Number of threads whose names are kept for min_logger_write_thread_names(). Threads past this
+/// are still logged, but only send their name with their first message.
+#ifndef MIN_LOGGER_THREAD_REGISTRY_SIZE
+    #define MIN_LOGGER_THREAD_REGISTRY_SIZE 32
+#endif
+
+/// Milliseconds between the min_logger_resend_thread_names() calls the buffered platforms make
+/// from their drain tasks, so logs that wrap and receivers that join late still get the names. 0
+/// leaves resending to the application.
+#ifndef MIN_LOGGER_THREAD_NAMES_INTERVAL_MS
+    #define MIN_LOGGER_THREAD_NAMES_INTERVAL_MS 1000
+#endif
+
+/// Payloads from the _ISR macros are truncated to this many bytes. Their messages are built on the
+/// interrupt's stack, so this bounds the stack they use.
+#ifndef MIN_LOGGER_ISR_MAX_PAYLOAD
+    #define MIN_LOGGER_ISR_MAX_PAYLOAD 32
+#endif
+
+/// Set to 1 to have the built-in serializers offer messages to min_logger_writev() before copying
+/// them into a buffer for min_logger_write(). Off by default, so transports that don't gather
+/// don't pay for building the pieces and the extra call on every message.
+#ifndef MIN_LOGGER_ENABLE_WRITEV
+    #define MIN_LOGGER_ENABLE_WRITEV 0
+#endif
+
+/// Define as BINARY, MICRO, MICRO_THREAD, or BLOCK (with MIN_LOGGER_ENABLE_BLOCK_FORMAT) to have
+/// the C++ logging macros call that built-in serializer directly, with the runtime level check
+/// inlined. This removes the function calls and indirect call min_logger_get_serialize_format()
+/// adds to every message. The serialization format callback defaults to this format, but
+/// min_logger_set_serialize_format() only affects C code.
+/// Must be defined the same way for the library and the code using it, which the CMake build does
+/// from its MIN_LOGGER_STATIC_FORMAT cache variable.
+// #define MIN_LOGGER_STATIC_FORMAT MICRO
+
 //////////////////////////////// Type Definitions ////////////////////////////////
 
 /// Type used for message IDs.
@@ -79,6 +193,74 @@ typedef uint32_t MinLoggerCRC;
 typedef void (*MinLoggerSerializeCallBack)(MinLoggerCRC msg_id, const void* payload,
                                            size_t payload_len, bool is_fixed_size);
 
+/**
+ * Space reserved by min_logger_write_reserve() for a message to be serialized into directly.
+ * If the space wraps around the end of a ring buffer, it's split between part1 and part2.
+ */
+typedef struct {
+    uint8_t* part1;     ///< Start of the reserved space
+    size_t part1_size;  ///< Bytes available at part1
+    uint8_t* part2;     ///< Continuation of the reserved space (NULL if it doesn't wrap)
+    size_t part2_size;  ///< Bytes available at part2
+    void* context;      ///< Platform specific data for min_logger_write_commit()
+    int context_id;     ///< Platform specific data for min_logger_write_commit()
+} MinLoggerWriteReservation;
+
+/// One piece of a message passed to min_logger_writev().
+typedef struct {
+    const void* data;  ///< Start of the piece
+    size_t len;        ///< Length of the piece in bytes
+} MinLoggerIoVec;
+
+/// Start of a scope timed by MIN_LOGGER_SCOPE_BEGIN_ID().
+typedef struct {
+    bool enabled;    ///< If the scope's level was enabled when it started
+    uint64_t start;  ///< min_logger_get_timestamp() when the scope started
+} MinLoggerScopeStart;
+
+/// Thread ID the built-in serializers tag messages from the _ISR macros with, for the core the
+/// interrupt ran on. The MICRO formats send it with the escaped 5 byte header, so it isn't shared
+/// with a thread.
+#define MIN_LOGGER_ISR_THREAD_ID(core) (0xFF - (core))
+
+/// Number of buckets in the histograms from MIN_LOGGER_RECORD_STAT_HISTOGRAM.
+#define MIN_LOGGER_STAT_BUCKETS 8
+
+/// Values one slot of a MIN_LOGGER_RECORD_STAT call site has accumulated since the last flush.
+typedef struct {
+    uint32_t busy;   ///< Set while a thread is updating or flushing the slot
+    uint32_t count;  ///< Number of values
+    double min;
+    double max;
+    double sum;
+    double sum_sq;                              ///< Sum of the squared values
+    uint32_t buckets[MIN_LOGGER_STAT_BUCKETS];  ///< Histogram counts, if the call site has one
+} MinLoggerStatSlot;
+
+/// State of a MIN_LOGGER_RECORD_STAT call site.
+typedef struct MinLoggerStatSite {
+    MinLoggerCRC id;       ///< ID the summaries are sent with
+    bool has_histogram;    ///< If values are counted in the buckets
+    double histogram_min;  ///< Lower edge of the first bucket
+    double histogram_max;  ///< Upper edge of the last bucket
+    uint32_t registered;   ///< Set once the call site is in the list min_logger_flush_stats() sends
+    struct MinLoggerStatSite* next;  ///< Next call site in the list
+    MinLoggerStatSlot slots[MIN_LOGGER_STAT_SLOTS];
+} MinLoggerStatSite;
+
+/// Static initializer for a MinLoggerStatSite.
+#define PRIVATE_MIN_LOGGER_STAT_SITE(id, has_histogram, histogram_min, histogram_max) \
+    {id, has_histogram, histogram_min, histogram_max, 0, NULL, {{0, 0, 0, 0, 0, 0, {0}}}}
+
+/**
+ * Tags every message in the file, so the metadata tools can select them by tag. Expands to nothing.
+ * The tags must be string literals.
+ *
+ * Example:
+ *   MIN_LOGGER_FILE_TAGS("network", "wifi");
+ */
+#define MIN_LOGGER_FILE_TAGS(...)
+
 #if MIN_LOGGER_ENABLED
 
 ////////////////////////////// Helper Macros ////////////////////////////////
@@ -122,6 +304,125 @@ extern "C" {
     /// Generates a unique string based on current file and line number
     #define MIN_LOGGER_LOC __FILE__ ":" MIN_LOGGER_S2(__LINE__)
 
+    #if defined(__cplusplus) && defined(MIN_LOGGER_STATIC_FORMAT)
+        /// Runtime level check used by the logging macros
+        #define PRIVATE_MIN_LOGGER_GET_LEVEL() min_logger_serializers::get_level()
+
+        /// Serializes a message with a payload of payload_len bytes
+        #define PRIVATE_MIN_LOGGER_SERIALIZE(id, payload, payload_len, is_fixed_size) \
+            min_logger_serializers::MIN_LOGGER_STATIC_FORMAT::Serialize(           \
+                id, payload, payload_len, is_fixed_size)
+
+        /// Serializes a message with a fixed size payload known at compile time
+        #define PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, payload, payload_len)              \
+            min_logger_serializers::MIN_LOGGER_STATIC_FORMAT::SerializeValue<payload_len>( \
+                id, payload)
+
+        /// Timestamp and duration for scope records
+        #define PRIVATE_MIN_LOGGER_GET_TIMESTAMP() min_logger_serializers::get_timestamp()
+        #define PRIVATE_MIN_LOGGER_GET_SCOPE_DURATION(start) \
+            min_logger_serializers::get_scope_duration(start)
+
+        /// Time based sampling checks
+        #define PRIVATE_MIN_LOGGER_SAMPLE_EVERY_NS(state, period_ns) \
+            min_logger_serializers::sample_every_ns(state, period_ns)
+        #define PRIVATE_MIN_LOGGER_RATE_LIMIT(state, interval_ns, burst) \
+            min_logger_serializers::rate_limit(state, interval_ns, burst)
+
+        /// Adds a value to a call site's statistics
+        #define PRIVATE_MIN_LOGGER_RECORD_STAT(site, value) \
+            min_logger_serializers::record_stat(site, value)
+    #else
+        #define PRIVATE_MIN_LOGGER_GET_LEVEL() min_logger_get_level()
+
+        #define PRIVATE_MIN_LOGGER_GET_TIMESTAMP() min_logger_get_timestamp()
+        #define PRIVATE_MIN_LOGGER_GET_SCOPE_DURATION(start) min_logger_get_scope_duration(start)
+
+        #define PRIVATE_MIN_LOGGER_SAMPLE_EVERY_NS(state, period_ns) \
+            min_logger_sample_every_ns(state, period_ns)
+        #define PRIVATE_MIN_LOGGER_RATE_LIMIT(state, interval_ns, burst) \
+            min_logger_rate_limit(state, interval_ns, burst)
+
+        #define PRIVATE_MIN_LOGGER_RECORD_STAT(site, value) min_logger_record_stat(site, value)
+
+        #define PRIVATE_MIN_LOGGER_SERIALIZE(id, payload, payload_len, is_fixed_size) \
+            (min_logger_get_serialize_format())(id, payload, payload_len, is_fixed_size)
+
+        #define PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, payload, payload_len) \
+            PRIVATE_MIN_LOGGER_SERIALIZE(id, payload, payload_len, true)
+    #endif
+
+    /// Token pasting helpers for generating unique local variable names
+    #define PRIVATE_MIN_LOGGER_CONCAT2(a, b) a##b
+    #define PRIVATE_MIN_LOGGER_CONCAT(a, b) PRIVATE_MIN_LOGGER_CONCAT2(a, b)
+
+    #if MIN_LOGGER_FILTER_BITS > 0
+        /// Index of the min_logger_filter word holding id's bit
+        #define PRIVATE_MIN_LOGGER_FILTER_WORD(id) \
+            (((uint32_t)(id) & (MIN_LOGGER_FILTER_BITS - 1)) / 32)
+
+        /// Checks if id's bit is set in the runtime ID filter
+        #define PRIVATE_MIN_LOGGER_FILTER_CHECK(id)                                   \
+            ((__atomic_load_n(&min_logger_filter[PRIVATE_MIN_LOGGER_FILTER_WORD(id)], \
+                              __ATOMIC_RELAXED) >>                                    \
+              ((uint32_t)(id) % 32)) &                                                \
+             1)
+    #else
+        #define PRIVATE_MIN_LOGGER_FILTER_CHECK(id) 0
+    #endif
+
+    /// Runtime check for whether a message should be sent. The ID filter is only checked for
+    /// messages the level filters out.
+    #define PRIVATE_MIN_LOGGER_IS_ENABLED(id, level) \
+        (MIN_LOGGER_MIN_LEVEL >= level &&            \
+         (PRIVATE_MIN_LOGGER_GET_LEVEL() >= level || PRIVATE_MIN_LOGGER_FILTER_CHECK(id)))
+
+    /// Sends a message with no payload
+    #define PRIVATE_MIN_LOGGER_SEND_LOG(id) PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, NULL, 0)
+
+    /// Sends a message with a fixed-size value
+    #define PRIVATE_MIN_LOGGER_SEND_VALUE(id, type, value) \
+        PRIVATE_MIN_LOGGER_ASSERT_TYPE(value, type);       \
+        PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, &value, sizeof(type))
+
+    /// Runs send if the level is enabled and the call site's sample check passes. The check uses
+    /// min_logger_sample_state, a static of state_type declared next to it. It's only touched by
+    /// calls the level lets through, so filtered calls don't use up samples.
+    #define PRIVATE_MIN_LOGGER_SAMPLED(id, level, state_type, sample, send) \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                     \
+            static state_type min_logger_sample_state = 0;                  \
+            if (sample) {                                                   \
+                send;                                                       \
+            }                                                               \
+        }
+
+    /// Sends value if it differs from the call site's cached copy, or min_logger_request_keyframe()
+    /// was called since the call site last sent. The cache is a static of type next to the ID, and
+    /// min_logger_last_epoch is the min_logger_keyframe_epoch it was last sent in.
+    #define PRIVATE_MIN_LOGGER_ON_CHANGE(id, level, type, value)                       \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                                \
+            static type min_logger_last_value;                                         \
+            static uint32_t min_logger_last_epoch = 0;                                 \
+            const uint32_t min_logger_epoch =                                          \
+                __atomic_load_n(&min_logger_keyframe_epoch, __ATOMIC_RELAXED);         \
+            PRIVATE_MIN_LOGGER_ASSERT_TYPE(value, type);                               \
+            if (min_logger_last_epoch != min_logger_epoch ||                           \
+                __builtin_memcmp(&min_logger_last_value, &value, sizeof(type)) != 0) { \
+                min_logger_last_epoch = min_logger_epoch;                              \
+                __builtin_memcpy(&min_logger_last_value, &value, sizeof(type));        \
+                PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, &value, sizeof(type));          \
+            }                                                                          \
+        }
+
+    /// Sample checks for PRIVATE_MIN_LOGGER_SAMPLED
+    #define PRIVATE_MIN_LOGGER_EVERY_N(n) \
+        (__atomic_fetch_add(&min_logger_sample_state, 1, __ATOMIC_RELAXED) % (n) == 0)
+    #define PRIVATE_MIN_LOGGER_EVERY_MS(ms) \
+        PRIVATE_MIN_LOGGER_SAMPLE_EVERY_NS(&min_logger_sample_state, (uint64_t)(ms) * 1000000ull)
+    #define PRIVATE_MIN_LOGGER_RATE_LIMITED(rate_hz, burst)                                  \
+        PRIVATE_MIN_LOGGER_RATE_LIMIT(&min_logger_sample_state, (uint64_t)(1e9 / (rate_hz)), \
+                                      burst)
+
 ////////////////////////////// Public API ////////////////////////////////
 
 /**
@@ -157,18 +458,123 @@ size_t min_logger_get_thread_name(char* thread_name, size_t max_len);
 void min_logger_write(const uint8_t* msg, size_t len_bytes);
 
 /**
- * Request all threads to report their names.
- * Thread-safe. Each thread will send its name the next time a log message is emitted
- * after min_logger_write_thread_names() was called.
+ * Platform-specific hook: Reserve space in the transport to serialize a message into directly.
+ * Weakly linked default implementation returns false, in which case the built-in serializers
+ * build the message on the stack and call min_logger_write(). Buffered platforms override this
+ * to hand out space in their ring buffer, avoiding a copy (ensure it is extern C).
+ *
+ * Every successful reservation must be filled quickly, then passed to min_logger_write_commit().
+ * A transport that is full can drop the message by returning true with an empty reservation.
+ * Nothing is written in that case and min_logger_write_commit() isn't called.
+ *
+ * @param len_bytes   Length of the message in bytes
+ * @param reservation Set to the reserved space on success
+ * @return true if the transport handled the reservation
+ */
+bool min_logger_write_reserve(size_t len_bytes, MinLoggerWriteReservation* reservation);
+
+/**
+ * Platform-specific hook: Complete a write started with min_logger_write_reserve().
+ *
+ * @param reservation The reservation that has been filled in
+ */
+void min_logger_write_commit(MinLoggerWriteReservation* reservation);
+
+/**
+ * Platform-specific hook: Send a serialized message that's split into pieces, like POSIX writev().
+ * Weakly linked default implementation returns false, in which case the built-in serializers copy
+ * the pieces into a buffer on the stack and call min_logger_write(). Transports that can gather
+ * the pieces themselves can override this to hand the caller's payload over without that copy.
+ * It's only called when MIN_LOGGER_ENABLE_WRITEV is 1 and min_logger_write_reserve() returns false
+ * (ensure it is extern C).
+ *
+ * @param iov       Pieces of the message, in order
+ * @param iov_count Number of pieces, at most 3 from the built-in serializers
+ * @return true if the transport handled the message
+ */
+bool min_logger_writev(const MinLoggerIoVec* iov, size_t iov_count);
+
+/**
+ * Platform-specific hook: Get the index of the CPU core the caller is running on. Must be safe to
+ * call from interrupts. Weakly linked default implementation uses xPortGetCoreID() on the ESP32
+ * and returns 0 elsewhere. It can be overriden in platform-specific code (ensure it is extern C).
+ *
+ * @return Index of the current core
+ */
+unsigned min_logger_get_core_id();
+
+/**
+ * Platform-specific hook: Send a message serialized by the _ISR macros. This is called from
+ * interrupt handlers, so it must not block. Weakly linked default implementation calls
+ * min_logger_write(), so it's only safe if min_logger_write() is (the default UART write on the
+ * ESP32 isn't). The buffered ESP32 platform overrides it to write to a buffer for each core that
+ * its output tasks merge into the main buffer (ensure it is extern C).
+ *
+ * @param msg       Pointer to msg to transmit
+ * @param len_bytes Length of msg in bytes
+ */
+void min_logger_isr_write(const uint8_t* msg, size_t len_bytes);
+
+/**
+ * Send the names of all threads that have logged, from the calling thread. Each thread's name is
+ * looked up once, when it first logs, and kept in a registry of MIN_LOGGER_THREAD_REGISTRY_SIZE
+ * threads. Threads that first log after this is called send their own name with their first
+ * message. Thread-safe.
  */
 void min_logger_write_thread_names();
 
+/**
+ * Send the registered thread names again if min_logger_write_thread_names() has been called.
+ * The buffered platforms call this every MIN_LOGGER_THREAD_NAMES_INTERVAL_MS.
+ */
+void min_logger_resend_thread_names();
+
+/**
+ * Send a calibration message pairing the current cycle counter value with
+ * min_logger_get_time_nanoseconds(). Sent automatically by the built-in serializers every
+ * MIN_LOGGER_TIME_CALIBRATION_TICKS. With a 32bit counter, the parser can only unwrap timestamps
+ * if messages are sent at least every 2^31 ticks, so systems that can be idle for longer should
+ * call this periodically. Does nothing unless MIN_LOGGER_CYCLE_COUNTER_TIME is set.
+ */
+void min_logger_write_time_calibration();
+
+/**
+ * Report the number of messages a transport dropped.
+ * Sends a reserved message that the parser uses to report where data was lost. Called
+ * periodically by the buffered platforms when they are configured to drop messages instead of
+ * overwriting old data.
+ *
+ * @param dropped_messages Total number of messages dropped so far (wraps on overflow)
+ * @param dropped_bytes    Total number of bytes dropped so far (wraps on overflow)
+ */
+void min_logger_write_dropped_count(uint32_t dropped_messages, uint32_t dropped_bytes);
+
 /// Built-in serialization function: Full binary format with timestamps and sync
 extern const MinLoggerSerializeCallBack MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT;
 
 /// Built-in serialization function: Minimal binary format for space-constrained systems
 extern const MinLoggerSerializeCallBack MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT;
 
+/// Built-in serialization function: Minimal binary format with the timestamps relative to the
+/// previous message on the same thread. Avoids contention between threads, but the log must be
+/// parsed with a reorder window to output the threads in timestamp order.
+extern const MinLoggerSerializeCallBack MIN_LOGGER_MICRO_THREAD_BINARY_SERIALIZED_FORMAT;
+
+    #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+/// Built-in serialization function: Each thread's messages are collected into blocks with an
+/// absolute timestamp and a CRC, with varint IDs and time deltas for the messages in the block.
+/// Messages are held until their block is full, too old, or min_logger_flush_block() is called.
+extern const MinLoggerSerializeCallBack MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT;
+
+/**
+ * Send the calling thread's partially filled block for MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT.
+ * Blocks are also sent when the thread exits.
+ */
+void min_logger_flush_block();
+    #else
+inline void min_logger_flush_block() {}
+    #endif
+
 /**
  * Set the serialization format callback.
  * Defaults to MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT if not called.
@@ -184,6 +590,14 @@ void min_logger_set_serialize_format(MinLoggerSerializeCallBack serialize_format
  */
 MinLoggerSerializeCallBack min_logger_get_serialize_format();
 
+/**
+ * Get the parser's --log_format name for the current serialization format callback.
+ *
+ * @return "BINARY", "MICRO_BINARY" (also used for MICRO_THREAD), "BLOCK_BINARY", or NULL for a
+ *         custom callback
+ */
+const char* min_logger_get_serialize_format_name();
+
 /**
  * Set the runtime log level filter.
  * Messages below this level will not be serialized at runtime.
@@ -200,14 +614,149 @@ void min_logger_set_level(int level);
  */
 int min_logger_get_level();
 
+/// Incremented by min_logger_request_keyframe(). Never 0, so call sites start out needing to send.
+extern uint32_t min_logger_keyframe_epoch;
+
+/**
+ * Have every MIN_LOGGER_RECORD_VALUE_ON_CHANGE call site send its value on its next call, even if
+ * it hasn't changed. Lets a receiver that missed the start of the log, like a late joining UDP
+ * receiver, get the current values. Thread-safe.
+ *
+ * The buffered platforms call this every MIN_LOGGER_KEYFRAME_INTERVAL_MS.
+ */
+void min_logger_request_keyframe();
+
+    #if MIN_LOGGER_FILTER_BITS > 0
+/// Bits of the runtime ID filter. Use min_logger_filter_set_ids() to change them.
+extern uint32_t min_logger_filter[MIN_LOGGER_FILTER_BITS / 32];
+    #endif
+
+/**
+ * Add or remove IDs from the runtime ID filter.
+ * Messages with an ID in the filter are sent even if the runtime level would filter them out.
+ * The compile-time MIN_LOGGER_MIN_LEVEL still applies. Thread-safe.
+ *
+ * The filter is a MIN_LOGGER_FILTER_BITS bitset indexed by the lower bits of the ID, so IDs can
+ * share a bit. Removing an ID also removes any IDs that share its bit. Does nothing if
+ * MIN_LOGGER_FILTER_BITS is 0.
+ *
+ * See python/src/min_logger/filter_main.py for a tool to generate the IDs for a set of files,
+ * tags, or names from the log metadata.
+ *
+ * @param ids     IDs to change
+ * @param num_ids Number of IDs in ids
+ * @param enabled true to add the IDs to the filter, false to remove them
+ */
+void min_logger_filter_set_ids(const MinLoggerCRC* ids, size_t num_ids, bool enabled);
+
+/**
+ * Remove all IDs from the runtime ID filter.
+ */
+void min_logger_filter_clear();
+
 /**
- * Send the current thread's name as a variable legnth string if thread name tracking was requested.
- * Called automatically by logging macros when needed.
+ * Register the current thread on its first message, and send its name if thread name tracking was
+ * requested. Later calls only check a thread local. Called automatically by logging macros.
  *
  * This can be used in custom serialization functions as well.
  */
 void send_thread_name_if_needed();
 
+/**
+ * Get the index the built-in serializers use to identify the calling thread.
+ * Indexes are assigned in the order threads first log, starting at 0. The first call on a thread
+ * adds its name to the registry min_logger_write_thread_names() sends.
+ *
+ * This can be used by platform implementations to select per-thread resources.
+ *
+ * @return Index of the calling thread
+ */
+size_t min_logger_get_thread_idx();
+
+/**
+ * Get the current timestamp in the units the built-in serializers use for messages. This is
+ * nanoseconds from min_logger_get_time_nanoseconds(), or cycle counter ticks with
+ * MIN_LOGGER_CYCLE_COUNTER_TIME. Used to time scopes for MIN_LOGGER_SCOPE.
+ *
+ * @return Current timestamp
+ */
+uint64_t min_logger_get_timestamp();
+
+/**
+ * Get the time since a timestamp from min_logger_get_timestamp(), for a scope record.
+ * Handles 32bit counters that wrap.
+ *
+ * @param start Timestamp the scope started at
+ * @return Elapsed time, saturated at UINT32_MAX
+ */
+uint32_t min_logger_get_scope_duration(uint64_t start);
+
+/**
+ * Sampling check for the _EVERY_MS macros. Passes at most once per period, using the time from
+ * min_logger_get_time_nanoseconds(). Thread-safe.
+ *
+ * @param next_ns   Call site's state, initially 0. The earliest time the next call can pass.
+ * @param period_ns Minimum time between calls that pass
+ * @return true if the message should be sent
+ */
+bool min_logger_sample_every_ns(uint64_t* next_ns, uint64_t period_ns);
+
+/**
+ * Rate limit check for the _RATE_LIMITED macros. Uses the generic cell rate algorithm, which acts
+ * like a token bucket refilled every interval_ns that holds burst tokens, with a single timestamp
+ * of state. Thread-safe.
+ *
+ * @param tat_ns      Call site's state, initially 0. The theoretical arrival time of the next call.
+ * @param interval_ns Time between calls that pass, once the burst is used up
+ * @param burst       Number of back to back calls that can pass. Must be at least 1.
+ * @return true if the message should be sent
+ */
+bool min_logger_rate_limit(uint64_t* tat_ns, uint64_t interval_ns, uint32_t burst);
+
+/**
+ * Add a value to a MIN_LOGGER_RECORD_STAT call site's statistics. Thread-safe and doesn't block.
+ * If every slot is busy, the value is dropped.
+ *
+ * @param site  Call site's state
+ * @param value Value to add
+ */
+void min_logger_record_stat(MinLoggerStatSite* site, double value);
+
+/**
+ * Send a summary of the values each MIN_LOGGER_RECORD_STAT call site has recorded since the last
+ * flush, and reset them. Call sites without new values are skipped. The summaries are sent with
+ * the call site's ID, and have the payload:
+ *   {uint32_t count, double min, double max, double sum, double sum_sq}
+ * followed by {double histogram_min, double histogram_max, uint32_t buckets[8]} for
+ * MIN_LOGGER_RECORD_STAT_HISTOGRAM.
+ *
+ * The buffered platforms call this every MIN_LOGGER_STAT_FLUSH_INTERVAL_MS. Otherwise call it
+ * periodically, e.g. from the task that drains the logs. Slots a thread is updating are left for
+ * the next flush, so this never waits on the threads recording values.
+ */
+void min_logger_flush_stats();
+
+/**
+ * Serialize a message from an interrupt handler, for the _ISR macros. Unlike the serialization
+ * callback, this doesn't use any per thread state or get the thread's name. The message is tagged
+ * with MIN_LOGGER_ISR_THREAD_ID(min_logger_get_core_id()), and written with
+ * min_logger_isr_write() in the format min_logger_get_serialize_format() is set to:
+ * - BINARY: A normal message.
+ * - MICRO and MICRO_THREAD: A TIME_SYNC message with the absolute timestamp, then the message.
+ *   The parser keeps the time for the ISR's thread ID separately, so the messages don't affect
+ *   the time deltas of the other threads.
+ * - BLOCK: A block with only this message.
+ * With MIN_LOGGER_CYCLE_COUNTER_TIME, the calibration messages are left to the other threads.
+ * Custom serialization callbacks are called directly, so they must be safe to call from
+ * interrupts. When min_logger_write_thread_names() was called, a name like "isr_core0" is sent
+ * before the core's next message.
+ *
+ * @param msg_id      Unique identifier for this log message
+ * @param payload     Pointer to the fixed size data to serialize (NULL if no data)
+ * @param payload_len Length of payload in bytes, truncated to MIN_LOGGER_ISR_MAX_PAYLOAD
+ */
+void min_logger_isr_serialize(MinLoggerCRC msg_id, const void* payload, size_t payload_len);
+
     /**
      * Log a message with an explicit ID.
      *
@@ -221,15 +770,16 @@ void send_thread_name_if_needed();
      *   logged values.
      *
      * Runtime behavior:
-     * - Checks MIN_LOGGER_MIN_LEVEL and min_logger_get_level()
-     * - Calls the registered serialization callback if both checks pass
+     * - Checks MIN_LOGGER_MIN_LEVEL and min_logger_get_level() or the runtime ID filter
+     * - Calls the registered serialization callback if both checks pass, or the
+     *   MIN_LOGGER_STATIC_FORMAT serializer if it's set
      *
      * Example:
      *   MIN_LOGGER_LOG_ID(0xABCD1234, MIN_LOGGER_INFO, "System initialized")
      */
-    #define MIN_LOGGER_LOG_ID(id, level, msg)                                   \
-        if (MIN_LOGGER_MIN_LEVEL >= level && min_logger_get_level() >= level) { \
-            (min_logger_get_serialize_format())(id, NULL, 0, true);             \
+    #define MIN_LOGGER_LOG_ID(id, level, msg)                \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {      \
+            PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, NULL, 0); \
         }
 
     /**
@@ -251,10 +801,10 @@ void send_thread_name_if_needed();
      *   float temp = 25.5f;
      *   MIN_LOGGER_RECORD_VALUE_ID(0xABCD1235, MIN_LOGGER_INFO, "temperature", float, temp)
      */
-    #define MIN_LOGGER_RECORD_VALUE_ID(id, level, name, type, value)             \
-        if (MIN_LOGGER_MIN_LEVEL >= level && min_logger_get_level() >= level) {  \
-            PRIVATE_MIN_LOGGER_ASSERT_TYPE(value, type);                         \
-            (min_logger_get_serialize_format())(id, &value, sizeof(type), true); \
+    #define MIN_LOGGER_RECORD_VALUE_ID(id, level, name, type, value)      \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                   \
+            PRIVATE_MIN_LOGGER_ASSERT_TYPE(value, type);                  \
+            PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, &value, sizeof(type)); \
         }
 
     /**
@@ -280,15 +830,17 @@ void send_thread_name_if_needed();
      *
      * Runtime behavior:
      * - Serializes all elements: sizeof(type) * num_values bytes
+     *   The built-in formats split arrays too long for one message into continuation records
+     *   that the parser joins back together.
      *
      * Example:
      *   int data[10] = {1, 2, 3, ...};
      *   MIN_LOGGER_RECORD_VALUE_ARRAY_ID(0xABCD1236, MIN_LOGGER_INFO, "sensor_data", int, data, 10)
      */
-    #define MIN_LOGGER_RECORD_VALUE_ARRAY_ID(id, level, name, type, values, num_values)        \
-        if (MIN_LOGGER_MIN_LEVEL >= level && min_logger_get_level() >= level) {                \
-            PRIVATE_MIN_LOGGER_ASSERT_TYPE(*values, type);                                     \
-            (min_logger_get_serialize_format())(id, values, sizeof(type) * num_values, false); \
+    #define MIN_LOGGER_RECORD_VALUE_ARRAY_ID(id, level, name, type, values, num_values) \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                                 \
+            PRIVATE_MIN_LOGGER_ASSERT_TYPE(*values, type);                              \
+            PRIVATE_MIN_LOGGER_SERIALIZE(id, values, sizeof(type) * num_values, false); \
         }
 
     /**
@@ -323,6 +875,202 @@ void send_thread_name_if_needed();
      */
     #define MIN_LOGGER_EXIT_ID(id, level, name) MIN_LOGGER_LOG_ID(id, level, name "_exit")
 
+    /// Local variable holding the start of a scope with an explicit ID
+    #define PRIVATE_MIN_LOGGER_SCOPE_START(id) PRIVATE_MIN_LOGGER_CONCAT(min_logger_scope_, id)
+
+    /**
+     * Start timing a scope with an explicit ID. Unlike MIN_LOGGER_ENTER_ID/MIN_LOGGER_EXIT_ID, only
+     * the matching MIN_LOGGER_SCOPE_END_ID sends a message. It has the scope's duration as a
+     * uint32_t payload, and the parser makes the slice from the message's timestamp and the
+     * duration. Scopes longer than 2^32 timestamp units (~4.3 seconds in nanoseconds) are
+     * reported with the maximum duration. The timestamps must come from one of the built-in
+     * serializers.
+     *
+     * Compile-time constraints:
+     * - id must be a 32-bit unsigned integer literal. It's used to name a local variable, so the
+     *   begin and end must be in the same block and use the same literal.
+     * - level must be an integer or priority constant
+     * - name must be a string literal
+     *
+     * Example:
+     *   void my_function() {
+     *       MIN_LOGGER_SCOPE_BEGIN_ID(0xABCD1239, MIN_LOGGER_DEBUG, "my_function");
+     *       // ... function body ...
+     *       MIN_LOGGER_SCOPE_END_ID(0xABCD1239, MIN_LOGGER_DEBUG, "my_function");
+     *   }
+     */
+    #define MIN_LOGGER_SCOPE_BEGIN_ID(id, level, name)                              \
+        MinLoggerScopeStart PRIVATE_MIN_LOGGER_SCOPE_START(id) = {false, 0};        \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                             \
+            PRIVATE_MIN_LOGGER_SCOPE_START(id).enabled = true;                      \
+            PRIVATE_MIN_LOGGER_SCOPE_START(id).start =                              \
+                PRIVATE_MIN_LOGGER_GET_TIMESTAMP();                                 \
+        }
+
+    /**
+     * Send the record for a scope started with MIN_LOGGER_SCOPE_BEGIN_ID. Only sent if the level
+     * was enabled when the scope started.
+     */
+    #define MIN_LOGGER_SCOPE_END_ID(id, level, name)                                              \
+        if (PRIVATE_MIN_LOGGER_SCOPE_START(id).enabled) {                                         \
+            const uint32_t min_logger_scope_duration =                                            \
+                PRIVATE_MIN_LOGGER_GET_SCOPE_DURATION(PRIVATE_MIN_LOGGER_SCOPE_START(id).start);  \
+            PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(id, &min_logger_scope_duration, sizeof(uint32_t)); \
+        }
+
+    /**
+     * Sampled versions of MIN_LOGGER_LOG_ID, MIN_LOGGER_RECORD_VALUE_ID and
+     * MIN_LOGGER_RECORD_AND_LOG_VALUE_ID, for call sites that run too often to send every time.
+     * Each call site keeps its sampling state in a static next to its ID, and it's checked after
+     * the level, so calls that are sampled out never reach the serializer.
+     *
+     * - _EVERY_N(..., n, ...) sends the 1st, (n+1)th, (2n+1)th ... call.
+     * - _EVERY_MS(..., ms, ...) sends a call if at least ms milliseconds have passed since the last
+     *   one it sent, using min_logger_get_time_nanoseconds().
+     * - _RATE_LIMITED(..., rate_hz, burst, ...) sends up to burst calls back to back, then at most
+     *   rate_hz calls per second. This is a token bucket that refills at rate_hz.
+     *
+     * Compile-time constraints:
+     * - The other arguments are the same as the unsampled macros
+     * - n, ms and burst must be positive integer literals, and rate_hz a positive number literal,
+     *   so the build tools can record the sampling in the metadata
+     *
+     * Example:
+     *   MIN_LOGGER_RECORD_VALUE_EVERY_N_ID(0xABCD123A, MIN_LOGGER_INFO, 100, "current", float,
+     *                                      current)
+     *   MIN_LOGGER_LOG_RATE_LIMITED_ID(0xABCD123B, MIN_LOGGER_WARN, 1, 5, "Checksum mismatch")
+     */
+    #define MIN_LOGGER_LOG_EVERY_N_ID(id, level, n, msg)                               \
+        PRIVATE_MIN_LOGGER_SAMPLED(id, level, uint32_t, PRIVATE_MIN_LOGGER_EVERY_N(n), \
+                                   PRIVATE_MIN_LOGGER_SEND_LOG(id))
+
+    #define MIN_LOGGER_RECORD_VALUE_EVERY_N_ID(id, level, n, name, type, value)        \
+        PRIVATE_MIN_LOGGER_SAMPLED(id, level, uint32_t, PRIVATE_MIN_LOGGER_EVERY_N(n), \
+                                   PRIVATE_MIN_LOGGER_SEND_VALUE(id, type, value))
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_N_ID(id, level, n, name, type, value, msg) \
+        MIN_LOGGER_RECORD_VALUE_EVERY_N_ID(id, level, n, name, type, value)
+
+    #define MIN_LOGGER_LOG_EVERY_MS_ID(id, level, ms, msg)                               \
+        PRIVATE_MIN_LOGGER_SAMPLED(id, level, uint64_t, PRIVATE_MIN_LOGGER_EVERY_MS(ms), \
+                                   PRIVATE_MIN_LOGGER_SEND_LOG(id))
+
+    #define MIN_LOGGER_RECORD_VALUE_EVERY_MS_ID(id, level, ms, name, type, value)        \
+        PRIVATE_MIN_LOGGER_SAMPLED(id, level, uint64_t, PRIVATE_MIN_LOGGER_EVERY_MS(ms), \
+                                   PRIVATE_MIN_LOGGER_SEND_VALUE(id, type, value))
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_MS_ID(id, level, ms, name, type, value, msg) \
+        MIN_LOGGER_RECORD_VALUE_EVERY_MS_ID(id, level, ms, name, type, value)
+
+    #define MIN_LOGGER_LOG_RATE_LIMITED_ID(id, level, rate_hz, burst, msg)          \
+        PRIVATE_MIN_LOGGER_SAMPLED(id, level, uint64_t,                             \
+                                   PRIVATE_MIN_LOGGER_RATE_LIMITED(rate_hz, burst), \
+                                   PRIVATE_MIN_LOGGER_SEND_LOG(id))
+
+    #define MIN_LOGGER_RECORD_VALUE_RATE_LIMITED_ID(id, level, rate_hz, burst, name, type, value) \
+        PRIVATE_MIN_LOGGER_SAMPLED(id, level, uint64_t,                                           \
+                                   PRIVATE_MIN_LOGGER_RATE_LIMITED(rate_hz, burst),               \
+                                   PRIVATE_MIN_LOGGER_SEND_VALUE(id, type, value))
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_RATE_LIMITED_ID(id, level, rate_hz, burst, name, type, \
+                                                            value, msg)                            \
+        MIN_LOGGER_RECORD_VALUE_RATE_LIMITED_ID(id, level, rate_hz, burst, name, type, value)
+
+    /**
+     * Versions of MIN_LOGGER_RECORD_VALUE_ID and MIN_LOGGER_RECORD_AND_LOG_VALUE_ID that only send
+     * the value when it differs from the last one the call site sent, for values like modes and
+     * status words that rarely change. The parser keeps the last value for ${VALUE_NAME}, so
+     * messages still see the current value. min_logger_request_keyframe() makes every call site
+     * send its next value regardless, so receivers that missed a change can catch up.
+     *
+     * Compile-time constraints:
+     * - The arguments are the same as MIN_LOGGER_RECORD_VALUE_ID
+     * - type can't be an array type, and is compared with memcmp, so padding bytes that differ
+     *   can cause extra sends
+     * - The call site's cache isn't synchronized, so use each call site from one thread
+     *
+     * Example:
+     *   MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(0xABCD123F, MIN_LOGGER_INFO, "mode", uint8_t, mode)
+     */
+    #define MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(id, level, name, type, value) \
+        PRIVATE_MIN_LOGGER_ON_CHANGE(id, level, type, value)
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ON_CHANGE_ID(id, level, name, type, value, msg) \
+        MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(id, level, name, type, value)
+
+    /**
+     * Accumulate statistics of a value with an explicit ID, instead of sending it. The count, min,
+     * max, sum and sum of squares are kept per call site, and min_logger_flush_stats() sends a
+     * single summary of them per interval. The parser outputs the count, min, max, mean and
+     * standard deviation.
+     *
+     * Compile-time constraints:
+     * - id must be a 32-bit unsigned integer literal
+     * - level must be an integer or priority constant
+     * - name should contain only variable-name-valid characters
+     * - type must be an arithmetic type matching the type of value. Values are accumulated as
+     *   doubles, which are emulated in software on MCUs without a double precision FPU.
+     *
+     * Example:
+     *   MIN_LOGGER_RECORD_STAT_ID(0xABCD123E, MIN_LOGGER_INFO, "loop_time", uint32_t, loop_time)
+     */
+    #define MIN_LOGGER_RECORD_STAT_ID(id, level, name, type, value)                 \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                             \
+            static MinLoggerStatSite min_logger_stat_site =                         \
+                PRIVATE_MIN_LOGGER_STAT_SITE(id, false, 0, 0);                      \
+            PRIVATE_MIN_LOGGER_ASSERT_TYPE(value, type);                            \
+            PRIVATE_MIN_LOGGER_RECORD_STAT(&min_logger_stat_site, (double)(value)); \
+        }
+
+    /**
+     * MIN_LOGGER_RECORD_STAT_ID that also counts the values in MIN_LOGGER_STAT_BUCKETS equal width
+     * buckets between histogram_min and histogram_max. Values outside the range are counted in the
+     * first or last bucket. histogram_min and histogram_max must be number literals.
+     */
+    #define MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID(id, level, name, type, value, histogram_min, \
+                                                histogram_max)                               \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                                      \
+            static MinLoggerStatSite min_logger_stat_site =                                  \
+                PRIVATE_MIN_LOGGER_STAT_SITE(id, true, histogram_min, histogram_max);        \
+            PRIVATE_MIN_LOGGER_ASSERT_TYPE(value, type);                                     \
+            PRIVATE_MIN_LOGGER_RECORD_STAT(&min_logger_stat_site, (double)(value));          \
+        }
+
+    /**
+     * Versions of MIN_LOGGER_LOG_ID, MIN_LOGGER_RECORD_VALUE_ID and
+     * MIN_LOGGER_RECORD_AND_LOG_VALUE_ID that are safe to call from interrupt handlers. The
+     * serializers' thread index and name lookups use thread local state and the scheduler, so
+     * these send the message with min_logger_isr_serialize() instead, which tags it with the core
+     * the interrupt ran on. With the buffered ESP32 platform, the messages go to a separate buffer
+     * for each core, which the output tasks merge into the main buffer.
+     *
+     * Compile-time constraints:
+     * - The arguments are the same as the macros they're based on
+     * - Values larger than MIN_LOGGER_ISR_MAX_PAYLOAD bytes are truncated
+     *
+     * Messages from interrupts can reach the transport after later messages from tasks, so parse
+     * the log with --reorder_window to output them in timestamp order.
+     *
+     * Example:
+     *   void IRAM_ATTR gpio_isr(void* arg) {
+     *       MIN_LOGGER_RECORD_VALUE_ISR_ID(0xABCD1240, MIN_LOGGER_INFO, "gpio_level", int32_t,
+     *                                      level)
+     *   }
+     */
+    #define MIN_LOGGER_LOG_ISR_ID(id, level, msg)       \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) { \
+            min_logger_isr_serialize(id, NULL, 0);      \
+        }
+
+    #define MIN_LOGGER_RECORD_VALUE_ISR_ID(id, level, name, type, value) \
+        if (PRIVATE_MIN_LOGGER_IS_ENABLED(id, level)) {                  \
+            PRIVATE_MIN_LOGGER_ASSERT_TYPE(value, type);                 \
+            min_logger_isr_serialize(id, &value, sizeof(type));          \
+        }
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ISR_ID(id, level, name, type, value, msg) \
+        MIN_LOGGER_RECORD_VALUE_ISR_ID(id, level, name, type, value)
+
     // C++ convenience macros that auto-generate the log ID based on source location
     #ifdef __cplusplus
         /**
@@ -338,7 +1086,7 @@ void send_thread_name_if_needed();
          *   previously logged values.
          *
          * Runtime behavior:
-         * - Checks MIN_LOGGER_MIN_LEVEL and min_logger_get_level()
+         * - Checks MIN_LOGGER_MIN_LEVEL and min_logger_get_level() or the runtime ID filter
          * - Calls the registered serialization callback if both checks pass
          *
          * @param level One of MIN_LOGGER_DEBUG, MIN_LOGGER_INFO, MIN_LOGGER_WARN, MIN_LOGGER_ERROR,
@@ -410,6 +1158,8 @@ void send_thread_name_if_needed();
          *
          * Runtime behavior:
          * - Serializes all elements: sizeof(type) * num_values bytes
+         *   The built-in formats split arrays too long for one message into continuation records
+         *   that the parser joins back together.
          *
          * @param level      The log level
          * @param name       Descriptive name for the array (used in external mapping)
@@ -481,6 +1231,170 @@ void send_thread_name_if_needed();
          */
         #define MIN_LOGGER_EXIT(level, name) MIN_LOGGER_LOG(level, name "_exit")
 
+        /**
+         * Time the rest of the enclosing scope with an explicit ID (C++ only). A single message
+         * with the duration is sent when the scope exits. See MIN_LOGGER_SCOPE.
+         */
+        #define MIN_LOGGER_SCOPE_ID(id, level, name) \
+            MinLoggerScope<id, level> PRIVATE_MIN_LOGGER_CONCAT(min_logger_scope_, __LINE__)
+
+        /**
+         * Time the rest of the enclosing scope (C++ only, auto-generates ID).
+         *
+         * Used for profiling like MIN_LOGGER_ENTER/MIN_LOGGER_EXIT, but the start time is kept in a
+         * local and a single message is sent when the scope exits, with the duration as a uint32_t
+         * payload. The parser makes a Perfetto slice from the message's timestamp and the
+         * duration. This halves the messages and bandwidth compared to entering and exiting.
+         *
+         * Scopes longer than 2^32 timestamp units (~4.3 seconds in nanoseconds) are reported with
+         * the maximum duration, so use MIN_LOGGER_ENTER/MIN_LOGGER_EXIT for those. The timestamps
+         * must come from one of the built-in serializers.
+         *
+         * Compile-time constraints:
+         * - level must be an integer or priority constant
+         * - name must be a string literal
+         * - Only one per line, since the local is named with __LINE__
+         *
+         * @param level The log level, checked when the scope starts
+         * @param name  Name of the function or code section being timed
+         *
+         * Example:
+         *   void process_data() {
+         *       MIN_LOGGER_SCOPE(MIN_LOGGER_DEBUG, "process_data");
+         *       // ... function body ...
+         *   }
+         */
+        #define MIN_LOGGER_SCOPE(level, name) \
+            MIN_LOGGER_SCOPE_ID(min_logger_crc::MIN_LOGGER_CPP_CRC32(MIN_LOGGER_LOC), level, name)
+
+        /**
+         * Sampled versions of MIN_LOGGER_LOG, MIN_LOGGER_RECORD_VALUE and
+         * MIN_LOGGER_RECORD_AND_LOG_VALUE (C++ only, auto-generates ID). See
+         * MIN_LOGGER_LOG_EVERY_N_ID for how the sampling works.
+         *
+         * Example:
+         *   // Sends every 100th reading from a 10kHz loop.
+         *   MIN_LOGGER_RECORD_VALUE_EVERY_N(MIN_LOGGER_INFO, 100, "current", float, current)
+         *   // Sends at most 1 message a second after a burst of 5.
+         *   MIN_LOGGER_LOG_RATE_LIMITED(MIN_LOGGER_WARN, 1, 5, "Checksum mismatch")
+         */
+        #define MIN_LOGGER_LOG_EVERY_N(level, n, msg)                 \
+            {                                                         \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);    \
+                MIN_LOGGER_LOG_EVERY_N_ID(min_log_id, level, n, msg); \
+            }
+
+        #define MIN_LOGGER_RECORD_VALUE_EVERY_N(level, n, name, type, value)                 \
+            {                                                                                \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);                           \
+                MIN_LOGGER_RECORD_VALUE_EVERY_N_ID(min_log_id, level, n, name, type, value); \
+            }
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_N(level, n, name, type, value, msg) \
+            MIN_LOGGER_RECORD_VALUE_EVERY_N(level, n, name, type, value)
+
+        #define MIN_LOGGER_LOG_EVERY_MS(level, ms, msg)                 \
+            {                                                           \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);      \
+                MIN_LOGGER_LOG_EVERY_MS_ID(min_log_id, level, ms, msg); \
+            }
+
+        #define MIN_LOGGER_RECORD_VALUE_EVERY_MS(level, ms, name, type, value)                 \
+            {                                                                                  \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);                             \
+                MIN_LOGGER_RECORD_VALUE_EVERY_MS_ID(min_log_id, level, ms, name, type, value); \
+            }
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_MS(level, ms, name, type, value, msg) \
+            MIN_LOGGER_RECORD_VALUE_EVERY_MS(level, ms, name, type, value)
+
+        #define MIN_LOGGER_LOG_RATE_LIMITED(level, rate_hz, burst, msg)                 \
+            {                                                                           \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);                      \
+                MIN_LOGGER_LOG_RATE_LIMITED_ID(min_log_id, level, rate_hz, burst, msg); \
+            }
+
+        #define MIN_LOGGER_RECORD_VALUE_RATE_LIMITED(level, rate_hz, burst, name, type, value)   \
+            {                                                                                    \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);                               \
+                MIN_LOGGER_RECORD_VALUE_RATE_LIMITED_ID(min_log_id, level, rate_hz, burst, name, \
+                                                        type, value);                            \
+            }
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_RATE_LIMITED(level, rate_hz, burst, name, type, \
+                                                             value, msg)                        \
+            MIN_LOGGER_RECORD_VALUE_RATE_LIMITED(level, rate_hz, burst, name, type, value)
+
+        /**
+         * Versions of MIN_LOGGER_RECORD_VALUE and MIN_LOGGER_RECORD_AND_LOG_VALUE that only send
+         * the value when it changes (C++ only, auto-generates ID). See
+         * MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID.
+         *
+         * Example:
+         *   // Recorded every loop, but only sent when the mode changes.
+         *   MIN_LOGGER_RECORD_AND_LOG_VALUE_ON_CHANGE(MIN_LOGGER_INFO, "mode", uint8_t, mode,
+         *                                             "Mode: ${mode}")
+         */
+        #define MIN_LOGGER_RECORD_VALUE_ON_CHANGE(level, name, type, value)                 \
+            {                                                                               \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);                          \
+                MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(min_log_id, level, name, type, value); \
+            }
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ON_CHANGE(level, name, type, value, msg) \
+            MIN_LOGGER_RECORD_VALUE_ON_CHANGE(level, name, type, value)
+
+        /**
+         * Accumulate statistics of a value instead of sending it (C++ only, auto-generates ID).
+         * See MIN_LOGGER_RECORD_STAT_ID.
+         *
+         * Example:
+         *   // One summary of the loop times per flush, instead of a message per loop.
+         *   MIN_LOGGER_RECORD_STAT(MIN_LOGGER_INFO, "loop_time", uint32_t, loop_time)
+         */
+        #define MIN_LOGGER_RECORD_STAT(level, name, type, value)                 \
+            {                                                                    \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);               \
+                MIN_LOGGER_RECORD_STAT_ID(min_log_id, level, name, type, value); \
+            }
+
+        /**
+         * MIN_LOGGER_RECORD_STAT with a histogram (C++ only, auto-generates ID). See
+         * MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID.
+         */
+        #define MIN_LOGGER_RECORD_STAT_HISTOGRAM(level, name, type, value, histogram_min, \
+                                                 histogram_max)                           \
+            {                                                                             \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);                        \
+                MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID(min_log_id, level, name, type, value, \
+                                                    histogram_min, histogram_max);        \
+            }
+
+        /**
+         * Versions of MIN_LOGGER_LOG, MIN_LOGGER_RECORD_VALUE and MIN_LOGGER_RECORD_AND_LOG_VALUE
+         * that are safe to call from interrupt handlers (C++ only, auto-generates ID). See
+         * MIN_LOGGER_LOG_ISR_ID.
+         *
+         * Example:
+         *   void IRAM_ATTR timer_isr(void* arg) {
+         *       MIN_LOGGER_LOG_ISR(MIN_LOGGER_DEBUG, "Timer fired");
+         *   }
+         */
+        #define MIN_LOGGER_LOG_ISR(level, msg)                     \
+            {                                                      \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC); \
+                MIN_LOGGER_LOG_ISR_ID(min_log_id, level, msg);     \
+            }
+
+        #define MIN_LOGGER_RECORD_VALUE_ISR(level, name, type, value)                 \
+            {                                                                         \
+                PRIVATE_MIN_LOGGER_LOG_MSG_GEN_ID(MIN_LOGGER_LOC);                    \
+                MIN_LOGGER_RECORD_VALUE_ISR_ID(min_log_id, level, name, type, value); \
+            }
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ISR(level, name, type, value, msg) \
+            MIN_LOGGER_RECORD_VALUE_ISR(level, name, type, value)
+
 }  // extern "C"
     #endif
 
@@ -491,16 +1405,34 @@ extern "C" {
     #endif
 
 inline void min_logger_write_thread_names() {}
+inline void min_logger_resend_thread_names() {}
+inline void min_logger_write_dropped_count(uint32_t dropped_messages, uint32_t dropped_bytes) {}
+inline void min_logger_write_time_calibration() {}
+inline void min_logger_flush_block() {}
+inline void min_logger_filter_set_ids(const MinLoggerCRC* ids, size_t num_ids, bool enabled) {}
+inline void min_logger_filter_clear() {}
 
 void min_logger_set_serialize_format(MinLoggerSerializeCallBack serialize_format) {}
 MinLoggerSerializeCallBack min_logger_get_serialize_format() { return nullptr; }
+inline const char* min_logger_get_serialize_format_name() { return nullptr; }
 void min_logger_set_level(int level) {}
 int min_logger_get_level() { return MIN_LOGGER_DEFAULT_LEVEL; }
 
 inline void send_thread_name_if_needed() {}
 
+inline size_t min_logger_get_thread_idx() { return 0; }
+
+inline uint64_t min_logger_get_timestamp() { return 0; }
+inline uint32_t min_logger_get_scope_duration(uint64_t start) { return 0; }
+inline void min_logger_flush_stats() {}
+inline void min_logger_request_keyframe() {}
+inline void min_logger_isr_serialize(MinLoggerCRC msg_id, const void* payload,
+                                     size_t payload_len) {}
+
     #define MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT nullptr
     #define MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT nullptr
+    #define MIN_LOGGER_MICRO_THREAD_BINARY_SERIALIZED_FORMAT nullptr
+    #define MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT nullptr
 
     #define MIN_LOGGER_LOG_ID(id, level, msg) \
         do {                                  \
@@ -531,6 +1463,80 @@ inline void send_thread_name_if_needed() {}
         do {                                \
         } while (0)
 
+    #define MIN_LOGGER_SCOPE_BEGIN_ID(id, level, name) \
+        do {                                           \
+        } while (0)
+
+    #define MIN_LOGGER_SCOPE_END_ID(id, level, name) \
+        do {                                         \
+        } while (0)
+
+    #define MIN_LOGGER_LOG_EVERY_N_ID(id, level, n, msg) \
+        do {                                             \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_VALUE_EVERY_N_ID(id, level, n, name, type, value) \
+        do {                                                                    \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_N_ID(id, level, n, name, type, value, msg) \
+        do {                                                                                 \
+        } while (0)
+
+    #define MIN_LOGGER_LOG_EVERY_MS_ID(id, level, ms, msg) \
+        do {                                               \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_VALUE_EVERY_MS_ID(id, level, ms, name, type, value) \
+        do {                                                                      \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_MS_ID(id, level, ms, name, type, value, msg) \
+        do {                                                                                   \
+        } while (0)
+
+    #define MIN_LOGGER_LOG_RATE_LIMITED_ID(id, level, rate_hz, burst, msg) \
+        do {                                                               \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_VALUE_RATE_LIMITED_ID(id, level, rate_hz, burst, name, type, value) \
+        do {                                                                                      \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_RATE_LIMITED_ID(id, level, rate_hz, burst, name, type, \
+                                                            value, msg)                            \
+        do {                                                                                       \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(id, level, name, type, value) \
+        do {                                                                   \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ON_CHANGE_ID(id, level, name, type, value, msg) \
+        do {                                                                                \
+        } while (0)
+
+    #define MIN_LOGGER_LOG_ISR_ID(id, level, msg) \
+        do {                                      \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_VALUE_ISR_ID(id, level, name, type, value) \
+        do {                                                             \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ISR_ID(id, level, name, type, value, msg) \
+        do {                                                                          \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_STAT_ID(id, level, name, type, value) \
+        do {                                                        \
+        } while (0)
+
+    #define MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID(id, level, name, type, value, histogram_min, \
+                                                histogram_max)                               \
+        do {                                                                                 \
+        } while (0)
+
     #ifdef __cplusplus
         #define MIN_LOGGER_LOG(level, msg) \
             do {                           \
@@ -559,11 +1565,121 @@ inline void send_thread_name_if_needed() {}
         #define MIN_LOGGER_EXIT(level, name) \
             do {                             \
             } while (0)
+
+        #define MIN_LOGGER_SCOPE_ID(id, level, name) \
+            do {                                     \
+            } while (0)
+
+        #define MIN_LOGGER_SCOPE(level, name) \
+            do {                              \
+            } while (0)
+
+        #define MIN_LOGGER_LOG_EVERY_N(level, n, msg) \
+            do {                                      \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_VALUE_EVERY_N(level, n, name, type, value) \
+            do {                                                             \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_N(level, n, name, type, value, msg) \
+            do {                                                                          \
+            } while (0)
+
+        #define MIN_LOGGER_LOG_EVERY_MS(level, ms, msg) \
+            do {                                        \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_VALUE_EVERY_MS(level, ms, name, type, value) \
+            do {                                                               \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_EVERY_MS(level, ms, name, type, value, msg) \
+            do {                                                                            \
+            } while (0)
+
+        #define MIN_LOGGER_LOG_RATE_LIMITED(level, rate_hz, burst, msg) \
+            do {                                                        \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_VALUE_RATE_LIMITED(level, rate_hz, burst, name, type, value) \
+            do {                                                                               \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_RATE_LIMITED(level, rate_hz, burst, name, type, \
+                                                             value, msg)                        \
+            do {                                                                                \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_VALUE_ON_CHANGE(level, name, type, value) \
+            do {                                                            \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ON_CHANGE(level, name, type, value, msg) \
+            do {                                                                         \
+            } while (0)
+
+        #define MIN_LOGGER_LOG_ISR(level, msg) \
+            do {                               \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_VALUE_ISR(level, name, type, value) \
+            do {                                                      \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_AND_LOG_VALUE_ISR(level, name, type, value, msg) \
+            do {                                                                   \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_STAT(level, name, type, value) \
+            do {                                                 \
+            } while (0)
+
+        #define MIN_LOGGER_RECORD_STAT_HISTOGRAM(level, name, type, value, histogram_min, \
+                                                 histogram_max)                           \
+            do {                                                                          \
+            } while (0)
 }
     #endif
 #endif
 
+// Inline serializers for MIN_LOGGER_STATIC_FORMAT
+#if MIN_LOGGER_ENABLED && defined(__cplusplus) && defined(MIN_LOGGER_STATIC_FORMAT)
+    #include "min_logger_serializers.h"
+#endif
+
+#if MIN_LOGGER_ENABLED && defined(__cplusplus)
+/**
+ * Times its lifetime for MIN_LOGGER_SCOPE. The level is checked on construction, and the record is
+ * sent on destruction.
+ */
+template <MinLoggerCRC ID, int LEVEL>
+class MinLoggerScope {
+   public:
+    MinLoggerScope()
+        : enabled_(PRIVATE_MIN_LOGGER_IS_ENABLED(ID, LEVEL)),
+          start_(enabled_ ? PRIVATE_MIN_LOGGER_GET_TIMESTAMP() : 0) {}
+
+    ~MinLoggerScope() {
+        if (enabled_) {
+            const uint32_t duration = PRIVATE_MIN_LOGGER_GET_SCOPE_DURATION(start_);
+            PRIVATE_MIN_LOGGER_SERIALIZE_FIXED(ID, &duration, sizeof(uint32_t));
+        }
+    }
+
+    MinLoggerScope(const MinLoggerScope&) = delete;
+    MinLoggerScope& operator=(const MinLoggerScope&) = delete;
+
+   private:
+    const bool enabled_;
+    const uint64_t start_;
+};
+#endif
+
 // Special platform implementations
 #ifdef MIN_LOGGER_BUFFERED_ESP32_PLATFORM
     #include "min_logger_buffered_esp32.h"
 #endif
+#ifdef MIN_LOGGER_BUFFERED_POSIX_PLATFORM
+    #include "min_logger_buffered_posix.h"
+#endif
@@ -7,6 +7,11 @@
  *
  * This overrides the:
  * void __attribute__((weak)) IRAM_ATTR min_logger_write(const uint8_t* msg, size_t len_bytes)
+ * bool __attribute__((weak)) IRAM_ATTR min_logger_write_reserve(
+ *     size_t len_bytes, MinLoggerWriteReservation* reservation)
+ * void __attribute__((weak)) IRAM_ATTR min_logger_write_commit(
+ *     MinLoggerWriteReservation* reservation)
+ * void __attribute__((weak)) IRAM_ATTR min_logger_isr_write(const uint8_t* msg, size_t len_bytes)
  * 
  * MIN_LOGGER_BUFFERED_ESP32_PLATFORM must be defined to use this over minimal implemetation in
  * src/min_logger/platform_implementations/defaults.cpp
@@ -20,6 +25,20 @@
 extern "C" {
 #endif
 
+// Outputs that can read the buffer at the same time. Each has its own reader and drop count.
+typedef enum {
+    MIN_LOGGER_SINK_UART,
+    MIN_LOGGER_SINK_UDP,
+    MIN_LOGGER_SINK_CALLBACK,
+    MIN_LOGGER_NUM_SINKS
+} MinLoggerSink;
+
+// Called by the callback sink with the data to send.
+// \param data Logged data. It's split into two calls when it wraps around the end of the buffer.
+// \param len_bytes Length of data
+// \param context The context passed to min_logger_init_callback()
+typedef void (*MinLoggerSinkCallback)(const uint8_t* data, size_t len_bytes, void* context);
+
 #if MIN_LOGGER_ENABLED && defined(MIN_LOGGER_BUFFERED_ESP32_PLATFORM)
 
     // Buffer size for the lock-free ring buffer (must be power of two)
@@ -27,16 +46,63 @@ extern "C" {
         #define MIN_LOGGER_BUFFER_SIZE 256
     #endif
 
+    // When the buffer is full, drop new messages instead of overwriting messages that haven't
+    // been sent yet. The number of dropped messages is periodically reported in the log (see
+    // min_logger_write_dropped_count()).
+    #ifndef MIN_LOGGER_DROP_WHEN_FULL
+        #define MIN_LOGGER_DROP_WHEN_FULL 0
+    #endif
+
+    // Size of the buffer for each core that messages from the _ISR macros are written to (must be
+    // power of two and less than MIN_LOGGER_BUFFER_SIZE). The output tasks merge them into the main
+    // buffer before sending it. Messages are dropped when a core's buffer is full, and the number
+    // dropped is reported in the log. 0 writes them to the main buffer directly.
+    #ifndef MIN_LOGGER_ISR_BUFFER_SIZE
+        #define MIN_LOGGER_ISR_BUFFER_SIZE 128
+    #endif
+
+    // The UART task sleeps until this many bytes have been written since it last woke, or
+    // MIN_LOGGER_UART_MAX_LATENCY_MS passes. Larger values send larger batches with fewer wakeups,
+    // but leave less room in the buffer for bursts (must be less than MIN_LOGGER_BUFFER_SIZE).
+    #ifndef MIN_LOGGER_UART_HIGH_WATER_MARK
+        #define MIN_LOGGER_UART_HIGH_WATER_MARK (MIN_LOGGER_BUFFER_SIZE / 4)
+    #endif
+
+    // Longest time the UART task sleeps while less than MIN_LOGGER_UART_HIGH_WATER_MARK bytes are
+    // waiting. Stats flushes, keyframes and drop reports are also checked when it wakes.
+    #ifndef MIN_LOGGER_UART_MAX_LATENCY_MS
+        #define MIN_LOGGER_UART_MAX_LATENCY_MS 100
+    #endif
+
+    // Stack size in bytes of the UART, UDP and callback tasks. Whichever wakes first also
+    // serializes the stats, drop reports, keyframe requests and thread names on its stack, and with
+    // MIN_LOGGER_ENABLE_BLOCK_FORMAT each task's thread local block is placed on it as well.
+    #ifndef MIN_LOGGER_SINK_TASK_STACK
+        #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+            #define MIN_LOGGER_SINK_TASK_STACK (2048 + MIN_LOGGER_BLOCK_SIZE + 152)
+        #else
+            #define MIN_LOGGER_SINK_TASK_STACK 2048
+        #endif
+    #endif
+
     // Compile in UDP logging functionality
     #ifndef MIN_LOGGER_ENABLE_UDP
         #define MIN_LOGGER_ENABLE_UDP 1
     #endif
 
+    // Longest time the UDP task waits for a full packet before sending the data it has as a
+    // shorter packet.
+    #ifndef MIN_LOGGER_UDP_MAX_LATENCY_MS
+        #define MIN_LOGGER_UDP_MAX_LATENCY_MS 100
+    #endif
+
 // Global buffer for logging data (used for post mortem or core dump)
 extern uint8_t min_logger_buffer[MIN_LOGGER_BUFFER_SIZE];
 
 // Initialize UART output for min logger
 // Starts a min_logger_uart task
+// The UART driver should be installed with a TX buffer of at least MIN_LOGGER_UART_HIGH_WATER_MARK
+// bytes, so sending a batch doesn't block the task until it's out of the FIFO.
 // \param uart_num UART port number to use for logging
 void min_logger_init_uart(unsigned uart_num);
 
@@ -46,8 +112,8 @@ void min_logger_init_uart(unsigned uart_num);
 // Logs will only start being sent when the network is up. Logs from before are ignored.
 //
 // \param packet_size Size of each UDP packet to send. Messages wait in buffer
-//                    until this size is reached. MIN_LOGGER_BUFFER_SIZE must
-//                    be integer multiple of packet_size.
+//                    until this size is reached, or MIN_LOGGER_UDP_MAX_LATENCY_MS
+//                    passes. Must be less than MIN_LOGGER_BUFFER_SIZE.
 // \param poll_interval_ms Polling interval in milliseconds for the UDP task
 // \param logging_udp_ip Destination IP address for UDP packets
 // \param logging_udp_port Destination port for UDP packets
@@ -55,10 +121,27 @@ void min_logger_init_udp(size_t packet_size, unsigned poll_interval_ms, const ch
                          uint16_t logging_udp_port);
     #endif
 
+// Initialize a user callback output for min logger
+// Starts a min_logger_cb task that passes the data in the buffer to callback. The callback runs on
+// that task, which has a MIN_LOGGER_SINK_TASK_STACK byte stack (2048 bytes by default, plus the
+// thread local block with MIN_LOGGER_ENABLE_BLOCK_FORMAT).
+// \param callback Function to send the data
+// \param context Passed to callback
+// \param poll_interval_ms Polling interval in milliseconds for the callback task
+void min_logger_init_callback(MinLoggerSinkCallback callback, void* context,
+                              unsigned poll_interval_ms);
+
+// Get the number of bytes a sink lost because it fell behind and they were overwritten.
+// Wraps on overflow.
+uint32_t min_logger_get_sink_dropped_bytes(MinLoggerSink sink);
+
 #else
 inline void min_logger_init_uart(unsigned uart_num) {}
 inline void min_logger_init_udp(size_t packet_size, unsigned poll_interval_ms,
                                 const char* logging_udp_ip, uint16_t logging_udp_port) {}
+inline void min_logger_init_callback(MinLoggerSinkCallback callback, void* context,
+                                     unsigned poll_interval_ms) {}
+inline uint32_t min_logger_get_sink_dropped_bytes(MinLoggerSink sink) { return 0; }
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,158 @@
+/*
+ * Buffered POSIX Platform Implementation
+ *
+ * Provides lock-free ring buffer-based logging for Linux and other POSIX hosts. Logging writes
+ * only copy into the ring buffer, with a separate drain thread handling output to a file
+ * descriptor. This keeps stdio locking and pipe/socket backpressure off of the logging thread.
+ *
+ * This overrides the:
+ * void __attribute__((weak)) min_logger_write(const uint8_t* msg, size_t len_bytes)
+ * bool __attribute__((weak)) min_logger_write_reserve(size_t len_bytes,
+ *                                                  MinLoggerWriteReservation* reservation)
+ * void __attribute__((weak)) min_logger_write_commit(MinLoggerWriteReservation* reservation)
+ *
+ * MIN_LOGGER_BUFFERED_POSIX_PLATFORM must be defined to use this over minimal implemetation in
+ * src/min_logger/platform_implementations/defaults.cpp
+ */
+
+#pragma once
+
+#include "min_logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIN_LOGGER_MMAP_MAGIC "MINLOGMM"
+#define MIN_LOGGER_MMAP_VERSION 1
+
+// Header at the start of a file created by min_logger_init_mmap(). Integers are in the writer's
+// byte order, and offsets are from the start of the file. The layout is also read by
+// min-logger-extract.
+typedef struct {
+    // MIN_LOGGER_MMAP_MAGIC without the null terminator. Set last, once the rest of the file is
+    // valid.
+    char magic[8];
+    // MIN_LOGGER_MMAP_VERSION
+    uint32_t version;
+    // MIN_LOGGER_BUFFER_SHARDS
+    uint32_t num_shards;
+    // Bytes of data in each shard
+    uint32_t shard_size;
+    // Size of the ring buffers' write counts in bytes (sizeof(LockFreeRingBufferIndex))
+    uint32_t index_size;
+    // Offset of shard 0's ring buffer
+    uint64_t ring_buffer_offset;
+    // Distance between the shards' ring buffers
+    uint64_t ring_buffer_stride;
+    // sizeof() the shards' ring buffers, so readers can check they're built the same way
+    uint64_t ring_buffer_size;
+    // Offset of each shard's total write count from its ring buffer. The shard's newest data ends
+    // at this count modulo shard_size.
+    uint64_t write_size_offset;
+    // Offset of shard 0's data. Each shard's data follows the previous shard's.
+    uint64_t data_offset;
+    // Process that created the file
+    uint32_t pid;
+    // min_logger_get_serialize_format_name() when the file was created, or empty for a custom
+    // format. Null terminated.
+    char format[20];
+} MinLoggerMmapHeader;
+
+// Get a shard's ring buffer from a mapping of a file created by min_logger_init_mmap(). In C++ it's
+// a LockFreeRingBufferBase, that a collector process can drain with a LockFreeRingBufferReader if
+// it's built with the same ring buffer (see index_size and ring_buffer_size). Readers register
+// with the buffer for backpressure, so the mapping must be writable.
+//
+// \param header Start of the mapping
+// \param shard Index of the shard, less than num_shards
+static inline void* min_logger_mmap_ring_buffer(MinLoggerMmapHeader* header, uint32_t shard) {
+    return (uint8_t*)header + header->ring_buffer_offset + shard * header->ring_buffer_stride;
+}
+
+#if MIN_LOGGER_ENABLED && defined(MIN_LOGGER_BUFFERED_POSIX_PLATFORM)
+
+    // Buffer size for the lock-free ring buffer (must be power of two)
+    #ifndef MIN_LOGGER_BUFFER_SIZE
+        #define MIN_LOGGER_BUFFER_SIZE 65536
+    #endif
+
+    // When the buffer is full, drop new messages instead of overwriting messages that haven't
+    // been sent yet. The number of dropped messages is periodically reported in the log (see
+    // min_logger_write_dropped_count()).
+    #ifndef MIN_LOGGER_DROP_WHEN_FULL
+        #define MIN_LOGGER_DROP_WHEN_FULL 0
+    #endif
+
+    // Number of ring buffers MIN_LOGGER_BUFFER_SIZE is split between (must be power of two).
+    // Each thread writes to the shard selected by min_logger_get_thread_idx(), so threads on
+    // different shards don't contend on the same write counters. Messages from different shards
+    // are drained in separate runs, so the output is only ordered per thread. Use a format with
+    // absolute timestamps along with the parser's --reorder_window to merge them.
+    #ifndef MIN_LOGGER_BUFFER_SHARDS
+        #define MIN_LOGGER_BUFFER_SHARDS 1
+    #endif
+
+    // Longest min_logger_flush() and min_logger_stop() wait for a write that was reserved before
+    // they were called, but not yet committed. Messages committed after it in the same shard can't
+    // be read until it is, so they may not be written if a thread stalls in the middle of a write.
+    // It's also how long the drain waits for a full non-blocking output descriptor to accept more
+    // data before it stops writing to it.
+    #ifndef MIN_LOGGER_FLUSH_TIMEOUT_MS
+        #define MIN_LOGGER_FLUSH_TIMEOUT_MS 1000
+    #endif
+
+// Global buffer for logging data (used for post mortem or core dump). Unused after
+// min_logger_init_mmap().
+extern uint8_t min_logger_buffer[MIN_LOGGER_BUFFER_SIZE];
+
+// Move the ring buffers to a shared mapping of a file, starting with a MinLoggerMmapHeader. The
+// data survives the process crashing, and other processes can read it while the logger is running.
+// Messages logged before this is called are left behind in min_logger_buffer, so it should be
+// called at startup, before min_logger_init_fd() or min_logger_init_file(). Those then drain the
+// mapped buffers. Set the serialization format first so the header records it.
+//
+// \param path Path of the file to create or truncate
+// \return false if the file couldn't be created and mapped, the buffers are already mapped, or
+//         the drain thread is already running
+bool min_logger_init_mmap(const char* path);
+
+// Initialize file descriptor output for min logger
+// Starts a min_logger drain thread. Messages logged before this is called are kept in the buffer
+// and sent once the thread starts, unless the buffer has already wrapped.
+//
+// \param fd File descriptor to write to. Can be a file, pipe, or connected socket. The logger does
+//           not take ownership and never closes it. Output stops if a write fails, or a
+//           non-blocking descriptor stays full for MIN_LOGGER_FLUSH_TIMEOUT_MS.
+// \param poll_interval_ms Time the drain thread sleeps when the buffer is empty
+// \return false if the logger was already initialized or the thread couldn't be started
+bool min_logger_init_fd(int fd, unsigned poll_interval_ms);
+
+// Initialize file output for min logger
+// Creates or truncates the file at path and passes it to min_logger_init_fd().
+//
+// \param path Path of the file to write logs to
+// \param poll_interval_ms Time the drain thread sleeps when the buffer is empty
+// \return false if the file couldn't be opened or the logger was already initialized
+bool min_logger_init_file(const char* path, unsigned poll_interval_ms);
+
+// Block until everything logged before this call has been written to the output. If another
+// thread is in the middle of writing a message, this waits up to MIN_LOGGER_FLUSH_TIMEOUT_MS for
+// it to finish. Does nothing if the drain thread isn't running.
+void min_logger_flush();
+
+// Flush, then stop the drain thread. Registered to run automatically at exit. Messages logged
+// afterwards are kept in the buffer, overwriting the oldest data when it's full.
+void min_logger_stop();
+
+#else
+inline bool min_logger_init_mmap(const char* path) { return false; }
+inline bool min_logger_init_fd(int fd, unsigned poll_interval_ms) { return false; }
+inline bool min_logger_init_file(const char* path, unsigned poll_interval_ms) { return false; }
+inline void min_logger_flush() {}
+inline void min_logger_stop() {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
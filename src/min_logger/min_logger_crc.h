@@ -52,6 +52,16 @@ constexpr MinLoggerCRC MIN_LOGGER_CPP_CRC32(const char* str) {
     return MIN_LOGGER_CRC32(str, MIN_LOGGER_STRLEN_C(str));
 }
 
+// Runtime CRC32 of a buffer using the same table.
+inline uint32_t MIN_LOGGER_CRC32_BUFFER(const void* data, size_t length) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t crc = ~0u;
+    while (length--) {
+        crc = (crc >> 8) ^ MIN_LOGGER_CRC_TABLE[(crc & 0xFF) ^ *p++];
+    }
+    return ~crc;
+}
+
 }  // namespace min_logger_crc
 
 #undef MIN_LOGGER_A
@@ -0,0 +1,915 @@
+/*
+ * Built-in serialization formats (C++ only).
+ *
+ * The serializers are defined inline so that when MIN_LOGGER_STATIC_FORMAT is set, the logging
+ * macros can call them directly instead of going through the MinLoggerSerializeCallBack returned
+ * by min_logger_get_serialize_format(). Calls with a fixed payload size are specialized on that
+ * size, so the header and payload copies can be folded into a few stores.
+ *
+ * The same implementations back MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT and
+ * MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT, so both paths produce identical output.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#include "min_logger.h"
+
+#if MIN_LOGGER_ENABLED
+
+    #if defined(ESP32) || defined(ESP_PLATFORM)
+        #include <esp_attr.h>
+        #define MIN_LOGGER_FUNC_ATTR IRAM_ATTR
+    #else
+        #define MIN_LOGGER_FUNC_ATTR
+    #endif
+
+namespace min_logger_serializers {
+
+// Largest message the serializers will write. Longer payloads are split into CONTINUATION_MSG_ID
+// messages.
+static constexpr size_t MAX_MSG_SIZE = 256;
+
+// Runtime log level set by min_logger_set_level().
+extern std::atomic<int> runtime_level;
+
+// Timestamp of the last message written in the MICRO format.
+extern std::atomic<uint64_t> micro_last_timestamp_ns;
+// Timestamp of the last sync marker written in the MICRO format.
+extern std::atomic<uint64_t> micro_last_sync_ns;
+// Timestamp of this thread's previous message in MICRO_THREAD, as reconstructed by the parser.
+extern thread_local uint64_t micro_thread_timestamp_ns;
+
+// Absolute timestamp of the following messages on a thread in MICRO_THREAD.
+static constexpr MinLoggerCRC TIME_SYNC_MSG_ID = 0XFFFFFF03;
+// Sync marker in the MICRO format, with a MicroSyncPayload.
+static constexpr MinLoggerCRC MICRO_SYNC_MSG_ID = 0XFFFFFF04;
+// Piece of a payload too long for one message, starting with a ContinuationHeader.
+static constexpr MinLoggerCRC CONTINUATION_MSG_ID = 0XFFFFFF05;
+
+// Most parts a payload is passed to write_message_parts() in.
+static constexpr size_t MAX_PAYLOAD_PARTS = 2;
+
+// Inline equivalent of min_logger_get_level().
+inline int get_level() { return runtime_level.load(std::memory_order_relaxed); }
+
+    #if MIN_LOGGER_CYCLE_COUNTER_TIME
+        #if defined(__x86_64__) || defined(__i386__)
+// Number of bits in the values returned by read_cycle_counter().
+static constexpr uint64_t CYCLE_COUNTER_BITS = 64;
+
+inline uint64_t read_cycle_counter() { return __builtin_ia32_rdtsc(); }
+        #elif defined(__aarch64__)
+static constexpr uint64_t CYCLE_COUNTER_BITS = 64;
+
+inline uint64_t read_cycle_counter() {
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+}
+        #elif defined(__XTENSA__)
+static constexpr uint64_t CYCLE_COUNTER_BITS = 32;
+
+inline uint64_t MIN_LOGGER_FUNC_ATTR read_cycle_counter() {
+    uint32_t ticks;
+    asm volatile("rsr %0, ccount" : "=a"(ticks));
+    return ticks;
+}
+        #else
+            #error "MIN_LOGGER_CYCLE_COUNTER_TIME isn't supported on this architecture"
+        #endif
+
+static constexpr uint64_t CYCLE_COUNTER_MASK =
+    (CYCLE_COUNTER_BITS == 64) ? ~uint64_t(0) : (uint64_t(1) << CYCLE_COUNTER_BITS) - 1;
+
+// Counter value when the last calibration message was sent.
+extern std::atomic<uint64_t> last_calibration_ticks;
+extern std::atomic<bool> calibration_sent;
+    #endif
+
+// Mask for the range of the values returned by get_timestamp().
+    #if MIN_LOGGER_CYCLE_COUNTER_TIME
+static constexpr uint64_t TIMESTAMP_MASK = CYCLE_COUNTER_MASK;
+    #else
+static constexpr uint64_t TIMESTAMP_MASK = ~uint64_t(0);
+    #endif
+
+// Time from start to end, handling counters that wrap. Returns 0 if end is before start, which can
+// happen when a message is sent while getting the timestamp for another.
+inline uint64_t MIN_LOGGER_FUNC_ATTR elapsed_since(uint64_t start, uint64_t end) {
+    uint64_t elapsed = (end - start) & TIMESTAMP_MASK;
+    return (elapsed > TIMESTAMP_MASK / 2) ? 0 : elapsed;
+}
+
+// Gets the timestamp for a message. This is the cycle counter with MIN_LOGGER_CYCLE_COUNTER_TIME,
+// sending a calibration message first when one is due.
+inline uint64_t MIN_LOGGER_FUNC_ATTR get_timestamp() {
+    #if MIN_LOGGER_CYCLE_COUNTER_TIME
+    uint64_t ticks = read_cycle_counter();
+    uint64_t last = last_calibration_ticks.load(std::memory_order_relaxed);
+    bool due = ((ticks - last) & CYCLE_COUNTER_MASK) >= MIN_LOGGER_TIME_CALIBRATION_TICKS ||
+               !calibration_sent.load(std::memory_order_relaxed);
+    // Only the thread that updates last_calibration_ticks sends the calibration.
+    if (due && last_calibration_ticks.compare_exchange_strong(last, ticks)) {
+        min_logger_write_time_calibration();
+    }
+    return ticks;
+    #else
+    return min_logger_get_time_nanoseconds();
+    #endif
+}
+
+// Time since start, a value from get_timestamp(), saturated to fit a scope record's payload.
+inline uint32_t MIN_LOGGER_FUNC_ATTR get_scope_duration(uint64_t start) {
+    uint64_t elapsed = elapsed_since(start, get_timestamp());
+    return (elapsed > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(elapsed);
+}
+
+// Inline equivalent of min_logger_sample_every_ns().
+inline bool MIN_LOGGER_FUNC_ATTR sample_every_ns(uint64_t* next_ns, uint64_t period_ns) {
+    uint64_t now = min_logger_get_time_nanoseconds();
+    uint64_t next = __atomic_load_n(next_ns, __ATOMIC_RELAXED);
+    if (now < next) {
+        return false;
+    }
+    // Only the thread that moves next_ns forward sends its message.
+    return __atomic_compare_exchange_n(next_ns, &next, now + period_ns, false, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED);
+}
+
+// Inline equivalent of min_logger_rate_limit().
+inline bool MIN_LOGGER_FUNC_ATTR rate_limit(uint64_t* tat_ns, uint64_t interval_ns,
+                                            uint32_t burst) {
+    uint64_t now = min_logger_get_time_nanoseconds();
+    uint64_t tat = __atomic_load_n(tat_ns, __ATOMIC_RELAXED);
+    while (true) {
+        // Time is credited back while the site is idle, up to a full burst.
+        uint64_t new_tat = std::max(tat, now) + interval_ns;
+        if (new_tat - now > interval_ns * burst) {
+            return false;
+        }
+        if (__atomic_compare_exchange_n(tat_ns, &tat, new_tat, false, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+}
+
+// Adds a call site to the list min_logger_flush_stats() sends. Defined in min_logger.cpp.
+void register_stat_site(MinLoggerStatSite* site);
+
+// Inline equivalent of min_logger_record_stat().
+inline void MIN_LOGGER_FUNC_ATTR record_stat(MinLoggerStatSite* site, double value) {
+    if (!__atomic_load_n(&site->registered, __ATOMIC_ACQUIRE)) {
+        register_stat_site(site);
+    }
+    size_t first = min_logger_get_thread_idx();
+    for (size_t i = 0; i < MIN_LOGGER_STAT_SLOTS; i++) {
+        MinLoggerStatSlot* slot = &site->slots[(first + i) % MIN_LOGGER_STAT_SLOTS];
+        // Another thread or the flush has this slot, so try the next one.
+        if (__atomic_exchange_n(&slot->busy, 1, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        if (slot->count == 0 || value < slot->min) {
+            slot->min = value;
+        }
+        if (slot->count == 0 || value > slot->max) {
+            slot->max = value;
+        }
+        slot->count++;
+        slot->sum += value;
+        slot->sum_sq += value * value;
+        if (site->has_histogram) {
+            size_t bucket = 0;
+            if (value >= site->histogram_max) {
+                bucket = MIN_LOGGER_STAT_BUCKETS - 1;
+            } else if (value > site->histogram_min) {
+                double offset = value - site->histogram_min;
+                double range = site->histogram_max - site->histogram_min;
+                bucket = static_cast<size_t>(offset * MIN_LOGGER_STAT_BUCKETS / range);
+                // Rounding can put values just below histogram_max past the last bucket.
+                bucket = std::min<size_t>(bucket, MIN_LOGGER_STAT_BUCKETS - 1);
+            }
+            slot->buckets[bucket]++;
+        }
+        __atomic_store_n(&slot->busy, 0, __ATOMIC_RELEASE);
+        return;
+    }
+}
+
+// Converts elapsed time in nanoseconds to (scale, value) pair
+// Scale: 0=ns, 1=us, 2=ms, 3=s
+// Value: 0-999
+inline std::pair<unsigned, unsigned> MIN_LOGGER_FUNC_ATTR convert_nanoseconds(uint64_t ns) {
+    unsigned scale = 0;
+    uint64_t value = ns;
+
+    // Scale up until value fits in 0-999 range
+    if (value >= 1000) {
+        value /= 1000;
+        scale = 1;  // microseconds
+
+        if (value >= 1000) {
+            value /= 1000;
+            scale = 2;  // milliseconds
+
+            if (value >= 1000) {
+                value /= 1000;
+                scale = 3;  // seconds
+
+                // Cap at 999 seconds
+                if (value > 999) {
+                    value = 999;
+                }
+            }
+        }
+    }
+
+    return {scale, static_cast<unsigned>(value)};
+}
+
+// Converts a (scale, value) pair from convert_nanoseconds() back to nanoseconds.
+inline uint64_t MIN_LOGGER_FUNC_ATTR scaled_to_nanoseconds(std::pair<unsigned, unsigned> delta) {
+    static constexpr uint64_t SCALES[] = {1ull, 1000ull, 1000000ull, 1000000000ull};
+    return delta.second * SCALES[delta.first];
+}
+
+// Copies data into a reservation at offset, handling the wrap between part1 and part2.
+inline void MIN_LOGGER_FUNC_ATTR reservation_copy(const MinLoggerWriteReservation& reservation,
+                                                  size_t offset, const void* data,
+                                                  size_t data_len) {
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    if (offset < reservation.part1_size) {
+        size_t copy1_size = std::min(data_len, reservation.part1_size - offset);
+        memcpy(reservation.part1 + offset, src, copy1_size);
+        src += copy1_size;
+        data_len -= copy1_size;
+        offset = 0;
+    } else {
+        offset -= reservation.part1_size;
+    }
+    if (data_len > 0) {
+        memcpy(reservation.part2 + offset, src, data_len);
+    }
+}
+
+// Writes a header, an optional one byte length prefix, and the payload as a single message. The
+// payload is the num_parts parts one after another, payload_len bytes in total.
+// If the platform can reserve space, the message is serialized directly into its buffer. If
+// MIN_LOGGER_ENABLE_WRITEV is set and the platform can gather the parts itself, they're passed to
+// min_logger_writev() without being copied. Otherwise it's assembled on the stack and passed to
+// min_logger_write().
+// MSG_BUFFER_SIZE must fit the header, length prefix, and payload.
+template <typename Header, size_t MSG_BUFFER_SIZE>
+inline void MIN_LOGGER_FUNC_ATTR write_message_parts(const Header& header, bool add_len_prefix,
+                                                     const MinLoggerIoVec* parts, size_t num_parts,
+                                                     size_t payload_len) {
+    const size_t header_size = sizeof(Header) + (add_len_prefix ? 1 : 0);
+    const uint8_t len_prefix = static_cast<uint8_t>(payload_len);
+
+    MinLoggerWriteReservation reservation;
+    if (min_logger_write_reserve(header_size + payload_len, &reservation)) {
+        // The transport is full and dropped the message.
+        if (reservation.part1_size + reservation.part2_size == 0) {
+            return;
+        }
+        if (reservation.part1_size >= sizeof(Header)) {
+            *reinterpret_cast<Header*>(reservation.part1) = header;
+        } else {
+            reservation_copy(reservation, 0, &header, sizeof(Header));
+        }
+        if (add_len_prefix) {
+            reservation_copy(reservation, sizeof(Header), &len_prefix, 1);
+        }
+        size_t offset = header_size;
+        for (size_t i = 0; i < num_parts; i++) {
+            if (parts[i].len > 0) {
+                reservation_copy(reservation, offset, parts[i].data, parts[i].len);
+                offset += parts[i].len;
+            }
+        }
+        min_logger_write_commit(&reservation);
+        return;
+    }
+
+    // The size checks skip these for messages that are known to have no payload.
+    uint8_t msg_buffer[MSG_BUFFER_SIZE];
+    *reinterpret_cast<Header*>(msg_buffer) = header;
+    if (MSG_BUFFER_SIZE > sizeof(Header) && add_len_prefix) {
+        msg_buffer[sizeof(Header)] = len_prefix;
+    }
+
+    #if MIN_LOGGER_ENABLE_WRITEV
+    MinLoggerIoVec iov[1 + MAX_PAYLOAD_PARTS];
+    iov[0].data = msg_buffer;
+    iov[0].len = header_size;
+    size_t iov_count = 1;
+    for (size_t i = 0; i < num_parts; i++) {
+        if (parts[i].len > 0) {
+            iov[iov_count++] = parts[i];
+        }
+    }
+    if (min_logger_writev(iov, iov_count)) {
+        return;
+    }
+    #endif
+
+    if (MSG_BUFFER_SIZE > sizeof(Header)) {
+        size_t offset = header_size;
+        for (size_t i = 0; i < num_parts; i++) {
+            if (parts[i].len > 0) {
+                memcpy(msg_buffer + offset, parts[i].data, parts[i].len);
+                offset += parts[i].len;
+            }
+        }
+    }
+    min_logger_write(msg_buffer, header_size + payload_len);
+}
+
+// write_message_parts() for a payload in one part.
+template <typename Header, size_t MSG_BUFFER_SIZE>
+inline void MIN_LOGGER_FUNC_ATTR write_message(const Header& header, bool add_len_prefix,
+                                               const void* payload, size_t payload_len) {
+    const MinLoggerIoVec part = {payload, payload_len};
+    write_message_parts<Header, MSG_BUFFER_SIZE>(header, add_len_prefix, &part, 1, payload_len);
+}
+
+    #pragma pack(1)
+// Start of a CONTINUATION_MSG_ID payload, followed by a piece of the original payload. The parser
+// joins the pieces into a message with msg_id once it has all total_len bytes.
+struct ContinuationHeader {
+    MinLoggerCRC msg_id = 0;
+    uint32_t offset = 0;     // Offset of this piece in the original payload
+    uint32_t total_len = 0;  // Length of the original payload
+};
+    #pragma pack()
+
+// Sends a payload longer than MAX_LEN bytes as CONTINUATION_MSG_ID messages with pieces of it, in
+// order. FORMAT::WriteContinuation() sends each one.
+template <typename FORMAT, size_t MAX_LEN>
+inline void MIN_LOGGER_FUNC_ATTR write_continuations(MinLoggerCRC msg_id, const void* payload,
+                                                     size_t payload_len) {
+    static_assert(MAX_LEN > sizeof(ContinuationHeader), "No room for the continuation's data");
+    static constexpr size_t PIECE_LEN = MAX_LEN - sizeof(ContinuationHeader);
+    const uint8_t* src = static_cast<const uint8_t*>(payload);
+
+    ContinuationHeader header;
+    header.msg_id = msg_id;
+    header.total_len = static_cast<uint32_t>(payload_len);
+    for (size_t offset = 0; offset < payload_len; offset += PIECE_LEN) {
+        header.offset = static_cast<uint32_t>(offset);
+        const size_t piece_len = std::min(PIECE_LEN, payload_len - offset);
+        const MinLoggerIoVec parts[MAX_PAYLOAD_PARTS] = {{&header, sizeof(header)},
+                                                         {src + offset, piece_len}};
+        FORMAT::WriteContinuation(parts, sizeof(header) + piece_len);
+    }
+}
+
+    #pragma pack(1)  // Set packing alignment to 1 byte
+struct BinaryMsgHeader {
+    static constexpr uint16_t SYNC = 0xFAAF;
+    uint16_t sync = SYNC;
+    uint8_t payload_len = 0;
+    uint8_t thread_id = 0;
+    MinLoggerCRC msg_id = 0;
+    uint64_t timestamp = 0;
+};
+    #pragma pack()  // Revert to default packing alignment
+
+    #pragma pack(1)  // Set packing alignment to 1 byte
+struct MicroMessageHeader {
+    // Thread IDs from this one up are sent as this value, followed by a byte with the whole ID.
+    static constexpr uint8_t THREAD_ID_ESCAPE = 0xF;
+
+    uint16_t truncated_id;
+    uint8_t thread_id : 4;     // 4 bits
+    uint8_t time_scale : 2;    // 2 bits
+    uint16_t time_value : 10;  // 10 bits
+
+    MicroMessageHeader() : truncated_id(0), thread_id(0), time_scale(0), time_value(0) {}
+
+    MicroMessageHeader(MinLoggerCRC id, uint8_t thread, uint8_t scale, uint16_t value)
+        : truncated_id(static_cast<uint16_t>(id)),
+          thread_id(thread < THREAD_ID_ESCAPE ? thread : THREAD_ID_ESCAPE),
+          time_scale(scale & 0x3),
+          time_value(value & 0x3FF) {}
+};
+
+// MicroMessageHeader for a thread ID of MicroMessageHeader::THREAD_ID_ESCAPE or more.
+struct MicroEscapedHeader {
+    MicroMessageHeader header;
+    uint8_t thread_id;
+
+    MicroEscapedHeader(MinLoggerCRC id, uint8_t thread, uint8_t scale, uint16_t value)
+        : header(id, thread, scale, value), thread_id(thread) {}
+};
+    #pragma pack()
+
+// write_message_parts() with a MicroEscapedHeader. Thread IDs this high are rare, so it's kept out
+// of line to avoid inlining a second copy at every call site. Defined in min_logger.cpp.
+void write_escaped_micro_message(const MicroEscapedHeader& header, bool add_len_prefix,
+                                 const MinLoggerIoVec* parts, size_t num_parts,
+                                 size_t payload_len);
+
+// Writes a micro format message with the header for thread_id.
+template <size_t MSG_BUFFER_SIZE>
+inline void MIN_LOGGER_FUNC_ATTR write_micro_message(MinLoggerCRC msg_id, uint8_t thread_id,
+                                                     std::pair<unsigned, unsigned> delta,
+                                                     bool add_len_prefix,
+                                                     const MinLoggerIoVec* parts,
+                                                     size_t num_parts, size_t payload_len) {
+    if (thread_id >= MicroMessageHeader::THREAD_ID_ESCAPE) {
+        const MicroEscapedHeader header(msg_id, thread_id, delta.first, delta.second);
+        write_escaped_micro_message(header, add_len_prefix, parts, num_parts, payload_len);
+        return;
+    }
+    const MicroMessageHeader header(msg_id, thread_id, delta.first, delta.second);
+    write_message_parts<MicroMessageHeader, MSG_BUFFER_SIZE>(header, add_len_prefix, parts,
+                                                             num_parts, payload_len);
+}
+
+    #pragma pack(1)
+struct MicroSyncPayload {
+    static constexpr uint32_t MAGIC = 0x5AA5C33C;
+    uint32_t magic = MAGIC;
+    uint64_t timestamp = 0;
+};
+    #pragma pack()
+
+    #pragma pack(1)
+// Summary min_logger_flush_stats() sends for a MIN_LOGGER_RECORD_STAT call site.
+struct StatPayload {
+    uint32_t count = 0;
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    double sum_sq = 0;
+};
+
+// StatPayload followed by the histogram, for MIN_LOGGER_RECORD_STAT_HISTOGRAM.
+struct StatHistogramPayload {
+    StatPayload stat;
+    double histogram_min = 0;
+    double histogram_max = 0;
+    uint32_t buckets[MIN_LOGGER_STAT_BUCKETS] = {0};
+};
+    #pragma pack()
+
+// Longest payload of a message in both formats. Longer ones are sent as continuations.
+static constexpr size_t MAX_PAYLOAD_SIZE = MAX_MSG_SIZE - sizeof(BinaryMsgHeader);
+
+// Length of the payload in the message for PAYLOAD_LEN bytes, which is split into continuations if
+// it's longer than MAX_PAYLOAD_SIZE.
+template <size_t PAYLOAD_LEN>
+struct TruncatedLen {
+    static constexpr size_t value =
+        (PAYLOAD_LEN > MAX_PAYLOAD_SIZE) ? MAX_PAYLOAD_SIZE : PAYLOAD_LEN;
+};
+
+// Full binary format with timestamps and sync (MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT).
+struct BINARY {
+    // Writes a message with a payload of at most MAX_PAYLOAD_SIZE bytes in num_parts parts.
+    template <size_t MSG_BUFFER_SIZE>
+    static inline void MIN_LOGGER_FUNC_ATTR WriteParts(MinLoggerCRC msg_id,
+                                                       const MinLoggerIoVec* parts,
+                                                       size_t num_parts, size_t payload_len) {
+        send_thread_name_if_needed();
+
+        BinaryMsgHeader header;
+        header.msg_id = msg_id;
+        header.payload_len = payload_len;
+        header.timestamp = get_timestamp();
+        header.thread_id = min_logger_get_thread_idx();
+        write_message_parts<BinaryMsgHeader, MSG_BUFFER_SIZE>(header, false, parts, num_parts,
+                                                              payload_len);
+    }
+
+    template <size_t MSG_BUFFER_SIZE>
+    static inline void MIN_LOGGER_FUNC_ATTR Write(MinLoggerCRC msg_id, const void* payload,
+                                                  size_t payload_len) {
+        if (payload_len > MAX_PAYLOAD_SIZE) {
+            write_continuations<BINARY, MAX_PAYLOAD_SIZE>(msg_id, payload, payload_len);
+            return;
+        }
+        const MinLoggerIoVec part = {payload, payload_len};
+        WriteParts<MSG_BUFFER_SIZE>(msg_id, &part, 1, payload_len);
+    }
+
+    // Sends a piece from write_continuations().
+    static inline void MIN_LOGGER_FUNC_ATTR WriteContinuation(const MinLoggerIoVec* parts,
+                                                              size_t payload_len) {
+        WriteParts<MAX_MSG_SIZE>(CONTINUATION_MSG_ID, parts, MAX_PAYLOAD_PARTS, payload_len);
+    }
+
+    // Has the MinLoggerSerializeCallBack signature.
+    static inline void MIN_LOGGER_FUNC_ATTR Serialize(MinLoggerCRC msg_id, const void* payload,
+                                                      size_t payload_len, bool is_fixed_size) {
+        Write<MAX_MSG_SIZE>(msg_id, payload, payload_len);
+    }
+
+    // Serialize() for a fixed size payload of PAYLOAD_LEN bytes.
+    template <size_t PAYLOAD_LEN>
+    static inline void MIN_LOGGER_FUNC_ATTR SerializeValue(MinLoggerCRC msg_id,
+                                                           const void* payload) {
+        Write<sizeof(BinaryMsgHeader) + TruncatedLen<PAYLOAD_LEN>::value>(msg_id, payload,
+                                                                          PAYLOAD_LEN);
+    }
+};
+
+// Minimal binary format for space-constrained systems
+// (MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT).
+struct MICRO {
+    // Writes a message with a payload of at most MAX_PAYLOAD_SIZE bytes in num_parts parts.
+    template <size_t MSG_BUFFER_SIZE>
+    static inline void MIN_LOGGER_FUNC_ATTR WriteParts(MinLoggerCRC msg_id,
+                                                       const MinLoggerIoVec* parts,
+                                                       size_t num_parts, size_t payload_len,
+                                                       bool is_fixed_size) {
+        send_thread_name_if_needed();
+
+        uint64_t current_timestamp_ns = get_timestamp();
+        WriteSyncIfNeeded(current_timestamp_ns);
+        uint64_t local_last_timestamp_ns = micro_last_timestamp_ns.exchange(current_timestamp_ns);
+        uint64_t elapsed_ns = 0;
+        // Handle initial case, and race condition between computing current time and doing
+        // exchange. There still an issue here where the messages can end up being sent in a
+        // different order then their deltas were computed. The overall time progress will still be
+        // correct, but individual message deltas may be off. This could be fixed with a mutex, but
+        // that would add significant overhead to this low-level function and copmlicate
+        // portability. Since this should be rare in practice, we accept the potential inaccuracy
+        // for the sake of performance.
+        if (local_last_timestamp_ns != 0 && current_timestamp_ns > local_last_timestamp_ns) {
+            elapsed_ns = current_timestamp_ns - local_last_timestamp_ns;
+        }
+
+        auto delta = convert_nanoseconds(elapsed_ns);
+
+        // Variable length payloads are prefixed with their length.
+        bool add_len_prefix = !is_fixed_size && payload_len > 0;
+        write_micro_message<MSG_BUFFER_SIZE>(msg_id, min_logger_get_thread_idx(), delta,
+                                             add_len_prefix, parts, num_parts, payload_len);
+    }
+
+    template <size_t MSG_BUFFER_SIZE>
+    static inline void MIN_LOGGER_FUNC_ATTR Write(MinLoggerCRC msg_id, const void* payload,
+                                                  size_t payload_len, bool is_fixed_size) {
+        if (payload_len > MAX_PAYLOAD_SIZE) {
+            write_continuations<MICRO, MAX_PAYLOAD_SIZE>(msg_id, payload, payload_len);
+            return;
+        }
+        const MinLoggerIoVec part = {payload, payload_len};
+        WriteParts<MSG_BUFFER_SIZE>(msg_id, &part, 1, payload_len, is_fixed_size);
+    }
+
+    // Sends a piece from write_continuations().
+    static inline void MIN_LOGGER_FUNC_ATTR WriteContinuation(const MinLoggerIoVec* parts,
+                                                              size_t payload_len) {
+        WriteParts<MAX_MSG_SIZE>(CONTINUATION_MSG_ID, parts, MAX_PAYLOAD_PARTS, payload_len,
+                                 false);
+    }
+
+    // Sends a sync marker with the absolute time when MIN_LOGGER_MICRO_SYNC_INTERVAL has passed
+    // since the last one. The parser takes the following deltas from the marker's timestamp.
+    static inline void MIN_LOGGER_FUNC_ATTR WriteSyncIfNeeded(uint64_t timestamp) {
+    #if MIN_LOGGER_MICRO_SYNC_INTERVAL > 0
+        uint64_t last_sync = micro_last_sync_ns.load(std::memory_order_relaxed);
+        bool due = last_sync == 0 ||
+                   elapsed_since(last_sync, timestamp) >= MIN_LOGGER_MICRO_SYNC_INTERVAL;
+        // Only the thread that updates micro_last_sync_ns sends the marker.
+        if (!due || !micro_last_sync_ns.compare_exchange_strong(last_sync, timestamp)) {
+            return;
+        }
+        MicroSyncPayload sync_payload;
+        sync_payload.timestamp = timestamp;
+        // Always thread 0, so markers have a fixed size the parser can search for.
+        MicroMessageHeader header(MICRO_SYNC_MSG_ID, 0, 0, 0);
+        write_message<MicroMessageHeader, sizeof(MicroMessageHeader) + sizeof(MicroSyncPayload)>(
+            header, false, &sync_payload, sizeof(sync_payload));
+        micro_last_timestamp_ns.store(timestamp);
+    #endif
+    }
+
+    // Has the MinLoggerSerializeCallBack signature.
+    static inline void MIN_LOGGER_FUNC_ATTR Serialize(MinLoggerCRC msg_id, const void* payload,
+                                                      size_t payload_len, bool is_fixed_size) {
+        Write<MAX_MSG_SIZE>(msg_id, payload, payload_len, is_fixed_size);
+    }
+
+    // Serialize() for a fixed size payload of PAYLOAD_LEN bytes.
+    template <size_t PAYLOAD_LEN>
+    static inline void MIN_LOGGER_FUNC_ATTR SerializeValue(MinLoggerCRC msg_id,
+                                                           const void* payload) {
+        Write<sizeof(MicroMessageHeader) + TruncatedLen<PAYLOAD_LEN>::value>(msg_id, payload,
+                                                                             PAYLOAD_LEN, true);
+    }
+};
+
+// Micro format with the deltas relative to the previous message on the same thread
+// (MIN_LOGGER_MICRO_THREAD_BINARY_SERIALIZED_FORMAT). This avoids contending on a shared timestamp,
+// and the deltas are relative to the time the parser reconstructs, so truncating them doesn't
+// accumulate error. A TIME_SYNC message with the absolute timestamp is sent before a thread's
+// first message, and when the delta is too large to represent.
+struct MICRO_THREAD {
+    // Writes a message with a payload of at most MAX_PAYLOAD_SIZE bytes in num_parts parts.
+    template <size_t MSG_BUFFER_SIZE>
+    static inline void MIN_LOGGER_FUNC_ATTR WriteParts(MinLoggerCRC msg_id,
+                                                       const MinLoggerIoVec* parts,
+                                                       size_t num_parts, size_t payload_len,
+                                                       bool is_fixed_size) {
+        send_thread_name_if_needed();
+
+        uint64_t current_timestamp_ns = get_timestamp();
+        uint8_t thread_idx = min_logger_get_thread_idx();
+        uint64_t elapsed_ns = current_timestamp_ns - micro_thread_timestamp_ns;
+        // Also catches the counter wrapping, since the time will be before the last message.
+        if (micro_thread_timestamp_ns == 0 || elapsed_ns >= 1000000000000ull) {
+            const MinLoggerIoVec sync_part = {&current_timestamp_ns, sizeof(current_timestamp_ns)};
+            write_micro_message<sizeof(MicroMessageHeader) + sizeof(uint64_t)>(
+                TIME_SYNC_MSG_ID, thread_idx, std::make_pair(0u, 0u), false, &sync_part, 1,
+                sizeof(current_timestamp_ns));
+            micro_thread_timestamp_ns = current_timestamp_ns;
+            elapsed_ns = 0;
+        }
+
+        auto delta = convert_nanoseconds(elapsed_ns);
+        micro_thread_timestamp_ns += scaled_to_nanoseconds(delta);
+
+        bool add_len_prefix = !is_fixed_size && payload_len > 0;
+        write_micro_message<MSG_BUFFER_SIZE>(msg_id, thread_idx, delta, add_len_prefix, parts,
+                                             num_parts, payload_len);
+    }
+
+    template <size_t MSG_BUFFER_SIZE>
+    static inline void MIN_LOGGER_FUNC_ATTR Write(MinLoggerCRC msg_id, const void* payload,
+                                                  size_t payload_len, bool is_fixed_size) {
+        if (payload_len > MAX_PAYLOAD_SIZE) {
+            write_continuations<MICRO_THREAD, MAX_PAYLOAD_SIZE>(msg_id, payload, payload_len);
+            return;
+        }
+        const MinLoggerIoVec part = {payload, payload_len};
+        WriteParts<MSG_BUFFER_SIZE>(msg_id, &part, 1, payload_len, is_fixed_size);
+    }
+
+    // Sends a piece from write_continuations().
+    static inline void MIN_LOGGER_FUNC_ATTR WriteContinuation(const MinLoggerIoVec* parts,
+                                                              size_t payload_len) {
+        WriteParts<MAX_MSG_SIZE>(CONTINUATION_MSG_ID, parts, MAX_PAYLOAD_PARTS, payload_len,
+                                 false);
+    }
+
+    // Has the MinLoggerSerializeCallBack signature.
+    static inline void MIN_LOGGER_FUNC_ATTR Serialize(MinLoggerCRC msg_id, const void* payload,
+                                                      size_t payload_len, bool is_fixed_size) {
+        Write<MAX_MSG_SIZE>(msg_id, payload, payload_len, is_fixed_size);
+    }
+
+    // Serialize() for a fixed size payload of PAYLOAD_LEN bytes.
+    template <size_t PAYLOAD_LEN>
+    static inline void MIN_LOGGER_FUNC_ATTR SerializeValue(MinLoggerCRC msg_id,
+                                                           const void* payload) {
+        Write<sizeof(MicroMessageHeader) + TruncatedLen<PAYLOAD_LEN>::value>(msg_id, payload,
+                                                                             PAYLOAD_LEN, true);
+    }
+};
+
+    #pragma pack(1)
+struct BlockHeader {
+    static constexpr uint16_t SYNC = 0xFBBF;
+    uint16_t sync = SYNC;
+    // CRC32 of the rest of the header and the body.
+    uint32_t crc = 0;
+    uint16_t body_len = 0;
+    uint8_t thread_id = 0;
+    uint64_t base_timestamp = 0;
+};
+    #pragma pack()
+
+static_assert(MIN_LOGGER_BLOCK_SIZE >= 64 && MIN_LOGGER_BLOCK_SIZE <= 0xFFFF,
+              "MIN_LOGGER_BLOCK_SIZE must be between 64 and 65535");
+
+// A block's message IDs are cached in id % BLOCK_ID_SLOTS, and repeats reference the slot.
+static constexpr size_t BLOCK_ID_SLOTS = 32;
+// Largest size of a message in a block other than the payload: slot reference with a new ID,
+// time delta, and payload length.
+static constexpr size_t MAX_BLOCK_MSG_OVERHEAD = 1 + sizeof(MinLoggerCRC) + 10 + 2;
+static constexpr size_t BLOCK_BODY_SIZE = MIN_LOGGER_BLOCK_SIZE - sizeof(BlockHeader);
+static constexpr size_t MAX_BLOCK_PAYLOAD_SIZE =
+    (BLOCK_BODY_SIZE - MAX_BLOCK_MSG_OVERHEAD < MAX_PAYLOAD_SIZE)
+        ? BLOCK_BODY_SIZE - MAX_BLOCK_MSG_OVERHEAD
+        : MAX_PAYLOAD_SIZE;
+
+    #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+// Block being filled by a thread for the BLOCK format.
+struct BlockBuffer {
+    // Header followed by the body
+    uint8_t data[MIN_LOGGER_BLOCK_SIZE];
+    size_t body_len = 0;
+    uint64_t base_timestamp = 0;
+    uint64_t last_timestamp = 0;
+    MinLoggerCRC id_slots[BLOCK_ID_SLOTS];
+
+    // Sends the block if it has any messages.
+    void Flush();
+    ~BlockBuffer() { Flush(); }
+};
+
+extern thread_local BlockBuffer block_buffer;
+    #endif
+
+// Writes header to the start of block, with the CRC of the header and the body_len bytes after it.
+inline void MIN_LOGGER_FUNC_ATTR write_block_header(uint8_t* block, BlockHeader header) {
+    memcpy(block, &header, sizeof(header));
+    const size_t crc_start = offsetof(BlockHeader, body_len);
+    const size_t crc_len = sizeof(header) - crc_start + header.body_len;
+    header.crc = min_logger_crc::MIN_LOGGER_CRC32_BUFFER(block + crc_start, crc_len);
+    memcpy(block + offsetof(BlockHeader, crc), &header.crc, sizeof(header.crc));
+}
+
+// Writes value as a LEB128 varint, returning the end of the written bytes.
+inline uint8_t* MIN_LOGGER_FUNC_ATTR write_varint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+    #if MIN_LOGGER_ENABLE_BLOCK_FORMAT
+// Block format (MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT). Each message in a block is:
+//   varint: 0 followed by the 4 byte ID, or 1 + the ID's slot in id_slots
+//   varint: time since the previous message in the block (or base_timestamp for the first)
+//   varint: payload length
+//   payload
+struct BLOCK {
+    // Adds a message with a payload of at most MAX_BLOCK_PAYLOAD_SIZE bytes in num_parts parts.
+    static inline void MIN_LOGGER_FUNC_ATTR WriteParts(MinLoggerCRC msg_id,
+                                                       const MinLoggerIoVec* parts,
+                                                       size_t num_parts, size_t payload_len) {
+        send_thread_name_if_needed();
+
+        uint64_t timestamp = get_timestamp();
+        BlockBuffer& block = block_buffer;
+
+        if (block.body_len > 0 &&
+            (block.body_len + MAX_BLOCK_MSG_OVERHEAD + payload_len > BLOCK_BODY_SIZE ||
+             elapsed_since(block.base_timestamp, timestamp) >= MIN_LOGGER_BLOCK_MAX_AGE)) {
+            block.Flush();
+        }
+        if (block.body_len == 0) {
+            block.base_timestamp = timestamp;
+            block.last_timestamp = timestamp;
+            memset(block.id_slots, 0, sizeof(block.id_slots));
+        }
+
+        uint8_t* out = block.data + sizeof(BlockHeader) + block.body_len;
+        size_t slot = msg_id % BLOCK_ID_SLOTS;
+        if (block.id_slots[slot] == msg_id) {
+            out = write_varint(out, slot + 1);
+        } else {
+            *out++ = 0;
+            memcpy(out, &msg_id, sizeof(msg_id));
+            out += sizeof(msg_id);
+            block.id_slots[slot] = msg_id;
+        }
+        uint64_t delta = elapsed_since(block.last_timestamp, timestamp);
+        block.last_timestamp += delta;
+        out = write_varint(out, delta);
+        out = write_varint(out, payload_len);
+        for (size_t i = 0; i < num_parts; i++) {
+            if (parts[i].len > 0) {
+                memcpy(out, parts[i].data, parts[i].len);
+                out += parts[i].len;
+            }
+        }
+        block.body_len = out - (block.data + sizeof(BlockHeader));
+    }
+
+    static inline void MIN_LOGGER_FUNC_ATTR Write(MinLoggerCRC msg_id, const void* payload,
+                                                  size_t payload_len) {
+        if (payload_len > MAX_BLOCK_PAYLOAD_SIZE) {
+            write_continuations<BLOCK, MAX_BLOCK_PAYLOAD_SIZE>(msg_id, payload, payload_len);
+            return;
+        }
+        const MinLoggerIoVec part = {payload, payload_len};
+        WriteParts(msg_id, &part, 1, payload_len);
+    }
+
+    // Sends a piece from write_continuations().
+    static inline void MIN_LOGGER_FUNC_ATTR WriteContinuation(const MinLoggerIoVec* parts,
+                                                              size_t payload_len) {
+        WriteParts(CONTINUATION_MSG_ID, parts, MAX_PAYLOAD_PARTS, payload_len);
+    }
+
+    // Has the MinLoggerSerializeCallBack signature.
+    static inline void MIN_LOGGER_FUNC_ATTR Serialize(MinLoggerCRC msg_id, const void* payload,
+                                                      size_t payload_len, bool is_fixed_size) {
+        Write(msg_id, payload, payload_len);
+    }
+
+    // Serialize() for a fixed size payload of PAYLOAD_LEN bytes.
+    template <size_t PAYLOAD_LEN>
+    static inline void MIN_LOGGER_FUNC_ATTR SerializeValue(MinLoggerCRC msg_id,
+                                                           const void* payload) {
+        Write(msg_id, payload, PAYLOAD_LEN);
+    }
+};
+    #endif
+
+// Payloads from min_logger_isr_serialize() are truncated to this length.
+static constexpr size_t MAX_ISR_PAYLOAD_SIZE = (MIN_LOGGER_ISR_MAX_PAYLOAD < MAX_BLOCK_PAYLOAD_SIZE)
+                                                   ? MIN_LOGGER_ISR_MAX_PAYLOAD
+                                                   : MAX_BLOCK_PAYLOAD_SIZE;
+
+// Timestamp for a message from an interrupt. The same as get_timestamp(), except a calibration is
+// never sent, since that goes through the serialization callback.
+inline uint64_t MIN_LOGGER_FUNC_ATTR get_isr_timestamp() {
+    #if MIN_LOGGER_CYCLE_COUNTER_TIME
+    return read_cycle_counter();
+    #else
+    return min_logger_get_time_nanoseconds();
+    #endif
+}
+
+// Versions of the formats for min_logger_isr_serialize(). The message is built on the stack and
+// written with min_logger_isr_write(), without the per thread state the other serializers use.
+// Since the platform can deliver these after messages that were sent later, they all have
+// absolute timestamps. payload_len must be at most MAX_ISR_PAYLOAD_SIZE.
+struct ISR {
+    static inline void MIN_LOGGER_FUNC_ATTR WriteBinary(uint8_t thread_id, MinLoggerCRC msg_id,
+                                                        const void* payload, size_t payload_len) {
+        BinaryMsgHeader header;
+        header.msg_id = msg_id;
+        header.payload_len = payload_len;
+        header.timestamp = get_isr_timestamp();
+        header.thread_id = thread_id;
+
+        uint8_t msg_buffer[sizeof(BinaryMsgHeader) + MAX_ISR_PAYLOAD_SIZE];
+        memcpy(msg_buffer, &header, sizeof(header));
+        if (payload_len > 0) {
+            memcpy(msg_buffer + sizeof(header), payload, payload_len);
+        }
+        min_logger_isr_write(msg_buffer, sizeof(header) + payload_len);
+    }
+
+    // For MICRO and MICRO_THREAD. A TIME_SYNC sets the parser's time for thread_id, and the
+    // message follows it with no delta.
+    static inline void MIN_LOGGER_FUNC_ATTR WriteMicro(uint8_t thread_id, MinLoggerCRC msg_id,
+                                                       const void* payload, size_t payload_len,
+                                                       bool is_fixed_size) {
+        const uint64_t timestamp = get_isr_timestamp();
+        // The ISR thread IDs are all escaped.
+        const MicroEscapedHeader sync_header(TIME_SYNC_MSG_ID, thread_id, 0, 0);
+        const MicroEscapedHeader header(msg_id, thread_id, 0, 0);
+
+        uint8_t msg_buffer[sizeof(MicroEscapedHeader) * 2 + sizeof(timestamp) + 1 +
+                           MAX_ISR_PAYLOAD_SIZE];
+        uint8_t* out = msg_buffer;
+        memcpy(out, &sync_header, sizeof(sync_header));
+        out += sizeof(sync_header);
+        memcpy(out, &timestamp, sizeof(timestamp));
+        out += sizeof(timestamp);
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        if (!is_fixed_size && payload_len > 0) {
+            *out++ = static_cast<uint8_t>(payload_len);
+        }
+        if (payload_len > 0) {
+            memcpy(out, payload, payload_len);
+            out += payload_len;
+        }
+        min_logger_isr_write(msg_buffer, out - msg_buffer);
+    }
+
+    // For BLOCK. Sends a block with only this message, which starts at the block's base timestamp.
+    static inline void MIN_LOGGER_FUNC_ATTR WriteBlock(uint8_t thread_id, MinLoggerCRC msg_id,
+                                                       const void* payload, size_t payload_len) {
+        uint8_t block[sizeof(BlockHeader) + MAX_BLOCK_MSG_OVERHEAD + MAX_ISR_PAYLOAD_SIZE];
+        uint8_t* body = block + sizeof(BlockHeader);
+        uint8_t* out = body;
+        *out++ = 0;
+        memcpy(out, &msg_id, sizeof(msg_id));
+        out += sizeof(msg_id);
+        out = write_varint(out, 0);
+        out = write_varint(out, payload_len);
+        if (payload_len > 0) {
+            memcpy(out, payload, payload_len);
+            out += payload_len;
+        }
+
+        BlockHeader header;
+        header.body_len = out - body;
+        header.thread_id = thread_id;
+        header.base_timestamp = get_isr_timestamp();
+        write_block_header(block, header);
+        min_logger_isr_write(block, out - block);
+    }
+};
+
+}  // namespace min_logger_serializers
+
+#endif  // MIN_LOGGER_ENABLED
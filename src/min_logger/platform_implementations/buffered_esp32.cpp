@@ -7,7 +7,6 @@
     #include <esp_netif.h>
     #include <esp_timer.h>
     #include <freertos/FreeRTOS.h>
-    #include <freertos/event_groups.h>
     #include <freertos/task.h>
     #if MIN_LOGGER_ENABLE_UDP
         #include <lwip/inet.h>
@@ -24,10 +23,183 @@ extern "C" {
 
 static_assert((MIN_LOGGER_BUFFER_SIZE & (MIN_LOGGER_BUFFER_SIZE - 1)) == 0,
               "MIN_LOGGER_BUFFER_SIZE must be power of two");
+static_assert(MIN_LOGGER_UART_HIGH_WATER_MARK > 0 &&
+                  MIN_LOGGER_UART_HIGH_WATER_MARK < MIN_LOGGER_BUFFER_SIZE,
+              "MIN_LOGGER_UART_HIGH_WATER_MARK must be less than MIN_LOGGER_BUFFER_SIZE");
 COREDUMP_DRAM_ATTR uint8_t min_logger_buffer[MIN_LOGGER_BUFFER_SIZE];
-static constexpr uint8_t DATA_READY_BIT = (1 << 0);
-static LockFreeRingBuffer ring_buffer(min_logger_buffer, MIN_LOGGER_BUFFER_SIZE);
-static bool is_init = false;
+
+// StaticLockFreeRingBuffer NotifyPolicy that wakes the UART task once
+// MIN_LOGGER_UART_HIGH_WATER_MARK bytes have been written since it last woke.
+struct UartDrainNotify {
+    inline void Notify();
+};
+
+static StaticLockFreeRingBuffer<MIN_LOGGER_BUFFER_SIZE, UartDrainNotify> ring_buffer(
+    min_logger_buffer);
+
+// The UART task, or null if it isn't running.
+static std::atomic<TaskHandle_t> uart_task{nullptr};
+// ring_buffer.GetTotalWriteSize() when the UART task last woke.
+static std::atomic<LockFreeRingBufferIndex> uart_drained_size{0};
+// Set once the UART task is notified, so the writes until it wakes don't notify it again.
+static std::atomic<bool> uart_notified{false};
+
+void IRAM_ATTR UartDrainNotify::Notify() {
+    TaskHandle_t task = uart_task.load(std::memory_order_relaxed);
+    if (task == nullptr ||
+        LockFreeRingBufferIndex(ring_buffer.GetTotalWriteSize() -
+                                uart_drained_size.load(std::memory_order_relaxed)) <
+            MIN_LOGGER_UART_HIGH_WATER_MARK ||
+        uart_notified.load(std::memory_order_relaxed) || uart_notified.exchange(true)) {
+        return;
+    }
+    // Interrupts can write to the buffer through min_logger_write().
+    if (xPortInIsrContext()) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    } else {
+        xTaskNotifyGive(task);
+    }
+}
+
+    #if MIN_LOGGER_ISR_BUFFER_SIZE > 0
+static_assert((MIN_LOGGER_ISR_BUFFER_SIZE & (MIN_LOGGER_ISR_BUFFER_SIZE - 1)) == 0 &&
+                  MIN_LOGGER_ISR_BUFFER_SIZE < MIN_LOGGER_BUFFER_SIZE,
+              "MIN_LOGGER_ISR_BUFFER_SIZE must be a power of two less than MIN_LOGGER_BUFFER_SIZE");
+
+// Messages from the interrupts on a core. Interrupts don't contend with the tasks on the other
+// core for the main buffer, and bursts from tasks can't overwrite their messages before they're
+// merged. Writes are dropped when it's full, so the reader never sees data being overwritten.
+struct IsrBuffer {
+    uint8_t data[MIN_LOGGER_ISR_BUFFER_SIZE];
+    StaticLockFreeRingBuffer<MIN_LOGGER_ISR_BUFFER_SIZE> ring_buffer{data};
+    LockFreeRingBufferReader reader{&ring_buffer};
+};
+static IsrBuffer isr_buffers[portNUM_PROCESSORS];
+// Set while an output task is merging the ISR buffers, since each only has one reader.
+static std::atomic<bool> isr_merge_busy{false};
+
+// Copy the messages in the ISR buffers to the main buffer. Each buffer's messages are copied in a
+// single write, so they can't be interleaved with messages from tasks.
+static void merge_isr_buffers() {
+    if (isr_merge_busy.exchange(true, std::memory_order_acquire)) {
+        return;
+    }
+    for (auto& isr_buffer : isr_buffers) {
+        LockFreeRingBufferReadResults results;
+        if (!isr_buffer.reader.PeekAvailable(&results) || results.Size() == 0) {
+            continue;
+        }
+        const uint32_t size = results.Size();
+        LockFreeRingBufferReservation reservation;
+        #if MIN_LOGGER_DROP_WHEN_FULL
+        // If the main buffer is full the messages are dropped, and counted as one dropped message.
+        const bool reserved = ring_buffer.TryReserve(size, &reservation);
+        #else
+        ring_buffer.Reserve(size, &reservation);
+        const bool reserved = true;
+        #endif
+        if (reserved) {
+            reservation.Copy(0, results.part1, results.part1_size);
+            reservation.Copy(results.part1_size, results.part2, results.part2_size);
+            ring_buffer.Commit(reservation);
+        }
+        isr_buffer.reader.MarkRead(size);
+    }
+    isr_merge_busy.store(false, std::memory_order_release);
+}
+    #endif
+
+    #if MIN_LOGGER_DROP_WHEN_FULL || MIN_LOGGER_ISR_BUFFER_SIZE > 0
+// Number of dropped messages in the last report, shared by the sinks so each count is only
+// reported once.
+static std::atomic<uint32_t> reported_dropped{0};
+
+// Log the total number of dropped messages if it changed since the last report.
+static void report_dropped() {
+    uint32_t dropped_messages = ring_buffer.GetDroppedMessages();
+    uint32_t dropped_bytes = ring_buffer.GetDroppedBytes();
+        #if MIN_LOGGER_ISR_BUFFER_SIZE > 0
+    for (const auto& isr_buffer : isr_buffers) {
+        dropped_messages += isr_buffer.ring_buffer.GetDroppedMessages();
+        dropped_bytes += isr_buffer.ring_buffer.GetDroppedBytes();
+    }
+        #endif
+    if (dropped_messages != reported_dropped.load(std::memory_order_relaxed) &&
+        reported_dropped.exchange(dropped_messages) != dropped_messages) {
+        min_logger_write_dropped_count(dropped_messages, dropped_bytes);
+    }
+}
+    #endif
+
+    #if MIN_LOGGER_STAT_FLUSH_INTERVAL_MS > 0 || MIN_LOGGER_KEYFRAME_INTERVAL_MS > 0 || \
+        MIN_LOGGER_THREAD_NAMES_INTERVAL_MS > 0
+// Check if interval_ms passed since *last_ns, and if so restart the interval. Only one of the
+// sinks calling this at once sees the interval elapse.
+static bool interval_elapsed(std::atomic<uint64_t>* last_ns, uint64_t interval_ms) {
+    const uint64_t now = min_logger_get_time_nanoseconds();
+    uint64_t last = last_ns->load(std::memory_order_relaxed);
+    return now - last >= interval_ms * 1000000 && last_ns->compare_exchange_strong(last, now);
+}
+    #endif
+
+    #if MIN_LOGGER_STAT_FLUSH_INTERVAL_MS > 0
+static std::atomic<uint64_t> last_stat_flush_ns{0};
+    #endif
+    #if MIN_LOGGER_KEYFRAME_INTERVAL_MS > 0
+static std::atomic<uint64_t> last_keyframe_ns{0};
+    #endif
+    #if MIN_LOGGER_THREAD_NAMES_INTERVAL_MS > 0
+static std::atomic<uint64_t> last_thread_names_ns{0};
+    #endif
+
+// Bytes each sink lost because it fell behind and they were overwritten.
+static std::atomic<uint32_t> sink_dropped_bytes[MIN_LOGGER_NUM_SINKS];
+// Set once a sink's task is started, since each sink can only be started once.
+static std::atomic<bool> sink_started[MIN_LOGGER_NUM_SINKS];
+
+// Work done by whichever sink task wakes first each interval, before it reads the buffer.
+static void run_sink_housekeeping() {
+    #if MIN_LOGGER_DROP_WHEN_FULL || MIN_LOGGER_ISR_BUFFER_SIZE > 0
+    report_dropped();
+    #endif
+    #if MIN_LOGGER_STAT_FLUSH_INTERVAL_MS > 0
+    if (interval_elapsed(&last_stat_flush_ns, MIN_LOGGER_STAT_FLUSH_INTERVAL_MS)) {
+        min_logger_flush_stats();
+    }
+    #endif
+    #if MIN_LOGGER_KEYFRAME_INTERVAL_MS > 0
+    if (interval_elapsed(&last_keyframe_ns, MIN_LOGGER_KEYFRAME_INTERVAL_MS)) {
+        min_logger_request_keyframe();
+    }
+    #endif
+    #if MIN_LOGGER_THREAD_NAMES_INTERVAL_MS > 0
+    if (interval_elapsed(&last_thread_names_ns, MIN_LOGGER_THREAD_NAMES_INTERVAL_MS)) {
+        min_logger_resend_thread_names();
+    }
+    #endif
+    #if MIN_LOGGER_ISR_BUFFER_SIZE > 0
+    merge_isr_buffers();
+    #endif
+}
+
+// Creates the reader for a sink's task. Each sink has its own reader, so a slow sink only loses
+// its own data, unless MIN_LOGGER_DROP_WHEN_FULL has the slowest sink hold back new writes.
+static LockFreeRingBufferReader make_sink_reader(MinLoggerSink sink) {
+    LockFreeRingBufferReader reader(&ring_buffer);
+    reader.SetOverflowFunc([sink](uint64_t lost_bytes, uint64_t buffer_size) {
+        sink_dropped_bytes[sink] += lost_bytes;
+    });
+    return reader;
+}
+
+// Marks a sink as started. Returns false if it already was.
+static bool start_sink(MinLoggerSink sink) { return !sink_started[sink].exchange(true); }
+
+uint32_t min_logger_get_sink_dropped_bytes(MinLoggerSink sink) {
+    return sink_dropped_bytes[sink].load(std::memory_order_relaxed);
+}
 
     #if MIN_LOGGER_ENABLE_UDP
 
@@ -38,12 +210,29 @@ struct UDPParameters {
     size_t udp_message_size;
 };
 
+// Sends the first size bytes of results as one packet. Data that wraps around the end of the
+// buffer is gathered by the network stack, so it doesn't need to be copied first.
+static int send_packet(int sock, const struct sockaddr_in* dest_addr,
+                       const LockFreeRingBufferReadResults& results, size_t size) {
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)results.part1;
+    iov[0].iov_len = (size < results.part1_size) ? size : results.part1_size;
+    iov[1].iov_base = (void*)results.part2;
+    iov[1].iov_len = size - iov[0].iov_len;
+    struct msghdr msg = {};
+    msg.msg_name = (void*)dest_addr;
+    msg.msg_namelen = sizeof(*dest_addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (iov[1].iov_len > 0) ? 2 : 1;
+    return sendmsg(sock, &msg, 0);
+}
+
 // https://github.com/espressif/esp-idf/tree/master/examples/protocols/sockets/udp_client
 static void min_logger_udp_client_task(void* pvParameters) {
     auto parameters = reinterpret_cast<const UDPParameters*>(pvParameters);
     const size_t udp_message_size = parameters->udp_message_size;
 
-    LockFreeRingBufferReader reader(&ring_buffer);
+    LockFreeRingBufferReader reader = make_sink_reader(MIN_LOGGER_SINK_UDP);
     LockFreeRingBufferReadResults results;
 
     struct sockaddr_in dest_addr;
@@ -51,36 +240,32 @@ static void min_logger_udp_client_task(void* pvParameters) {
     dest_addr.sin_family = AF_INET;
     dest_addr.sin_port = htons(parameters->port);
     bool udp_up = false;
-    bool buffer_misaligned = false;
+    // Time the data left in the buffer has been waiting since.
+    uint64_t waiting_since_ns = min_logger_get_time_nanoseconds();
 
     esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
 
     int sock = -1;
 
     while (1) {
+        run_sink_housekeeping();
         if (!reader.PeekAvailable(&results)) {
             ESP_LOGE(TAG, "Fell behind");
-            buffer_misaligned = true;
             continue;
         }
-        // Check if a UDP packet's worth of data is ready to send.
-        if (results.Size() >= udp_message_size) {
-            // After dropping data, realign buffer.
-            if (buffer_misaligned) {
-                // The read tore, so move read head to start of buffer.
-                if (results.part1_size < udp_message_size) {
-                    if (!reader.MarkRead(results.part1_size)) {
-                        ESP_LOGE(TAG, "Fell behind");
-                    } else {
-                        buffer_misaligned = false;
-                    }
-                    continue;
-                }
-            } else {
-                // Since reads are always udp_message_size, and buffer is multiple
-                // of udp_message_size, should never need to tear read.
-                assert(results.part1_size >= udp_message_size);
-            }
+
+        // Send every full packet that's ready. The rest is sent as a partial packet once it's
+        // waited MIN_LOGGER_UDP_MAX_LATENCY_MS, so logs don't sit in the buffer at low rates.
+        const uint64_t now = min_logger_get_time_nanoseconds();
+        if (results.Size() == 0) {
+            waiting_since_ns = now;
+        }
+        const bool flush = now - waiting_since_ns >= MIN_LOGGER_UDP_MAX_LATENCY_MS * 1000000ull;
+        size_t sent = 0;
+        while (results.Size() - sent >= udp_message_size || (flush && results.Size() > sent)) {
+            const size_t packet_size = (results.Size() - sent < udp_message_size)
+                                           ? results.Size() - sent
+                                           : udp_message_size;
 
             // Open Socket if needed.
             if (sock == -1) {
@@ -93,13 +278,9 @@ static void min_logger_udp_client_task(void* pvParameters) {
 
             int err = 0;
             if (sock != -1) {
-                err = sendto(sock, results.part1, udp_message_size, 0, (struct sockaddr*)&dest_addr,
-                             sizeof(dest_addr));
-            }
-            if (!reader.MarkRead(udp_message_size)) {
-                ESP_LOGE(TAG, "Fell behind");
-                buffer_misaligned = true;
+                err = send_packet(sock, &dest_addr, results.AddOffset(sent), packet_size);
             }
+            sent += packet_size;
             if (err < 0) {
                 if (udp_up) {
                     if (errno == 12) {
@@ -117,36 +298,53 @@ static void min_logger_udp_client_task(void* pvParameters) {
                 udp_up = true;
             }
         }
+        if (sent > 0) {
+            waiting_since_ns = now;
+            if (!reader.MarkRead(sent)) {
+                ESP_LOGE(TAG, "Fell behind");
+            }
+        }
         vTaskDelay(parameters->poll_interval_ms / portTICK_PERIOD_MS);
     }
 }
 
 void min_logger_init_udp(size_t packet_size, unsigned poll_interval_ms, const char* logging_udp_ip,
                          uint16_t logging_udp_port) {
-    // buffer must be multiple of packet size.
-    assert(MIN_LOGGER_BUFFER_SIZE > packet_size);
-    assert(MIN_LOGGER_BUFFER_SIZE % packet_size == 0);
+    assert(packet_size > 0 && MIN_LOGGER_BUFFER_SIZE > packet_size);
     // Can't init twice
-    assert(!is_init);
+    if (!start_sink(MIN_LOGGER_SINK_UDP)) {
+        ESP_LOGE(TAG, "UDP output already started");
+        return;
+    }
     static UDPParameters parameters{.hostname = logging_udp_ip,
                                     .port = logging_udp_port,
                                     .poll_interval_ms = poll_interval_ms,
                                     .udp_message_size = packet_size};
-    xTaskCreate(min_logger_udp_client_task, "min_logger_udp", 2048, &parameters, 1, NULL);
+    xTaskCreate(min_logger_udp_client_task, "min_logger_udp", MIN_LOGGER_SINK_TASK_STACK,
+                &parameters, 1, NULL);
 }
 
     #endif
 
 static void min_logger_uart_task(void* pvParameters) {
     auto uart_num = *reinterpret_cast<const uart_port_t*>(pvParameters);
-    LockFreeRingBufferReader reader(&ring_buffer);
+    LockFreeRingBufferReader reader = make_sink_reader(MIN_LOGGER_SINK_UART);
     LockFreeRingBufferReadResults results;
     while (1) {
+        run_sink_housekeeping();
+        // Everything written up to here is sent below, so writes notify again once another
+        // MIN_LOGGER_UART_HIGH_WATER_MARK bytes are waiting. A notification that comes in before
+        // ulTaskNotifyTake() is kept, so it isn't missed.
+        uart_notified.store(false);
+        uart_drained_size.store(ring_buffer.GetTotalWriteSize());
         if (!reader.PeekAvailable(&results)) {
             ESP_LOGE(TAG, "Fell behind");
             continue;
         }
 
+        // uart_write_bytes() copies the data into the driver's TX ring buffer, so with the driver
+        // installed with a large enough TX buffer this doesn't wait for the data to be sent. The
+        // data is only split into two writes when it wraps around the end of the buffer.
         if (results.part1_size > 0) {
             uart_write_bytes(uart_num, results.part1, results.part1_size);
             if (results.part2_size > 0) {
@@ -158,21 +356,105 @@ static void min_logger_uart_task(void* pvParameters) {
             ESP_LOGE(TAG, "Fell behind");
         }
 
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MIN_LOGGER_UART_MAX_LATENCY_MS));
     }
 }
 
 void min_logger_init_uart(unsigned uart_num) {
     // Can't init twice
-    assert(!is_init);
+    if (!start_sink(MIN_LOGGER_SINK_UART)) {
+        ESP_LOGE(TAG, "UART output already started");
+        return;
+    }
     static uart_port_t static_uart_num = (uart_port_t)uart_num;
-    xTaskCreate(min_logger_uart_task, "min_logger_uart", 1024, &static_uart_num, 1, NULL);
+    TaskHandle_t task = NULL;
+    xTaskCreate(min_logger_uart_task, "min_logger_uart", MIN_LOGGER_SINK_TASK_STACK,
+                &static_uart_num, 1, &task);
+    uart_task.store(task);
+}
+
+struct CallbackParameters {
+    MinLoggerSinkCallback callback;
+    void* context;
+    unsigned poll_interval_ms;
+};
+
+static void min_logger_callback_task(void* pvParameters) {
+    auto parameters = reinterpret_cast<const CallbackParameters*>(pvParameters);
+    LockFreeRingBufferReader reader = make_sink_reader(MIN_LOGGER_SINK_CALLBACK);
+    LockFreeRingBufferReadResults results;
+    while (1) {
+        run_sink_housekeeping();
+        if (!reader.PeekAvailable(&results)) {
+            ESP_LOGE(TAG, "Fell behind");
+            continue;
+        }
+
+        if (results.part1_size > 0) {
+            parameters->callback(results.part1, results.part1_size, parameters->context);
+            if (results.part2_size > 0) {
+                parameters->callback(results.part2, results.part2_size, parameters->context);
+            }
+        }
+
+        if (!reader.MarkRead(results.Size())) {
+            ESP_LOGE(TAG, "Fell behind");
+        }
+
+        vTaskDelay(parameters->poll_interval_ms / portTICK_PERIOD_MS);
+    }
+}
+
+void min_logger_init_callback(MinLoggerSinkCallback callback, void* context,
+                              unsigned poll_interval_ms) {
+    // Can't init twice
+    if (!start_sink(MIN_LOGGER_SINK_CALLBACK)) {
+        ESP_LOGE(TAG, "Callback output already started");
+        return;
+    }
+    static CallbackParameters parameters{
+        .callback = callback, .context = context, .poll_interval_ms = poll_interval_ms};
+    xTaskCreate(min_logger_callback_task, "min_logger_cb", MIN_LOGGER_SINK_TASK_STACK, &parameters,
+                1, NULL);
 }
 
 void IRAM_ATTR min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    #if MIN_LOGGER_DROP_WHEN_FULL
+    ring_buffer.TryWrite(msg, len_bytes);
+    #else
     ring_buffer.Write(msg, len_bytes);
+    #endif
+}
+
+bool IRAM_ATTR min_logger_write_reserve(size_t len_bytes, MinLoggerWriteReservation* reservation) {
+    LockFreeRingBufferReservation ring_reservation;
+    #if MIN_LOGGER_DROP_WHEN_FULL
+    // If the message is dropped the reservation is left empty.
+    ring_buffer.TryReserve(len_bytes, &ring_reservation);
+    #else
+    ring_buffer.Reserve(len_bytes, &ring_reservation);
+    #endif
+    reservation->part1 = ring_reservation.part1;
+    reservation->part1_size = ring_reservation.part1_size;
+    reservation->part2 = ring_reservation.part2;
+    reservation->part2_size = ring_reservation.part2_size;
+    reservation->context_id = ring_reservation.write_slot;
+    reservation->context = nullptr;
+    return true;
+}
+
+void IRAM_ATTR min_logger_write_commit(MinLoggerWriteReservation* reservation) {
+    LockFreeRingBufferReservation ring_reservation;
+    ring_reservation.write_slot = reservation->context_id;
+    ring_buffer.Commit(ring_reservation);
 }
 
+    #if MIN_LOGGER_ISR_BUFFER_SIZE > 0
+void IRAM_ATTR min_logger_isr_write(const uint8_t* msg, size_t len_bytes) {
+    isr_buffers[xPortGetCoreID()].ring_buffer.TryWrite(msg, len_bytes);
+}
+    #endif
+
     #ifdef __cplusplus
 }
     #endif
@@ -0,0 +1,460 @@
+#include "../min_logger.h"
+
+#if MIN_LOGGER_ENABLED && defined(MIN_LOGGER_BUFFERED_POSIX_PLATFORM)
+
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <sys/mman.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+
+    #include <atomic>
+    #include <cerrno>
+    #include <chrono>
+    #include <condition_variable>
+    #include <cstdio>
+    #include <cstdlib>
+    #include <cstring>
+    #include <mutex>
+    #include <new>
+    #include <thread>
+    #include <type_traits>
+    #include <vector>
+
+    #include "lock_free_ring_buffer.h"
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+static_assert((MIN_LOGGER_BUFFER_SIZE & (MIN_LOGGER_BUFFER_SIZE - 1)) == 0,
+              "MIN_LOGGER_BUFFER_SIZE must be power of two");
+static_assert((MIN_LOGGER_BUFFER_SHARDS & (MIN_LOGGER_BUFFER_SHARDS - 1)) == 0,
+              "MIN_LOGGER_BUFFER_SHARDS must be power of two");
+static constexpr uint32_t SHARD_SIZE = MIN_LOGGER_BUFFER_SIZE / MIN_LOGGER_BUFFER_SHARDS;
+static_assert(SHARD_SIZE >= 1024, "MIN_LOGGER_BUFFER_SIZE too small for MIN_LOGGER_BUFFER_SHARDS");
+uint8_t min_logger_buffer[MIN_LOGGER_BUFFER_SIZE];
+typedef StaticLockFreeRingBuffer<SHARD_SIZE> ShardRingBuffer;
+
+// Each shard's write counters are on their own cache line so writers on different shards don't
+// contend.
+struct alignas(64) BufferShard {
+    explicit BufferShard(uint8_t* data) : ring_buffer(data) {}
+    ShardRingBuffer ring_buffer;
+};
+
+static std::aligned_storage<sizeof(BufferShard), alignof(BufferShard)>::type
+    shard_storage[MIN_LOGGER_BUFFER_SHARDS];
+
+static bool init_shards(BufferShard* shards) {
+    for (size_t i = 0; i < MIN_LOGGER_BUFFER_SHARDS; i++) {
+        new (&shards[i]) BufferShard(min_logger_buffer + i * SHARD_SIZE);
+    }
+    return true;
+}
+
+// The shards in shard_storage are built on first use instead of by a static initializer, since
+// static constructors in other translation units may log before this file's initializers run.
+static BufferShard* get_static_shards() {
+    BufferShard* shards = reinterpret_cast<BufferShard*>(shard_storage);
+    static const bool shards_ready = init_shards(shards);
+    (void)shards_ready;
+    return shards;
+}
+
+static_assert(sizeof(MinLoggerMmapHeader) == 88, "min-logger-extract expects an 88 byte header");
+// Shards in the file mapped by min_logger_init_mmap(), or null before it's called.
+static std::atomic<BufferShard*> mapped_shards = {nullptr};
+
+static BufferShard* get_shards() {
+    BufferShard* shards = mapped_shards.load(std::memory_order_acquire);
+    return (shards != nullptr) ? shards : get_static_shards();
+}
+
+struct DrainState {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    // Created before the thread starts so backpressure applies as soon as the logger is
+    // initialized.
+    std::vector<LockFreeRingBufferReader> readers;
+    int fd = -1;
+    unsigned poll_interval_ms = 10;
+    bool stop = false;
+    // Flush requests are acknowledged once the drain has written everything reserved before it saw
+    // the request.
+    uint64_t flush_requested = 0;
+    uint64_t flush_completed = 0;
+};
+
+static DrainState drain_state;
+static std::atomic<bool> is_init = {false};
+
+// Write both parts of a read, retrying short writes. Returns false on an unrecoverable error, or if
+// non-blocking output stays full for MIN_LOGGER_FLUSH_TIMEOUT_MS.
+static bool write_all(int fd, const LockFreeRingBufferReadResults& results) {
+    struct iovec iov[2] = {{const_cast<uint8_t*>(results.part1), results.part1_size},
+                           {const_cast<uint8_t*>(results.part2), results.part2_size}};
+    struct iovec* cur = iov;
+    int count = (results.part2_size > 0) ? 2 : 1;
+    while (count > 0) {
+        ssize_t written = writev(fd, cur, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Non-blocking output is full. Wait for it to drain instead of retrying hot.
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                int ready = poll(&pfd, 1, MIN_LOGGER_FLUSH_TIMEOUT_MS);
+                if (ready > 0 || (ready < 0 && errno == EINTR)) {
+                    continue;
+                }
+                if (ready == 0) {
+                    errno = EAGAIN;
+                }
+            }
+            return false;
+        }
+        if (written == 0) {
+            // Nothing was written for a non-empty write, so retrying won't make progress.
+            errno = EIO;
+            return false;
+        }
+        size_t remaining = static_cast<size_t>(written);
+        while (count > 0 && remaining >= cur->iov_len) {
+            remaining -= cur->iov_len;
+            cur++;
+            count--;
+        }
+        if (count > 0) {
+            cur->iov_base = static_cast<uint8_t*>(cur->iov_base) + remaining;
+            cur->iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+    #if MIN_LOGGER_DROP_WHEN_FULL
+// Log the total number of dropped messages if it changed since the last report.
+static void report_dropped(uint32_t* reported_messages) {
+    uint32_t dropped_messages = 0;
+    uint32_t dropped_bytes = 0;
+    BufferShard* shards = get_shards();
+    for (size_t i = 0; i < MIN_LOGGER_BUFFER_SHARDS; i++) {
+        dropped_messages += shards[i].ring_buffer.GetDroppedMessages();
+        dropped_bytes += shards[i].ring_buffer.GetDroppedBytes();
+    }
+    if (dropped_messages != *reported_messages) {
+        *reported_messages = dropped_messages;
+        min_logger_write_dropped_count(dropped_messages, dropped_bytes);
+    }
+}
+    #endif
+
+    #if MIN_LOGGER_STAT_FLUSH_INTERVAL_MS > 0 || MIN_LOGGER_KEYFRAME_INTERVAL_MS > 0 || \
+        MIN_LOGGER_THREAD_NAMES_INTERVAL_MS > 0
+// Check if interval_ms passed since *last_ns, and if so restart the interval.
+static bool interval_elapsed(uint64_t* last_ns, uint64_t interval_ms) {
+    const uint64_t now = min_logger_get_time_nanoseconds();
+    if (now - *last_ns < interval_ms * 1000000) {
+        return false;
+    }
+    *last_ns = now;
+    return true;
+}
+    #endif
+
+static void min_logger_drain_task() {
+    pthread_setname_np(pthread_self(), "min_logger");
+    LockFreeRingBufferReadResults results;
+    bool write_failed = false;
+    #if MIN_LOGGER_DROP_WHEN_FULL
+    uint32_t reported_dropped = 0;
+    #endif
+    #if MIN_LOGGER_STAT_FLUSH_INTERVAL_MS > 0
+    uint64_t last_stat_flush_ns = min_logger_get_time_nanoseconds();
+    #endif
+    #if MIN_LOGGER_KEYFRAME_INTERVAL_MS > 0
+    uint64_t last_keyframe_ns = min_logger_get_time_nanoseconds();
+    #endif
+    #if MIN_LOGGER_THREAD_NAMES_INTERVAL_MS > 0
+    uint64_t last_thread_names_ns = min_logger_get_time_nanoseconds();
+    #endif
+    // The flush request or stop being waited on, and each shard's write total when it was seen.
+    uint64_t flush_target_request = 0;
+    bool stop_target = false;
+    uint64_t flush_targets[MIN_LOGGER_BUFFER_SHARDS] = {};
+    uint64_t flush_deadline_ns = 0;
+
+    std::unique_lock<std::mutex> lock(drain_state.mutex);
+    while (true) {
+        uint64_t flush_requested = drain_state.flush_requested;
+        bool stop = drain_state.stop;
+        lock.unlock();
+
+    #if MIN_LOGGER_DROP_WHEN_FULL
+        // Reported before reading so the report goes out in this pass.
+        report_dropped(&reported_dropped);
+    #endif
+    #if MIN_LOGGER_STAT_FLUSH_INTERVAL_MS > 0
+        // Flush what's left on the last pass so it isn't lost at shutdown.
+        if ((stop && !stop_target) ||
+            interval_elapsed(&last_stat_flush_ns, MIN_LOGGER_STAT_FLUSH_INTERVAL_MS)) {
+            min_logger_flush_stats();
+        }
+    #endif
+    #if MIN_LOGGER_KEYFRAME_INTERVAL_MS > 0
+        if (interval_elapsed(&last_keyframe_ns, MIN_LOGGER_KEYFRAME_INTERVAL_MS)) {
+            min_logger_request_keyframe();
+        }
+    #endif
+    #if MIN_LOGGER_THREAD_NAMES_INTERVAL_MS > 0
+        if (interval_elapsed(&last_thread_names_ns, MIN_LOGGER_THREAD_NAMES_INTERVAL_MS)) {
+            min_logger_resend_thread_names();
+        }
+    #endif
+
+        // Take the targets after the messages above are written so they're included. Any write
+        // the flushing thread finished is reserved by now, so it's before its shard's target.
+        if (flush_requested > flush_target_request || stop != stop_target) {
+            for (size_t i = 0; i < MIN_LOGGER_BUFFER_SHARDS; i++) {
+                flush_targets[i] = drain_state.readers[i].GetWriteTotal();
+            }
+            flush_target_request = flush_requested;
+            stop_target = stop;
+            flush_deadline_ns =
+                min_logger_get_time_nanoseconds() + uint64_t(MIN_LOGGER_FLUSH_TIMEOUT_MS) * 1000000;
+        }
+
+        // Each shard is written out as a separate run of whole messages. Messages from different
+        // shards can end up out of timestamp order, but each thread's messages stay in order.
+        size_t total_read = 0;
+        for (auto& reader : drain_state.readers) {
+            if (!reader.PeekAvailable(&results)) {
+                fprintf(stderr, "min-logger: Fell behind\n");
+            }
+
+            if (results.Size() > 0) {
+                if (!write_failed && !write_all(drain_state.fd, results)) {
+                    // Keep draining so writers don't see stale data, but stop trying to output.
+                    fprintf(stderr, "min-logger: Error occurred during write: errno %d\n", errno);
+                    write_failed = true;
+                }
+                if (!reader.MarkRead(results.Size())) {
+                    fprintf(stderr, "min-logger: Fell behind\n");
+                }
+                total_read += results.Size();
+            }
+        }
+
+        // Readers only see data up to the oldest write in progress, so a write reserved before the
+        // request can hold back later data until it's committed.
+        bool reached_targets = true;
+        for (size_t i = 0; i < MIN_LOGGER_BUFFER_SHARDS; i++) {
+            if (drain_state.readers[i].GetReadPosition() < flush_targets[i]) {
+                reached_targets = false;
+            }
+        }
+        if (!reached_targets && (flush_target_request > 0 || stop_target) &&
+            min_logger_get_time_nanoseconds() >= flush_deadline_ns) {
+            fprintf(stderr, "min-logger: Timed out flushing a write still in progress\n");
+            reached_targets = true;
+        }
+
+        lock.lock();
+        if (reached_targets) {
+            if (flush_target_request > drain_state.flush_completed) {
+                drain_state.flush_completed = flush_target_request;
+                drain_state.flushed.notify_all();
+            }
+            if (stop_target) {
+                break;
+            }
+        }
+        if (drain_state.flush_requested != flush_requested || drain_state.stop != stop) {
+            continue;
+        }
+        if (!reached_targets) {
+            // Poll for the write in progress to be committed.
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        } else if (total_read == 0) {
+            // Only sleep once the buffer has been emptied.
+            drain_state.wake.wait_for(lock,
+                                      std::chrono::milliseconds(drain_state.poll_interval_ms));
+        }
+    }
+}
+
+bool min_logger_init_fd(int fd, unsigned poll_interval_ms) {
+    bool expected = false;
+    // Can't init twice
+    if (fd < 0 || !is_init.compare_exchange_strong(expected, true)) {
+        return false;
+    }
+    drain_state.fd = fd;
+    drain_state.poll_interval_ms = poll_interval_ms;
+    drain_state.readers.reserve(MIN_LOGGER_BUFFER_SHARDS);
+    BufferShard* shards = get_shards();
+    for (size_t i = 0; i < MIN_LOGGER_BUFFER_SHARDS; i++) {
+        drain_state.readers.emplace_back(&shards[i].ring_buffer,
+                                         []() { std::this_thread::yield(); });
+    }
+    drain_state.thread = std::thread(min_logger_drain_task);
+    atexit(min_logger_stop);
+    return true;
+}
+
+bool min_logger_init_file(const char* path, unsigned poll_interval_ms) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (!min_logger_init_fd(fd, poll_interval_ms)) {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+// Rounds value up to a multiple of alignment.
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool min_logger_init_mmap(const char* path) {
+    static std::atomic<bool> is_mapped = {false};
+    bool expected = false;
+    // Once the drain is running its readers are on the static shards.
+    if (is_init || !is_mapped.compare_exchange_strong(expected, true)) {
+        return false;
+    }
+
+    // The ring buffers follow the header, and the data starts on the next page.
+    const size_t ring_buffer_offset = align_up(sizeof(MinLoggerMmapHeader), alignof(BufferShard));
+    const size_t data_offset =
+        align_up(ring_buffer_offset + MIN_LOGGER_BUFFER_SHARDS * sizeof(BufferShard),
+                 static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+    const size_t file_size = data_offset + MIN_LOGGER_BUFFER_SIZE;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        is_mapped = false;
+        return false;
+    }
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, file_size) == 0) {
+        mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    // The mapping stays valid after the file is closed.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        is_mapped = false;
+        return false;
+    }
+
+    // The file starts zeroed, so the magic isn't set until the header is filled in.
+    uint8_t* base = static_cast<uint8_t*>(mapping);
+    auto header = reinterpret_cast<MinLoggerMmapHeader*>(base);
+    BufferShard* shards = reinterpret_cast<BufferShard*>(base + ring_buffer_offset);
+    for (size_t i = 0; i < MIN_LOGGER_BUFFER_SHARDS; i++) {
+        new (&shards[i]) BufferShard(base + data_offset + i * SHARD_SIZE);
+    }
+    header->version = MIN_LOGGER_MMAP_VERSION;
+    header->num_shards = MIN_LOGGER_BUFFER_SHARDS;
+    header->shard_size = SHARD_SIZE;
+    header->index_size = sizeof(LockFreeRingBufferIndex);
+    header->ring_buffer_offset = reinterpret_cast<uint8_t*>(&shards[0].ring_buffer) - base;
+    header->ring_buffer_stride = sizeof(BufferShard);
+    header->ring_buffer_size = sizeof(ShardRingBuffer);
+    header->write_size_offset = shards[0].ring_buffer.GetTotalWriteSizeOffset();
+    header->data_offset = data_offset;
+    header->pid = static_cast<uint32_t>(getpid());
+    const char* format = min_logger_get_serialize_format_name();
+    if (format != nullptr) {
+        strncpy(header->format, format, sizeof(header->format) - 1);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, MIN_LOGGER_MMAP_MAGIC, sizeof(header->magic));
+
+    mapped_shards.store(shards, std::memory_order_release);
+    return true;
+}
+
+void min_logger_flush() {
+    std::unique_lock<std::mutex> lock(drain_state.mutex);
+    if (!drain_state.thread.joinable() || drain_state.stop) {
+        return;
+    }
+    uint64_t request = ++drain_state.flush_requested;
+    drain_state.wake.notify_all();
+    drain_state.flushed.wait(lock, [request]() {
+        return drain_state.flush_completed >= request || drain_state.stop;
+    });
+}
+
+void min_logger_stop() {
+    {
+        std::lock_guard<std::mutex> lock(drain_state.mutex);
+        if (!drain_state.thread.joinable() || drain_state.stop) {
+            return;
+        }
+        // The drain does one last pass through the buffer after seeing stop.
+        drain_state.stop = true;
+        drain_state.wake.notify_all();
+    }
+    drain_state.thread.join();
+    // Unregister the readers, so with MIN_LOGGER_DROP_WHEN_FULL later writes overwrite old data
+    // instead of being dropped for a reader that's gone.
+    drain_state.readers.clear();
+}
+
+static ShardRingBuffer* get_write_ring_buffer() {
+    #if MIN_LOGGER_BUFFER_SHARDS > 1
+    return &get_shards()[min_logger_get_thread_idx() & (MIN_LOGGER_BUFFER_SHARDS - 1)].ring_buffer;
+    #else
+    return &get_shards()[0].ring_buffer;
+    #endif
+}
+
+void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    #if MIN_LOGGER_DROP_WHEN_FULL
+    get_write_ring_buffer()->TryWrite(msg, len_bytes);
+    #else
+    get_write_ring_buffer()->Write(msg, len_bytes);
+    #endif
+}
+
+bool min_logger_write_reserve(size_t len_bytes, MinLoggerWriteReservation* reservation) {
+    ShardRingBuffer* ring_buffer = get_write_ring_buffer();
+    LockFreeRingBufferReservation ring_reservation;
+    #if MIN_LOGGER_DROP_WHEN_FULL
+    // If the message is dropped the reservation is left empty.
+    ring_buffer->TryReserve(len_bytes, &ring_reservation);
+    #else
+    ring_buffer->Reserve(len_bytes, &ring_reservation);
+    #endif
+    reservation->part1 = ring_reservation.part1;
+    reservation->part1_size = ring_reservation.part1_size;
+    reservation->part2 = ring_reservation.part2;
+    reservation->part2_size = ring_reservation.part2_size;
+    reservation->context_id = ring_reservation.write_slot;
+    reservation->context = ring_buffer;
+    return true;
+}
+
+void min_logger_write_commit(MinLoggerWriteReservation* reservation) {
+    LockFreeRingBufferReservation ring_reservation;
+    ring_reservation.write_slot = reservation->context_id;
+    static_cast<ShardRingBuffer*>(reservation->context)->Commit(ring_reservation);
+}
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif
@@ -33,6 +33,25 @@ void __attribute__((weak)) IRAM_ATTR min_logger_write(const uint8_t* msg, size_t
     uart_write_bytes(UART_NUM_0, msg, len_bytes);
 }
 
+bool __attribute__((weak)) IRAM_ATTR
+min_logger_write_reserve(size_t len_bytes, MinLoggerWriteReservation* reservation) {
+    return false;
+}
+
+void __attribute__((weak)) IRAM_ATTR
+min_logger_write_commit(MinLoggerWriteReservation* reservation) {}
+
+bool __attribute__((weak)) IRAM_ATTR min_logger_writev(const MinLoggerIoVec* iov,
+                                                       size_t iov_count) {
+    return false;
+}
+
+unsigned __attribute__((weak)) IRAM_ATTR min_logger_get_core_id() { return xPortGetCoreID(); }
+
+void __attribute__((weak)) IRAM_ATTR min_logger_isr_write(const uint8_t* msg, size_t len_bytes) {
+    min_logger_write(msg, len_bytes);
+}
+
     ////////////////////////////////////// Posix //////////////////////////////////////////////////
     #else
 
@@ -52,6 +71,23 @@ uint64_t __attribute__((weak)) min_logger_get_time_nanoseconds() {
 void __attribute__((weak)) min_logger_write(const uint8_t* msg, size_t len_bytes) {
     fwrite(msg, sizeof(uint8_t), len_bytes, stdout);
 }
+
+bool __attribute__((weak)) min_logger_write_reserve(size_t len_bytes,
+                                                    MinLoggerWriteReservation* reservation) {
+    return false;
+}
+
+void __attribute__((weak)) min_logger_write_commit(MinLoggerWriteReservation* reservation) {}
+
+bool __attribute__((weak)) min_logger_writev(const MinLoggerIoVec* iov, size_t iov_count) {
+    return false;
+}
+
+unsigned __attribute__((weak)) min_logger_get_core_id() { return 0; }
+
+void __attribute__((weak)) min_logger_isr_write(const uint8_t* msg, size_t len_bytes) {
+    min_logger_write(msg, len_bytes);
+}
     #endif
 
     #ifdef __cplusplus
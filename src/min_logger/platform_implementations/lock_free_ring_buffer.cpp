@@ -12,44 +12,92 @@ constexpr bool is_always_lock_free() {
 static constexpr uint64_t MASK_LOWER_32BITS = 0xFFFFFFFF;
 static constexpr uint64_t MASK_UPPER_32BITS = MASK_LOWER_32BITS << uint64_t(32);
 static constexpr uint64_t OVERFLOW_32BITS = MASK_LOWER_32BITS + uint64_t(1);
-LockFreeRingBuffer::LockFreeRingBuffer(void* buffer, uint32_t buffer_size,
-                                       const std::function<void()>& data_callback)
-    : buffer_((uint8_t*)buffer), buffer_size_(buffer_size), data_callback_(data_callback) {
-    static_assert(is_always_lock_free<uint32_t>(), "Requires lock free indexing variables");
+constexpr LockFreeRingBufferIndex LockFreeRingBufferBase::INDEX_HALF_RANGE;
+
+LockFreeRingBufferBase::LockFreeRingBufferBase(void* buffer, uint32_t buffer_size)
+    : buffer_offset_(reinterpret_cast<uint8_t*>(buffer) - reinterpret_cast<uint8_t*>(this)),
+      buffer_size_(buffer_size) {
+    static_assert(is_always_lock_free<LockFreeRingBufferIndex>(),
+                  "Requires lock free indexing variables");
     assert(buffer_size_ > 0);
-    // Handle total_write_size_ overflow without needing atomic modulo if buffer size is power
-    // of 2.
-    assert((buffer_size_ & (buffer_size_ - 1)) == 0);
+    // Handle 32bit total_write_size_ overflow without needing atomic modulo if buffer size is
+    // power of 2.
+    assert(HAS_64BIT_INDEX || (buffer_size_ & (buffer_size_ - 1)) == 0);
+    for (auto& start : write_slot_starts_) {
+        start = 0;
+    }
+    for (auto& tail : reader_tails_) {
+        tail = 0;
+    }
 }
 
-void LockFreeRingBuffer::Write(const void* data, uint32_t data_len) {
-    assert(data_len < buffer_size_);
+uint32_t LockFreeRingBufferBase::GetDroppedMessages() const { return dropped_messages_; }
 
-    // Indicate that there are outstanding writes ongoing.
-    active_writers_++;
+uint32_t LockFreeRingBufferBase::GetDroppedBytes() const { return dropped_bytes_; }
 
-    // Based on the number of bytes written previously, get the current write pointer.
-    // At the same time update the number of bytes written to include this new data.
-    // The data can't be counted on to be finished writen until active_writers_ is zero.
-    // Since the buffer size is a power of two, when total_write_size_ overflows it will
-    // still align correctly to the buffer offset.
-    uint32_t old_size = total_write_size_.fetch_add(data_len);
-    uint32_t buffer_offset = (old_size % buffer_size_);
-    uint8_t* write_ptr = buffer_ + buffer_offset;
-    uint32_t bytes_till_end = buffer_size_ - buffer_offset;
+bool LockFreeRingBufferBase::GetWriteSizes(LockFreeRingBufferIndex* total_write_size,
+                                           LockFreeRingBufferIndex* committed_write_size) const {
+    // Writers claim their slot before adding to total_write_size_, so any write included in
+    // total_write_size is either complete or visible in write_slots_busy_.
+    *total_write_size = total_write_size_;
+    uint32_t busy = write_slots_busy_;
+    if (active_writers_ != 0) {
+        return false;
+    }
 
-    // Wrap message around end of buffer.
-    if (bytes_till_end < data_len) {
-        memcpy(write_ptr, data, bytes_till_end);
-        write_ptr = buffer_;
-        data = ((const char*)data) + bytes_till_end;
-        data_len -= bytes_till_end;
+    // Find the in progress write that started furthest before total_write_size. A slot that was
+    // just claimed may still hold the start of its previous write, which only makes this more
+    // conservative. Writes that appear to start after total_write_size aren't included in it.
+    LockFreeRingBufferIndex max_pending = 0;
+    while (busy != 0) {
+        int slot = __builtin_ctz(busy);
+        busy &= busy - 1;
+        LockFreeRingBufferIndex pending = *total_write_size - write_slot_starts_[slot];
+        if (pending > max_pending && pending < INDEX_HALF_RANGE) {
+            max_pending = pending;
+        }
     }
+    *committed_write_size = *total_write_size - max_pending;
+    return true;
+}
 
-    memcpy(write_ptr, data, data_len);
+int LockFreeRingBufferBase::RegisterReader(LockFreeRingBufferIndex read_tail) const {
+    static_assert(MAX_READERS <= 32, "readers_registered_ needs a bit for each reader");
+    constexpr uint32_t ALL_READERS = (uint32_t(1) << MAX_READERS) - 1;
+    uint32_t registered = readers_registered_;
+    while (registered != ALL_READERS) {
+        uint32_t free_bit = ~registered & (registered + 1);
+        if (readers_registered_.compare_exchange_weak(registered, registered | free_bit)) {
+            int slot = __builtin_ctz(free_bit);
+            reader_tails_[slot] = read_tail;
+            return slot;
+        }
+    }
+    return -1;
+}
 
-    // Indicates this write is complete.
-    active_writers_--;
+void LockFreeRingBufferBase::UnregisterReader(int reader_slot) const {
+    readers_registered_.fetch_and(~(uint32_t(1) << reader_slot));
+}
+
+LockFreeRingBuffer::LockFreeRingBuffer(void* buffer, uint32_t buffer_size,
+                                       const std::function<void()>& data_callback)
+    : LockFreeRingBufferBase(buffer, buffer_size), data_callback_(data_callback) {}
+
+void LockFreeRingBuffer::Write(const void* data, uint32_t data_len) {
+    LockFreeRingBufferReservation reservation;
+    Reserve(data_len, &reservation);
+    reservation.Copy(0, data, data_len);
+    Commit(reservation);
+}
+
+void LockFreeRingBuffer::Reserve(uint32_t data_len, LockFreeRingBufferReservation* reservation) {
+    assert(data_len < GetBufferSize());
+    ReserveImpl(GetBufferSize(), data_len, reservation);
+}
+
+void LockFreeRingBuffer::Commit(const LockFreeRingBufferReservation& reservation) {
+    CommitImpl(reservation);
 
     // Don't pass size back since can't guarentee there aren't other
     // outstanding writes earlier in the buffer.
@@ -58,6 +106,22 @@ void LockFreeRingBuffer::Write(const void* data, uint32_t data_len) {
     }
 }
 
+bool LockFreeRingBuffer::TryWrite(const void* data, uint32_t data_len) {
+    LockFreeRingBufferReservation reservation;
+    if (!TryReserve(data_len, &reservation)) {
+        return false;
+    }
+    reservation.Copy(0, data, data_len);
+    Commit(reservation);
+    return true;
+}
+
+bool LockFreeRingBuffer::TryReserve(uint32_t data_len,
+                                    LockFreeRingBufferReservation* reservation) {
+    assert(data_len < GetBufferSize());
+    return TryReserveImpl(GetBufferSize(), data_len, reservation);
+}
+
 size_t LockFreeRingBufferReadResults::Copy(void* dest, size_t max_size) const {
     size_t copy1_size = (part1_size > max_size) ? max_size : part1_size;
     memcpy(dest, part1, copy1_size);
@@ -89,7 +153,7 @@ LockFreeRingBufferReadResults LockFreeRingBufferReadResults::AddOffset(size_t of
     return result;
 }
 
-LockFreeRingBufferReader::LockFreeRingBufferReader(const LockFreeRingBuffer* buffer,
+LockFreeRingBufferReader::LockFreeRingBufferReader(const LockFreeRingBufferBase* buffer,
                                                    const std::function<void()>& sleep_func)
     : buffer_(buffer), sleep_func_(sleep_func) {
     read_tail_ = GetWriteTotal();
@@ -97,6 +161,22 @@ LockFreeRingBufferReader::LockFreeRingBufferReader(const LockFreeRingBuffer* buf
     if (read_tail_ < buffer_->buffer_size_) {
         read_tail_ = 0;
     }
+    reader_slot_ = buffer_->RegisterReader(read_tail_);
+}
+
+LockFreeRingBufferReader::LockFreeRingBufferReader(LockFreeRingBufferReader&& other)
+    : buffer_(other.buffer_),
+      sleep_func_(std::move(other.sleep_func_)),
+      read_tail_(other.read_tail_),
+      reader_slot_(other.reader_slot_),
+      overflow_func_(std::move(other.overflow_func_)) {
+    other.reader_slot_ = -1;
+}
+
+LockFreeRingBufferReader::~LockFreeRingBufferReader() {
+    if (reader_slot_ >= 0) {
+        buffer_->UnregisterReader(reader_slot_);
+    }
 }
 
 bool LockFreeRingBufferReader::PeekAvailable(LockFreeRingBufferReadResults* results) {
@@ -107,13 +187,13 @@ bool LockFreeRingBufferReader::PeekAvailable(LockFreeRingBufferReadResults* resu
     }
 
     uint32_t buffer_offset = (read_tail_ % buffer_->buffer_size_);
-    results->part1 = buffer_->buffer_ + buffer_offset;
+    results->part1 = buffer_->GetBuffer() + buffer_offset;
     uint32_t bytes_till_end = buffer_->buffer_size_ - buffer_offset;
 
     // Wrap data around end of buffer.
     if (bytes_till_end < new_bytes) {
         results->part1_size = bytes_till_end;
-        results->part2 = buffer_->buffer_;
+        results->part2 = buffer_->GetBuffer();
         results->part2_size = new_bytes - bytes_till_end;
     } else {
         results->part1_size = new_bytes;
@@ -132,6 +212,7 @@ bool LockFreeRingBufferReader::MarkRead(uint32_t num_bytes) {
     }
 
     read_tail_ += num_bytes;
+    UpdateRegisteredTail();
     return true;
 }
 
@@ -152,36 +233,53 @@ bool LockFreeRingBufferReader::Read(void* dest, size_t* size_read, size_t max_si
 }
 
 bool LockFreeRingBufferReader::GetNewBytesResetIfOverflow(uint64_t* new_bytes) {
-    uint64_t cur_total = GetWriteTotal();
+    LockFreeRingBufferIndex total_write_size = 0;
+    LockFreeRingBufferIndex committed_write_size = 0;
+    while (!buffer_->GetWriteSizes(&total_write_size, &committed_write_size)) {
+        if (sleep_func_) {
+            sleep_func_();
+        }
+    }
+
+    uint64_t cur_total = ExtendWriteSize(total_write_size);
     *new_bytes = cur_total - read_tail_;
     if (*new_bytes > buffer_->buffer_size_) {
         if (overflow_func_) {
             overflow_func_(*new_bytes, buffer_->buffer_size_);
         }
         read_tail_ = cur_total;
+        UpdateRegisteredTail();
         *new_bytes = 0;
         return false;
     }
+
+    // Only report data before the oldest write still in progress.
+    LockFreeRingBufferIndex pending = total_write_size - committed_write_size;
+    *new_bytes = (pending > *new_bytes) ? 0 : *new_bytes - pending;
     return true;
 }
 
 uint64_t LockFreeRingBufferReader::GetWriteTotal() {
-    uint32_t total_write_size = 0;
-    // Get write offset, and double check that it isn't being updated.
-    while (1) {
-        total_write_size = buffer_->total_write_size_;
-        if (buffer_->active_writers_ == 0 && buffer_->total_write_size_ == total_write_size) {
-            uint64_t tail_lower_32bit = read_tail_ & MASK_LOWER_32BITS;
-            uint64_t tail_upper_32bit = read_tail_ & MASK_UPPER_32BITS;
-
-            if (total_write_size < tail_lower_32bit) {
-                tail_upper_32bit += OVERFLOW_32BITS;
-            }
-            return tail_upper_32bit + uint64_t(total_write_size);
-        }
-        if (sleep_func_) {
-            sleep_func_();
-        }
+    return ExtendWriteSize(buffer_->total_write_size_);
+}
+
+uint64_t LockFreeRingBufferReader::ExtendWriteSize(LockFreeRingBufferIndex total_write_size) const {
+    if (LockFreeRingBufferBase::HAS_64BIT_INDEX) {
+        return total_write_size;
+    }
+
+    uint64_t tail_lower_32bit = read_tail_ & MASK_LOWER_32BITS;
+    uint64_t tail_upper_32bit = read_tail_ & MASK_UPPER_32BITS;
+
+    if (total_write_size < tail_lower_32bit) {
+        tail_upper_32bit += OVERFLOW_32BITS;
+    }
+    return tail_upper_32bit + uint64_t(total_write_size);
+}
+
+void LockFreeRingBufferReader::UpdateRegisteredTail() {
+    if (reader_slot_ >= 0) {
+        buffer_->reader_tails_[reader_slot_] = static_cast<LockFreeRingBufferIndex>(read_tail_);
     }
 }
 
@@ -1,12 +1,45 @@
-#pragma once 
+#pragma once
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <type_traits>
+
+// Set to 1 to use 32bit indexing even when 64bit atomics are available (e.g. to test the rollover
+// logic on a 64bit host).
+#ifndef LOCK_FREE_RING_BUFFER_FORCE_32BIT_INDEX
+    #define LOCK_FREE_RING_BUFFER_FORCE_32BIT_INDEX 0
+#endif
+
+// Type of the running byte counts the buffer positions are derived from. 64bit counts are used
+// when the platform has lock free 64bit atomics, so they never roll over in practice.
+typedef std::conditional<!LOCK_FREE_RING_BUFFER_FORCE_32BIT_INDEX &&
+                             __atomic_always_lock_free(sizeof(uint64_t), 0),
+                         uint64_t, uint32_t>::type LockFreeRingBufferIndex;
 
 class LockFreeRingBufferReader;
 
-// Note: Using uint32_t instead of size_t to test rollover logic on 64bit systems.
+// Space reserved for a write. If the space wraps around, its split between part1 and part2.
+struct LockFreeRingBufferReservation {
+    uint8_t* part1 = nullptr;
+    size_t part1_size = 0;
+    uint8_t* part2 = nullptr;
+    size_t part2_size = 0;
+    // Write slot tracking this reservation, or -1 if all the slots were in use.
+    int write_slot = -1;
+
+    // Copies data into the reserved space, handling wrap-around.
+    // \param offset Byte offset into the reserved space to start writing at
+    // \param data Pointer to the data to copy
+    // \param data_len Length of data to copy. Data past the end of the reservation is dropped.
+    // \return Number of bytes copied
+    inline size_t Copy(size_t offset, const void* data, size_t data_len) const;
+
+    // Returns the total size of the reserved space (part1_size + part2_size).
+    size_t Size() const { return part1_size + part2_size; }
+};
 
 /*
  * A lock free ring buffer.
@@ -19,22 +52,149 @@ class LockFreeRingBufferReader;
  * 2. Supports multiple simultaneous writers
  * 3. Supports multiple simultaneous readers
  * 4. Reads are always aligned to the start of a write.
+ * 5. Readers can consume data up to the oldest write still in progress.
+ * 6. Optional backpressure with TryWrite(), which drops new data instead of overwriting data
+ *    registered readers haven't consumed.
  *
  * Limitations:
- * 1. The buffer size must be a power of 2
- * 2. Writers cannot detect when the buffer is full (no backpressure)
- * 4. Once the buffer fills up it will currupt old data if it hasn't been read
- * 5. To support both Posix and FreeRTOS, external callbacks need to be provided
+ * 1. With 32bit indexing, the buffer size must be a power of 2
+ * 2. Only the first MAX_READERS readers are registered for backpressure
+ * 3. Once the buffer fills up Write() will currupt old data if it hasn't been read
+ * 4. To support both Posix and FreeRTOS, external callbacks need to be provided
+ *
+ * On platforms without lock free 64bit atomics (e.g. the ESP32) the counts are 32bit. Readers
+ * extend them to 64bits, which has a potential race condition every ~4GB. The power of 2
+ * limitation is so the buffer offsets stay aligned when the counts roll over.
+ *
+ * The buffer memory is tracked by its offset from this object, so a ring buffer constructed in
+ * shared memory along with its buffer can be written and read by processes that map it at
+ * different addresses.
+ *
+ * This base class holds the state shared with LockFreeRingBufferReader. Writes go through
+ * LockFreeRingBuffer, where the size and data callback are set at runtime, or
+ * StaticLockFreeRingBuffer, where they are fixed at compile time.
+ */
+class LockFreeRingBufferBase {
+   public:
+    LockFreeRingBufferBase(const LockFreeRingBufferBase&) = delete;
+    LockFreeRingBufferBase& operator=(const LockFreeRingBufferBase&) = delete;
+
+    // Size of the buffer in bytes.
+    uint32_t GetBufferSize() const { return buffer_size_; }
+
+    // Total number of writes dropped by TryWrite() and TryReserve(). Wraps on overflow.
+    uint32_t GetDroppedMessages() const;
+
+    // Total number of bytes dropped by TryWrite() and TryReserve(). Wraps on overflow.
+    uint32_t GetDroppedBytes() const;
+
+    // Total number of bytes reserved by writes so far. Wraps on overflow with a 32bit index, so
+    // compare values by their difference. Inlined so it can be used by a NotifyPolicy.
+    LockFreeRingBufferIndex GetTotalWriteSize() const {
+        return total_write_size_.load(std::memory_order_relaxed);
+    }
+
+    // Offset of the count GetTotalWriteSize() returns from this object, for tools that read the
+    // buffer from outside the process (e.g. from a memory mapped file after a crash).
+    size_t GetTotalWriteSizeOffset() const {
+        return reinterpret_cast<const uint8_t*>(&total_write_size_) -
+               reinterpret_cast<const uint8_t*>(this);
+    }
+
+    // Maximum number of writes that can be tracked in progress at once. Writes beyond this
+    // fall back to active_writers_, which readers have to wait to reach zero.
+    static constexpr int NUM_WRITE_SLOTS = 32;
+
+    // Maximum number of readers that can be registered for backpressure.
+    static constexpr int MAX_READERS = 4;
+
+    // True if LockFreeRingBufferIndex is 64bit, so the buffer size doesn't need to be a power of 2.
+    static constexpr bool HAS_64BIT_INDEX = sizeof(LockFreeRingBufferIndex) == sizeof(uint64_t);
+
+   protected:
+    // \param buffer Pointer to the buffer memory
+    // \param buffer_size Size of the buffer in bytes (must be power of 2 without HAS_64BIT_INDEX)
+    LockFreeRingBufferBase(void* buffer, uint32_t buffer_size);
+
+    // Buffer memory, at buffer_offset_ from this object.
+    uint8_t* GetBuffer() const {
+        return const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(this)) + buffer_offset_;
+    }
+
+    // Implementations of the write functions. They take the buffer size so that writers with a
+    // size known at compile time have the offset calculations folded into a mask.
+    inline void ReserveImpl(uint32_t buffer_size, uint32_t data_len,
+                            LockFreeRingBufferReservation* reservation);
+    inline bool TryReserveImpl(uint32_t buffer_size, uint32_t data_len,
+                               LockFreeRingBufferReservation* reservation);
+    inline void CommitImpl(const LockFreeRingBufferReservation& reservation);
+
+   private:
+    friend LockFreeRingBufferReader;
+
+    // Distances between indexes at least this large are treated as negative.
+    static constexpr LockFreeRingBufferIndex INDEX_HALF_RANGE =
+        LockFreeRingBufferIndex(1) << (sizeof(LockFreeRingBufferIndex) * 8 - 1);
+
+    // Claims a free bit in write_slots_busy_. Returns -1 if they're all in use.
+    inline int ClaimWriteSlot();
+
+    // Marks the start of a write. Returns the write slot to pass to FinishWrite().
+    inline int StartWrite();
+
+    // Marks a write started with StartWrite() as complete.
+    inline void FinishWrite(int write_slot);
+
+    // Sets reservation to the space for a write that started at total_write_size start.
+    inline void SetReservation(uint32_t buffer_size, LockFreeRingBufferIndex start,
+                               uint32_t data_len, int write_slot,
+                               LockFreeRingBufferReservation* reservation);
+
+    // Gets the number of bytes before total_write_size the slowest registered reader is.
+    // Returns false if there are no registered readers.
+    inline bool GetUnreadBytes(LockFreeRingBufferIndex total_write_size,
+                               LockFreeRingBufferIndex* unread_bytes) const;
+
+    // Gets total_write_size_, along with the size before the oldest write still in progress.
+    // Returns false if a write without a slot is in progress, since then the committed size
+    // isn't known.
+    bool GetWriteSizes(LockFreeRingBufferIndex* total_write_size,
+                       LockFreeRingBufferIndex* committed_write_size) const;
+
+    // Registers a reader's position for backpressure. Returns -1 if MAX_READERS are registered.
+    int RegisterReader(LockFreeRingBufferIndex read_tail) const;
+
+    // Removes a reader registered with RegisterReader().
+    void UnregisterReader(int reader_slot) const;
+
+    const intptr_t buffer_offset_;
+    const uint32_t buffer_size_;
+    std::atomic<LockFreeRingBufferIndex> total_write_size_{0};
+    // Writes in progress that didn't get a write slot.
+    std::atomic<uint32_t> active_writers_{0};
+    // Bit i is set while write slot i is in use.
+    std::atomic<uint32_t> write_slots_busy_{0};
+    // For each write slot in use, a lower bound of the total_write_size_ its write starts at.
+    std::atomic<LockFreeRingBufferIndex> write_slot_starts_[NUM_WRITE_SLOTS];
+    // Readers only have a const pointer to the buffer, so their registrations are mutable.
+    // Bit i is set while reader slot i is in use.
+    mutable std::atomic<uint32_t> readers_registered_{0};
+    // Each registered reader's read_tail_, truncated to LockFreeRingBufferIndex.
+    mutable std::atomic<LockFreeRingBufferIndex> reader_tails_[MAX_READERS];
+    std::atomic<uint32_t> dropped_messages_{0};
+    std::atomic<uint32_t> dropped_bytes_{0};
+};
+
+/*
+ * Lock free ring buffer with the size and data callback set at runtime.
  *
- * The power of 2 limitation is solely to support 32bit rollovers. It could be
- * removed with minimal changes for a system that supported 64bit atomic
- * variables or if having a potential race condition every ~4GB isn't a concern.
+ * See LockFreeRingBufferBase for details.
  */
-class LockFreeRingBuffer {
+class LockFreeRingBuffer : public LockFreeRingBufferBase {
    public:
     // Constructs a lock-free ring buffer.
-    // \param buffer Pointer to the buffer memory (must be power of 2 size)
-    // \param buffer_size Size of the buffer in bytes (must be power of 2)
+    // \param buffer Pointer to the buffer memory
+    // \param buffer_size Size of the buffer in bytes (must be power of 2 without HAS_64BIT_INDEX)
     // \param data_callback Optional callback invoked when data is written
     LockFreeRingBuffer(
         void* buffer, uint32_t buffer_size, const std::function<void()>& data_callback = {});
@@ -45,15 +205,101 @@ class LockFreeRingBuffer {
     // \param data_len Length of data to write (must be less than buffer_size)
     void Write(const void* data, uint32_t data_len);
 
+    // Reserves space in the ring buffer to be filled in place, avoiding a copy through a
+    // temporary buffer. Readers wait for outstanding reservations, so the space must be filled
+    // quickly and every call must be followed by exactly one call to Commit().
+    // Multiple writers can call this simultaneously.
+    // \param data_len Number of bytes to reserve (must be less than buffer_size)
+    // \param reservation Set to the space reserved for the write
+    void Reserve(uint32_t data_len, LockFreeRingBufferReservation* reservation);
+
+    // Marks a write started with Reserve() or TryReserve() as complete.
+    // \param reservation The reservation returned by Reserve()
+    void Commit(const LockFreeRingBufferReservation& reservation);
+
+    // Writes data only if it fits without overwriting data the slowest registered reader hasn't
+    // consumed. If no readers are registered, old data is overwritten like Write().
+    // Multiple writers can call this simultaneously.
+    // \param data Pointer to the data to write
+    // \param data_len Length of data to write (must be less than buffer_size)
+    // \return false if the data was dropped
+    bool TryWrite(const void* data, uint32_t data_len);
+
+    // Reserve() with the same backpressure as TryWrite(). Only call Commit() if this succeeds.
+    // \param data_len Number of bytes to reserve (must be less than buffer_size)
+    // \param reservation Set to the space reserved for the write, or left empty if dropped
+    // \return false if the write was dropped
+    bool TryReserve(uint32_t data_len, LockFreeRingBufferReservation* reservation);
+
    private:
-    friend LockFreeRingBufferReader;
-    uint8_t* buffer_ = nullptr;
-    const uint32_t buffer_size_;
-    std::atomic<uint32_t> total_write_size_{0};
-    std::atomic<uint32_t> active_writers_{0};
     const std::function<void()> data_callback_;
 };
 
+// StaticLockFreeRingBuffer NotifyPolicy that does nothing when data is written.
+struct LockFreeRingBufferNoNotify {
+    void Notify() {}
+};
+
+/*
+ * Lock free ring buffer with the size and data callback fixed at compile time.
+ *
+ * The write functions are inlined, so they can be used from code that can't call into flash
+ * (e.g. IRAM_ATTR functions on the ESP32).
+ *
+ * See LockFreeRingBufferBase and LockFreeRingBuffer for details.
+ *
+ * \tparam SIZE Size of the buffer in bytes (must be power of 2 without HAS_64BIT_INDEX)
+ * \tparam NotifyPolicy Type with a void Notify() method called after each write. The default
+ *                      compiles it out.
+ */
+template <uint32_t SIZE, typename NotifyPolicy = LockFreeRingBufferNoNotify>
+class StaticLockFreeRingBuffer : public LockFreeRingBufferBase {
+   public:
+    static_assert(SIZE > 0 && (HAS_64BIT_INDEX || (SIZE & (SIZE - 1)) == 0),
+                  "SIZE must be a power of two");
+
+    // \param buffer Pointer to the buffer memory (must be SIZE bytes)
+    // \param notify Policy instance to call after each write
+    explicit StaticLockFreeRingBuffer(void* buffer, const NotifyPolicy& notify = NotifyPolicy())
+        : LockFreeRingBufferBase(buffer, SIZE), notify_(notify) {}
+
+    // See LockFreeRingBuffer for the behavior of these functions.
+    void Write(const void* data, uint32_t data_len) {
+        LockFreeRingBufferReservation reservation;
+        Reserve(data_len, &reservation);
+        reservation.Copy(0, data, data_len);
+        Commit(reservation);
+    }
+
+    void Reserve(uint32_t data_len, LockFreeRingBufferReservation* reservation) {
+        ReserveImpl(SIZE, data_len, reservation);
+    }
+
+    void Commit(const LockFreeRingBufferReservation& reservation) {
+        CommitImpl(reservation);
+        notify_.Notify();
+    }
+
+    bool TryWrite(const void* data, uint32_t data_len) {
+        LockFreeRingBufferReservation reservation;
+        if (!TryReserve(data_len, &reservation)) {
+            return false;
+        }
+        reservation.Copy(0, data, data_len);
+        Commit(reservation);
+        return true;
+    }
+
+    bool TryReserve(uint32_t data_len, LockFreeRingBufferReservation* reservation) {
+        return TryReserveImpl(SIZE, data_len, reservation);
+    }
+
+    NotifyPolicy& GetNotifyPolicy() { return notify_; }
+
+   private:
+    NotifyPolicy notify_;
+};
+
 // Data available in buffer. If data wraps around, its split between part1 and part2.
 struct LockFreeRingBufferReadResults {
     const uint8_t* part1 = nullptr;
@@ -81,8 +327,13 @@ struct LockFreeRingBufferReadResults {
 class LockFreeRingBufferReader {
    public:
     // Constructs a reader for the given buffer.
-    LockFreeRingBufferReader(const LockFreeRingBuffer* buffer,
+    // The reader is registered with the buffer for backpressure while it exists.
+    LockFreeRingBufferReader(const LockFreeRingBufferBase* buffer,
                              const std::function<void()>& sleep_func={});
+    LockFreeRingBufferReader(LockFreeRingBufferReader&& other);
+    LockFreeRingBufferReader(const LockFreeRingBufferReader&) = delete;
+    LockFreeRingBufferReader& operator=(const LockFreeRingBufferReader&) = delete;
+    ~LockFreeRingBufferReader();
 
     // Returns pointers to available data without advancing the read position.
     // If data wraps around the buffer end, it's split into part1 and part2.
@@ -111,18 +362,173 @@ class LockFreeRingBufferReader {
     // \param overflow_func Callback with signature void(bytes_available, buffer_size)
     void SetOverflowFunc(const std::function<void(uint64_t, uint64_t)>& overflow_func);
 
-   private:
-    // Gets the total number of bytes written to the buffer.
-    // Polls until no writes are in progress to ensure a consistent view.
-    // Handles 32-bit overflow by tracking upper 32 bits separately.
+    // Gets the total number of bytes reserved in the buffer, including writes in progress. Once
+    // GetReadPosition() reaches this, every write reserved before the call has been read.
     uint64_t GetWriteTotal();
 
+    // Gets the number of bytes consumed from the buffer so far.
+    uint64_t GetReadPosition() const { return read_tail_; }
+
+   private:
+
+    // Extends total_write_size_ to 64 bits relative to read_tail_. Only needed to handle rollover
+    // with a 32bit LockFreeRingBufferIndex.
+    uint64_t ExtendWriteSize(LockFreeRingBufferIndex total_write_size) const;
+
+    // Publishes read_tail_ to the buffer for backpressure.
+    void UpdateRegisteredTail();
+
     // Pointer to the underlying ring buffer
-    const LockFreeRingBuffer* buffer_ = nullptr;
+    const LockFreeRingBufferBase* buffer_ = nullptr;
     // Function to call when polling (allows task yielding)
     std::function<void()> sleep_func_;
     // Current read position in the buffer (in bytes)
     uint64_t read_tail_ = 0;
+    // Slot registered with the buffer, or -1 if not registered
+    int reader_slot_ = -1;
 
     std::function<void(uint64_t, uint64_t)> overflow_func_;
 };
+
+////////////////////////////// Inline Implementations ////////////////////////////////
+
+size_t LockFreeRingBufferReservation::Copy(size_t offset, const void* data,
+                                           size_t data_len) const {
+    size_t copied = 0;
+    if (offset < part1_size) {
+        copied = (data_len > part1_size - offset) ? part1_size - offset : data_len;
+        memcpy(part1 + offset, data, copied);
+        data = ((const char*)data) + copied;
+        data_len -= copied;
+        offset = 0;
+    } else {
+        offset -= part1_size;
+    }
+
+    if (data_len > 0 && offset < part2_size) {
+        size_t copy2_size = (data_len > part2_size - offset) ? part2_size - offset : data_len;
+        memcpy(part2 + offset, data, copy2_size);
+        copied += copy2_size;
+    }
+    return copied;
+}
+
+void LockFreeRingBufferBase::ReserveImpl(uint32_t buffer_size, uint32_t data_len,
+                                         LockFreeRingBufferReservation* reservation) {
+    int write_slot = StartWrite();
+
+    // Based on the number of bytes written previously, get the current write pointer.
+    // At the same time update the number of bytes written to include this new data.
+    // The data can't be counted on to be finished writen until its slot is released.
+    // With a 32bit index the buffer size is a power of two, so when total_write_size_ overflows
+    // it will still align correctly to the buffer offset.
+    LockFreeRingBufferIndex old_size = total_write_size_.fetch_add(data_len);
+    SetReservation(buffer_size, old_size, data_len, write_slot, reservation);
+}
+
+bool LockFreeRingBufferBase::TryReserveImpl(uint32_t buffer_size, uint32_t data_len,
+                                            LockFreeRingBufferReservation* reservation) {
+    *reservation = {};
+
+    int write_slot = StartWrite();
+
+    // Same as Reserve(), except the space is only claimed if it doesn't pass the slowest reader.
+    LockFreeRingBufferIndex old_size = total_write_size_;
+    do {
+        LockFreeRingBufferIndex unread_bytes = 0;
+        if (GetUnreadBytes(old_size, &unread_bytes) && unread_bytes + data_len > buffer_size) {
+            FinishWrite(write_slot);
+            dropped_messages_++;
+            dropped_bytes_ += data_len;
+            return false;
+        }
+    } while (!total_write_size_.compare_exchange_weak(old_size, old_size + data_len));
+
+    SetReservation(buffer_size, old_size, data_len, write_slot, reservation);
+    return true;
+}
+
+void LockFreeRingBufferBase::CommitImpl(const LockFreeRingBufferReservation& reservation) {
+    FinishWrite(reservation.write_slot);
+}
+
+int LockFreeRingBufferBase::ClaimWriteSlot() {
+    static_assert(NUM_WRITE_SLOTS == 32, "write_slots_busy_ needs a bit for each slot");
+    uint32_t busy = write_slots_busy_.load(std::memory_order_relaxed);
+    while (busy != ~uint32_t(0)) {
+        uint32_t free_bit = ~busy & (busy + 1);
+        if (write_slots_busy_.compare_exchange_weak(busy, busy | free_bit)) {
+            return __builtin_ctz(free_bit);
+        }
+    }
+    return -1;
+}
+
+int LockFreeRingBufferBase::StartWrite() {
+    // Indicate that there is an outstanding write ongoing. If a slot is available, record a lower
+    // bound for where this write will start before claiming the space. Readers can then consume
+    // data up to that point without waiting for this write to finish.
+    int write_slot = ClaimWriteSlot();
+    if (write_slot >= 0) {
+        write_slot_starts_[write_slot] = total_write_size_.load();
+    } else {
+        active_writers_++;
+    }
+    return write_slot;
+}
+
+void LockFreeRingBufferBase::FinishWrite(int write_slot) {
+    // Indicates this write is complete.
+    if (write_slot >= 0) {
+        write_slots_busy_.fetch_and(~(uint32_t(1) << write_slot));
+    } else {
+        active_writers_--;
+    }
+}
+
+void LockFreeRingBufferBase::SetReservation(uint32_t buffer_size, LockFreeRingBufferIndex start,
+                                            uint32_t data_len, int write_slot,
+                                            LockFreeRingBufferReservation* reservation) {
+    if (write_slot >= 0) {
+        write_slot_starts_[write_slot] = start;
+    }
+    reservation->write_slot = write_slot;
+    // Only has to be a modulo for 64bit indexes. Either way, a constant buffer_size is folded
+    // into a mask if its a power of 2.
+    uint32_t buffer_offset = HAS_64BIT_INDEX ? uint32_t(start % buffer_size)
+                                             : uint32_t(start & (buffer_size - 1));
+    uint8_t* buffer = GetBuffer();
+    reservation->part1 = buffer + buffer_offset;
+    uint32_t bytes_till_end = buffer_size - buffer_offset;
+
+    // Wrap message around end of buffer.
+    if (bytes_till_end < data_len) {
+        reservation->part1_size = bytes_till_end;
+        reservation->part2 = buffer;
+        reservation->part2_size = data_len - bytes_till_end;
+    } else {
+        reservation->part1_size = data_len;
+        reservation->part2 = nullptr;
+        reservation->part2_size = 0;
+    }
+}
+
+bool LockFreeRingBufferBase::GetUnreadBytes(LockFreeRingBufferIndex total_write_size,
+                                            LockFreeRingBufferIndex* unread_bytes) const {
+    uint32_t registered = readers_registered_;
+    if (registered == 0) {
+        return false;
+    }
+
+    // Readers that have moved past total_write_size have no unread bytes before it.
+    *unread_bytes = 0;
+    while (registered != 0) {
+        int slot = __builtin_ctz(registered);
+        registered &= registered - 1;
+        LockFreeRingBufferIndex unread = total_write_size - reader_tails_[slot];
+        if (unread > *unread_bytes && unread < INDEX_HALF_RANGE) {
+            *unread_bytes = unread;
+        }
+    }
+    return true;
+}
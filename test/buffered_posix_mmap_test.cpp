@@ -0,0 +1,237 @@
+#include <fcntl.h>
+#include <min_logger/min_logger.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "min_logger/platform_implementations/lock_free_ring_buffer.h"
+
+#ifndef MIN_LOGGER_BUFFERED_POSIX_PLATFORM
+    #error "This test must be built with MIN_LOGGER_BUFFERED_POSIX_PLATFORM"
+#endif
+
+static constexpr MinLoggerCRC TEST_MSG_ID = 0x12345678;
+static constexpr uint16_t SYNC = 0xFAAF;
+static constexpr size_t HEADER_SIZE = 16;
+static constexpr uint32_t NUM_WRITES = 100;
+// Enough writes to wrap the shard several times.
+static constexpr uint32_t NUM_WRAP_WRITES = 5000;
+
+static void LogValues(uint32_t count = NUM_WRITES) {
+    for (uint32_t i = 0; i < count; i++) {
+        MIN_LOGGER_RECORD_VALUE_ID(TEST_MSG_ID, MIN_LOGGER_INFO, "count", uint32_t, i);
+    }
+}
+
+// Check the newest message in the file is the last one from LogValues(count) after wrapping.
+static bool CheckNewestValue(MinLoggerMmapHeader* header, uint32_t count) {
+    const size_t msg_size = HEADER_SIZE + sizeof(uint32_t);
+    for (uint32_t i = 0; i < header->num_shards; i++) {
+        LockFreeRingBufferIndex total_write_size = 0;
+        memcpy(&total_write_size,
+               (uint8_t*)min_logger_mmap_ring_buffer(header, i) + header->write_size_offset,
+               sizeof(total_write_size));
+        if (total_write_size < count * msg_size) {
+            continue;
+        }
+        const uint8_t* data = (uint8_t*)header + header->data_offset + i * header->shard_size;
+        uint8_t msg[msg_size];
+        for (size_t j = 0; j < msg_size; j++) {
+            msg[j] = data[(total_write_size - msg_size + j) % header->shard_size];
+        }
+        uint32_t value = 0;
+        memcpy(&value, msg + HEADER_SIZE, sizeof(value));
+        if (value != count - 1) {
+            printf("FAIL: Newest value is %u\n", value);
+            return false;
+        }
+        return true;
+    }
+    printf("FAIL: No shard has all the writes\n");
+    return false;
+}
+
+// Map the whole file read/write, like a collector would.
+static MinLoggerMmapHeader* MapFile(const char* path) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat file_stat;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &file_stat) == 0 && size_t(file_stat.st_size) >= sizeof(MinLoggerMmapHeader)) {
+        mapping = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    return (mapping == MAP_FAILED) ? nullptr : static_cast<MinLoggerMmapHeader*>(mapping);
+}
+
+static bool CheckHeader(const MinLoggerMmapHeader* header, pid_t pid) {
+    if (header == nullptr || memcmp(header->magic, MIN_LOGGER_MMAP_MAGIC, 8) != 0 ||
+        header->version != MIN_LOGGER_MMAP_VERSION ||
+        header->num_shards != MIN_LOGGER_BUFFER_SHARDS ||
+        header->shard_size != MIN_LOGGER_BUFFER_SIZE / MIN_LOGGER_BUFFER_SHARDS ||
+        header->index_size != sizeof(LockFreeRingBufferIndex) || header->pid != uint32_t(pid) ||
+        strcmp(header->format, "BINARY") != 0) {
+        printf("FAIL: Wrong header\n");
+        return false;
+    }
+    return true;
+}
+
+// Check data has the messages from LogValues() in order.
+static bool CheckValues(const std::vector<uint8_t>& data) {
+    uint32_t count = 0;
+    size_t offset = 0;
+    while (offset + HEADER_SIZE <= data.size()) {
+        uint16_t sync = 0;
+        uint32_t msg_id = 0;
+        uint32_t value = 0;
+        memcpy(&sync, data.data() + offset, sizeof(sync));
+        memcpy(&msg_id, data.data() + offset + 4, sizeof(msg_id));
+        memcpy(&value, data.data() + offset + HEADER_SIZE, sizeof(value));
+        if (sync != SYNC || msg_id != TEST_MSG_ID || data[offset + 2] != sizeof(value) ||
+            value != count) {
+            printf("FAIL: Wrong message at offset %zu\n", offset);
+            return false;
+        }
+        count++;
+        offset += HEADER_SIZE + sizeof(value);
+    }
+    if (count != NUM_WRITES || offset != data.size()) {
+        printf("FAIL: Expected %u messages, got %u\n", NUM_WRITES, count);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Buffered POSIX mmap Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    char crash_path[] = "/tmp/min_logger_mmap_crash_testXXXXXX";
+    char live_path[] = "/tmp/min_logger_mmap_live_testXXXXXX";
+    int crash_fd = mkstemp(crash_path);
+    int live_fd = mkstemp(live_path);
+    if (crash_fd < 0 || live_fd < 0) {
+        printf("FAIL: Couldn't create temp files\n");
+        return 1;
+    }
+    close(crash_fd);
+    close(live_fd);
+
+    printf("Test: Messages survive the process crashing... ");
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (!min_logger_init_mmap(crash_path)) {
+            _exit(1);
+        }
+        LogValues();
+        abort();
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFSIGNALED(status)) {
+        printf("FAIL: Child didn't crash\n");
+        return 1;
+    }
+    MinLoggerMmapHeader* header = MapFile(crash_path);
+    if (!CheckHeader(header, pid)) {
+        return 1;
+    }
+    // The child only logged from one thread, so its messages are all in one shard.
+    std::vector<uint8_t> crash_data;
+    for (uint32_t i = 0; i < header->num_shards; i++) {
+        LockFreeRingBufferIndex total_write_size = 0;
+        memcpy(&total_write_size,
+               (uint8_t*)min_logger_mmap_ring_buffer(header, i) + header->write_size_offset,
+               sizeof(total_write_size));
+        const uint8_t* data = (uint8_t*)header + header->data_offset + i * header->shard_size;
+        crash_data.insert(crash_data.end(), data, data + total_write_size);
+    }
+    if (!CheckValues(crash_data)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Stopping the drain unregisters its readers... ");
+    char wrap_path[] = "/tmp/min_logger_mmap_wrap_testXXXXXX";
+    int wrap_fd = mkstemp(wrap_path);
+    if (wrap_fd < 0) {
+        printf("FAIL: Couldn't create temp file\n");
+        return 1;
+    }
+    close(wrap_fd);
+    pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (!min_logger_init_mmap(wrap_path) || !min_logger_init_fd(null_fd, 1)) {
+            _exit(1);
+        }
+        min_logger_stop();
+        // Without readers the writes overwrite the old data instead of being dropped.
+        LogValues(NUM_WRAP_WRITES);
+        abort();
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFSIGNALED(status)) {
+        printf("FAIL: Child didn't crash\n");
+        return 1;
+    }
+    header = MapFile(wrap_path);
+    if (header == nullptr || !CheckNewestValue(header, NUM_WRAP_WRITES)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Collector reads the buffer through its own mapping... ");
+    if (!min_logger_init_mmap(live_path)) {
+        printf("FAIL: init returned false\n");
+        return 1;
+    }
+    if (min_logger_init_mmap(live_path)) {
+        printf("FAIL: Second init should fail\n");
+        return 1;
+    }
+    // A second mapping is at a different address than the one the logger writes through.
+    header = MapFile(live_path);
+    if (!CheckHeader(header, getpid())) {
+        return 1;
+    }
+    if (header->ring_buffer_size != sizeof(StaticLockFreeRingBuffer<MIN_LOGGER_BUFFER_SIZE /
+                                                                    MIN_LOGGER_BUFFER_SHARDS>)) {
+        printf("FAIL: Wrong ring buffer size\n");
+        return 1;
+    }
+    std::vector<LockFreeRingBufferReader> readers;
+    for (uint32_t i = 0; i < header->num_shards; i++) {
+        readers.emplace_back(
+            static_cast<const LockFreeRingBufferBase*>(min_logger_mmap_ring_buffer(header, i)));
+    }
+    LogValues();
+    std::vector<uint8_t> live_data;
+    for (auto& reader : readers) {
+        LockFreeRingBufferReadResults results;
+        if (!reader.PeekAvailable(&results)) {
+            printf("FAIL: PeekAvailable returned false\n");
+            return 1;
+        }
+        size_t offset = live_data.size();
+        live_data.resize(offset + results.Size());
+        results.Copy(live_data.data() + offset, results.Size());
+    }
+    if (!CheckValues(live_data)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    remove(crash_path);
+    remove(wrap_path);
+    remove(live_path);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <min_logger/min_logger.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef MIN_LOGGER_BUFFERED_POSIX_PLATFORM
+    #error "This test must be built with MIN_LOGGER_BUFFERED_POSIX_PLATFORM"
+#endif
+
+static constexpr MinLoggerCRC TEST_MSG_ID = 0x12345678;
+static constexpr uint32_t TEST_VALUE = 0xC0FFEE;
+static constexpr uint16_t SYNC = 0xFAAF;
+static constexpr size_t HEADER_SIZE = 16;
+
+// This file is linked before buffered_posix.cpp, so this runs before its static initializers.
+struct LogBeforeMain {
+    LogBeforeMain() {
+        MIN_LOGGER_RECORD_VALUE_ID(TEST_MSG_ID, MIN_LOGGER_INFO, "value", uint32_t, TEST_VALUE);
+    }
+};
+static LogBeforeMain log_before_main;
+
+int main() {
+    printf("\n=== Buffered POSIX Static Initialization Tests ===\n\n");
+
+    char path[] = "/tmp/min_logger_buffered_posix_static_init_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAIL: Couldn't create temp file\n");
+        return 1;
+    }
+
+    printf("Test: Message logged by a static constructor... ");
+    if (!min_logger_init_fd(fd, 1)) {
+        printf("FAIL: init returned false\n");
+        return 1;
+    }
+    min_logger_flush();
+
+    std::vector<uint8_t> output(HEADER_SIZE + sizeof(TEST_VALUE) + 1);
+    ssize_t len = pread(fd, output.data(), output.size(), 0);
+    min_logger_stop();
+    close(fd);
+    unlink(path);
+
+    if (len != static_cast<ssize_t>(HEADER_SIZE + sizeof(TEST_VALUE))) {
+        printf("FAIL: Wrote %zd bytes\n", len);
+        return 1;
+    }
+    uint16_t sync = 0;
+    uint32_t msg_id = 0;
+    uint32_t value = 0;
+    memcpy(&sync, output.data(), sizeof(sync));
+    memcpy(&msg_id, output.data() + 4, sizeof(msg_id));
+    memcpy(&value, output.data() + HEADER_SIZE, sizeof(value));
+    if (sync != SYNC || msg_id != TEST_MSG_ID || value != TEST_VALUE) {
+        printf("FAIL: Corrupt message\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
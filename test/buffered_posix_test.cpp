@@ -0,0 +1,158 @@
+#include <min_logger/min_logger.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifndef MIN_LOGGER_BUFFERED_POSIX_PLATFORM
+    #error "This test must be built with MIN_LOGGER_BUFFERED_POSIX_PLATFORM"
+#endif
+
+static constexpr MinLoggerCRC TEST_MSG_ID = 0x12345678;
+static constexpr uint16_t SYNC = 0xFAAF;
+static constexpr size_t HEADER_SIZE = 16;
+
+struct TestData {
+    uint32_t thread;
+    uint32_t count;
+};
+
+static std::vector<uint8_t> ReadFile(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        return data;
+    }
+    uint8_t chunk[4096];
+    size_t read = 0;
+    while ((read = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(fp);
+    return data;
+}
+
+int main() {
+    printf("\n=== Buffered POSIX Platform Tests ===\n\n");
+
+    char path[] = "/tmp/min_logger_buffered_posix_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAIL: Couldn't create temp file\n");
+        return 1;
+    }
+
+    printf("Test: Drain to file descriptor... ");
+    if (!min_logger_init_fd(fd, 1)) {
+        printf("FAIL: init returned false\n");
+        return 1;
+    }
+    if (min_logger_init_fd(fd, 1)) {
+        printf("FAIL: Second init should fail\n");
+        return 1;
+    }
+
+    constexpr uint32_t num_threads = 8;
+    constexpr uint32_t writes_per_thread = 1000;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < num_threads; i++) {
+        threads.emplace_back([i]() {
+            TestData data = {i, 0};
+            for (uint32_t j = 0; j < writes_per_thread; j++) {
+                data.count = j;
+                MIN_LOGGER_RECORD_VALUE_ID(TEST_MSG_ID, MIN_LOGGER_INFO, "data", TestData, data);
+                if (j % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    min_logger_flush();
+
+    std::vector<uint8_t> output = ReadFile(path);
+    std::array<uint32_t, num_threads> counts = {};
+    size_t offset = 0;
+    while (offset + HEADER_SIZE <= output.size()) {
+        uint16_t sync = 0;
+        uint32_t msg_id = 0;
+        memcpy(&sync, output.data() + offset, sizeof(sync));
+        memcpy(&msg_id, output.data() + offset + 4, sizeof(msg_id));
+        uint8_t payload_len = output[offset + 2];
+        if (sync != SYNC || msg_id != TEST_MSG_ID || payload_len != 8) {
+            printf("FAIL: Currupt message at offset %zu\n", offset);
+            return 1;
+        }
+        TestData data;
+        memcpy(&data, output.data() + offset + HEADER_SIZE, sizeof(data));
+        if (data.thread >= num_threads || data.count != counts[data.thread]) {
+            printf("FAIL: Out of order value %u from thread %u\n", data.count, data.thread);
+            return 1;
+        }
+        counts[data.thread]++;
+        offset += HEADER_SIZE + payload_len;
+    }
+
+    for (auto& c : counts) {
+        if (c != writes_per_thread) {
+            printf("FAIL: Missing writes %u / %u\n", c, writes_per_thread);
+            return 1;
+        }
+    }
+    printf("PASS\n");
+
+    printf("Test: Flush waits for a write in progress... ");
+    // Hold a reservation open on another thread, so the message logged after it can't be read
+    // until it's committed.
+    const size_t msg_size = HEADER_SIZE + sizeof(TestData);
+    MinLoggerWriteReservation reservation;
+    std::thread reserve_thread(
+        [&reservation, msg_size]() { min_logger_write_reserve(msg_size, &reservation); });
+    reserve_thread.join();
+    MIN_LOGGER_LOG_ID(TEST_MSG_ID, MIN_LOGGER_INFO, "after reservation");
+    std::atomic<bool> flushed = {false};
+    std::thread flush_thread([&flushed]() {
+        min_logger_flush();
+        flushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    bool flushed_early = flushed;
+    // Fill the reservation with a copy of the first message.
+    memcpy(reservation.part1, output.data(), reservation.part1_size);
+    memcpy(reservation.part2, output.data() + reservation.part1_size, reservation.part2_size);
+    min_logger_write_commit(&reservation);
+    flush_thread.join();
+    if (flushed_early) {
+        printf("FAIL: Flush returned before the reserved write was committed\n");
+        return 1;
+    }
+    size_t flushed_size = ReadFile(path).size();
+    if (flushed_size != output.size() + msg_size + HEADER_SIZE) {
+        printf("FAIL: Flushed %zu bytes, expected %zu\n", flushed_size - output.size(),
+               msg_size + HEADER_SIZE);
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Stop drains remaining data... ");
+    MIN_LOGGER_LOG_ID(TEST_MSG_ID, MIN_LOGGER_INFO, "last message");
+    min_logger_stop();
+    if (ReadFile(path).size() != flushed_size + HEADER_SIZE) {
+        printf("FAIL: Last message not written\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    close(fd);
+    remove(path);
+    return 0;
+}
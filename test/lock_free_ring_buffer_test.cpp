@@ -509,6 +509,258 @@ bool TestOverflowDetection() {
     return true;
 }
 
+// Test: Reserve space across the end of the buffer and fill it in place
+bool TestReserveCommit() {
+    printf("Test: Reserve and commit... ");
+
+    uint8_t buffer[16];
+    memset(buffer, 0, sizeof(buffer));
+
+    int callback_count = 0;
+    LockFreeRingBuffer ring_buffer(buffer, sizeof(buffer),
+                                   [&callback_count]() { callback_count++; });
+    LockFreeRingBufferReader reader(&ring_buffer, SleepFunc);
+
+    ring_buffer.Write("1234567890", 10);
+    LockFreeRingBufferReadResults results;
+    if (!reader.PeekAvailable(&results) || !reader.MarkRead(results.Size())) {
+        printf("FAIL: Initial read failed\n");
+        return false;
+    }
+
+    LockFreeRingBufferReservation reservation;
+    ring_buffer.Reserve(12, &reservation);
+    if (reservation.part1 != buffer + 10 || reservation.part1_size != 6 ||
+        reservation.part2 != buffer || reservation.part2_size != 6) {
+        printf("FAIL: Reservation should wrap around (part1_size %zu, part2_size %zu)\n",
+               reservation.part1_size, reservation.part2_size);
+        return false;
+    }
+    if (callback_count != 1) {
+        printf("FAIL: Callback shouldn't be called until commit\n");
+        return false;
+    }
+
+    // Fill the reservation in pieces that straddle the wrap.
+    if (reservation.Copy(0, "ABCD", 4) != 4 || reservation.Copy(4, "EFGH", 4) != 4 ||
+        reservation.Copy(8, "IJKLMNOP", 8) != 4) {
+        printf("FAIL: Copy returned wrong size\n");
+        return false;
+    }
+    ring_buffer.Commit(reservation);
+
+    if (callback_count != 2) {
+        printf("FAIL: callback_count was %d, expected 2\n", callback_count);
+        return false;
+    }
+
+    if (!reader.PeekAvailable(&results)) {
+        printf("FAIL: PeekAvailable returned false\n");
+        return false;
+    }
+    if (!IsBufferEqual("ABCDEFGHIJKL", 12, results)) {
+        printf("FAIL\n");
+        return false;
+    }
+
+    printf("PASS\n");
+    return true;
+}
+
+// Test: Data before a write in progress can be read without waiting for it
+bool TestReadPastWriteInProgress() {
+    printf("Test: Read up to write in progress... ");
+
+    uint8_t buffer[256];
+    memset(buffer, 0, sizeof(buffer));
+
+    LockFreeRingBuffer ring_buffer(buffer, sizeof(buffer));
+    LockFreeRingBufferReader reader(&ring_buffer, SleepFunc);
+
+    ring_buffer.Write("first", 5);
+    LockFreeRingBufferReservation reservation;
+    ring_buffer.Reserve(4, &reservation);
+    ring_buffer.Write("after", 5);
+
+    // Only the data before the reservation is complete.
+    LockFreeRingBufferReadResults results;
+    if (!reader.PeekAvailable(&results)) {
+        printf("FAIL: PeekAvailable returned false\n");
+        return false;
+    }
+    if (!IsBufferEqual("first", 5, results)) {
+        printf("FAIL\n");
+        return false;
+    }
+    if (!reader.MarkRead(results.Size())) {
+        printf("FAIL: MarkRead returned false\n");
+        return false;
+    }
+
+    reservation.Copy(0, "RSVD", 4);
+    ring_buffer.Commit(reservation);
+    if (!reader.PeekAvailable(&results)) {
+        printf("FAIL: Second PeekAvailable returned false\n");
+        return false;
+    }
+    if (!IsBufferEqual("RSVDafter", 9, results)) {
+        printf("FAIL\n");
+        return false;
+    }
+    if (!reader.MarkRead(results.Size())) {
+        printf("FAIL: Second MarkRead returned false\n");
+        return false;
+    }
+
+    // Writes beyond the number of slots still complete normally.
+    constexpr int num_reservations = LockFreeRingBuffer::NUM_WRITE_SLOTS + 2;
+    LockFreeRingBufferReservation reservations[num_reservations];
+    for (int i = 0; i < num_reservations; i++) {
+        ring_buffer.Reserve(1, &reservations[i]);
+        uint8_t value = i;
+        reservations[i].Copy(0, &value, 1);
+    }
+    if (reservations[num_reservations - 1].write_slot != -1) {
+        printf("FAIL: Expected to run out of write slots\n");
+        return false;
+    }
+    for (int i = 0; i < num_reservations; i++) {
+        ring_buffer.Commit(reservations[i]);
+    }
+    if (ring_buffer.write_slots_busy_ != 0 || ring_buffer.active_writers_ != 0) {
+        printf("FAIL: Writes not released\n");
+        return false;
+    }
+    if (!reader.PeekAvailable(&results) || results.Size() != num_reservations) {
+        printf("FAIL: Expected %d bytes, got %zu\n", num_reservations, results.Size());
+        return false;
+    }
+
+    printf("PASS\n");
+    return true;
+}
+
+// Test: TryWrite drops data instead of overwriting what a reader hasn't consumed
+bool TestTryWriteBackpressure() {
+    printf("Test: TryWrite backpressure... ");
+
+    uint8_t buffer[16];
+    memset(buffer, 0, sizeof(buffer));
+
+    LockFreeRingBuffer ring_buffer(buffer, sizeof(buffer));
+
+    // With no readers registered, old data is overwritten.
+    for (int i = 0; i < 4; i++) {
+        if (!ring_buffer.TryWrite("0123456789", 10)) {
+            printf("FAIL: TryWrite with no readers should overwrite\n");
+            return false;
+        }
+    }
+
+    LockFreeRingBufferReader reader(&ring_buffer, SleepFunc);
+    if (!ring_buffer.TryWrite("ABCDEFGHIJ", 10)) {
+        printf("FAIL: First TryWrite returned false\n");
+        return false;
+    }
+    LockFreeRingBufferReservation reservation;
+    if (ring_buffer.TryReserve(10, &reservation) || reservation.Size() != 0) {
+        printf("FAIL: TryReserve should drop when the reader is behind\n");
+        return false;
+    }
+    if (ring_buffer.TryWrite("KLMNOPQRST", 10)) {
+        printf("FAIL: TryWrite should drop when the reader is behind\n");
+        return false;
+    }
+    if (ring_buffer.GetDroppedMessages() != 2 || ring_buffer.GetDroppedBytes() != 20) {
+        printf("FAIL: Dropped %u messages (%u bytes), expected 2 (20 bytes)\n",
+               ring_buffer.GetDroppedMessages(), ring_buffer.GetDroppedBytes());
+        return false;
+    }
+
+    LockFreeRingBufferReadResults results;
+    if (!reader.PeekAvailable(&results)) {
+        printf("FAIL: Reader overflowed\n");
+        return false;
+    }
+    if (!IsBufferEqual("ABCDEFGHIJ", 10, results) || !reader.MarkRead(results.Size())) {
+        printf("FAIL\n");
+        return false;
+    }
+
+    // Once the reader catches up there's room again.
+    if (!ring_buffer.TryWrite("KLMNOPQRST", 10)) {
+        printf("FAIL: TryWrite after read returned false\n");
+        return false;
+    }
+    if (!reader.PeekAvailable(&results) || !IsBufferEqual("KLMNOPQRST", 10, results)) {
+        printf("FAIL\n");
+        return false;
+    }
+
+    // Moving the reader transfers its registration.
+    LockFreeRingBufferReader moved_reader(std::move(reader));
+    if (reader.reader_slot_ != -1 || moved_reader.reader_slot_ < 0 ||
+        ring_buffer.readers_registered_ != 1) {
+        printf("FAIL: Registration not moved\n");
+        return false;
+    }
+
+    printf("PASS\n");
+    return true;
+}
+
+struct CountingNotify {
+    int* count;
+    void Notify() { (*count)++; }
+};
+
+// Test: Compile time sized buffer with a notify policy
+bool TestStaticBuffer() {
+    printf("Test: Static buffer... ");
+
+    uint8_t buffer[16];
+    memset(buffer, 0, sizeof(buffer));
+
+    int notify_count = 0;
+    StaticLockFreeRingBuffer<sizeof(buffer), CountingNotify> ring_buffer(
+        buffer, CountingNotify{&notify_count});
+    LockFreeRingBufferReader reader(&ring_buffer, SleepFunc);
+
+    ring_buffer.Write("1234567890", 10);
+    LockFreeRingBufferReadResults results;
+    if (!reader.PeekAvailable(&results) || !reader.MarkRead(results.Size())) {
+        printf("FAIL: Initial read failed\n");
+        return false;
+    }
+
+    // Wraps around the end of the buffer.
+    ring_buffer.Write("ABCDEFGHIJ", 10);
+    if (ring_buffer.TryWrite("KLMNOPQRST", 10)) {
+        printf("FAIL: TryWrite should drop when the reader is behind\n");
+        return false;
+    }
+    if (notify_count != 2) {
+        printf("FAIL: notify_count was %d, expected 2\n", notify_count);
+        return false;
+    }
+    if (ring_buffer.GetTotalWriteSize() != 20) {
+        printf("FAIL: Total write size should not include the dropped write\n");
+        return false;
+    }
+
+    if (!reader.PeekAvailable(&results)) {
+        printf("FAIL: PeekAvailable returned false\n");
+        return false;
+    }
+    if (results.part2_size != 4 || !IsBufferEqual("ABCDEFGHIJ", 10, results)) {
+        printf("FAIL\n");
+        return false;
+    }
+
+    printf("PASS\n");
+    return true;
+}
+
 // Test: 32bit overflow
 bool Test32BitOverflow() {
     printf("Test: Buffer wraparound... ");
@@ -578,6 +830,43 @@ bool Test32BitOverflow() {
     return true;
 }
 
+// Test: 64bit indexes allow any buffer size
+bool TestNonPowerOfTwoSize() {
+    printf("Test: Non power of 2 size... ");
+
+    uint8_t buffer[10];
+    memset(buffer, 0, sizeof(buffer));
+
+    // Start past where a 32bit index would roll over.
+    LockFreeRingBuffer ring_buffer(buffer, sizeof(buffer));
+    ring_buffer.total_write_size_ = (uint64_t(1) << uint64_t(32)) - uint64_t(4);
+    LockFreeRingBufferReader reader(&ring_buffer, SleepFunc);
+
+    LockFreeRingBufferReadResults results;
+    for (int i = 0; i < 3; i++) {
+        ring_buffer.Write("123456", 6);
+        if (!reader.PeekAvailable(&results)) {
+            printf("FAIL: PeekAvailable returned false\n");
+            return false;
+        }
+        if (!IsBufferEqual("123456", 6, results) || !reader.MarkRead(results.Size())) {
+            printf("FAIL: Write %d\n", i);
+            return false;
+        }
+    }
+
+    // The first write starts at offset 2 (4294967292 % 10), so the second wraps and the third
+    // ends at the end of the buffer.
+    if (results.part1_size != 6 || results.part2_size != 0 ||
+        ring_buffer.total_write_size_ != (uint64_t(1) << uint64_t(32)) + uint64_t(14)) {
+        printf("FAIL: Unexpected buffer position\n");
+        return false;
+    }
+
+    printf("PASS\n");
+    return true;
+}
+
 int main() {
     int passed = 0;
     int failed = 0;
@@ -620,6 +909,33 @@ int main() {
         passed++;
     else
         failed++;
+    if (TestReserveCommit())
+        passed++;
+    else
+        failed++;
+    if (TestReadPastWriteInProgress())
+        passed++;
+    else
+        failed++;
+    if (TestTryWriteBackpressure())
+        passed++;
+    else
+        failed++;
+    if (TestStaticBuffer())
+        passed++;
+    else
+        failed++;
+    if (LockFreeRingBufferBase::HAS_64BIT_INDEX) {
+        if (TestNonPowerOfTwoSize())
+            passed++;
+        else
+            failed++;
+    } else {
+        if (Test32BitOverflow())
+            passed++;
+        else
+            failed++;
+    }
 
     printf("\n=== Results ===\n");
     printf("Passed: %d\n", passed);
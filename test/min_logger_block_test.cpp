@@ -0,0 +1,177 @@
+#include <min_logger/min_logger.h>
+#include <min_logger/min_logger_crc.h>
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static constexpr MinLoggerCRC TEST_ID = 0x12345678;
+static constexpr MinLoggerCRC OTHER_ID = 0x12345679;
+// Shares TEST_ID's slot
+static constexpr MinLoggerCRC COLLIDING_ID = 0x12345698;
+static constexpr size_t BLOCK_HEADER_SIZE = 17;
+static constexpr size_t BLOCK_CRC_START = 6;
+
+struct DecodedMsg {
+    MinLoggerCRC msg_id;
+    uint64_t timestamp;
+    std::vector<uint8_t> payload;
+};
+
+struct DecodedBlock {
+    unsigned thread_id;
+    size_t encoded_len;
+    std::vector<DecodedMsg> msgs;
+};
+
+static std::vector<DecodedBlock> sent_blocks;
+static bool decode_failed = false;
+static uint64_t current_time_ns = 1000;
+
+extern "C" uint64_t min_logger_get_time_nanoseconds() { return current_time_ns; }
+
+static uint64_t ReadVarint(const uint8_t** p) {
+    uint64_t value = 0;
+    unsigned shift = 0;
+    while (**p & 0x80) {
+        value |= uint64_t(*(*p)++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= uint64_t(*(*p)++) << shift;
+    return value;
+}
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    uint16_t sync, body_len;
+    uint32_t crc;
+    uint64_t timestamp;
+    memcpy(&sync, msg, 2);
+    memcpy(&crc, msg + 2, 4);
+    memcpy(&body_len, msg + 6, 2);
+    memcpy(&timestamp, msg + 9, 8);
+    if (sync != 0xFBBF || len_bytes != BLOCK_HEADER_SIZE + body_len ||
+        crc != min_logger_crc::MIN_LOGGER_CRC32_BUFFER(msg + BLOCK_CRC_START,
+                                                       len_bytes - BLOCK_CRC_START)) {
+        decode_failed = true;
+        return;
+    }
+
+    DecodedBlock block = {msg[8], len_bytes, {}};
+    MinLoggerCRC id_slots[32] = {0};
+    const uint8_t* p = msg + BLOCK_HEADER_SIZE;
+    while (p < msg + len_bytes) {
+        DecodedMsg decoded;
+        uint64_t slot_ref = ReadVarint(&p);
+        if (slot_ref == 0) {
+            memcpy(&decoded.msg_id, p, sizeof(decoded.msg_id));
+            p += sizeof(decoded.msg_id);
+            id_slots[decoded.msg_id % 32] = decoded.msg_id;
+        } else {
+            decoded.msg_id = id_slots[slot_ref - 1];
+        }
+        timestamp += ReadVarint(&p);
+        decoded.timestamp = timestamp;
+        size_t payload_len = ReadVarint(&p);
+        decoded.payload.assign(p, p + payload_len);
+        p += payload_len;
+        block.msgs.push_back(decoded);
+    }
+    sent_blocks.push_back(block);
+}
+
+static bool CheckMsg(const DecodedMsg& msg, MinLoggerCRC msg_id, uint64_t timestamp,
+                     size_t payload_len) {
+    if (msg.msg_id != msg_id || msg.timestamp != timestamp || msg.payload.size() != payload_len) {
+        printf("FAIL: Got 0x%08X at %llu with %zu bytes\n", msg.msg_id,
+               (unsigned long long)msg.timestamp, msg.payload.size());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Block Format Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Messages held until flush... ");
+    uint32_t value = 42;
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    current_time_ns += 300;
+    MIN_LOGGER_RECORD_VALUE_ID(OTHER_ID, MIN_LOGGER_INFO, "other", uint32_t, value);
+    current_time_ns += 70000;
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    MIN_LOGGER_LOG_ID(COLLIDING_ID, MIN_LOGGER_INFO, "colliding");
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    if (!sent_blocks.empty()) {
+        printf("FAIL: Block sent before flush\n");
+        return 1;
+    }
+    min_logger_flush_block();
+    if (decode_failed || sent_blocks.size() != 1 || sent_blocks[0].msgs.size() != 5) {
+        printf("FAIL: Expected one block with 5 messages\n");
+        return 1;
+    }
+    const auto& msgs = sent_blocks[0].msgs;
+    if (!CheckMsg(msgs[0], TEST_ID, 1000, 0) || !CheckMsg(msgs[1], OTHER_ID, 1300, 4) ||
+        !CheckMsg(msgs[2], TEST_ID, 71300, 0) || !CheckMsg(msgs[3], COLLIDING_ID, 71300, 0) ||
+        !CheckMsg(msgs[4], TEST_ID, 71300, 0)) {
+        return 1;
+    }
+    // Each message is the slot reference (5 bytes for a new ID), delta, length, and payload. The
+    // last TEST_ID needs the full ID again since COLLIDING_ID replaced it in the slot.
+    size_t expected_len = BLOCK_HEADER_SIZE + (5 + 1 + 1) + (5 + 2 + 1 + 4) + (1 + 3 + 1) +
+                          (5 + 1 + 1) + (5 + 1 + 1);
+    if (sent_blocks[0].encoded_len != expected_len) {
+        printf("FAIL: Block is %zu bytes, expected %zu\n", sent_blocks[0].encoded_len,
+               expected_len);
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Full block is sent... ");
+    sent_blocks.clear();
+    uint8_t array[200] = {0};
+    for (int i = 0; i < 10; i++) {
+        MIN_LOGGER_RECORD_VALUE_ARRAY_ID(OTHER_ID, MIN_LOGGER_INFO, "array", uint8_t, array,
+                                         sizeof(array));
+    }
+    if (decode_failed || sent_blocks.size() != 4) {
+        printf("FAIL: Sent %zu blocks\n", sent_blocks.size());
+        return 1;
+    }
+    for (const auto& block : sent_blocks) {
+        if (block.encoded_len > MIN_LOGGER_BLOCK_SIZE) {
+            printf("FAIL: Block is %zu bytes\n", block.encoded_len);
+            return 1;
+        }
+    }
+    min_logger_flush_block();
+    printf("PASS\n");
+
+    printf("Test: Old block is sent... ");
+    sent_blocks.clear();
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    current_time_ns += MIN_LOGGER_BLOCK_MAX_AGE;
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    if (decode_failed || sent_blocks.size() != 1 || sent_blocks[0].msgs.size() != 1) {
+        printf("FAIL: Expected the first message to be sent\n");
+        return 1;
+    }
+    min_logger_flush_block();
+    printf("PASS\n");
+
+    printf("Test: Block sent on thread exit... ");
+    sent_blocks.clear();
+    unsigned main_thread_id = min_logger_get_thread_idx();
+    std::thread thread([]() { MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test"); });
+    thread.join();
+    if (decode_failed || sent_blocks.size() != 1 || sent_blocks[0].thread_id == main_thread_id) {
+        printf("FAIL: Expected a block from the thread\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr MinLoggerCRC ARRAY_ID = 0x12345678;
+static constexpr MinLoggerCRC CONTINUATION_ID = 0xFFFFFF05;
+static constexpr size_t BINARY_HEADER_SIZE = 16;
+static constexpr size_t MAX_MSG_SIZE = 256;
+static constexpr size_t CONTINUATION_HEADER_SIZE = 12;
+static constexpr size_t NUM_VALUES = 2048;
+
+typedef std::vector<uint8_t> Msg;
+
+static std::vector<Msg> sent_msgs;
+static bool use_writev = false;
+// Pieces passed to min_logger_writev() that pointed into the logged array.
+static size_t uncopied_pieces = 0;
+static const uint16_t* logged_values = nullptr;
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    sent_msgs.emplace_back(msg, msg + len_bytes);
+}
+
+extern "C" bool min_logger_writev(const MinLoggerIoVec* iov, size_t iov_count) {
+    if (!use_writev) {
+        return false;
+    }
+    Msg msg;
+    for (size_t i = 0; i < iov_count; i++) {
+        const uint8_t* data = static_cast<const uint8_t*>(iov[i].data);
+        const uint8_t* values = reinterpret_cast<const uint8_t*>(logged_values);
+        if (data >= values && data < values + NUM_VALUES * sizeof(uint16_t)) {
+            uncopied_pieces++;
+        }
+        msg.insert(msg.end(), data, data + iov[i].len);
+    }
+    sent_msgs.push_back(msg);
+    return true;
+}
+
+static void RecordArray(const uint16_t* values, size_t num_values) {
+    logged_values = values;
+    MIN_LOGGER_RECORD_VALUE_ARRAY_ID(ARRAY_ID, MIN_LOGGER_INFO, "array", uint16_t, values,
+                                     num_values);
+}
+
+// Join the continuation messages in sent_msgs back into the array's payload.
+static bool JoinBinary(std::vector<uint8_t>* payload) {
+    for (const Msg& msg : sent_msgs) {
+        MinLoggerCRC msg_id = 0;
+        MinLoggerCRC continued_id = 0;
+        uint32_t offset = 0;
+        uint32_t total_len = 0;
+        if (msg.size() > MAX_MSG_SIZE ||
+            msg.size() < BINARY_HEADER_SIZE + CONTINUATION_HEADER_SIZE ||
+            msg[2] != msg.size() - BINARY_HEADER_SIZE) {
+            printf("FAIL: Wrong message size %zu\n", msg.size());
+            return false;
+        }
+        memcpy(&msg_id, msg.data() + 4, sizeof(msg_id));
+        memcpy(&continued_id, msg.data() + BINARY_HEADER_SIZE, sizeof(continued_id));
+        memcpy(&offset, msg.data() + BINARY_HEADER_SIZE + 4, sizeof(offset));
+        memcpy(&total_len, msg.data() + BINARY_HEADER_SIZE + 8, sizeof(total_len));
+        if (msg_id != CONTINUATION_ID || continued_id != ARRAY_ID || offset != payload->size() ||
+            total_len != NUM_VALUES * sizeof(uint16_t)) {
+            printf("FAIL: Wrong continuation header at offset %zu\n", payload->size());
+            return false;
+        }
+        payload->insert(payload->end(), msg.begin() + BINARY_HEADER_SIZE + CONTINUATION_HEADER_SIZE,
+                        msg.end());
+    }
+    return true;
+}
+
+static bool CheckJoined(const uint16_t* values) {
+    std::vector<uint8_t> payload;
+    if (!JoinBinary(&payload)) {
+        return false;
+    }
+    if (payload.size() != NUM_VALUES * sizeof(uint16_t) ||
+        memcmp(payload.data(), values, payload.size()) != 0) {
+        printf("FAIL: Joined payload doesn't match\n");
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Continuation Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+    std::vector<uint16_t> values(NUM_VALUES);
+    for (size_t i = 0; i < NUM_VALUES; i++) {
+        values[i] = i * 3;
+    }
+    // Send the thread name first so it isn't mixed in with the tested messages.
+    RecordArray(values.data(), 1);
+    sent_msgs.clear();
+
+    printf("Test: Short arrays are sent in one message... ");
+    RecordArray(values.data(), 10);
+    if (sent_msgs.size() != 1 ||
+        sent_msgs[0].size() != BINARY_HEADER_SIZE + 10 * sizeof(uint16_t)) {
+        printf("FAIL: Expected a single message\n");
+        return 1;
+    }
+    MinLoggerCRC msg_id = 0;
+    memcpy(&msg_id, sent_msgs[0].data() + 4, sizeof(msg_id));
+    if (msg_id != ARRAY_ID) {
+        printf("FAIL: Wrong message ID\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Long arrays are split into continuations... ");
+    sent_msgs.clear();
+    RecordArray(values.data(), NUM_VALUES);
+    if (!CheckJoined(values.data())) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Continuations pass the payload to writev without copying... ");
+    sent_msgs.clear();
+    use_writev = true;
+    RecordArray(values.data(), NUM_VALUES);
+    use_writev = false;
+    if (!CheckJoined(values.data())) {
+        return 1;
+    }
+    if (uncopied_pieces != sent_msgs.size()) {
+        printf("FAIL: Only %zu of %zu pieces were passed in place\n", uncopied_pieces,
+               sent_msgs.size());
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Micro format continuations have a length prefix... ");
+    min_logger_set_serialize_format(MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT);
+    // Skip the sync marker sent before the first message.
+    RecordArray(values.data(), 1);
+    sent_msgs.clear();
+    RecordArray(values.data(), NUM_VALUES);
+    size_t joined_len = 0;
+    for (const Msg& msg : sent_msgs) {
+        uint16_t truncated_id = 0;
+        if (msg.size() < 5 + CONTINUATION_HEADER_SIZE) {
+            printf("FAIL: Micro continuation too short\n");
+            return 1;
+        }
+        memcpy(&truncated_id, msg.data(), sizeof(truncated_id));
+        if (truncated_id != (CONTINUATION_ID & 0xFFFF) || msg[4] != msg.size() - 5) {
+            printf("FAIL: Wrong micro continuation\n");
+            return 1;
+        }
+        joined_len += msg.size() - 5 - CONTINUATION_HEADER_SIZE;
+    }
+    if (joined_len != NUM_VALUES * sizeof(uint16_t)) {
+        printf("FAIL: Continuations have %zu bytes\n", joined_len);
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if !MIN_LOGGER_CYCLE_COUNTER_TIME
+    #error "This test must be built with MIN_LOGGER_CYCLE_COUNTER_TIME=1"
+#endif
+
+static constexpr MinLoggerCRC TEST_ID = 0x12345678;
+static constexpr MinLoggerCRC TIME_CALIBRATION_MSG_ID = 0XFFFFFF02;
+
+struct SentMsg {
+    MinLoggerCRC msg_id;
+    uint64_t timestamp;
+    uint64_t payload[3];
+};
+
+static std::vector<SentMsg> sent_msgs;
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    SentMsg sent = {};
+    memcpy(&sent.msg_id, msg + 4, sizeof(sent.msg_id));
+    memcpy(&sent.timestamp, msg + 8, sizeof(sent.timestamp));
+    if (len_bytes >= 16 + sizeof(sent.payload)) {
+        memcpy(sent.payload, msg + 16, sizeof(sent.payload));
+    }
+    sent_msgs.push_back(sent);
+}
+
+static std::vector<SentMsg> GetMessages(MinLoggerCRC msg_id) {
+    std::vector<SentMsg> msgs;
+    for (const auto& msg : sent_msgs) {
+        if (msg.msg_id == msg_id) {
+            msgs.push_back(msg);
+        }
+    }
+    return msgs;
+}
+
+int main() {
+    printf("\n=== Cycle Counter Time Tests ===\n\n");
+
+    printf("Test: Calibration sent before first message... ");
+    uint64_t before_ns = min_logger_get_time_nanoseconds();
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "first");
+    uint64_t after_ns = min_logger_get_time_nanoseconds();
+    auto calibrations = GetMessages(TIME_CALIBRATION_MSG_ID);
+    auto logs = GetMessages(TEST_ID);
+    if (calibrations.size() != 1 || logs.size() != 1) {
+        printf("FAIL: Sent %zu calibrations, %zu logs\n", calibrations.size(), logs.size());
+        return 1;
+    }
+    if (sent_msgs.back().msg_id != TEST_ID) {
+        printf("FAIL: Log wasn't sent last\n");
+        return 1;
+    }
+    const SentMsg calibration = calibrations[0];
+    if (calibration.payload[1] < before_ns || calibration.payload[1] > after_ns) {
+        printf("FAIL: Calibration time out of range\n");
+        return 1;
+    }
+    if (calibration.payload[2] != 64) {
+        printf("FAIL: Expected 64bit counter, got %llu\n",
+               (unsigned long long)calibration.payload[2]);
+        return 1;
+    }
+    if (calibration.payload[0] < logs[0].timestamp || calibration.timestamp < logs[0].timestamp) {
+        printf("FAIL: Calibration ticks before message ticks\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Calibration repeats... ");
+    sent_msgs.clear();
+    // Log until a second calibration is sent.
+    for (int i = 0; i < 10000000 && GetMessages(TIME_CALIBRATION_MSG_ID).empty(); i++) {
+        MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "repeat");
+        if (sent_msgs.size() > 1000) {
+            sent_msgs.erase(sent_msgs.begin(), sent_msgs.end() - 1);
+        }
+    }
+    calibrations = GetMessages(TIME_CALIBRATION_MSG_ID);
+    if (calibrations.size() != 1) {
+        printf("FAIL: Sent %zu calibrations\n", calibrations.size());
+        return 1;
+    }
+    uint64_t elapsed_ticks = calibrations[0].payload[0] - calibration.payload[0];
+    if (elapsed_ticks < MIN_LOGGER_TIME_CALIBRATION_TICKS ||
+        calibrations[0].payload[1] <= calibration.payload[1]) {
+        printf("FAIL: Calibration sent after %llu ticks\n", (unsigned long long)elapsed_ticks);
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
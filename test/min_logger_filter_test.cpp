@@ -0,0 +1,89 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if MIN_LOGGER_FILTER_BITS != 64
+    #error "This test must be built with MIN_LOGGER_FILTER_BITS=64"
+#endif
+
+MIN_LOGGER_FILE_TAGS("test");
+
+static constexpr MinLoggerCRC FILTERED_ID = 0x12345678;
+static constexpr MinLoggerCRC OTHER_ID = 0x12345679;
+// Shares FILTERED_ID's bit
+static constexpr MinLoggerCRC COLLIDING_ID = 0x12345638;
+
+static std::vector<MinLoggerCRC> sent_ids;
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    MinLoggerCRC msg_id = 0;
+    memcpy(&msg_id, msg + 4, sizeof(msg_id));
+    sent_ids.push_back(msg_id);
+}
+
+static void LogAll() {
+    sent_ids.clear();
+    MIN_LOGGER_LOG_ID(FILTERED_ID, MIN_LOGGER_INFO, "filtered");
+    MIN_LOGGER_LOG_ID(OTHER_ID, MIN_LOGGER_INFO, "other");
+    uint32_t value = 1;
+    MIN_LOGGER_RECORD_VALUE_ID(COLLIDING_ID, MIN_LOGGER_INFO, "colliding", uint32_t, value);
+}
+
+static bool CheckSent(const std::vector<MinLoggerCRC>& expected) {
+    if (sent_ids != expected) {
+        printf("FAIL: Sent %zu messages, expected %zu\n", sent_ids.size(), expected.size());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Runtime ID Filter Tests ===\n\n");
+
+    printf("Test: Level filters messages... ");
+    min_logger_set_level(MIN_LOGGER_DEBUG);
+    LogAll();
+    if (!CheckSent({})) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Filter enables IDs... ");
+    min_logger_filter_set_ids(&FILTERED_ID, 1, true);
+    LogAll();
+    if (!CheckSent({FILTERED_ID, COLLIDING_ID})) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Level still applies with filter... ");
+    min_logger_set_level(MIN_LOGGER_INFO);
+    LogAll();
+    if (!CheckSent({FILTERED_ID, OTHER_ID, COLLIDING_ID})) {
+        return 1;
+    }
+    min_logger_set_level(MIN_LOGGER_DEBUG);
+    printf("PASS\n");
+
+    printf("Test: Remove IDs... ");
+    const MinLoggerCRC ids[] = {OTHER_ID, FILTERED_ID};
+    min_logger_filter_set_ids(ids, 2, true);
+    min_logger_filter_set_ids(&COLLIDING_ID, 1, false);
+    LogAll();
+    if (!CheckSent({OTHER_ID})) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Clear... ");
+    min_logger_filter_clear();
+    LogAll();
+    if (!CheckSent({})) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
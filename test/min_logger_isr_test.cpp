@@ -0,0 +1,181 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr MinLoggerCRC LOG_ID = 0x12345678;
+static constexpr MinLoggerCRC VALUE_ID = 0x12345679;
+static constexpr MinLoggerCRC THREAD_NAME_ID = 0xFFFFFF00;
+static constexpr size_t BINARY_HEADER_SIZE = 16;
+
+struct Large {
+    uint8_t data[MIN_LOGGER_ISR_MAX_PAYLOAD + 8];
+};
+
+typedef std::vector<uint8_t> Msg;
+
+static std::vector<Msg> isr_msgs;
+static size_t task_writes = 0;
+static size_t thread_name_calls = 0;
+static unsigned current_core = 0;
+static uint64_t current_time_ns = 1000;
+
+extern "C" uint64_t min_logger_get_time_nanoseconds() { return current_time_ns; }
+
+extern "C" unsigned min_logger_get_core_id() { return current_core; }
+
+extern "C" size_t min_logger_get_thread_name(char* thread_name, size_t max_len) {
+    thread_name_calls++;
+    return 0;
+}
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) { task_writes++; }
+
+extern "C" void min_logger_isr_write(const uint8_t* msg, size_t len_bytes) {
+    isr_msgs.emplace_back(msg, msg + len_bytes);
+}
+
+static void LogIsr() { MIN_LOGGER_LOG_ISR_ID(LOG_ID, MIN_LOGGER_INFO, "isr"); }
+
+static void RecordIsr(uint32_t value) {
+    MIN_LOGGER_RECORD_VALUE_ISR_ID(VALUE_ID, MIN_LOGGER_INFO, "isr_value", uint32_t, value);
+}
+
+static void RecordLarge(const Large& value) {
+    MIN_LOGGER_RECORD_VALUE_ISR_ID(VALUE_ID, MIN_LOGGER_INFO, "large", Large, value);
+}
+
+static bool CheckBinary(const Msg& msg, MinLoggerCRC id, uint8_t thread_id, size_t payload_len) {
+    MinLoggerCRC msg_id = 0;
+    uint64_t timestamp = 0;
+    if (msg.size() == BINARY_HEADER_SIZE + payload_len) {
+        memcpy(&msg_id, msg.data() + 4, sizeof(msg_id));
+        memcpy(&timestamp, msg.data() + 8, sizeof(timestamp));
+    }
+    if (msg_id != id || msg[2] != payload_len || msg[3] != thread_id ||
+        timestamp != current_time_ns) {
+        printf("FAIL: Expected message 0x%08X from thread %u with %zu bytes, got 0x%08X from %u\n",
+               id, thread_id, payload_len, msg_id, msg[3]);
+        return false;
+    }
+    return true;
+}
+
+static bool CheckNoTaskState() {
+    if (task_writes != 0 || thread_name_calls != 0) {
+        printf("FAIL: Expected no task writes or thread name lookups, got %zu and %zu\n",
+               task_writes, thread_name_calls);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== ISR Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Messages are tagged with the core... ");
+    LogIsr();
+    current_core = 1;
+    uint32_t value = 42;
+    RecordIsr(value);
+    if (isr_msgs.size() != 2 || !CheckBinary(isr_msgs[0], LOG_ID, 0xFF, 0) ||
+        !CheckBinary(isr_msgs[1], VALUE_ID, 0xFE, sizeof(uint32_t)) ||
+        memcmp(isr_msgs[1].data() + BINARY_HEADER_SIZE, &value, sizeof(value)) != 0) {
+        return 1;
+    }
+    if (!CheckNoTaskState()) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Core names are sent without the thread machinery... ");
+    isr_msgs.clear();
+    min_logger_write_thread_names();
+    LogIsr();
+    LogIsr();
+    const char expected_name[] = "isr_core1";
+    if (isr_msgs.size() != 3 ||
+        !CheckBinary(isr_msgs[0], THREAD_NAME_ID, 0xFE, sizeof(expected_name) - 1) ||
+        memcmp(isr_msgs[0].data() + BINARY_HEADER_SIZE, expected_name,
+               sizeof(expected_name) - 1) != 0 ||
+        !CheckBinary(isr_msgs[1], LOG_ID, 0xFE, 0) || !CheckBinary(isr_msgs[2], LOG_ID, 0xFE, 0)) {
+        printf("FAIL: Expected the name then 2 messages, got %zu messages\n", isr_msgs.size());
+        return 1;
+    }
+    if (!CheckNoTaskState()) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Payloads are truncated... ");
+    isr_msgs.clear();
+    Large large = {};
+    RecordLarge(large);
+    if (isr_msgs.size() != 1 ||
+        !CheckBinary(isr_msgs[0], VALUE_ID, 0xFE, MIN_LOGGER_ISR_MAX_PAYLOAD)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Micro messages start with a time sync... ");
+    isr_msgs.clear();
+    current_core = 0;
+    min_logger_set_serialize_format(MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT);
+    RecordIsr(value);
+    // TIME_SYNC (0xFFFFFF03) header with the escaped thread ID 0xFF, the timestamp, then the
+    // message header with no time delta.
+    Msg expected_micro = {0x03, 0xFF, 0x0F, 0x00, 0xFF};
+    expected_micro.insert(expected_micro.end(), (uint8_t*)&current_time_ns,
+                          (uint8_t*)&current_time_ns + sizeof(current_time_ns));
+    expected_micro.insert(expected_micro.end(), {0x79, 0x56, 0x0F, 0x00, 0xFF});
+    expected_micro.insert(expected_micro.end(), (uint8_t*)&value, (uint8_t*)&value + sizeof(value));
+    // Core 0 hasn't sent its name since min_logger_write_thread_names(), so that comes first.
+    if (isr_msgs.size() != 2 || isr_msgs[1] != expected_micro) {
+        printf("FAIL: Wrong micro message\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Block messages are sent in their own block... ");
+    isr_msgs.clear();
+    min_logger_set_serialize_format(MIN_LOGGER_BLOCK_BINARY_SERIALIZED_FORMAT);
+    RecordIsr(value);
+    // Header is sync(2) crc(4) body_len(2) thread_id(1) base_timestamp(8). The body is a new ID,
+    // a time delta of 0, and the length.
+    Msg expected_body = {0x00, 0x79, 0x56, 0x34, 0x12, 0x00, sizeof(value)};
+    expected_body.insert(expected_body.end(), (uint8_t*)&value, (uint8_t*)&value + sizeof(value));
+    uint64_t base_timestamp = 0;
+    if (isr_msgs.size() == 1 && isr_msgs[0].size() == 17 + expected_body.size()) {
+        memcpy(&base_timestamp, isr_msgs[0].data() + 9, sizeof(base_timestamp));
+    }
+    if (base_timestamp != current_time_ns || isr_msgs[0][0] != 0xBF || isr_msgs[0][1] != 0xFB ||
+        isr_msgs[0][6] != expected_body.size() || isr_msgs[0][8] != 0xFF ||
+        Msg(isr_msgs[0].begin() + 17, isr_msgs[0].end()) != expected_body) {
+        printf("FAIL: Wrong block\n");
+        return 1;
+    }
+    uint32_t crc = 0;
+    memcpy(&crc, isr_msgs[0].data() + 2, sizeof(crc));
+    if (crc != min_logger_crc::MIN_LOGGER_CRC32_BUFFER(isr_msgs[0].data() + 6,
+                                                       isr_msgs[0].size() - 6)) {
+        printf("FAIL: Wrong block CRC\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Filtered messages aren't sent... ");
+    isr_msgs.clear();
+    min_logger_set_level(MIN_LOGGER_DEBUG);
+    LogIsr();
+    RecordIsr(value);
+    if (!isr_msgs.empty() || !CheckNoTaskState()) {
+        printf("FAIL: Expected no messages, got %zu\n", isr_msgs.size());
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr MinLoggerCRC TEST_ID = 0x12345678;
+static constexpr uint16_t MICRO_SYNC_TRUNCATED_ID = 0xFF04;
+static constexpr uint32_t MICRO_SYNC_MAGIC = 0x5AA5C33C;
+
+struct SentMsg {
+    uint16_t truncated_id;
+    uint64_t delta_ns;
+    uint32_t magic;
+    uint64_t sync_ns;
+};
+
+static std::vector<SentMsg> sent_msgs;
+static uint64_t current_time_ns = 1000;
+
+extern "C" uint64_t min_logger_get_time_nanoseconds() { return current_time_ns; }
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    static constexpr uint64_t SCALES[] = {1ull, 1000ull, 1000000ull, 1000000000ull};
+    SentMsg sent = {};
+    memcpy(&sent.truncated_id, msg, sizeof(sent.truncated_id));
+    uint16_t bitfield = 0;
+    memcpy(&bitfield, msg + 2, sizeof(bitfield));
+    sent.delta_ns = ((bitfield >> 6) & 0x3FF) * SCALES[(bitfield >> 4) & 0x3];
+    if (sent.truncated_id == MICRO_SYNC_TRUNCATED_ID && len_bytes == 16) {
+        memcpy(&sent.magic, msg + 4, sizeof(sent.magic));
+        memcpy(&sent.sync_ns, msg + 8, sizeof(sent.sync_ns));
+    }
+    sent_msgs.push_back(sent);
+}
+
+static bool CheckSync(const SentMsg& msg, uint64_t sync_ns) {
+    if (msg.truncated_id != MICRO_SYNC_TRUNCATED_ID || msg.magic != MICRO_SYNC_MAGIC ||
+        msg.sync_ns != sync_ns) {
+        printf("FAIL: Expected sync marker at %llu\n", (unsigned long long)sync_ns);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Micro Sync Marker Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Log starts with sync marker... ");
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    current_time_ns += 5000;
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    if (sent_msgs.size() != 3 || !CheckSync(sent_msgs[0], 1000)) {
+        return 1;
+    }
+    if (sent_msgs[1].delta_ns != 0 || sent_msgs[2].delta_ns != 5000) {
+        printf("FAIL: Wrong deltas after sync\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Sync marker after interval... ");
+    sent_msgs.clear();
+    current_time_ns += MIN_LOGGER_MICRO_SYNC_INTERVAL - 5000 - 1;
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    current_time_ns += 1;
+    MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    if (sent_msgs.size() != 3 || sent_msgs[0].truncated_id == MICRO_SYNC_TRUNCATED_ID ||
+        !CheckSync(sent_msgs[1], current_time_ns) || sent_msgs[2].delta_ns != 0) {
+        printf("FAIL: Expected sync marker only after the interval\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static constexpr MinLoggerCRC TEST_ID = 0x12345678;
+static constexpr uint16_t TIME_SYNC_TRUNCATED_ID = 0xFF03;
+
+struct SentMsg {
+    uint16_t truncated_id;
+    unsigned thread_id;
+    uint64_t delta_ns;
+    uint64_t sync_ns;
+};
+
+static std::vector<SentMsg> sent_msgs;
+static uint64_t current_time_ns = 0;
+
+extern "C" uint64_t min_logger_get_time_nanoseconds() { return current_time_ns; }
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    static constexpr uint64_t SCALES[] = {1ull, 1000ull, 1000000ull, 1000000000ull};
+    SentMsg sent = {};
+    memcpy(&sent.truncated_id, msg, sizeof(sent.truncated_id));
+    uint16_t bitfield = 0;
+    memcpy(&bitfield, msg + 2, sizeof(bitfield));
+    sent.thread_id = bitfield & 0xF;
+    sent.delta_ns = ((bitfield >> 6) & 0x3FF) * SCALES[(bitfield >> 4) & 0x3];
+    if (sent.truncated_id == TIME_SYNC_TRUNCATED_ID && len_bytes >= 4 + sizeof(sent.sync_ns)) {
+        memcpy(&sent.sync_ns, msg + 4, sizeof(sent.sync_ns));
+    }
+    sent_msgs.push_back(sent);
+}
+
+// Logs a message at each time, then checks the timestamps the parser would reconstruct.
+// timestamp is the thread's last reconstructed timestamp, or 0 if it hasn't been synced.
+static bool CheckThreadTimeline(const std::vector<uint64_t>& times, uint64_t max_error_ns,
+                                uint64_t* timestamp) {
+    sent_msgs.clear();
+    for (uint64_t time : times) {
+        current_time_ns = time;
+        MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    }
+
+    bool synced = *timestamp != 0;
+    size_t log_count = 0;
+    for (const auto& msg : sent_msgs) {
+        if (msg.truncated_id == TIME_SYNC_TRUNCATED_ID) {
+            synced = true;
+            *timestamp = msg.sync_ns;
+            continue;
+        }
+        if (!synced) {
+            printf("FAIL: Message before TIME_SYNC\n");
+            return false;
+        }
+        *timestamp += msg.delta_ns;
+        uint64_t expected = times[log_count++];
+        uint64_t error = (*timestamp > expected) ? *timestamp - expected : expected - *timestamp;
+        if (error > max_error_ns) {
+            printf("FAIL: Timestamp %llu expected %llu\n", (unsigned long long)*timestamp,
+                   (unsigned long long)expected);
+            return false;
+        }
+    }
+    if (log_count != times.size()) {
+        printf("FAIL: Sent %zu messages, expected %zu\n", log_count, times.size());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Per-Thread Micro Format Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_MICRO_THREAD_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    uint64_t main_timestamp = 0;
+
+    printf("Test: Truncation doesn't accumulate... ");
+    // Each 1234567ns delta would be truncated to 1ms, so the error would grow by 234567ns per
+    // message if it accumulated.
+    std::vector<uint64_t> times;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        times.push_back(i * 1234567);
+    }
+    if (!CheckThreadTimeline(times, 1000000, &main_timestamp)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Long gap resyncs... ");
+    times = {times.back() + 1, times.back() + 2000000000000ull, times.back() + 2000000000001ull};
+    if (!CheckThreadTimeline(times, 1000000, &main_timestamp)) {
+        return 1;
+    }
+    if (sent_msgs[0].truncated_id == TIME_SYNC_TRUNCATED_ID ||
+        sent_msgs[1].truncated_id != TIME_SYNC_TRUNCATED_ID) {
+        printf("FAIL: Expected TIME_SYNC only before the long gap\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: New thread starts with TIME_SYNC... ");
+    bool passed = false;
+    unsigned first_thread_id = sent_msgs[0].thread_id;
+    // The other thread's delta state doesn't affect this one.
+    std::thread thread([&]() {
+        uint64_t thread_timestamp = 0;
+        passed = CheckThreadTimeline({1000, 2000}, 0, &thread_timestamp);
+    });
+    thread.join();
+    if (!passed) {
+        return 1;
+    }
+    if (sent_msgs[0].truncated_id != TIME_SYNC_TRUNCATED_ID ||
+        sent_msgs[0].thread_id == first_thread_id) {
+        printf("FAIL: Expected TIME_SYNC from a new thread ID\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
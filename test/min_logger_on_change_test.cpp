@@ -0,0 +1,114 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr MinLoggerCRC VALUE_ID = 0x12345678;
+static constexpr MinLoggerCRC STRUCT_ID = 0x12345679;
+
+struct Status {
+    uint16_t mode;
+    uint16_t flags;
+    uint32_t errors;
+};
+
+struct SentMsg {
+    MinLoggerCRC msg_id;
+    uint8_t payload_len;
+    uint8_t payload[sizeof(Status)];
+};
+
+static std::vector<SentMsg> sent_msgs;
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    SentMsg sent = {};
+    memcpy(&sent.msg_id, msg + 4, sizeof(sent.msg_id));
+    // Skip the thread name message.
+    if (len_bytes < 16 || sent.msg_id == 0xFFFFFF00) {
+        return;
+    }
+    sent.payload_len = msg[2];
+    memcpy(sent.payload, msg + 16, sent.payload_len);
+    sent_msgs.push_back(sent);
+}
+
+static void RecordValue(uint32_t value) {
+    MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(VALUE_ID, MIN_LOGGER_INFO, "value", uint32_t, value);
+}
+
+static void RecordStatus(const Status& status) {
+    MIN_LOGGER_RECORD_VALUE_ON_CHANGE_ID(STRUCT_ID, MIN_LOGGER_INFO, "status", Status, status);
+}
+
+static bool CheckValues(const std::vector<uint32_t>& expected) {
+    if (sent_msgs.size() != expected.size()) {
+        printf("FAIL: Expected %zu messages, got %zu\n", expected.size(), sent_msgs.size());
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        uint32_t value = 0;
+        memcpy(&value, sent_msgs[i].payload, sizeof(value));
+        if (sent_msgs[i].msg_id != VALUE_ID || sent_msgs[i].payload_len != sizeof(uint32_t) ||
+            value != expected[i]) {
+            printf("FAIL: Expected message %zu to be %u, got %u\n", i, expected[i], value);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== On Change Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Only changed values are sent... ");
+    // The first value is sent even though it matches the zeroed cache.
+    for (uint32_t value : {0, 0, 0, 7, 7, 3, 3, 3, 0}) {
+        RecordValue(value);
+    }
+    if (!CheckValues({0, 7, 3, 0})) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Keyframe resends the unchanged value once... ");
+    sent_msgs.clear();
+    min_logger_request_keyframe();
+    RecordValue(0);
+    RecordValue(0);
+    if (!CheckValues({0})) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Struct fields are compared... ");
+    sent_msgs.clear();
+    Status status = {1, 2, 3};
+    RecordStatus(status);
+    RecordStatus(status);
+    status.errors++;
+    RecordStatus(status);
+    if (sent_msgs.size() != 2 || sent_msgs[1].msg_id != STRUCT_ID ||
+        sent_msgs[1].payload_len != sizeof(Status) ||
+        memcmp(sent_msgs[1].payload, &status, sizeof(Status)) != 0) {
+        printf("FAIL: Expected 2 status messages, got %zu\n", sent_msgs.size());
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Filtered calls don't update the cache... ");
+    sent_msgs.clear();
+    min_logger_set_level(MIN_LOGGER_DEBUG);
+    RecordValue(5);
+    min_logger_set_level(MIN_LOGGER_INFO);
+    RecordValue(5);
+    RecordValue(5);
+    if (!CheckValues({5})) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
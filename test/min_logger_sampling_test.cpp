@@ -0,0 +1,126 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr MinLoggerCRC EVERY_N_ID = 0x12345678;
+static constexpr MinLoggerCRC EVERY_MS_ID = 0x12345679;
+static constexpr MinLoggerCRC RATE_LIMITED_ID = 0x1234567A;
+
+struct SentMsg {
+    MinLoggerCRC msg_id;
+    uint8_t payload_len;
+    uint32_t value;
+};
+
+static std::vector<SentMsg> sent_msgs;
+static uint64_t current_time_ns = 1000;
+
+extern "C" uint64_t min_logger_get_time_nanoseconds() { return current_time_ns; }
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    // Skip the thread name message.
+    if (len_bytes < 16 || msg[2] > 4) {
+        return;
+    }
+    SentMsg sent = {};
+    sent.payload_len = msg[2];
+    memcpy(&sent.msg_id, msg + 4, sizeof(sent.msg_id));
+    memcpy(&sent.value, msg + 16, sent.payload_len);
+    sent_msgs.push_back(sent);
+}
+
+static void EveryN(uint32_t value) {
+    MIN_LOGGER_RECORD_VALUE_EVERY_N_ID(EVERY_N_ID, MIN_LOGGER_INFO, 3, "value", uint32_t, value);
+}
+
+static void EveryMs() { MIN_LOGGER_LOG_EVERY_MS_ID(EVERY_MS_ID, MIN_LOGGER_INFO, 10, "every ms"); }
+
+static void RateLimited() {
+    MIN_LOGGER_LOG_RATE_LIMITED_ID(RATE_LIMITED_ID, MIN_LOGGER_INFO, 100, 2, "rate limited");
+}
+
+static bool CheckCount(size_t expected) {
+    if (sent_msgs.size() != expected) {
+        printf("FAIL: Expected %zu messages, got %zu\n", expected, sent_msgs.size());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Sampling Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Every N sends every Nth call... ");
+    for (uint32_t i = 0; i < 7; i++) {
+        EveryN(i);
+    }
+    if (!CheckCount(3)) {
+        return 1;
+    }
+    if (sent_msgs[0].value != 0 || sent_msgs[1].value != 3 || sent_msgs[2].value != 6 ||
+        sent_msgs[0].payload_len != sizeof(uint32_t)) {
+        printf("FAIL: Wrong values sent\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Filtered calls don't count as samples... ");
+    sent_msgs.clear();
+    min_logger_set_level(MIN_LOGGER_DEBUG);
+    EveryN(100);
+    EveryN(101);
+    min_logger_set_level(MIN_LOGGER_INFO);
+    for (uint32_t i = 7; i < 10; i++) {
+        EveryN(i);
+    }
+    if (!CheckCount(1) || sent_msgs[0].value != 9) {
+        printf("FAIL: Expected the 10th enabled call to be sent\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Every ms sends once per period... ");
+    sent_msgs.clear();
+    EveryMs();
+    EveryMs();
+    current_time_ns += 10000000 - 1;
+    EveryMs();
+    current_time_ns += 1;
+    EveryMs();
+    EveryMs();
+    if (!CheckCount(2)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Rate limit allows a burst, then the rate... ");
+    sent_msgs.clear();
+    for (int i = 0; i < 5; i++) {
+        RateLimited();
+    }
+    if (!CheckCount(2)) {
+        return 1;
+    }
+    // The limit is 100 per second, so a message is allowed every 10ms.
+    current_time_ns += 10000000;
+    RateLimited();
+    RateLimited();
+    if (!CheckCount(3)) {
+        return 1;
+    }
+    // The burst refills while the site is idle, but no further.
+    current_time_ns += 1000000000;
+    for (int i = 0; i < 5; i++) {
+        RateLimited();
+    }
+    if (!CheckCount(5) || sent_msgs[4].msg_id != RATE_LIMITED_ID) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <min_logger/min_logger.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr MinLoggerCRC OUTER_ID = 0x12345678;
+static constexpr MinLoggerCRC INNER_ID = 0x12345679;
+static constexpr MinLoggerCRC C_SCOPE_ID = 0x1234567A;
+
+struct SentMsg {
+    MinLoggerCRC msg_id;
+    uint64_t timestamp;
+    uint8_t payload_len;
+    uint32_t duration;
+};
+
+static std::vector<SentMsg> sent_msgs;
+static uint64_t current_time_ns = 1000;
+
+extern "C" uint64_t min_logger_get_time_nanoseconds() { return current_time_ns; }
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    // Skip the thread name message.
+    if (len_bytes < 16 || msg[2] > 4) {
+        return;
+    }
+    SentMsg sent = {};
+    sent.payload_len = msg[2];
+    memcpy(&sent.msg_id, msg + 4, sizeof(sent.msg_id));
+    memcpy(&sent.timestamp, msg + 8, sizeof(sent.timestamp));
+    memcpy(&sent.duration, msg + 16, sent.payload_len);
+    sent_msgs.push_back(sent);
+}
+
+static bool CheckScope(const SentMsg& msg, MinLoggerCRC id, uint64_t end_ns, uint32_t duration) {
+    if (msg.msg_id != id || msg.payload_len != sizeof(uint32_t) || msg.timestamp != end_ns ||
+        msg.duration != duration) {
+        printf("FAIL: Expected scope 0x%08X ending at %llu lasting %u, got 0x%08X at %llu lasting "
+               "%u\n",
+               id, (unsigned long long)end_ns, duration, msg.msg_id,
+               (unsigned long long)msg.timestamp, msg.duration);
+        return false;
+    }
+    return true;
+}
+
+static void TimedScope(uint64_t duration_ns) {
+    MIN_LOGGER_SCOPE_ID(OUTER_ID, MIN_LOGGER_INFO, "outer");
+    current_time_ns += duration_ns;
+}
+
+static void NestedScopes() {
+    MIN_LOGGER_SCOPE_ID(OUTER_ID, MIN_LOGGER_INFO, "outer");
+    current_time_ns += 100;
+    {
+        MIN_LOGGER_SCOPE_ID(INNER_ID, MIN_LOGGER_INFO, "inner");
+        current_time_ns += 200;
+    }
+    current_time_ns += 300;
+}
+
+static void CScope() {
+    MIN_LOGGER_SCOPE_BEGIN_ID(0x1234567A, MIN_LOGGER_INFO, "c_scope");
+    current_time_ns += 400;
+    MIN_LOGGER_SCOPE_END_ID(0x1234567A, MIN_LOGGER_INFO, "c_scope");
+}
+
+int main() {
+    printf("\n=== Scope Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Scope sends one message with its duration... ");
+    TimedScope(1500);
+    if (sent_msgs.size() != 1 || !CheckScope(sent_msgs[0], OUTER_ID, 2500, 1500)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Nested scopes send the inner one first... ");
+    sent_msgs.clear();
+    uint64_t start_ns = current_time_ns;
+    NestedScopes();
+    if (sent_msgs.size() != 2 || !CheckScope(sent_msgs[0], INNER_ID, start_ns + 300, 200) ||
+        !CheckScope(sent_msgs[1], OUTER_ID, start_ns + 600, 600)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: C begin and end pair... ");
+    sent_msgs.clear();
+    CScope();
+    if (sent_msgs.size() != 1 || !CheckScope(sent_msgs[0], C_SCOPE_ID, current_time_ns, 400)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Long scope saturates its duration... ");
+    sent_msgs.clear();
+    TimedScope(uint64_t(UINT32_MAX) + 1000);
+    if (sent_msgs.size() != 1 ||
+        !CheckScope(sent_msgs[0], OUTER_ID, current_time_ns, UINT32_MAX)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Filtered scope sends nothing... ");
+    sent_msgs.clear();
+    min_logger_set_level(MIN_LOGGER_DEBUG);
+    TimedScope(100);
+    CScope();
+    min_logger_set_level(MIN_LOGGER_INFO);
+    if (!sent_msgs.empty()) {
+        printf("FAIL: Expected no messages, got %zu\n", sent_msgs.size());
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
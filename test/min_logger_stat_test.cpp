@@ -0,0 +1,178 @@
+#include <min_logger/min_logger.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr MinLoggerCRC STAT_ID = 0x12345678;
+static constexpr MinLoggerCRC HISTOGRAM_ID = 0x12345679;
+static constexpr MinLoggerCRC IDLE_ID = 0x1234567A;
+static constexpr MinLoggerCRC WIDE_HISTOGRAM_ID = 0x1234567B;
+
+#pragma pack(1)
+struct StatPayload {
+    uint32_t count;
+    double min;
+    double max;
+    double sum;
+    double sum_sq;
+};
+
+struct StatHistogramPayload {
+    StatPayload stat;
+    double histogram_min;
+    double histogram_max;
+    uint32_t buckets[MIN_LOGGER_STAT_BUCKETS];
+};
+#pragma pack()
+
+struct SentMsg {
+    MinLoggerCRC msg_id;
+    uint8_t payload_len;
+    StatHistogramPayload payload;
+};
+
+static std::vector<SentMsg> sent_msgs;
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    SentMsg sent = {};
+    memcpy(&sent.msg_id, msg + 4, sizeof(sent.msg_id));
+    // Skip the thread name message.
+    if (len_bytes < 16 || sent.msg_id == 0xFFFFFF00) {
+        return;
+    }
+    sent.payload_len = msg[2];
+    memcpy(&sent.payload, msg + 16, sent.payload_len);
+    sent_msgs.push_back(sent);
+}
+
+static void RecordStat(uint32_t value) {
+    MIN_LOGGER_RECORD_STAT_ID(STAT_ID, MIN_LOGGER_INFO, "stat", uint32_t, value);
+}
+
+static void RecordHistogram(double value) {
+    MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID(HISTOGRAM_ID, MIN_LOGGER_INFO, "histogram", double, value,
+                                        0.0, 8.0);
+}
+
+// A range wide enough that values just below the max round up to the end of the last bucket.
+static void RecordWideHistogram(double value) {
+    MIN_LOGGER_RECORD_STAT_HISTOGRAM_ID(WIDE_HISTOGRAM_ID, MIN_LOGGER_INFO, "wide_histogram",
+                                        double, value, -1.0, 1e16);
+}
+
+static void RecordIdle(uint32_t value) {
+    MIN_LOGGER_RECORD_STAT_ID(IDLE_ID, MIN_LOGGER_INFO, "idle", uint32_t, value);
+}
+
+static bool CheckStat(const StatPayload& stat, uint32_t count, double min, double max, double sum,
+                      double sum_sq) {
+    if (stat.count != count || stat.min != min || stat.max != max || stat.sum != sum ||
+        stat.sum_sq != sum_sq) {
+        printf("FAIL: Expected count %u min %g max %g sum %g sum_sq %g, got %u %g %g %g %g\n",
+               count, min, max, sum, sum_sq, stat.count, stat.min, stat.max, stat.sum,
+               stat.sum_sq);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Stat Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Values are only sent on flush... ");
+    RecordIdle(1);
+    min_logger_flush_stats();
+    sent_msgs.clear();
+    RecordStat(4);
+    RecordStat(2);
+    RecordStat(6);
+    if (!sent_msgs.empty()) {
+        printf("FAIL: Expected no messages before the flush, got %zu\n", sent_msgs.size());
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Flush sends one summary per call site with data... ");
+    min_logger_flush_stats();
+    if (sent_msgs.size() != 1 || sent_msgs[0].msg_id != STAT_ID ||
+        sent_msgs[0].payload_len != sizeof(StatPayload)) {
+        printf("FAIL: Expected one stat message, got %zu\n", sent_msgs.size());
+        return 1;
+    }
+    if (!CheckStat(sent_msgs[0].payload.stat, 3, 2, 6, 12, 56)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Flush resets the call site... ");
+    sent_msgs.clear();
+    min_logger_flush_stats();
+    if (!sent_msgs.empty()) {
+        printf("FAIL: Expected no messages, got %zu\n", sent_msgs.size());
+        return 1;
+    }
+    RecordStat(10);
+    min_logger_flush_stats();
+    if (sent_msgs.size() != 1 || !CheckStat(sent_msgs[0].payload.stat, 1, 10, 10, 10, 100)) {
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Histogram counts values into buckets... ");
+    sent_msgs.clear();
+    RecordHistogram(-5.0);
+    RecordHistogram(0.5);
+    RecordHistogram(3.0);
+    RecordHistogram(3.5);
+    RecordHistogram(8.0);
+    RecordHistogram(100.0);
+    min_logger_flush_stats();
+    if (sent_msgs.size() != 1 || sent_msgs[0].msg_id != HISTOGRAM_ID ||
+        sent_msgs[0].payload_len != sizeof(StatHistogramPayload)) {
+        printf("FAIL: Expected one histogram message, got %zu\n", sent_msgs.size());
+        return 1;
+    }
+    const StatHistogramPayload& histogram = sent_msgs[0].payload;
+    const uint32_t expected_buckets[MIN_LOGGER_STAT_BUCKETS] = {2, 0, 0, 2, 0, 0, 0, 2};
+    if (histogram.histogram_min != 0.0 || histogram.histogram_max != 8.0 ||
+        memcmp(histogram.buckets, expected_buckets, sizeof(expected_buckets)) != 0) {
+        printf("FAIL: Wrong histogram range or buckets\n");
+        return 1;
+    }
+    if (histogram.stat.count != 6 || histogram.stat.min != -5.0 || histogram.stat.max != 100.0) {
+        printf("FAIL: Wrong histogram stats\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Values just below the histogram max go in the last bucket... ");
+    sent_msgs.clear();
+    RecordWideHistogram(std::nextafter(1e16, 0.0));
+    min_logger_flush_stats();
+    const uint32_t last_bucket[MIN_LOGGER_STAT_BUCKETS] = {0, 0, 0, 0, 0, 0, 0, 1};
+    if (sent_msgs.size() != 1 || sent_msgs[0].msg_id != WIDE_HISTOGRAM_ID ||
+        memcmp(sent_msgs[0].payload.buckets, last_bucket, sizeof(last_bucket)) != 0) {
+        printf("FAIL: Expected the value in the last bucket\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Filtered values aren't recorded... ");
+    sent_msgs.clear();
+    min_logger_set_level(MIN_LOGGER_DEBUG);
+    RecordStat(1);
+    RecordHistogram(1.0);
+    min_logger_set_level(MIN_LOGGER_INFO);
+    min_logger_flush_stats();
+    if (!sent_msgs.empty()) {
+        printf("FAIL: Expected no messages, got %zu\n", sent_msgs.size());
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}
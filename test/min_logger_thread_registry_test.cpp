@@ -0,0 +1,150 @@
+#include <min_logger/min_logger.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr MinLoggerCRC TEST_ID = 0x12345678;
+static constexpr MinLoggerCRC WORKER_ID = 0x12345679;
+static constexpr MinLoggerCRC THREAD_REGISTRY_ID = 0xFFFFFF06;
+static constexpr size_t BINARY_HEADER_SIZE = 16;
+// More than the micro format's 4 bit thread ID can hold.
+static constexpr size_t NUM_WORKERS = 20;
+
+typedef std::vector<uint8_t> Msg;
+
+static std::mutex msgs_mutex;
+static std::vector<Msg> sent_msgs;
+static std::atomic<unsigned> name_lookups = {0};
+static thread_local std::string test_thread_name = "main";
+
+extern "C" void min_logger_write(const uint8_t* msg, size_t len_bytes) {
+    std::lock_guard<std::mutex> lock(msgs_mutex);
+    sent_msgs.emplace_back(msg, msg + len_bytes);
+}
+
+extern "C" size_t min_logger_get_thread_name(char* thread_name, size_t max_len) {
+    name_lookups++;
+    strncpy(thread_name, test_thread_name.c_str(), max_len);
+    thread_name[max_len - 1] = 0;
+    return strlen(thread_name);
+}
+
+// Record worker, so the test can tell which thread index it was given.
+static void LogFromThread(const std::string& name, uint32_t worker) {
+    test_thread_name = name;
+    MIN_LOGGER_RECORD_VALUE_ID(WORKER_ID, MIN_LOGGER_INFO, "worker", uint32_t, worker);
+}
+
+static MinLoggerCRC BinaryId(const Msg& msg) {
+    MinLoggerCRC msg_id = 0;
+    if (msg.size() >= BINARY_HEADER_SIZE) {
+        memcpy(&msg_id, msg.data() + 4, sizeof(msg_id));
+    }
+    return msg_id;
+}
+
+// Check msg is a registry record naming thread_idx.
+static bool CheckRegistry(const Msg& msg, size_t thread_idx, const std::string& name) {
+    if (BinaryId(msg) != THREAD_REGISTRY_ID || msg.size() != BINARY_HEADER_SIZE + 1 + name.size() ||
+        msg[BINARY_HEADER_SIZE] != thread_idx ||
+        std::string(msg.begin() + BINARY_HEADER_SIZE + 1, msg.end()) != name) {
+        printf("FAIL: Wrong name for thread %zu\n", thread_idx);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("\n=== Thread Registry Tests ===\n\n");
+    min_logger_set_serialize_format(MIN_LOGGER_DEFAULT_BINARY_SERIALIZED_FORMAT);
+    min_logger_set_level(MIN_LOGGER_INFO);
+
+    printf("Test: Names are looked up once per thread... ");
+    for (int i = 0; i < 3; i++) {
+        MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < NUM_WORKERS; i++) {
+        workers.emplace_back(LogFromThread, "worker" + std::to_string(i), i);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (name_lookups != 1 + NUM_WORKERS || sent_msgs.size() != 3 + NUM_WORKERS) {
+        printf("FAIL: %u lookups for %zu messages\n", name_lookups.load(), sent_msgs.size());
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Registered names are written in bulk... ");
+    // The workers can log in any order, so name each index after the worker that sent it.
+    std::vector<std::string> names(1 + NUM_WORKERS);
+    names[0] = "main";
+    for (size_t i = 0; i < NUM_WORKERS; i++) {
+        const Msg& msg = sent_msgs[3 + i];
+        uint32_t worker = 0;
+        if (BinaryId(msg) != WORKER_ID || msg.size() != BINARY_HEADER_SIZE + sizeof(worker) ||
+            msg[3] >= names.size()) {
+            printf("FAIL: Wrong worker message\n");
+            return 1;
+        }
+        memcpy(&worker, msg.data() + BINARY_HEADER_SIZE, sizeof(worker));
+        names[msg[3]] = "worker" + std::to_string(worker);
+    }
+    sent_msgs.clear();
+    min_logger_write_thread_names();
+    if (sent_msgs.size() != names.size() || name_lookups != names.size()) {
+        printf("FAIL: Expected %zu names, got %zu\n", names.size(), sent_msgs.size());
+        return 1;
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        // Sent from the main thread on the workers' behalf.
+        if (sent_msgs[i][3] != 0 || !CheckRegistry(sent_msgs[i], i, names[i])) {
+            return 1;
+        }
+    }
+    printf("PASS\n");
+
+    printf("Test: Later threads send their name with their first message... ");
+    sent_msgs.clear();
+    std::thread(LogFromThread, "late", 0).join();
+    const size_t late_idx = names.size();
+    if (sent_msgs.size() != 2 || sent_msgs[0][3] != late_idx ||
+        !CheckRegistry(sent_msgs[0], late_idx, "late") || BinaryId(sent_msgs[1]) != WORKER_ID) {
+        printf("FAIL: Expected the name, then the message\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    printf("Test: Micro thread IDs past 15 are escaped... ");
+    min_logger_set_serialize_format(MIN_LOGGER_MICRO_BINARY_SERIALIZED_FORMAT);
+    sent_msgs.clear();
+    std::thread([] {
+        // Skip the sync marker before the first micro message.
+        MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+        {
+            std::lock_guard<std::mutex> lock(msgs_mutex);
+            sent_msgs.clear();
+        }
+        MIN_LOGGER_LOG_ID(TEST_ID, MIN_LOGGER_INFO, "test");
+    }).join();
+    if (sent_msgs.size() != 1 || sent_msgs[0].size() != 5) {
+        printf("FAIL: Expected a single 5 byte message\n");
+        return 1;
+    }
+    uint16_t truncated_id = 0;
+    memcpy(&truncated_id, sent_msgs[0].data(), sizeof(truncated_id));
+    if (truncated_id != (TEST_ID & 0xFFFF) || (sent_msgs[0][2] & 0xF) != 0xF ||
+        sent_msgs[0][4] != late_idx + 1) {
+        printf("FAIL: Expected a 5 byte header with the thread ID\n");
+        return 1;
+    }
+    printf("PASS\n");
+
+    return 0;
+}